@@ -0,0 +1,59 @@
+#include <cstdio>
+#include <cstdlib>
+
+#include "HalideBuffer.h"
+#include "halide_benchmark.h"
+
+#include "benchmark_c.h"
+#include "benchmark_c_openmp.h"
+#include "benchmark_native.h"
+
+using namespace Halide::Runtime;
+using namespace Halide::Tools;
+
+// Compare the C backend's output for a vectorized, parallel blur
+// against the LLVM backend's, both when parallel loops run on the
+// Halide thread pool and when they are emitted as OpenMP pragmas.
+int main(int argc, char **argv) {
+    const int width = 4096, height = 2048;
+
+    Buffer<uint16_t, 2> input(width + 2, height + 2);
+    for (int y = 0; y < input.height(); y++) {
+        for (int x = 0; x < input.width(); x++) {
+            input(x, y) = (uint16_t)(rand() & 0xfff);
+        }
+    }
+
+    Buffer<uint16_t, 2> out_native(width, height);
+    Buffer<uint16_t, 2> out_c(width, height);
+    Buffer<uint16_t, 2> out_c_openmp(width, height);
+
+    const int samples = 10, iterations = 5;
+    double t_native = benchmark(samples, iterations, [&]() {
+        benchmark_native(input, out_native);
+    });
+    double t_c = benchmark(samples, iterations, [&]() {
+        benchmark_c(input, out_c);
+    });
+    double t_c_openmp = benchmark(samples, iterations, [&]() {
+        benchmark_c_openmp(input, out_c_openmp);
+    });
+
+    for (int y = 0; y < height; y++) {
+        for (int x = 0; x < width; x++) {
+            if (out_c(x, y) != out_native(x, y) ||
+                out_c_openmp(x, y) != out_native(x, y)) {
+                printf("out_native(%d, %d) = %d, but out_c = %d and out_c_openmp = %d\n",
+                       x, y, out_native(x, y), out_c(x, y), out_c_openmp(x, y));
+                return 1;
+            }
+        }
+    }
+
+    printf("LLVM backend:                 %f ms\n", t_native * 1e3);
+    printf("C backend, Halide threads:    %f ms\n", t_c * 1e3);
+    printf("C backend, OpenMP:            %f ms\n", t_c_openmp * 1e3);
+
+    printf("Success!\n");
+    return 0;
+}
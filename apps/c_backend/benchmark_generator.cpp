@@ -0,0 +1,31 @@
+#include "Halide.h"
+
+namespace {
+
+// A separable 3x3 box blur, scheduled the way the blur app is: tiled,
+// vectorized and parallel. Compiled with both the LLVM backend and the
+// C backend so that their output can be compared.
+class Benchmark : public Halide::Generator<Benchmark> {
+public:
+    Input<Buffer<uint16_t, 2>> input{"input"};
+    Output<Buffer<uint16_t, 2>> output{"output"};
+
+    void generate() {
+        Var x("x"), y("y"), xi("xi"), yi("yi");
+
+        Func blur_x("blur_x");
+        blur_x(x, y) = (input(x, y) + input(x + 1, y) + input(x + 2, y)) / 3;
+        output(x, y) = (blur_x(x, y) + blur_x(x, y + 1) + blur_x(x, y + 2)) / 3;
+
+        const int vec = natural_vector_size<uint16_t>();
+        output.tile(x, y, xi, yi, 256, 32)
+            .vectorize(xi, vec)
+            .parallel(y);
+        blur_x.compute_at(output, x)
+            .vectorize(x, vec);
+    }
+};
+
+}  // namespace
+
+HALIDE_REGISTER_GENERATOR(Benchmark, benchmark)
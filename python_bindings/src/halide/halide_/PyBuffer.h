@@ -20,7 +20,13 @@ Halide::Runtime::Buffer<T, Dims, InClassDimStorage> pybufferinfo_to_halidebuffer
     halide_dimension_t *dims = (halide_dimension_t *)alloca(info.ndim * sizeof(halide_dimension_t));
     _halide_user_assert(dims);
     for (int i = 0; i < info.ndim; i++) {
-        if (INT_MAX < info.shape[i] || INT_MAX < (info.strides[i] / t.bytes())) {
+        // The buffer is always wrapped in place, whatever its strides (negative,
+        // Fortran-ordered, or a non-contiguous view), so reject strides that
+        // can't be expressed in elements rather than silently misreading them.
+        if (info.strides[i] % t.bytes() != 0) {
+            throw py::value_error("Buffer strides must be a multiple of the element size.");
+        }
+        if (INT_MAX < info.shape[i] || INT_MAX < (info.strides[i] / t.bytes()) || INT_MIN > (info.strides[i] / t.bytes())) {
             throw py::value_error("Out of range dimensions in buffer conversion.");
         }
         // Halide's default indexing convention is col-major (the most rapidly varying index comes first);
@@ -192,6 +192,11 @@ public:
                 << "Expected exactly " << (argc - 1) << " positional arguments, but saw " << args.size() << ".";
         }
 
+        // Everything from here on only touches the halide_buffer_t wrappers
+        // (which alias the Python buffers' memory, and are kept alive by
+        // args/kwargs), so let other Python threads run while we execute.
+        py::gil_scoped_release release;
+
         int result = c.call_argv_checked(argc, argv, cci);
         _halide_user_assert(result == 0) << "Halide Runtime Error: " << result;
 
@@ -222,7 +227,9 @@ void define_callable(py::module &m) {
 
     auto callable_class =
         py::class_<Callable>(m, "Callable")
-            .def("__call__", PyCallable::call_impl);
+            .def("__call__", PyCallable::call_impl)
+            .def("specialize_on_shapes", &Callable::specialize_on_shapes,
+                 py::arg("calls_before_specializing") = 4, py::arg("max_variants") = 4);
 }
 
 }  // namespace PythonBindings
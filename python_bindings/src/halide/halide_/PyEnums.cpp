@@ -189,6 +189,12 @@ void define_enums(py::module &m) {
         .value("VulkanV12", Target::VulkanV12)
         .value("VulkanV13", Target::VulkanV13)
         .value("Semihosting", Target::Feature::Semihosting)
+        .value("NoLoopCarry", Target::Feature::NoLoopCarry)
+        .value("AutoPrefetch", Target::Feature::AutoPrefetch)
+        .value("TieredJIT", Target::Feature::TieredJIT)
+        .value("COpenMP", Target::Feature::COpenMP)
+        .value("CoalesceAllocations", Target::Feature::CoalesceAllocations)
+        .value("LUTShuffles", Target::Feature::LUTShuffles)
         .value("FeatureEnd", Target::Feature::FeatureEnd);
 
     py::enum_<halide_type_code_t>(m, "TypeCode")
@@ -219,6 +219,7 @@ void define_func(py::module &m) {
             .def("store_root", &Func::store_root)
 
             .def("store_in", &Func::store_in, py::arg("memory_type"))
+            .def("store_nontemporal", &Func::store_nontemporal)
 
             .def(
                 "compile_to", [](Func &f, const std::map<OutputFileType, std::string> &output_files, const std::vector<Argument> &args, const std::string &fn_name, const Target &target) {
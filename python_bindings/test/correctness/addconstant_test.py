@@ -31,7 +31,8 @@ def test(addconstant_impl_func, offset):
     scalar_float = 3.14159
     scalar_double = 1.61803
 
-    input_u8 = numpy.array([0, 1, 2], dtype=numpy.uint8)
+    # A non-contiguous view, which is passed to Halide without a copy.
+    input_u8 = numpy.array([0, 99, 1, 99, 2, 99], dtype=numpy.uint8)[::2]
     input_u16 = numpy.array([0, 256, 512], dtype=numpy.uint16)
     input_u32 = numpy.array([0, 65536, 131072], dtype=numpy.uint32)
     input_u64 = numpy.array([0, 4294967296, 8589934592], dtype=numpy.uint64)
@@ -43,9 +44,10 @@ def test(addconstant_impl_func, offset):
     input_double = numpy.array([3.14, 2.718, 1.618], dtype=numpy.float64)
     input_half = numpy.array([3.14, 2.718, 1.618], dtype=numpy.float16)
     input_2d = numpy.array([[1, 2, 3], [4, 5, 6]], dtype=numpy.int8, order="F")
-    input_3d = numpy.array([[[1, 2], [3, 4]], [[5, 6], [7, 8]]], dtype=numpy.int8)
+    # Neither C nor Fortran contiguous
+    input_3d = numpy.array([[[1, 2], [3, 4]], [[5, 6], [7, 8]]], dtype=numpy.int8).transpose(1, 0, 2)
 
-    output_u8 = numpy.zeros((3,), dtype=numpy.uint8)
+    output_u8 = numpy.zeros((6,), dtype=numpy.uint8)[::-2]
     output_u16 = numpy.zeros((3,), dtype=numpy.uint16)
     output_u32 = numpy.zeros((3,), dtype=numpy.uint32)
     output_u64 = numpy.zeros((3,), dtype=numpy.uint64)
@@ -259,6 +259,40 @@ def test_interleaved_ndarray():
     assert b.dim(2).stride() == c
 
 
+def test_strided_ndarray():
+    # Fortran-ordered arrays, non-contiguous views and negative strides
+    # are all wrapped in place, never copied.
+    a = np.zeros((5, 7), dtype=np.int16, order="F")
+    b = hl.Buffer(a)
+    assert b.dim(0).extent() == 7
+    assert b.dim(0).stride() == 5
+    assert b.dim(1).extent() == 5
+    assert b.dim(1).stride() == 1
+    b[3, 4] = 42
+    assert a[4, 3] == 42
+
+    a = np.zeros((6, 8), dtype=np.float32)
+    view = a[1:5, ::-2]
+    b = hl.Buffer(view)
+    assert b.dim(0).extent() == 4
+    assert b.dim(0).stride() == -2
+    assert b.dim(1).extent() == 4
+    assert b.dim(1).stride() == 8
+    b[0, 0] = 3.0
+    b[3, 2] = 5.0
+    assert a[1, 7] == 3.0
+    assert a[3, 1] == 5.0
+
+    # Strides that aren't a whole number of elements can't be wrapped.
+    s = np.zeros(4, dtype=[("a", np.int16), ("b", np.int8)])
+    try:
+        hl.Buffer(s["a"])
+    except ValueError as e:
+        assert "multiple of the element size" in str(e)
+    else:
+        assert False, "Did not see expected exception!"
+
+
 def test_reorder():
     W = 7
     H = 5
@@ -385,6 +419,7 @@ def test_oob():
 if __name__ == "__main__":
     test_make_interleaved()
     test_interleaved_ndarray()
+    test_strided_ndarray()
     test_ndarray_to_buffer(reverse_axes=True)
     test_ndarray_to_buffer(reverse_axes=False)
     test_buffer_to_ndarray(reverse_axes=True)
@@ -1,5 +1,6 @@
 import halide as hl
 import numpy as np
+import threading
 
 from simplepy_generator import SimplePy
 import simplecpp_pystub  # Needed for create_callable_from_generator("simplecpp") to work
@@ -171,6 +172,65 @@ def test_simple(callable_factory):
         assert False, "Did not see expected exception!"
 
 
+def test_ndarray_args():
+    x, y = hl.Var(), hl.Var()
+    p_img = hl.ImageParam(hl.Int(32), 2)
+    f = hl.Func("f")
+    f[x, y] = p_img[x, y] * 2 + x + y * 100
+
+    c = f.compile_to_callable([p_img])
+
+    def _expected(a):
+        # numpy indexing is [y, x] for the default (reversed) axes
+        ys, xs = np.indices(a.shape)
+        return a * 2 + xs + ys * 100
+
+    base = np.arange(12 * 16, dtype=np.int32).reshape(12, 16)
+    inputs = [
+        base,
+        np.asfortranarray(base),
+        base[2:10, 1:15:3],
+        base[::-1, ::2],
+    ]
+    for a in inputs:
+        # Outputs are written in place, whatever their layout.
+        outputs = [
+            np.zeros(a.shape, dtype=np.int32),
+            np.zeros(a.shape, dtype=np.int32, order="F"),
+            np.zeros((a.shape[0] * 2, a.shape[1] * 3), dtype=np.int32)[::2, ::3],
+        ]
+        for out in outputs:
+            c(a, out)
+            assert np.array_equal(out, _expected(a))
+
+
+def test_threads():
+    # The Callable runs without holding the GIL, so it must be safe to
+    # call it from several Python threads at once.
+    x = hl.Var()
+    p_img = hl.ImageParam(hl.Float(32), 1)
+    f = hl.Func("f")
+    f[x] = hl.sqrt(p_img[x]) + 1.0
+    c = f.compile_to_callable([p_img])
+
+    def _run(seed, results):
+        a = np.full((10000,), float(seed * seed), dtype=np.float32)
+        out = np.zeros_like(a)
+        for _ in range(20):
+            c(a, out)
+        results[seed] = out
+
+    results = {}
+    threads = [threading.Thread(target=_run, args=(i, results)) for i in range(8)]
+    for t in threads:
+        t.start()
+    for t in threads:
+        t.join()
+
+    for i in range(8):
+        assert np.all(results[i] == i + 1.0)
+
+
 if __name__ == "__main__":
     # test_callable()
 
@@ -184,3 +244,5 @@ if __name__ == "__main__":
 
     test_simple(via_simplecpp_pystub)
     test_simple(via_simplepy)
+    test_ndarray_args()
+    test_threads()
@@ -23,6 +23,7 @@
 #include "Solve.h"
 #include "Util.h"
 #include "Var.h"
+#include "WorkBudget.h"
 
 #ifndef DO_TRACK_BOUNDS_INTERVALS
 #define DO_TRACK_BOUNDS_INTERVALS 0
@@ -122,6 +123,10 @@ public:
     // and lower bounds. If the bound is not constant, it is set to
     // unbounded.
     bool const_bound;
+    // Bounds the work done on one Expr. Once it runs out, the
+    // remaining Selects, Lets, Mins and Maxes are given the bounds of
+    // their type instead of being analyzed.
+    WorkBudget budget{"bounds"};
 
     Bounds(const Scope<Interval> *s, const FuncValueBounds &fb, bool const_bound)
         : func_bounds(fb), const_bound(const_bound) {
@@ -222,6 +227,16 @@ private:
         }
     }
 
+    // If the work budget has run out, set the interval to the bounds
+    // of the type of e and return true.
+    bool out_of_budget(const Expr &e) {
+        if (budget.spend(e)) {
+            return false;
+        }
+        bounds_of_type(e.type());
+        return true;
+    }
+
     using IRVisitor::visit;
 
     void visit(const IntImm *op) override {
@@ -741,6 +756,9 @@ private:
 
     void visit(const Min *op) override {
         TRACK_BOUNDS_INTERVAL;
+        if (out_of_budget(op)) {
+            return;
+        }
         op->a.accept(this);
         Interval a = interval;
 
@@ -759,6 +777,9 @@ private:
 
     void visit(const Max *op) override {
         TRACK_BOUNDS_INTERVAL;
+        if (out_of_budget(op)) {
+            return;
+        }
         op->a.accept(this);
         Interval a = interval;
 
@@ -997,6 +1018,9 @@ private:
 
     void visit(const Select *op) override {
         TRACK_BOUNDS_INTERVAL;
+        if (out_of_budget(op)) {
+            return;
+        }
         op->true_value.accept(this);
         Interval a = interval;
 
@@ -1536,6 +1560,9 @@ private:
 
     void visit(const Let *op) override {
         TRACK_BOUNDS_INTERVAL;
+        if (out_of_budget(op)) {
+            return;
+        }
         op->value.accept(this);
         Interval val = interval;
 
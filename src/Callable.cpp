@@ -1,4 +1,7 @@
+#include <algorithm>
 #include <map>
+#include <memory>
+#include <mutex>
 
 #include "Argument.h"
 #include "Callable.h"
@@ -9,6 +12,135 @@ using namespace Halide::Internal;
 
 namespace Halide {
 
+namespace {
+
+// The calls made to a Callable since specialize_on_shapes(), and the
+// variants compiled for the most frequent shapes.
+struct ShapeSpecializations {
+    int calls_before_specializing = 0;
+    size_t max_variants = 0;
+
+    struct Variant {
+        // The min, extent, and stride of each dimension of each buffer
+        // argument in turn.
+        std::vector<int32_t> shape;
+        std::shared_ptr<JITCache> jit_cache;
+        uint64_t last_used = 0;
+    };
+
+    std::mutex mutex;
+    std::vector<Variant> variants;
+    // The number of calls seen with each shape that has no variant yet,
+    // or -1 if its variant is being compiled.
+    std::map<std::vector<int32_t>, int> call_counts;
+    uint64_t clock = 0;
+    Callable::ShapeSpecializationStats stats;
+};
+
+// Call fn on every dimension of every buffer argument in argv. Returns
+// false if any buffer is missing, is a bounds query, or has the wrong
+// dimensionality, in which case the call is never specialized.
+template<typename Fn>
+bool for_each_buffer_dim(const std::vector<Argument> &args, const void *const *argv, Fn &&fn) {
+    for (size_t i = 0; i < args.size(); i++) {
+        if (args[i].is_scalar()) {
+            continue;
+        }
+        const halide_buffer_t *buf = (const halide_buffer_t *)argv[i];
+        if (buf == nullptr ||
+            (buf->host == nullptr && buf->device == 0) ||
+            buf->dimensions != args[i].dimensions) {
+            return false;
+        }
+        for (int d = 0; d < buf->dimensions; d++) {
+            fn(buf->dim[d]);
+        }
+    }
+    return true;
+}
+
+bool matches_shape(const std::vector<int32_t> &shape, const std::vector<Argument> &args, const void *const *argv) {
+    size_t i = 0;
+    bool same = true;
+    bool ok = for_each_buffer_dim(args, argv, [&](const halide_dimension_t &dim) {
+        same = same &&
+               i + 3 <= shape.size() &&
+               shape[i] == dim.min &&
+               shape[i + 1] == dim.extent &&
+               shape[i + 2] == dim.stride;
+        i += 3;
+    });
+    return ok && same && i == shape.size();
+}
+
+// Find the variant to use for a call, compiling it first if this call
+// makes its shape hot. Returns nullptr if the generic code should be
+// used.
+template<typename CompileFn>
+std::shared_ptr<JITCache> select_variant(ShapeSpecializations &s,
+                                         const CompileFn &compile_specialized,
+                                         const std::vector<Argument> &args,
+                                         const void *const *argv) {
+    std::unique_lock<std::mutex> lock(s.mutex);
+    s.clock++;
+    for (auto &v : s.variants) {
+        if (matches_shape(v.shape, args, argv)) {
+            v.last_used = s.clock;
+            s.stats.specialized_calls++;
+            return v.jit_cache;
+        }
+    }
+
+    std::vector<int32_t> shape;
+    if (!for_each_buffer_dim(args, argv, [&](const halide_dimension_t &dim) {
+            shape.push_back(dim.min);
+            shape.push_back(dim.extent);
+            shape.push_back(dim.stride);
+        })) {
+        return nullptr;
+    }
+
+    // Don't let a stream of distinct shapes grow the counts forever.
+    constexpr size_t max_counted_shapes = 64;
+    if (s.call_counts.size() >= max_counted_shapes && !s.call_counts.count(shape)) {
+        s.call_counts.clear();
+    }
+    int &count = s.call_counts[shape];
+    if (count < 0 || ++count < s.calls_before_specializing) {
+        return nullptr;
+    }
+    count = -1;
+
+    // Compile without holding the lock, so that other calls can keep
+    // running the generic code in the meantime.
+    lock.unlock();
+    std::shared_ptr<JITCache> jit_cache;
+#ifdef HALIDE_WITH_EXCEPTIONS
+    try {
+#endif
+        jit_cache = std::make_shared<JITCache>(compile_specialized(argv));
+#ifdef HALIDE_WITH_EXCEPTIONS
+    } catch (Halide::Error &err) {
+        debug(1) << "Failed to compile a shape-specialized variant: " << err.what() << "\n";
+        return nullptr;
+    }
+#endif
+    lock.lock();
+
+    s.call_counts.erase(shape);
+    if (s.variants.size() >= s.max_variants) {
+        auto lru = std::min_element(s.variants.begin(), s.variants.end(),
+                                    [](const auto &a, const auto &b) { return a.last_used < b.last_used; });
+        s.variants.erase(lru);
+    }
+    s.variants.push_back({std::move(shape), jit_cache, s.clock});
+    s.stats.variants_compiled++;
+    s.stats.specialized_calls++;
+    return jit_cache;
+}
+
+}  // namespace
+
 struct CallableContents {
     mutable RefCount ref_count;
 
@@ -32,6 +164,12 @@ struct CallableContents {
     // Encoded values for complete runtime type checking, used
     // only for make_std_function. Lazily created.
     std::vector<Callable::FullCallCheckInfo> full_call_check_info;
+
+    // Compiles variants for specialize_on_shapes().
+    Callable::CompileSpecializedFn compile_specialized;
+
+    // Only set on Callables returned by specialize_on_shapes().
+    std::shared_ptr<ShapeSpecializations> shape_specializations;
 };
 
 namespace Internal {
@@ -57,12 +195,14 @@ bool Callable::defined() const {
 Callable::Callable(const std::string &name,
                    const JITHandlers &jit_handlers,
                    const std::map<std::string, JITExtern> &jit_externs,
-                   JITCache &&jit_cache)
+                   JITCache &&jit_cache,
+                   CompileSpecializedFn compile_specialized)
     : contents(new CallableContents) {
     contents->name = name;
     contents->jit_cache = std::move(jit_cache);
     contents->saved_jit_handlers = jit_handlers;
     contents->saved_jit_externs = jit_externs;
+    contents->compile_specialized = std::move(compile_specialized);
 
     contents->quick_call_check_info.reserve(contents->jit_cache.arguments.size());
     for (const Argument &a : contents->jit_cache.arguments) {
@@ -75,6 +215,37 @@ Callable::Callable(const std::string &name,
     // Don't create full_call_check_info yet.
 }
 
+Callable Callable::specialize_on_shapes(int calls_before_specializing, int max_variants) const {
+    user_assert(defined()) << "Cannot specialize a default-constructed Callable.";
+    user_assert(contents->compile_specialized) << "Callable '" << contents->name << "' cannot be specialized.";
+    user_assert(calls_before_specializing > 0 && max_variants > 0)
+        << "specialize_on_shapes() requires a positive number of calls and of variants.";
+
+    Callable result;
+    result.contents = new CallableContents;
+    result.contents->name = contents->name;
+    result.contents->jit_cache = contents->jit_cache;
+    result.contents->saved_jit_handlers = contents->saved_jit_handlers;
+    result.contents->saved_jit_externs = contents->saved_jit_externs;
+    result.contents->quick_call_check_info = contents->quick_call_check_info;
+    result.contents->compile_specialized = contents->compile_specialized;
+
+    auto s = std::make_shared<ShapeSpecializations>();
+    s->calls_before_specializing = calls_before_specializing;
+    s->max_variants = (size_t)max_variants;
+    result.contents->shape_specializations = std::move(s);
+    return result;
+}
+
+Callable::ShapeSpecializationStats Callable::shape_specialization_stats() const {
+    user_assert(defined()) << "Cannot get the stats of a default-constructed Callable.";
+    if (!contents->shape_specializations) {
+        return {};
+    }
+    std::lock_guard<std::mutex> lock(contents->shape_specializations->mutex);
+    return contents->shape_specializations->stats;
+}
+
 const std::vector<Argument> &Callable::arguments() const {
     return contents->jit_cache.arguments;
 }
@@ -192,10 +363,20 @@ Callable::FailureFn Callable::check_fcci(size_t argc, const FullCallCheckInfo *a
 
     JITFuncCallContext jit_call_context(context, contents->saved_jit_handlers);
 
-    int exit_status = contents->jit_cache.call_jit_code(contents->jit_cache.jit_target, argv);
+    JITCache *jit_cache = &contents->jit_cache;
+    std::shared_ptr<JITCache> variant;
+    if (contents->shape_specializations) {
+        variant = select_variant(*contents->shape_specializations, contents->compile_specialized,
+                                 contents->jit_cache.arguments, argv);
+        if (variant) {
+            jit_cache = variant.get();
+        }
+    }
+
+    int exit_status = jit_cache->call_jit_code(jit_cache->jit_target, argv);
 
     // If we're profiling, report runtimes and reset profiler stats.
-    contents->jit_cache.finish_profiling(context);
+    jit_cache->finish_profiling(context);
 
     jit_call_context.finalize(exit_status);
 
@@ -7,6 +7,7 @@
  */
 
 #include <array>
+#include <functional>
 #include <map>
 
 #include "Buffer.h"
@@ -273,10 +274,15 @@ private:
         }
     };
 
+    // Compiles a variant of the Callable in which the shapes of all the
+    // buffer arguments are those of the buffers in the given argv.
+    using CompileSpecializedFn = std::function<Internal::JITCache(const void *const *argv)>;
+
     Callable(const std::string &name,
              const JITHandlers &jit_handlers,
              const std::map<std::string, JITExtern> &jit_externs,
-             Internal::JITCache &&jit_cache);
+             Internal::JITCache &&jit_cache,
+             CompileSpecializedFn compile_specialized = nullptr);
 
     // Note that the first entry in argv must always be a JITUserContext*.
     int call_argv_checked(size_t argc, const void *const *argv, const QuickCallCheckInfo *actual_cci) const;
@@ -309,6 +315,27 @@ public:
     /** Return true if the Callable is well-defined and usable, false if it is a default-constructed empty Callable. */
     bool defined() const;
 
+    /** Return a Callable that runs the same code as this one, but that
+     * also compiles variants of it specialized to the exact shapes (the
+     * min, extent, and stride of every dimension) of its buffer
+     * arguments. Once calls_before_specializing calls have been made with
+     * the same shapes, a variant in which those shapes are constants is
+     * compiled, and it is used for every later call with those shapes.
+     * At most max_variants are kept; the least recently used one is
+     * dropped to make room for a new one. Calls with any other shapes
+     * run the original code. */
+    Callable specialize_on_shapes(int calls_before_specializing = 4, int max_variants = 4) const;
+
+    /** What a Callable returned by specialize_on_shapes() has done so far:
+     * how many variants it has compiled (including ones since evicted),
+     * and how many calls ran one of them rather than the original code.
+     * Both are zero for any other Callable. */
+    struct ShapeSpecializationStats {
+        int variants_compiled = 0;
+        int specialized_calls = 0;
+    };
+    ShapeSpecializationStats shape_specialization_stats() const;
+
     template<typename... Args>
     HALIDE_FUNCTION_ATTRS int
     operator()(JITUserContext *context, Args &&...args) const {
@@ -0,0 +1,531 @@
+#include <algorithm>
+#include <map>
+#include <set>
+#include <utility>
+
+#include "CSE.h"
+#include "CoalesceAllocations.h"
+#include "CodeGen_Internal.h"
+#include "CompilerLogger.h"
+#include "ExprUsesVar.h"
+#include "IRMutator.h"
+#include "IROperator.h"
+#include "IRVisitor.h"
+#include "Simplify.h"
+#include "Target.h"
+#include "Util.h"
+
+namespace Halide {
+namespace Internal {
+
+using std::map;
+using std::pair;
+using std::string;
+using std::vector;
+
+namespace {
+
+// Slots in the arena are rounded up to a multiple of this many bytes,
+// so every allocation gets at least the alignment of the arena itself.
+const int64_t slot_alignment = 128;
+
+struct Candidate {
+    const Allocate *op = nullptr;
+    // The first and last points in the linearized program at which
+    // the allocation is live. Realizations are nested, so the Allocate
+    // node is usually well before the first use.
+    int start = -1, end = -1;
+    // The straight-line statements enclosing the allocation, outermost
+    // first. Ends with the Allocate node itself.
+    vector<const IRNode *> path;
+    // The LetStmts enclosing the allocation, paired with their position
+    // in 'path'.
+    vector<pair<size_t, const LetStmt *>> lets;
+    // The Free node injected by inject_early_frees that ends the
+    // lifetime, if there is one.
+    const Free *free = nullptr;
+    // The time of the last assertion before the Allocate node.
+    int checked_at = 0;
+    // The size in bytes, computable at the point at which the arena is
+    // allocated.
+    Expr size;
+    int slot = -1;
+};
+
+// Find the names of the buffers an IR node refers to.
+class FindBufferUses : public IRGraphVisitor {
+    using IRGraphVisitor::visit;
+
+    void visit(const Variable *op) override {
+        if (ends_with(op->name, ".buffer")) {
+            names.insert(op->name.substr(0, op->name.size() - 7));
+        } else if (op->type.is_handle()) {
+            names.insert(op->name);
+        }
+    }
+
+    void visit(const Load *op) override {
+        names.insert(op->name);
+        IRGraphVisitor::visit(op);
+    }
+
+    void visit(const Store *op) override {
+        names.insert(op->name);
+        IRGraphVisitor::visit(op);
+    }
+
+public:
+    std::set<string> names;
+};
+
+// Check whether a Stmt contains an assertion.
+class ContainsAssert : public IRVisitor {
+    using IRVisitor::visit;
+
+    void visit(const AssertStmt *op) override {
+        result = true;
+    }
+
+public:
+    bool result = false;
+};
+
+// Walk the parts of a Stmt that aren't inside any loop, numbering the
+// statements in program order, and find the lifetime of each heap
+// allocation. The lifetime starts at the first statement that refers
+// to it, and ends at the Free node injected by inject_early_frees, if
+// there is one at the same level, otherwise at the end of the Allocate
+// node. Allocations inside an if statement are not candidates, as
+// their sizes may not make sense on the paths that skip them.
+class FindLifetimes {
+    int time = 0;
+    int last_check = 0;
+    int branch_depth = 0;
+    vector<const IRNode *> path;
+    vector<pair<size_t, const LetStmt *>> lets;
+    map<string, size_t> in_scope;
+
+    template<typename T>
+    void mark_uses(const T &node) {
+        if (in_scope.empty()) {
+            return;
+        }
+        FindBufferUses uses;
+        node.accept(&uses);
+        for (const string &name : uses.names) {
+            auto it = in_scope.find(name);
+            if (it != in_scope.end() && candidates[it->second].start < 0) {
+                candidates[it->second].start = time;
+            }
+        }
+    }
+
+    static bool is_candidate(const Allocate *op) {
+        if (op->new_expr.defined() ||
+            !op->free_function.empty() ||
+            !is_const_one(op->condition) ||
+            op->extents.empty()) {
+            return false;
+        }
+        if (op->memory_type == MemoryType::Heap) {
+            return true;
+        }
+        if (op->memory_type != MemoryType::Auto) {
+            return false;
+        }
+        // Leave the ones that will go on the stack alone.
+        int32_t constant_size = op->constant_allocation_size();
+        return !(constant_size > 0 &&
+                 can_allocation_fit_on_stack((int64_t)constant_size * op->type.bytes()));
+    }
+
+    void enter(const IRNode *op) {
+        path.push_back(op);
+        entered_at[op] = time;
+    }
+
+public:
+    vector<Candidate> candidates;
+    std::set<string> allocation_names;
+    // The time at which each statement on the path to a candidate
+    // starts.
+    map<const IRNode *, int> entered_at;
+
+    void walk(const Stmt &s) {
+        if (const Block *op = s.as<Block>()) {
+            enter(op);
+            walk(op->first);
+            walk(op->rest);
+            path.pop_back();
+        } else if (const LetStmt *op = s.as<LetStmt>()) {
+            mark_uses(op->value);
+            enter(op);
+            lets.emplace_back(path.size() - 1, op);
+            walk(op->body);
+            lets.pop_back();
+            path.pop_back();
+        } else if (const ProducerConsumer *op = s.as<ProducerConsumer>()) {
+            enter(op);
+            walk(op->body);
+            path.pop_back();
+        } else if (const IfThenElse *op = s.as<IfThenElse>()) {
+            // Still walk the branches, to find uses of the allocations
+            // outside of it.
+            enter(op);
+            time++;
+            mark_uses(op->condition);
+            branch_depth++;
+            walk(op->then_case);
+            if (op->else_case.defined()) {
+                walk(op->else_case);
+            }
+            branch_depth--;
+            path.pop_back();
+        } else if (const Allocate *op = s.as<Allocate>()) {
+            allocation_names.insert(op->name);
+            for (const Expr &e : op->extents) {
+                mark_uses(e);
+            }
+            enter(op);
+            if (branch_depth == 0 && is_candidate(op)) {
+                size_t idx = candidates.size();
+                Candidate c;
+                c.op = op;
+                c.path = path;
+                c.lets = lets;
+                c.checked_at = last_check;
+                candidates.push_back(std::move(c));
+                in_scope[op->name] = idx;
+                walk(op->body);
+                Candidate &found = candidates[idx];
+                if (found.end < 0) {
+                    found.end = ++time;
+                }
+                if (found.start < 0) {
+                    found.start = found.end;
+                }
+                in_scope.erase(op->name);
+            } else {
+                walk(op->body);
+            }
+            path.pop_back();
+        } else if (const Free *op = s.as<Free>()) {
+            time++;
+            auto it = in_scope.find(op->name);
+            if (it != in_scope.end() && branch_depth == 0 && candidates[it->second].end < 0) {
+                candidates[it->second].end = time;
+                candidates[it->second].free = op;
+            }
+        } else {
+            // Loops and everything else are opaque.
+            time++;
+            mark_uses(s);
+            ContainsAssert check;
+            s.accept(&check);
+            if (check.result) {
+                last_check = time;
+            }
+        }
+    }
+};
+
+// Check whether an allocation size can be evaluated ahead of the
+// allocation: it must not read memory or refer to allocations.
+class SizeIsHoistable : public IRVisitor {
+    const std::set<string> &allocation_names;
+
+    using IRVisitor::visit;
+
+    void visit(const Load *op) override {
+        result = false;
+    }
+
+    void visit(const Call *op) override {
+        if (!op->is_pure() &&
+            !starts_with(op->name, "_halide_buffer_get_")) {
+            result = false;
+        }
+        IRVisitor::visit(op);
+    }
+
+    void visit(const Variable *op) override {
+        if (allocation_names.count(op->name)) {
+            result = false;
+        }
+    }
+
+public:
+    bool result = true;
+
+    SizeIsHoistable(const std::set<string> &allocation_names)
+        : allocation_names(allocation_names) {
+    }
+};
+
+// Compute the size in bytes of an allocation, wrapped in whichever of
+// the lets between 'depth' and the allocation it depends on.
+Expr hoisted_allocation_size(const Candidate &c, size_t depth) {
+    const Allocate *op = c.op;
+    Expr elements = make_const(Int(64), 1);
+    for (const Expr &e : op->extents) {
+        elements *= max(cast<int64_t>(e), 0);
+    }
+    Expr size = (elements + op->padding) * op->type.bytes();
+    for (auto it = c.lets.rbegin(); it != c.lets.rend() && it->first >= depth; it++) {
+        if (expr_uses_var(size, it->second->name)) {
+            size = Let::make(it->second->name, it->second->value, size);
+        }
+    }
+    return size;
+}
+
+// Count the assertions that 's' starts with, looking through the
+// first statement of each Block and the body of each LetStmt.
+int count_leading_asserts(const Stmt &s) {
+    if (s.as<AssertStmt>()) {
+        return 1;
+    } else if (const Block *op = s.as<Block>()) {
+        if (op->first.as<AssertStmt>()) {
+            return 1 + count_leading_asserts(op->rest);
+        }
+    } else if (const LetStmt *op = s.as<LetStmt>()) {
+        return count_leading_asserts(op->body);
+    }
+    return 0;
+}
+
+class InjectArena : public IRMutator {
+    using IRMutator::visit;
+
+    const IRNode *site;
+    const map<const Allocate *, Expr> &new_exprs;
+    const vector<pair<string, Expr>> &arena_lets;
+    const string &arena_name;
+    // The allocation whose lifetime ends last, and the Free node that
+    // ends it, if any. The arena is freed along with it.
+    const Allocate *last;
+    const Free *last_free;
+
+    Stmt visit(const Allocate *op) override {
+        auto it = new_exprs.find(op);
+        if (it == new_exprs.end()) {
+            return IRMutator::visit(op);
+        }
+        Stmt body = mutate(op->body);
+        // The arena is freed as a whole, so freeing the allocation
+        // itself must do nothing.
+        Stmt result = Allocate::make(op->name, op->type, MemoryType::Heap, op->extents, op->condition,
+                                     body, it->second, "halide_device_host_nop_free", op->padding);
+        if (op == last && !last_free) {
+            result = Block::make(result, Free::make(arena_name));
+        }
+        return result;
+    }
+
+    Stmt visit(const Free *op) override {
+        if (op == last_free) {
+            return Block::make(op, Free::make(arena_name));
+        }
+        return op;
+    }
+
+    // Allocate the arena around 's', after any assertions it starts
+    // with, so that they are checked first.
+    Stmt allocate_arena(const Stmt &s) {
+        if (count_leading_asserts(s) > 0) {
+            if (const Block *op = s.as<Block>()) {
+                return Block::make(op->first, allocate_arena(op->rest));
+            } else if (const LetStmt *op = s.as<LetStmt>()) {
+                return LetStmt::make(op->name, op->value, allocate_arena(op->body));
+            }
+            internal_error << "An arena can't be allocated around an assertion alone\n";
+        }
+
+        // The arena is an allocation of its own, so it is freed
+        // on error, or by the Free node injected above.
+        Expr arena_size = Variable::make(Int(64), arena_name + ".size");
+        Expr arena = Call::make(Handle(), "halide_malloc", {cast(UInt(64), arena_size)}, Call::Extern);
+        Stmt result = Allocate::make(arena_name, UInt(8), MemoryType::Heap, {}, arena_size > 0,
+                                     s, arena, "halide_free");
+        for (auto it = arena_lets.rbegin(); it != arena_lets.rend(); it++) {
+            result = LetStmt::make(it->first, it->second, result);
+        }
+        return result;
+    }
+
+public:
+    InjectArena(const IRNode *site,
+                const map<const Allocate *, Expr> &new_exprs,
+                const vector<pair<string, Expr>> &arena_lets,
+                const string &arena_name,
+                const Candidate &last)
+        : site(site), new_exprs(new_exprs), arena_lets(arena_lets), arena_name(arena_name),
+          last(last.op), last_free(last.free) {
+    }
+
+    Stmt mutate(const Stmt &s) override {
+        Stmt result = IRMutator::mutate(s);
+        if (s.get() != site) {
+            return result;
+        }
+        return allocate_arena(result);
+    }
+};
+
+}  // namespace
+
+Stmt coalesce_allocations(const Stmt &s, const Target &t) {
+    // The arena is sized in 64-bit arithmetic, and may be larger than
+    // any single allocation is allowed to be.
+    if (t.bits != 64) {
+        return s;
+    }
+
+    FindLifetimes lifetimes;
+    lifetimes.walk(s);
+    vector<Candidate> &candidates = lifetimes.candidates;
+
+    // The arena is allocated just outside the innermost straight-line
+    // statement that encloses all of the allocations packed into it,
+    // after any assertions that statement starts with. Drop any
+    // allocation whose size can't be computed there, or which comes
+    // after some other assertion that might fail, and repeat, as that
+    // might move the arena inwards.
+    size_t depth = 0;
+    while (candidates.size() >= 2) {
+        depth = candidates[0].path.size();
+        for (const Candidate &c : candidates) {
+            size_t d = 0;
+            while (d < depth && d < c.path.size() && c.path[d] == candidates[0].path[d]) {
+                d++;
+            }
+            depth = d;
+        }
+        internal_assert(depth > 0);
+        const IRNode *site = candidates[0].path[depth - 1];
+        const int checked_at = lifetimes.entered_at[site] +
+                               count_leading_asserts(Stmt(static_cast<const BaseStmtNode *>(site)));
+
+        bool dropped = false;
+        for (size_t i = 0; i < candidates.size(); i++) {
+            if (candidates[i].checked_at > checked_at) {
+                debug(3) << "Not coalescing " << candidates[i].op->name
+                         << " because it follows an assertion\n";
+                candidates.erase(candidates.begin() + i);
+                dropped = true;
+                break;
+            }
+            // Lets at the site of the arena aren't in scope there either.
+            candidates[i].size = hoisted_allocation_size(candidates[i], depth - 1);
+            SizeIsHoistable check(lifetimes.allocation_names);
+            candidates[i].size.accept(&check);
+            if (!check.result) {
+                debug(3) << "Not coalescing " << candidates[i].op->name
+                         << " because its size can't be computed ahead of time\n";
+                candidates.erase(candidates.begin() + i);
+                dropped = true;
+                break;
+            }
+        }
+        if (!dropped) {
+            break;
+        }
+    }
+    if (candidates.size() < 2) {
+        return s;
+    }
+
+    // Assign allocations to slots in order of the start of their
+    // lifetimes. An allocation can go in any slot that is no longer in
+    // use. Prefer one that is already known to be big enough, then
+    // the one that became free most recently.
+    std::sort(candidates.begin(), candidates.end(),
+              [](const Candidate &a, const Candidate &b) { return a.start < b.start; });
+    struct Slot {
+        int free_at;
+        vector<Expr> sizes;
+    };
+    vector<Slot> slots;
+    for (Candidate &c : candidates) {
+        int best = -1;
+        bool best_fits = false;
+        for (int i = 0; i < (int)slots.size(); i++) {
+            if (slots[i].free_at >= c.start) {
+                continue;
+            }
+            bool fits = false;
+            for (const Expr &e : slots[i].sizes) {
+                fits = fits || can_prove(c.size <= e);
+            }
+            if (best < 0 ||
+                (fits && !best_fits) ||
+                (fits == best_fits && slots[i].free_at > slots[best].free_at)) {
+                best = i;
+                best_fits = fits;
+            }
+        }
+        if (best < 0) {
+            best = (int)slots.size();
+            slots.push_back(Slot{0, {}});
+        }
+        slots[best].free_at = c.end;
+        if (!best_fits) {
+            slots[best].sizes.push_back(c.size);
+        }
+        c.slot = best;
+    }
+
+    const string arena_name = unique_name("arena");
+    vector<pair<string, Expr>> arena_lets;
+    vector<Expr> offsets;
+    Expr offset = make_zero(Int(64));
+    Expr arena_size = make_zero(Int(64));
+    for (size_t i = 0; i < slots.size(); i++) {
+        Expr size = slots[i].sizes[0];
+        for (size_t j = 1; j < slots[i].sizes.size(); j++) {
+            size = max(size, slots[i].sizes[j]);
+        }
+        Expr alignment = make_const(Int(64), slot_alignment);
+        size = ((size + alignment - 1) / alignment) * alignment;
+        size = common_subexpression_elimination(size);
+        string name = arena_name + ".slot." + std::to_string(i) + ".size";
+        arena_lets.emplace_back(name, size);
+        offsets.push_back(offset);
+        offset = simplify(offset + Variable::make(Int(64), name));
+        arena_size += size;
+    }
+    arena_lets.emplace_back(arena_name + ".size", offset);
+
+    Expr arena = reinterpret(UInt(64), Variable::make(Handle(), arena_name));
+    map<const Allocate *, Expr> new_exprs;
+    for (const Candidate &c : candidates) {
+        new_exprs[c.op] = reinterpret(Handle(), arena + cast(UInt(64), offsets[c.slot]));
+    }
+
+    auto *logger = get_compiler_logger();
+    if (logger || debug::debug_level() >= 1) {
+        // Allocated one at a time, all of the allocations could be live
+        // at once.
+        Expr total_size = make_zero(Int(64));
+        for (const Candidate &c : candidates) {
+            total_size += c.size;
+        }
+        total_size = simplify(common_subexpression_elimination(total_size));
+        arena_size = simplify(common_subexpression_elimination(arena_size));
+        if (logger) {
+            logger->record_coalesced_allocations(arena_name, (int)candidates.size(), total_size, arena_size);
+        }
+        debug(1) << "Coalesced " << candidates.size() << " allocations into "
+                 << slots.size() << " slots of " << arena_name << ".\n"
+                 << "Sum of allocation sizes: " << total_size << " bytes\n"
+                 << "Arena size: " << arena_size << " bytes\n";
+    }
+
+    const Candidate &last = *std::max_element(candidates.begin(), candidates.end(),
+                                              [](const Candidate &a, const Candidate &b) { return a.end < b.end; });
+    InjectArena inject(candidates[0].path[depth - 1], new_exprs, arena_lets, arena_name, last);
+    return inject.mutate(s);
+}
+
+}  // namespace Internal
+}  // namespace Halide
@@ -0,0 +1,32 @@
+#ifndef HALIDE_COALESCE_ALLOCATIONS_H
+#define HALIDE_COALESCE_ALLOCATIONS_H
+
+/** \file
+ * Defines the lowering pass that packs heap allocations with
+ * non-overlapping lifetimes into a single arena.
+ */
+
+#include "Expr.h"
+
+namespace Halide {
+
+struct Target;
+
+namespace Internal {
+
+/** Find the heap allocations that are not inside any loop or if
+ * statement, work out their lifetimes from the Free nodes injected by
+ * inject_early_frees, and assign allocations whose lifetimes never
+ * overlap to shared slots of a single arena. The arena is allocated
+ * once with halide_malloc, after any assertions it would otherwise
+ * precede, and freed when the last of the allocations in it would have
+ * been. Each allocation becomes a pointer into it. The sizes before
+ * and after are reported to the CompilerLogger. Does nothing on
+ * targets without 64-bit pointers. Only run by lowering for targets
+ * with the coalesce_allocations feature. */
+Stmt coalesce_allocations(const Stmt &s, const Target &t);
+
+}  // namespace Internal
+}  // namespace Halide
+
+#endif
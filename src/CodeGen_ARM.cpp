@@ -12,6 +12,8 @@
 #include "IROperator.h"
 #include "IRPrinter.h"
 #include "LLVM_Headers.h"
+#include "LoopCarry.h"
+#include "OptimizeShuffles.h"
 #include "Simplify.h"
 #include "Substitute.h"
 #include "Util.h"
@@ -148,6 +150,13 @@ protected:
     bool use_soft_float_abi() const override;
     int native_vector_bits() const override;
 
+    /** The largest LUT, in bytes, that we turn gathers into shuffles
+     * of, or zero if we don't. */
+    int max_lut_bytes() const;
+
+    /** Look up a vector of byte indices in a byte LUT using tbl/tbx. */
+    Value *table_lookup(const Expr &lut, const Expr &idx);
+
     // NEON can be disabled for older processors.
     bool neon_intrinsics_disabled() {
         return target.has_feature(Target::NoNEON);
@@ -853,6 +862,26 @@ void CodeGen_ARM::compile_func(const LoweredFunc &f,
         func.body = SubstituteInStridedLoads().mutate(func.body);
     }
 
+    if (max_lut_bytes() > 0) {
+        debug(1) << "ARM: Optimizing shuffles...\n";
+        // There's no benefit to aligning the LUT, and we can't read past
+        // the end of the buffer it lives in.
+        func.body = optimize_shuffles(func.body, 1, max_lut_bytes());
+        debug(2) << "ARM: Lowering after optimizing shuffles:\n"
+                 << func.body << "\n\n";
+    }
+
+    if (!target.has_feature(Target::NoLoopCarry)) {
+        debug(1) << "ARM: Carrying values across loop iterations...\n";
+        // Use at most half of the vector registers (32 on aarch64, 16
+        // quad registers on arm32) for carrying values, so that the loop
+        // body still has room to work.
+        const int vector_registers = target.bits == 64 ? 32 : 16;
+        func.body = loop_carry(func.body, vector_registers / 2, native_vector_bits());
+        debug(2) << "ARM: Lowering after carrying values:\n"
+                 << func.body << "\n\n";
+    }
+
     CodeGen_Posix::compile_func(func, simple_name, extern_name);
 }
 
@@ -986,6 +1015,16 @@ void CodeGen_ARM::visit(const Store *op) {
         return;
     }
 
+    // The vst/st intrinsics are calls, so they can't carry the
+    // nontemporal hint. Leave nontemporal stores to the generic path,
+    // which interleaves with a shuffle and then emits a single store
+    // that does (selected as stnp on AArch64).
+    if (emit_nontemporal_stores ||
+        Call::as_intrinsic(op->value, {Call::nontemporal})) {
+        CodeGen_Posix::visit(op);
+        return;
+    }
+
     // A dense store of an interleaving can be done using a vst2 intrinsic
     const Ramp *ramp = op->index.as<Ramp>();
 
@@ -1256,6 +1295,14 @@ void CodeGen_ARM::visit(const Call *op) {
         // We want these as left shifts with a negative b instead.
         value = codegen(op->args[0] << simplify(-op->args[1]));
         return;
+    } else if (op->is_intrinsic(Call::dynamic_shuffle)) {
+        internal_assert(op->args.size() == 4);
+        if (op->type.bits() != 8) {
+            codegen(lower_dynamic_shuffle_to_bytes(op));
+        } else {
+            value = table_lookup(op->args[0], op->args[1]);
+        }
+        return;
     } else if (op->is_intrinsic(Call::round)) {
         // llvm's roundeven intrinsic reliably lowers to the correct
         // instructions on aarch64, but despite having the same instruction
@@ -1616,6 +1663,76 @@ int CodeGen_ARM::native_vector_bits() const {
     return 128;
 }
 
+int CodeGen_ARM::max_lut_bytes() const {
+    if (!target.has_feature(Target::LUTShuffles) ||
+        target.has_feature(Target::NoNEON)) {
+        return 0;
+    }
+    // Allow at most four lookups per vector of results, each of which
+    // indexes a table of four registers.
+    const int register_bytes = target.bits == 64 ? 16 : 8;
+    return 4 * 4 * register_bytes;
+}
+
+Value *CodeGen_ARM::table_lookup(const Expr &lut, const Expr &idx) {
+    internal_assert(lut.type().element_of() == UInt(8) &&
+                    idx.type().element_of() == UInt(8));
+    // tbl looks up indices in a table of up to four registers, and
+    // gives zero for indices past the end of the table. tbx does the
+    // same but leaves the destination unchanged for those indices, so
+    // we use it to chain lookups into larger tables. On arm32, the
+    // registers are 64-bit d registers.
+    const int register_bytes = target.bits == 64 ? 16 : 8;
+    const int lanes = idx.type().lanes();
+    const int padded_lanes = ((lanes + register_bytes - 1) / register_bytes) * register_bytes;
+    Expr padded_idx = idx;
+    if (padded_lanes > lanes) {
+        padded_idx = Shuffle::make_concat({idx, make_zero(idx.type().with_lanes(padded_lanes - lanes))});
+    }
+    const int lut_lanes = lut.type().lanes();
+    const int lut_registers = (lut_lanes + register_bytes - 1) / register_bytes;
+    Expr padded_lut = lut;
+    if (lut_registers * register_bytes > lut_lanes) {
+        padded_lut = Shuffle::make_concat({lut, make_zero(lut.type().with_lanes(lut_registers * register_bytes - lut_lanes))});
+    }
+
+    Value *lut_value = codegen(padded_lut);
+    Value *idx_value = codegen(padded_idx);
+    llvm::Type *register_type = get_vector_type(i8_t, register_bytes);
+
+    vector<Value *> results;
+    for (int i = 0; i < padded_lanes; i += register_bytes) {
+        Value *idx_slice = slice_vector(idx_value, i, register_bytes);
+        Value *result = nullptr;
+        for (int r = 0; r < lut_registers; r += 4) {
+            const int n = std::min(4, lut_registers - r);
+            vector<Value *> args;
+            if (result) {
+                args.push_back(result);
+            }
+            for (int j = 0; j < n; j++) {
+                args.push_back(slice_vector(lut_value, (r + j) * register_bytes, register_bytes));
+            }
+            if (r == 0) {
+                args.push_back(idx_slice);
+            } else {
+                Value *offset = codegen(make_const(UInt(8, register_bytes), r * register_bytes));
+                args.push_back(builder->CreateSub(idx_slice, offset));
+            }
+
+            const string op_name = result ? "tbx" : "tbl";
+            const string intrin = target.bits == 64 ?
+                                      "llvm.aarch64.neon." + op_name + std::to_string(n) + ".v16i8" :
+                                      "llvm.arm.neon.v" + op_name + std::to_string(n);
+            vector<llvm::Type *> arg_types(args.size(), register_type);
+            llvm::Function *fn = get_llvm_intrin(register_type, intrin, arg_types);
+            result = builder->CreateCall(fn, args);
+        }
+        results.push_back(result);
+    }
+    return slice_vector(concat_vectors(results), 0, lanes);
+}
+
 bool CodeGen_ARM::supports_call_as_float16(const Call *op) const {
     bool is_fp16_native = float16_native_funcs.find(op->name) != float16_native_funcs.end();
     bool is_fp16_transcendental = float16_transcendental_remapping.find(op->name) != float16_transcendental_remapping.end();
@@ -1838,6 +1838,12 @@ void CodeGen_C::visit(const Call *op) {
         rhs << "(__builtin_prefetch("
             << "((" << print_type(op->type) << " *)" << print_name(base->name)
             << " + " << print_expr(base_offset) << "), /*rw*/0, /*locality*/0), 0)";
+    } else if (op->is_intrinsic(Call::nontemporal)) {
+        // Non-temporal stores are just a hint; emit ordinary stores.
+        rhs << print_expr(op->args[0]);
+    } else if (op->is_intrinsic(Call::store_fence)) {
+        // Ordinary stores need no fence.
+        rhs << "0";
     } else if (op->is_intrinsic(Call::size_of_halide_buffer_t)) {
         rhs << "(sizeof(halide_buffer_t))";
     } else if (op->is_intrinsic(Call::strict_float)) {
@@ -2212,11 +2218,22 @@ void CodeGen_C::visit(const For *op) {
     string id_min = print_expr(op->min);
     string id_extent = print_expr(op->extent);
 
-    if (op->for_type == ForType::Parallel) {
+    internal_assert(op->for_type == ForType::Serial ||
+                    op->for_type == ForType::Parallel)
+        << "Can only emit serial or parallel for loops to C\n";
+    const bool parallel = op->for_type == ForType::Parallel;
+
+    // It isn't legal to return out of an OpenMP parallel loop, so the
+    // body of a parallel loop goes in a lambda, and the first error
+    // any iteration returns is returned once the loop is done.
+    string id_par_result;
+    if (parallel) {
+        id_par_result = unique_name('_');
+        open_scope();
+        stream << get_indent() << "int " << id_par_result << " = 0;\n";
+        stream << "#if defined(_OPENMP)\n";
         stream << get_indent() << "#pragma omp parallel for\n";
-    } else {
-        internal_assert(op->for_type == ForType::Serial)
-            << "Can only emit serial or parallel for loops to C\n";
+        stream << "#endif\n";
     }
 
     stream << get_indent() << "for (int "
@@ -2231,8 +2248,34 @@ void CodeGen_C::visit(const For *op) {
            << "++)\n";
 
     open_scope();
-    op->body.accept(this);
+    if (parallel) {
+        string id_result = unique_name('_');
+        stream << get_indent() << "int " << id_result << " = [&]() -> int\n";
+        open_scope();
+        op->body.accept(this);
+        stream << get_indent() << "return 0;\n";
+        cache.clear();
+        indent--;
+        stream << get_indent() << "}();\n";
+        stream << get_indent() << "if (" << id_result << " != 0)\n";
+        open_scope();
+        stream << "#if defined(_OPENMP)\n";
+        stream << get_indent() << "#pragma omp critical\n";
+        stream << "#endif\n";
+        stream << get_indent() << id_par_result << " = " << id_result << ";\n";
+        close_scope("");
+    } else {
+        op->body.accept(this);
+    }
     close_scope("for " + print_name(op->name));
+
+    if (parallel) {
+        stream << get_indent() << "if (" << id_par_result << " != 0)\n";
+        open_scope();
+        stream << get_indent() << "return " << id_par_result << ";\n";
+        close_scope("");
+        close_scope("");
+    }
 }
 
 void CodeGen_C::visit(const Ramp *op) {
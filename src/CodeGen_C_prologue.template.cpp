@@ -13,6 +13,7 @@
 #include <stdio.h>
 #include <string.h>
 #include <type_traits>
+#include <utility>
 
 extern "C" {
 int64_t halide_current_time_ns(void *ctx);
@@ -589,11 +589,9 @@ public:
     }
 
     static Vec ramp(const ElementType base, const ElementType stride) {
-        Vec r;
-        for (size_t i = 0; i < Lanes; i++) {
-            r[i] = base + stride * i;
-        }
-        return r;
+        // Build the ramp with vector arithmetic on a constant vector of
+        // lane indices, rather than lane-by-lane inserts.
+        return broadcast(base) + broadcast(stride) * lane_indices(std::make_index_sequence<Lanes>());
     }
 
     static Vec load(const void *base, int32_t offset) {
@@ -695,6 +693,13 @@ public:
         // TODO: GCC doesn't seem to recognize this pattern, and scalarizes instead
         return a > b ? a : b;
 #else
+#if __has_builtin(__builtin_elementwise_max)
+        // Only for integers: for floats this builtin has different NaN
+        // semantics than the compare-and-select below.
+        if constexpr (std::is_integral<ElementType>::value) {
+            return __builtin_elementwise_max(a, b);
+        }
+#endif
         // Clang doesn't do ternary operator for vectors, but recognizes this pattern
         Vec r;
         for (size_t i = 0; i < Lanes; i++) {
@@ -709,6 +714,11 @@ public:
         // TODO: GCC doesn't seem to recognize this pattern, and scalarizes instead
         return a < b ? a : b;
 #else
+#if __has_builtin(__builtin_elementwise_min)
+        if constexpr (std::is_integral<ElementType>::value) {
+            return __builtin_elementwise_min(a, b);
+        }
+#endif
         // Clang doesn't do ternary operator for vectors, but recognizes this pattern
         Vec r;
         for (size_t i = 0; i < Lanes; i++) {
@@ -782,6 +792,13 @@ public:
         const NativeVector<T, Lanes> r = a != b;
         return NativeVectorOps<uint8_t, Lanes>::convert_from(r);
     }
+
+private:
+    template<size_t... Indices>
+    static Vec lane_indices(std::index_sequence<Indices...>) {
+        const Vec r = {(ElementType)Indices...};
+        return r;
+    }
 };
 
 #endif  // __has_attribute(ext_vector_type) || __has_attribute(vector_size)
@@ -559,6 +559,29 @@ Expr lower_round_to_nearest_ties_to_even(const Expr &x) {
     return common_subexpression_elimination(a - correction);
 }
 
+Expr lower_dynamic_shuffle_to_bytes(const Call *op) {
+    internal_assert(op->is_intrinsic(Call::dynamic_shuffle) && op->args.size() == 4);
+    const Expr &lut = op->args[0];
+    const Expr &idx = op->args[1];
+    const int bytes = op->type.bytes();
+    const int lut_bytes = lut.type().lanes() * bytes;
+    internal_assert(op->type.bits() == bytes * 8 && lut_bytes <= 256)
+        << "Can't look up " << op->type << " elements one byte at a time\n";
+
+    // Element i of the LUT is made of bytes [i * bytes, (i + 1) * bytes)
+    // of the byte LUT, so look up each of those and interleave them.
+    Expr byte_idx = idx * cast(idx.type(), bytes);
+    std::vector<Expr> byte_indices;
+    for (int b = 0; b < bytes; b++) {
+        byte_indices.push_back(b == 0 ? byte_idx : byte_idx + cast(idx.type(), b));
+    }
+    Expr byte_lut = reinterpret(UInt(8, lut_bytes), lut);
+    Expr shuffled = Call::make(UInt(8, op->type.lanes() * bytes), Call::dynamic_shuffle,
+                               {byte_lut, Shuffle::make_interleave(byte_indices), 0, lut_bytes - 1},
+                               Call::PureIntrinsic);
+    return reinterpret(op->type, shuffled);
+}
+
 bool get_md_bool(llvm::Metadata *value, bool &result) {
     if (!value) {
         return false;
@@ -676,6 +699,10 @@ std::unique_ptr<llvm::TargetMachine> make_target_machine(const llvm::Module &mod
     return std::unique_ptr<llvm::TargetMachine>(tm);
 }
 
+bool is_fast_jit_tier(const Target &t) {
+    return t.has_feature(Target::JIT) && t.has_feature(Target::TieredJIT);
+}
+
 void set_function_attributes_from_halide_target_options(llvm::Function &fn) {
     llvm::Module &module = *fn.getParent();
 
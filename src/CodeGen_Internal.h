@@ -91,6 +91,16 @@ Expr lower_concat_bits(const Call *c);
  * standard library being present. */
 Expr lower_round_to_nearest_ties_to_even(const Expr &);
 
+/** Rewrite a dynamic_shuffle from a LUT of elements wider than a byte
+ * as a dynamic_shuffle of the bytes of the LUT, for targets whose table
+ * lookup instructions only operate on bytes. */
+Expr lower_dynamic_shuffle_to_bytes(const Call *op);
+
+/** Is this the first, quickly compiled tier of a Target::TieredJIT
+ * compilation? If so, LLVM should spend as little time as it can on
+ * optimization. */
+bool is_fast_jit_tier(const Target &t);
+
 /** Given an llvm::Module, set llvm:TargetOptions information */
 void get_target_options(const llvm::Module &module, llvm::TargetOptions &options);
 
@@ -460,6 +460,9 @@ void CodeGen_LLVM::init_codegen(const std::string &name, bool any_strict_float)
 }
 
 std::unique_ptr<llvm::Module> CodeGen_LLVM::compile(const Module &input) {
+    user_assert(!input.target().has_feature(Target::COpenMP))
+        << "Target feature c_openmp is only supported when emitting C++ source.\n";
+
     init_codegen(input.name(), input.any_strict_float());
 
     internal_assert(module && context && builder)
@@ -1149,7 +1152,9 @@ void CodeGen_LLVM::optimize_module() {
     ModulePassManager mpm;
 
     using OptimizationLevel = llvm::OptimizationLevel;
-    OptimizationLevel level = OptimizationLevel::O3;
+    // The fast tier of a tiered JIT compile is replaced by fully
+    // optimized code as soon as that is ready.
+    OptimizationLevel level = is_fast_jit_tier(get_target()) ? OptimizationLevel::O1 : OptimizationLevel::O3;
 
     if (get_target().has_feature(Target::SanitizerCoverage)) {
         pb.registerOptimizerLastEPCallback(
@@ -3284,6 +3289,14 @@ void CodeGen_LLVM::visit(const Call *op) {
 
         // Prefetch evaluates to zero of the prefetched type.
         value = codegen(make_zero(op->type));
+    } else if (op->is_intrinsic(Call::nontemporal)) {
+        // Only meaningful as the value of a Store.
+        value = codegen(op->args[0]);
+    } else if (op->is_intrinsic(Call::store_fence)) {
+        // Non-temporal stores are weakly ordered, so this must be a
+        // full fence.
+        builder->CreateFence(AtomicOrdering::SequentiallyConsistent);
+        value = ConstantInt::get(i32_t, 0);
     } else if (op->is_intrinsic(Call::signed_integer_overflow)) {
         user_error << "Signed integer overflow occurred during constant-folding. Signed"
                       " integer overflow for int32 and int64 is undefined behavior in"
@@ -3716,6 +3729,12 @@ void CodeGen_LLVM::visit(const For *op) {
 }
 
 void CodeGen_LLVM::visit(const Store *op) {
+    if (const Call *c = Call::as_intrinsic(op->value, {Call::nontemporal})) {
+        ScopedValue<bool> old_emit_nontemporal_stores(emit_nontemporal_stores, true);
+        codegen(Store::make(op->name, c->args[0], op->index, op->param, op->predicate, op->alignment));
+        return;
+    }
+
     if (!emit_atomic_stores) {
         // Peel lets off the index to make us more likely to pattern
         // match a ramp.
@@ -3759,6 +3778,10 @@ void CodeGen_LLVM::visit(const Store *op) {
         add_tbaa_metadata(store, op->name, index);
         if (emit_atomic_stores) {
             store->setAtomic(AtomicOrdering::Monotonic);
+        } else if (emit_nontemporal_stores) {
+            // Selects movnt on x86 and stnp on AArch64.
+            llvm::Metadata *one = ConstantAsMetadata::get(ConstantInt::get(i32_t, 1));
+            store->setMetadata(LLVMContext::MD_nontemporal, MDNode::get(*context, {one}));
         }
     };
 
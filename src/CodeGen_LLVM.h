@@ -534,6 +534,9 @@ protected:
     /** Emit atomic store instructions? */
     bool emit_atomic_stores = false;
 
+    /** Mark store instructions as non-temporal? */
+    bool emit_nontemporal_stores = false;
+
     /** Can we call this operation with float16 type?
         This is used to avoid "emulated" equivalent code-gen in case target has FP16 feature **/
     virtual bool supports_call_as_float16(const Call *op) const;
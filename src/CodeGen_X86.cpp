@@ -6,6 +6,8 @@
 #include "IRMutator.h"
 #include "IROperator.h"
 #include "LLVM_Headers.h"
+#include "LoopCarry.h"
+#include "OptimizeShuffles.h"
 #include "Simplify.h"
 #include "Substitute.h"
 #include "Util.h"
@@ -72,6 +74,8 @@ protected:
     using CodeGen_Posix::visit;
 
     void init_module() override;
+    void compile_func(const LoweredFunc &f,
+                      const std::string &simple_name, const std::string &extern_name) override;
 
     /** Nodes for which we want to emit specific sse/avx intrinsics */
     // @{
@@ -92,6 +96,14 @@ protected:
     void codegen_vector_reduce(const VectorReduce *, const Expr &init) override;
     // @}
 
+    /** The largest LUT, in bytes, that we turn gathers into shuffles
+     * of, or zero if we don't. */
+    int max_lut_bytes() const;
+
+    /** Look up a vector of byte indices in a byte LUT using pshufb, or
+     * vpermb when available. */
+    Value *table_lookup(const Expr &lut, const Expr &idx);
+
 private:
     Scope<MemoryType> mem_type;
 };
@@ -152,6 +164,12 @@ const x86Intrinsic intrinsic_defs[] = {
     {"llvm.ssub.sat.v16i16", Int(16, 16), "saturating_sub", {Int(16, 16), Int(16, 16)}, Target::AVX2},
     {"llvm.ssub.sat.v8i16", Int(16, 8), "saturating_sub", {Int(16, 8), Int(16, 8)}},
 
+    // Byte shuffles with variable indices, used for table lookups
+    {"llvm.x86.ssse3.pshuf.b.128", UInt(8, 16), "pshufb", {UInt(8, 16), UInt(8, 16)}, Target::SSE41},
+    {"llvm.x86.avx2.pshuf.b", UInt(8, 32), "pshufb", {UInt(8, 32), UInt(8, 32)}, Target::AVX2},
+    {"llvm.x86.avx512.pshuf.b.512", UInt(8, 64), "pshufb", {UInt(8, 64), UInt(8, 64)}, Target::AVX512_Skylake},
+    {"llvm.x86.avx512.permvar.qi.512", UInt(8, 64), "vpermb", {UInt(8, 64), UInt(8, 64)}, Target::AVX512_Cannonlake},
+
     // Sum of absolute differences
     {"llvm.x86.sse2.psad.bw", UInt(64, 2), "sum_of_absolute_differences", {UInt(8, 16), UInt(8, 16)}},
     {"llvm.x86.avx2.psad.bw", UInt(64, 4), "sum_of_absolute_differences", {UInt(8, 32), UInt(8, 32)}, Target::AVX2},
@@ -303,6 +321,39 @@ void CodeGen_X86::init_module() {
     }
 }
 
+void CodeGen_X86::compile_func(const LoweredFunc &f,
+                               const string &simple_name,
+                               const string &extern_name) {
+    LoweredFunc func = f;
+
+    if (max_lut_bytes() > 0) {
+        debug(1) << "X86: Optimizing shuffles...\n";
+        // There's no benefit to aligning the LUT, and we can't read past
+        // the end of the buffer it lives in.
+        func.body = optimize_shuffles(func.body, 1, max_lut_bytes());
+        debug(2) << "X86: Lowering after optimizing shuffles:\n"
+                 << func.body << "\n\n";
+    }
+
+    if (!target.has_feature(Target::NoLoopCarry)) {
+        debug(1) << "X86: Carrying values across loop iterations...\n";
+        // Use at most half of the vector registers for carrying values,
+        // so that the loop body still has room to work. x86-64 has 16
+        // (32 with AVX-512), x86-32 only has 8.
+        int vector_registers = 16;
+        if (target.bits == 32) {
+            vector_registers = 8;
+        } else if (target.has_feature(Target::AVX512)) {
+            vector_registers = 32;
+        }
+        func.body = loop_carry(func.body, vector_registers / 2, native_vector_bits());
+        debug(2) << "X86: Lowering after carrying values:\n"
+                 << func.body << "\n\n";
+    }
+
+    CodeGen_Posix::compile_func(func, simple_name, extern_name);
+}
+
 // i32(i16_a)*i32(i16_b) +/- i32(i16_c)*i32(i16_d) can be done by
 // interleaving a, c, and b, d, and then using dot_product.
 bool should_use_dot_product(const Expr &a, const Expr &b, vector<Expr> &result) {
@@ -540,6 +591,12 @@ void CodeGen_X86::visit(const Call *op) {
         if (value) {
             return;
         }
+    } else if (op->is_intrinsic(Call::store_fence)) {
+        // sfence is enough to order movnt stores, and is cheaper than
+        // the mfence that a generic fence becomes.
+        builder->CreateCall(module->getOrInsertFunction("llvm.x86.sse.sfence", void_t));
+        value = ConstantInt::get(i32_t, 0);
+        return;
     }
 
     if (!op->type.is_vector()) {
@@ -583,6 +640,14 @@ void CodeGen_X86::visit(const Call *op) {
         Expr b = cast(t, op->args[1]);
         codegen(cast(op->type, rounding_halving_add(a, b) + ((a ^ b) & (1 << (t.bits() - 1)))));
         return;
+    } else if (op->is_intrinsic(Call::dynamic_shuffle)) {
+        internal_assert(op->args.size() == 4);
+        if (op->type.bits() != 8) {
+            codegen(lower_dynamic_shuffle_to_bytes(op));
+        } else {
+            value = table_lookup(op->args[0], op->args[1]);
+        }
+        return;
     } else if (op->is_intrinsic(Call::absd)) {
         internal_assert(op->args.size() == 2);
         if (op->args[0].type().is_uint()) {
@@ -969,6 +1034,74 @@ bool CodeGen_X86::use_soft_float_abi() const {
     return false;
 }
 
+int CodeGen_X86::max_lut_bytes() const {
+    if (!target.has_feature(Target::LUTShuffles)) {
+        return 0;
+    }
+    // Allow at most four shuffles per vector of results. pshufb looks up
+    // 16 byte tables, and vpermb 64 byte tables.
+    if (target.has_feature(Target::AVX512_Cannonlake)) {
+        return 4 * 64;
+    } else if (target.has_feature(Target::SSE41)) {
+        return 4 * 16;
+    } else {
+        return 0;
+    }
+}
+
+Value *CodeGen_X86::table_lookup(const Expr &lut, const Expr &idx) {
+    internal_assert(lut.type().element_of() == UInt(8) &&
+                    idx.type().element_of() == UInt(8));
+    const bool use_vpermb = target.has_feature(Target::AVX512_Cannonlake);
+    const int table_size = use_vpermb ? 64 : 16;
+
+    // pshufb shuffles within each 128-bit lane, so each table is
+    // replicated across the whole index vector, which we pad to a
+    // multiple of the table size.
+    const int lanes = idx.type().lanes();
+    const int padded_lanes = ((lanes + table_size - 1) / table_size) * table_size;
+    Expr padded_idx = idx;
+    if (padded_lanes > lanes) {
+        padded_idx = Shuffle::make_concat({idx, make_zero(idx.type().with_lanes(padded_lanes - lanes))});
+    }
+    const int lut_lanes = lut.type().lanes();
+    const int padded_lut_lanes = ((lut_lanes + table_size - 1) / table_size) * table_size;
+    Expr padded_lut = lut;
+    if (padded_lut_lanes > lut_lanes) {
+        padded_lut = Shuffle::make_concat({lut, make_zero(lut.type().with_lanes(padded_lut_lanes - lut_lanes))});
+    }
+
+    // Only generate code for the LUT and the indices once.
+    const string lut_name = unique_name('t');
+    const string idx_name = unique_name('t');
+    sym_push(lut_name, codegen(padded_lut));
+    sym_push(idx_name, codegen(padded_idx));
+    Expr lut_var = Variable::make(padded_lut.type(), lut_name);
+    Expr idx_var = Variable::make(padded_idx.type(), idx_name);
+
+    // Look up each table in turn, keeping the result from the last
+    // table that the index reaches into.
+    Type t = UInt(8, padded_lanes);
+    Value *result = nullptr;
+    for (int i = 0; i < padded_lut_lanes; i += table_size) {
+        Expr table = Shuffle::make_broadcast(Shuffle::make_slice(lut_var, i, 1, table_size),
+                                             padded_lanes / table_size);
+        Expr table_idx = i == 0 ? idx_var : idx_var - cast(t, i);
+        Value *lookup = call_overloaded_intrin(t, use_vpermb ? "vpermb" : "pshufb", {table, table_idx});
+        internal_assert(lookup);
+        if (result) {
+            Value *in_table = codegen(idx_var >= cast(t, i));
+            result = builder->CreateSelect(in_table, lookup, result);
+        } else {
+            result = lookup;
+        }
+    }
+
+    sym_pop(idx_name);
+    sym_pop(lut_name);
+    return slice_vector(result, 0, lanes);
+}
+
 int CodeGen_X86::native_vector_bits() const {
     if (target.has_feature(Target::AVX512) ||
         target.has_feature(Target::AVX512_Skylake) ||
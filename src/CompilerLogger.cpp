@@ -17,7 +17,7 @@ namespace {
 // TODO: for now we are just going to ignore potential issues with
 // static-initialization-order-fiasco, as CompilerLogger isn't currently used
 // from any static-initialization execution scope.
-std::unique_ptr<CompilerLogger> active_compiler_logger;
+thread_local std::unique_ptr<CompilerLogger> active_compiler_logger;
 
 class ObfuscateNames : public IRMutator {
     using IRMutator::visit;
@@ -108,6 +108,15 @@ void JSONCompilerLogger::record_failed_to_prove(Expr failed_to_prove, Expr origi
     failed_to_prove_exprs.emplace_back(failed_to_prove, original_expr);
 }
 
+void JSONCompilerLogger::record_work_budget_exceeded(const std::string &analysis, Expr expr) {
+    work_budget_exceeded[analysis].emplace_back(std::move(expr));
+}
+
+void JSONCompilerLogger::record_coalesced_allocations(const std::string &arena, int allocations,
+                                                      Expr allocation_bytes, Expr arena_bytes) {
+    coalesced_allocations[arena] = {allocations, std::move(allocation_bytes), std::move(arena_bytes)};
+}
+
 void JSONCompilerLogger::record_object_code_size(uint64_t bytes) {
     object_code_size += bytes;
 }
@@ -142,6 +151,28 @@ void JSONCompilerLogger::obfuscate() {
         }
         failed_to_prove_exprs = n;
     }
+    {
+        std::map<std::string, std::vector<Expr>> n;
+        for (const auto &it : work_budget_exceeded) {
+            std::string analysis = it.first;
+            for (const auto &e : it.second) {
+                ObfuscateNames obfuscater;
+                n[analysis].emplace_back(obfuscater.mutate(e));
+            }
+        }
+        work_budget_exceeded = n;
+    }
+    {
+        std::map<std::string, CoalescedAllocations> n;
+        for (const auto &it : coalesced_allocations) {
+            // The two sizes of an arena share identifiers with each other.
+            ObfuscateNames obfuscater;
+            n[it.first] = {it.second.allocations,
+                           obfuscater.mutate(it.second.allocation_bytes),
+                           obfuscater.mutate(it.second.arena_bytes)};
+        }
+        coalesced_allocations = n;
+    }
 }
 
 namespace {
@@ -327,6 +358,34 @@ std::ostream &JSONCompilerLogger::emit_to_stream(std::ostream &o) {
         emit_object_key_close(o, indent);
     }
 
+    if (!work_budget_exceeded.empty()) {
+        emit_object_key_open(o, indent, "work_budget_exceeded");
+
+        int commas_to_emit = (int)work_budget_exceeded.size() - 1;
+        for (const auto &it : work_budget_exceeded) {
+            emit_key(o, indent + 1, it.first);
+            emit_eol(o, false);
+            emit_list(o, indent + 1, exprs_to_strings(it.second), (commas_to_emit-- > 0));
+        }
+
+        emit_object_key_close(o, indent);
+    }
+
+    if (!coalesced_allocations.empty()) {
+        emit_object_key_open(o, indent, "coalesced_allocations");
+
+        int commas_to_emit = (int)coalesced_allocations.size() - 1;
+        for (const auto &it : coalesced_allocations) {
+            emit_object_key_open(o, indent + 1, it.first);
+            emit_key_value(o, indent + 2, "allocations", it.second.allocations);
+            emit_key_value(o, indent + 2, "allocation_bytes", expr_to_string(it.second.allocation_bytes));
+            emit_key_value(o, indent + 2, "arena_bytes", expr_to_string(it.second.arena_bytes), false);
+            emit_object_key_close(o, indent + 1, (commas_to_emit-- > 0));
+        }
+
+        emit_object_key_close(o, indent);
+    }
+
     // Emit this last as a simple way to dodge the trailing-comma nonsense
     o << " \"version\": \"HalideJSONCompilerLoggerV1\"\n";
     o << "}\n";
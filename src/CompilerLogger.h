@@ -45,6 +45,18 @@ public:
      */
     virtual void record_failed_to_prove(Expr failed_to_prove, Expr original_expr) = 0;
 
+    /** Record when an analysis (e.g. the simplifier or bounds inference)
+     * ran out of its work budget and gave up early on an expression.
+     */
+    virtual void record_work_budget_exceeded(const std::string &analysis, Expr expr) = 0;
+
+    /** Record that a number of heap allocations were packed into an arena
+     * (see coalesce_allocations), along with the sum of their sizes and
+     * the size of the arena, in bytes.
+     */
+    virtual void record_coalesced_allocations(const std::string &arena, int allocations,
+                                              Expr allocation_bytes, Expr arena_bytes) = 0;
+
     /** Record total size (in bytes) of final generated object code (e.g., file size of .o output).
      */
     virtual void record_object_code_size(uint64_t bytes) = 0;
@@ -61,7 +73,8 @@ public:
 
 /** Set the active CompilerLogger object, replacing any existing one.
  * It is legal to pass in a nullptr (which means "don't do any compiler logging").
- * Returns the previous CompilerLogger (if any). */
+ * Returns the previous CompilerLogger (if any). Each thread has its own active
+ * CompilerLogger, so that pipelines being compiled at once don't share one. */
 std::unique_ptr<CompilerLogger> set_compiler_logger(std::unique_ptr<CompilerLogger> compiler_logger);
 
 /** Return the currently active CompilerLogger object. If set_compiler_logger()
@@ -88,6 +101,9 @@ public:
     void record_matched_simplifier_rule(const std::string &rulename, Expr expr) override;
     void record_non_monotonic_loop_var(const std::string &loop_var, Expr expr) override;
     void record_failed_to_prove(Expr failed_to_prove, Expr original_expr) override;
+    void record_work_budget_exceeded(const std::string &analysis, Expr expr) override;
+    void record_coalesced_allocations(const std::string &arena, int allocations,
+                                      Expr allocation_bytes, Expr arena_bytes) override;
     void record_object_code_size(uint64_t bytes) override;
     void record_compilation_time(Phase phase, double duration) override;
 
@@ -110,6 +126,16 @@ protected:
     // List of (unprovable simplified Expr, original version of that Expr passed to can_prove()).
     std::vector<std::pair<Expr, Expr>> failed_to_prove_exprs;
 
+    // Maps analysis name -> list of Exprs on which that analysis ran out of work budget
+    std::map<std::string, std::vector<Expr>> work_budget_exceeded;
+
+    struct CoalescedAllocations {
+        int allocations;
+        Expr allocation_bytes, arena_bytes;
+    };
+    // Maps arena name -> the allocations packed into it
+    std::map<std::string, CoalescedAllocations> coalesced_allocations;
+
     // Total code size generated, in bytes.
     uint64_t object_code_size{0};
 
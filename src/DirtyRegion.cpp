@@ -0,0 +1,145 @@
+#include "DirtyRegion.h"
+#include "ExternFuncArgument.h"
+#include "FindCalls.h"
+#include "Function.h"
+#include "IR.h"
+#include "IROperator.h"
+#include "RealizationOrder.h"
+#include "Simplify.h"
+#include "Solve.h"
+
+namespace Halide {
+namespace Internal {
+
+using std::map;
+using std::string;
+using std::vector;
+
+namespace {
+
+bool is_empty_box(const Box &b) {
+    for (const Interval &i : b.bounds) {
+        if (i.is_empty()) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// The condition under which a box required by a definition overlaps a
+// dirty box.
+Expr overlaps(const Box &required, const Box &dirty) {
+    Expr cond = const_true();
+    for (size_t i = 0; i < required.size() && i < dirty.size(); i++) {
+        const Interval &r = required[i];
+        const Interval &d = dirty[i];
+        if (r.has_lower_bound() && d.has_upper_bound()) {
+            cond = cond && (r.min <= d.max);
+        }
+        if (r.has_upper_bound() && d.has_lower_bound()) {
+            cond = cond && (r.max >= d.min);
+        }
+    }
+    return cond;
+}
+
+// Does an extern definition read anything that is dirty?
+bool extern_reads_dirty(const Function &f, const map<string, Box> &dirty) {
+    for (const ExternFuncArgument &arg : f.extern_arguments()) {
+        string name;
+        if (arg.is_func()) {
+            name = Function(arg.func).name();
+        } else if (arg.is_image_param()) {
+            name = arg.image_param.name();
+        } else if (arg.is_buffer()) {
+            name = arg.buffer.name();
+        } else {
+            continue;
+        }
+        auto it = dirty.find(name);
+        if (it != dirty.end() && !is_empty_box(it->second)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+}  // namespace
+
+map<string, Box> dirty_regions(const Function &f, const string &input, const Box &changed) {
+    map<string, Function> env = find_transitive_calls(f);
+    vector<string> order = topological_order({f}, env);
+
+    map<string, Box> dirty;
+    dirty[input] = changed;
+
+    for (const string &name : order) {
+        if (name == input) {
+            continue;
+        }
+        const Function &func = env.at(name);
+        const int dims = func.dimensions();
+
+        Box result(dims);
+        for (int i = 0; i < dims; i++) {
+            result[i] = Interval::nothing();
+        }
+
+        if (func.has_extern_definition()) {
+            if (extern_reads_dirty(func, dirty)) {
+                result = Box(dims);
+            }
+            dirty[name] = result;
+            continue;
+        }
+
+        vector<Definition> definitions = {func.definition()};
+        definitions.insert(definitions.end(), func.updates().begin(), func.updates().end());
+        for (const Definition &def : definitions) {
+            // Update definitions read the sites dirtied by the earlier
+            // definitions.
+            dirty[name] = result;
+
+            Scope<Interval> scope;
+            for (const ReductionVariable &rv : def.schedule().rvars()) {
+                scope.push(rv.var, Interval(rv.min, simplify(rv.min + rv.extent - 1)));
+            }
+            Stmt s = Provide::make(name, def.values(), def.args(), def.predicate());
+            map<string, Box> required = boxes_required(s, scope);
+
+            Expr cond = const_false();
+            for (const auto &it : required) {
+                auto d = dirty.find(it.first);
+                if (d == dirty.end() || is_empty_box(d->second)) {
+                    continue;
+                }
+                cond = cond || overlaps(it.second, d->second);
+            }
+            cond = simplify(cond);
+            if (is_const_zero(cond)) {
+                continue;
+            }
+
+            for (int i = 0; i < dims; i++) {
+                // Only dimensions indexed by the pure var can be solved
+                // for. Anything else (e.g. a scatter) may write anywhere.
+                const Variable *v = def.args()[i].as<Variable>();
+                if (v && v->name == func.args()[i]) {
+                    result[i].include(solve_for_outer_interval(cond, v->name));
+                } else {
+                    result[i] = Interval::everything();
+                }
+            }
+        }
+        dirty[name] = result;
+    }
+
+    return dirty;
+}
+
+Box dirty_region(const Function &f, const string &input, const Box &changed) {
+    return dirty_regions(f, input, changed)[f.name()];
+}
+
+}  // namespace Internal
+}  // namespace Halide
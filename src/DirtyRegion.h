@@ -0,0 +1,34 @@
+#ifndef HALIDE_DIRTY_REGION_H
+#define HALIDE_DIRTY_REGION_H
+
+/** \file
+ * Defines a query for the region of a Func that depends on a given
+ * region of one of its inputs.
+ */
+
+#include <map>
+#include <string>
+
+#include "Bounds.h"
+
+namespace Halide {
+namespace Internal {
+
+class Function;
+
+/** Find a box containing every site of f that may depend on the given
+ * region of an input, which may be a Func or an ImageParam called by
+ * f directly or indirectly. The dependencies are found from the
+ * algorithm alone, ignoring the schedule. Dimensions in which the
+ * dependency can't be bounded are unbounded in the result, and the
+ * result is empty if f does not depend on the region at all. */
+Box dirty_region(const Function &f, const std::string &input, const Box &changed);
+
+/** The dirty regions of f and of every Func it calls directly or
+ * indirectly, as computed by dirty_region, keyed by name. */
+std::map<std::string, Box> dirty_regions(const Function &f, const std::string &input, const Box &changed);
+
+}  // namespace Internal
+}  // namespace Halide
+
+#endif
@@ -2228,6 +2228,12 @@ Func &Func::store_in(MemoryType t) {
     return *this;
 }
 
+Func &Func::store_nontemporal() {
+    invalidate_cache();
+    func.schedule().nontemporal() = true;
+    return *this;
+}
+
 Func &Func::async() {
     invalidate_cache();
     func.schedule().async() = true;
@@ -2372,6 +2372,19 @@ public:
      * on MemoryType for more detail. */
     Func &store_in(MemoryType memory_type);
 
+    /** Write this Func with non-temporal (streaming) stores, which
+     * bypass the caches instead of evicting data that will be used
+     * again. This is worthwhile for large outputs that are written once
+     * and not read back by the pipeline, e.g. format conversions or
+     * copies, where it also saves reading each line in before it is
+     * overwritten. A fence is inserted at the end of the production of
+     * the Func (and at the end of each parallel task within it), so the
+     * stores are visible to the consumers. The hint is ignored on
+     * targets without non-temporal stores, inside GPU or Hexagon
+     * loops, and for predicated stores. Non-temporal vector stores on
+     * x86 work best if the buffer is aligned to the vector width. */
+    Func &store_nontemporal();
+
     /** Trace all loads from this Func by emitting calls to
      * halide_trace. If the Func is inlined, this has no
      * effect. */
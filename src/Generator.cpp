@@ -1,11 +1,23 @@
 #include <atomic>
+#include <chrono>
 #include <cmath>
 #include <condition_variable>
+#include <csignal>
+#include <cstring>
+#include <deque>
 #include <fstream>
 #include <memory>
+#include <mutex>
+#include <thread>
 #include <unordered_map>
 #include <utility>
 
+#ifndef _WIN32
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#endif
+
 #include "CompilerLogger.h"
 #include "Generator.h"
 #include "IRPrinter.h"
@@ -633,9 +645,25 @@ std::string halide_type_to_c_type(const Type &t) {
 
 namespace {
 
+// The environment variables that affect a gengen invocation. Requests sent
+// to a Generator server carry their client's values of these, which are
+// used instead of the server's.
+const char *const generator_env_vars[] = {
+    "HL_EXTRA_OUTPUTS",
+    "HL_DEBUG_COMPILER_LOGGER",
+    "HL_OBFUSCATE_COMPILER_LOGGER",
+};
+
+int serve_generators(const std::string &socket_path, int num_threads,
+                     const GeneratorFactoryProvider &generator_factory_provider);
+int send_generator_request(const std::string &socket_path, int argc, char **argv);
+
+// If env is non-null, it holds the values of the generator_env_vars to use
+// rather than those of this process.
 int generate_filter_main_inner(int argc,
                                char **argv,
-                               const GeneratorFactoryProvider &generator_factory_provider) {
+                               const GeneratorFactoryProvider &generator_factory_provider,
+                               const std::map<std::string, std::string> *env = nullptr) {
     static const char kUsage[] = R"INLINE_CODE(
 gengen
   [-g GENERATOR_NAME] [-f FUNCTION_NAME] [-o OUTPUT_DIR] [-r RUNTIME_NAME]
@@ -643,6 +671,21 @@ gengen
   [-s AUTOSCHEDULER_NAME] [-t TIMEOUT]
   target=target-string[,target-string...]
   [generator_param=value [...]]
+gengen --serve SOCKET_PATH [NUM_THREADS]
+gengen --client SOCKET_PATH (ARGS AS ABOVE | --shutdown)
+
+ --serve  Run as a server that carries out the requests of --client
+     invocations, up to NUM_THREADS at once (by default, one per core). All
+     requests share one process, so LLVM and the runtime modules are set up
+     once rather than once per Generator. Stop it with --client --shutdown.
+     Errors in a request are reported to its client only if Halide was built
+     with exceptions; otherwise they stop the server.
+
+ --client  Send the rest of the arguments to a server started with --serve,
+     wait for it to finish, and exit with its result. Relative output and
+     plugin paths are resolved against the client's working directory, and
+     the client's HL_EXTRA_OUTPUTS, HL_DEBUG_COMPILER_LOGGER and
+     HL_OBFUSCATE_COMPILER_LOGGER apply to the request, not the server's.
 
  -d  Build a module that is suitable for using for gradient descent calculation
      in TensorFlow or PyTorch. See Generator::build_gradient_module()
@@ -674,6 +717,21 @@ gengen
  -v  If nonzero, log the path to all generated files to stdout.
 )INLINE_CODE";
 
+    const auto env_var = [env](const char *name) {
+        if (env) {
+            auto it = env->find(name);
+            return it != env->end() ? it->second : std::string();
+        }
+        return get_env_variable(name);
+    };
+
+    if (argc >= 3 && !strcmp(argv[1], "--serve")) {
+        return serve_generators(argv[2], argc >= 4 ? std::atoi(argv[3]) : 0, generator_factory_provider);
+    }
+    if (argc >= 3 && !strcmp(argv[1], "--client")) {
+        return send_generator_request(argv[2], argc - 3, argv + 3);
+    }
+
     std::map<std::string, std::string> flags_info = {
         {"-d", "0"},
         {"-e", ""},
@@ -774,7 +832,7 @@ gengen
         std::string emit_flags_string = flags_info["-e"];
         // If HL_EXTRA_OUTPUTS is defined, assume it's extra outputs we want to generate
         // (usually for temporary debugging purposes) and just tack it on to the -e contents.
-        std::string extra_outputs = get_env_variable("HL_EXTRA_OUTPUTS");
+        std::string extra_outputs = env_var("HL_EXTRA_OUTPUTS");
         if (!extra_outputs.empty()) {
             if (!emit_flags_string.empty()) {
                 emit_flags_string += ",";
@@ -848,9 +906,9 @@ gengen
 
     // Allow quick-n-dirty use of compiler logging via HL_DEBUG_COMPILER_LOGGER env var
     const bool do_compiler_logging = args.output_types.count(OutputFileType::compiler_log) ||
-                                     (get_env_variable("HL_DEBUG_COMPILER_LOGGER") == "1");
+                                     (env_var("HL_DEBUG_COMPILER_LOGGER") == "1");
     if (do_compiler_logging) {
-        const bool obfuscate_compiler_logging = get_env_variable("HL_OBFUSCATE_COMPILER_LOGGER") == "1";
+        const bool obfuscate_compiler_logging = env_var("HL_OBFUSCATE_COMPILER_LOGGER") == "1";
         args.compiler_logger_factory =
             [obfuscate_compiler_logging, &args](const std::string &function_name, const Target &target) -> std::unique_ptr<CompilerLogger> {
             // rebuild generator_args from the map so that they are always canonical
@@ -899,6 +957,275 @@ gengen
     return 0;
 }
 
+// A Generator server runs the requests of many gengen invocations in one
+// process. Each connection to its socket carries one request: a pair of
+// arguments "--env" and "NAME=VALUE" for each of the generator_env_vars the
+// client has set, then the arguments of an ordinary invocation, each
+// argument terminated by a NUL, followed by an empty argument. The reply
+// is the exit code on a line of its own, followed by the error message, if
+// any.
+#ifndef _WIN32
+
+bool write_all(int fd, const std::string &data) {
+    size_t written = 0;
+    while (written < data.size()) {
+        ssize_t r = write(fd, data.data() + written, data.size() - written);
+        if (r <= 0) {
+            return false;
+        }
+        written += r;
+    }
+    return true;
+}
+
+bool read_request(int fd, std::vector<std::string> *args) {
+    std::string arg;
+    char buf[4096];
+    while (true) {
+        ssize_t r = read(fd, buf, sizeof(buf));
+        if (r <= 0) {
+            return false;
+        }
+        for (ssize_t i = 0; i < r; i++) {
+            if (buf[i] != 0) {
+                arg += buf[i];
+            } else if (arg.empty()) {
+                return true;
+            } else {
+                args->push_back(std::move(arg));
+                arg.clear();
+            }
+        }
+    }
+}
+
+bool make_socket_address(const std::string &socket_path, sockaddr_un *addr) {
+    memset(addr, 0, sizeof(*addr));
+    addr->sun_family = AF_UNIX;
+    if (socket_path.size() >= sizeof(addr->sun_path)) {
+        return false;
+    }
+    strncpy(addr->sun_path, socket_path.c_str(), sizeof(addr->sun_path) - 1);
+    return true;
+}
+
+// Run one request, catching any error so that it is reported to the
+// client rather than taking down the server.
+int run_generator_request(const std::vector<std::string> &args,
+                          const GeneratorFactoryProvider &generator_factory_provider,
+                          std::string *error) {
+    std::map<std::string, std::string> env;
+    size_t first = 0;
+    while (first + 1 < args.size() && args[first] == "--env") {
+        const std::string &var = args[first + 1];
+        const size_t eq = var.find('=');
+        if (eq == std::string::npos) {
+            *error = "Malformed environment variable in request: " + var + "\n";
+            return -1;
+        }
+        env[var.substr(0, eq)] = var.substr(eq + 1);
+        first += 2;
+    }
+
+    std::vector<char *> argv;
+    argv.push_back(const_cast<char *>("gengen"));
+    for (size_t i = first; i < args.size(); i++) {
+        argv.push_back(const_cast<char *>(args[i].c_str()));
+    }
+    argv.push_back(nullptr);
+    const int argc = (int)argv.size() - 1;
+    if (argc >= 2 && (!strcmp(argv[1], "--serve") || !strcmp(argv[1], "--client"))) {
+        *error = std::string(argv[1]) + " can't be sent to a Generator server\n";
+        return -1;
+    }
+#ifdef HALIDE_WITH_EXCEPTIONS
+    try {
+        return generate_filter_main_inner(argc, argv.data(), generator_factory_provider, &env);
+    } catch (::Halide::Error &err) {
+        *error = err.what();
+    } catch (std::exception &err) {
+        *error = err.what();
+    } catch (...) {
+        *error = "Unhandled exception: (unknown)\n";
+    }
+    return -1;
+#else
+    return generate_filter_main_inner(argc, argv.data(), generator_factory_provider, &env);
+#endif
+}
+
+int serve_generators(const std::string &socket_path, int num_threads,
+                     const GeneratorFactoryProvider &generator_factory_provider) {
+    sockaddr_un addr;
+    user_assert(make_socket_address(socket_path, &addr)) << "Socket path is too long: " << socket_path << "\n";
+
+    int listener = socket(AF_UNIX, SOCK_STREAM, 0);
+    user_assert(listener >= 0) << "Could not create a socket for the Generator server\n";
+    // Replace any socket left behind by a server that didn't shut down cleanly.
+    unlink(socket_path.c_str());
+    user_assert(bind(listener, (const sockaddr *)&addr, sizeof(addr)) == 0 && listen(listener, 128) == 0)
+        << "Could not listen on " << socket_path << "\n";
+
+    if (num_threads <= 0) {
+        num_threads = std::max(1, (int)std::thread::hardware_concurrency());
+    }
+    // Clients that go away early shouldn't take the server with them.
+    signal(SIGPIPE, SIG_IGN);
+
+    std::mutex mutex;
+    std::condition_variable cv;
+    std::deque<int> pending;
+    bool shutting_down = false;
+
+    const auto worker = [&]() {
+        while (true) {
+            int fd;
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                cv.wait(lock, [&]() { return !pending.empty() || shutting_down; });
+                if (pending.empty()) {
+                    return;
+                }
+                fd = pending.front();
+                pending.pop_front();
+            }
+
+            std::vector<std::string> args;
+            std::string error;
+            int result = -1;
+            if (!read_request(fd, &args)) {
+                error = "Malformed request\n";
+            } else if (args.size() == 1 && args[0] == "--shutdown") {
+                result = 0;
+                {
+                    std::lock_guard<std::mutex> lock(mutex);
+                    shutting_down = true;
+                }
+                cv.notify_all();
+                // Wake up the accept() in the main thread.
+                shutdown(listener, SHUT_RDWR);
+            } else {
+                result = run_generator_request(args, generator_factory_provider, &error);
+            }
+            (void)write_all(fd, std::to_string(result) + "\n" + error);
+            close(fd);
+        }
+    };
+
+    std::vector<std::thread> workers;
+    for (int i = 0; i < num_threads; i++) {
+        workers.emplace_back(worker);
+    }
+
+    while (true) {
+        int fd = accept(listener, nullptr, nullptr);
+        std::lock_guard<std::mutex> lock(mutex);
+        if (shutting_down) {
+            if (fd >= 0) {
+                close(fd);
+            }
+            break;
+        }
+        if (fd >= 0) {
+            pending.push_back(fd);
+            cv.notify_one();
+        }
+    }
+
+    for (auto &t : workers) {
+        t.join();
+    }
+    close(listener);
+    unlink(socket_path.c_str());
+    return 0;
+}
+
+int send_generator_request(const std::string &socket_path, int argc, char **argv) {
+    sockaddr_un addr;
+    user_assert(make_socket_address(socket_path, &addr)) << "Socket path is too long: " << socket_path << "\n";
+
+    // The server runs in its own working directory, so resolve relative
+    // paths here.
+    char cwd_buf[4096];
+    user_assert(getcwd(cwd_buf, sizeof(cwd_buf)) != nullptr) << "Could not get the current directory\n";
+    const std::string cwd = cwd_buf;
+    const auto absolute = [&](const std::string &path) {
+        return (path.empty() || path[0] == '/') ? path : cwd + "/" + path;
+    };
+    const bool shutdown_request = argc == 1 && !strcmp(argv[0], "--shutdown");
+    std::string request;
+    for (const char *name : generator_env_vars) {
+        const std::string value = get_env_variable(name);
+        if (!value.empty() && !shutdown_request) {
+            request += "--env";
+            request += '\0';
+            request += std::string(name) + "=" + value;
+            request += '\0';
+        }
+    }
+    for (int i = 0; i < argc; i++) {
+        std::string arg = argv[i];
+        if (i > 0 && !strcmp(argv[i - 1], "-o")) {
+            arg = absolute(arg);
+        } else if (i > 0 && !strcmp(argv[i - 1], "-p")) {
+            std::string sep;
+            arg.clear();
+            for (const auto &lib : split_string(argv[i], ",")) {
+                arg += sep + (lib.find('/') == std::string::npos ? lib : absolute(lib));
+                sep = ",";
+            }
+        }
+        user_assert(!arg.empty()) << "Empty arguments can't be sent to a Generator server\n";
+        request += arg;
+        request += '\0';
+    }
+    request += '\0';
+
+    // A server that is still starting up may not be listening yet, so
+    // retry for a few seconds before giving up.
+    int fd = -1;
+    for (int attempt = 0; attempt < 50; attempt++) {
+        fd = socket(AF_UNIX, SOCK_STREAM, 0);
+        user_assert(fd >= 0) << "Could not create a socket to connect to the Generator server\n";
+        if (connect(fd, (const sockaddr *)&addr, sizeof(addr)) == 0) {
+            break;
+        }
+        close(fd);
+        fd = -1;
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    }
+    user_assert(fd >= 0) << "Could not connect to a Generator server at " << socket_path << "\n";
+
+    user_assert(write_all(fd, request)) << "Could not send the request to the Generator server\n";
+    std::string reply;
+    char buf[4096];
+    ssize_t r;
+    while ((r = read(fd, buf, sizeof(buf))) > 0) {
+        reply.append(buf, r);
+    }
+    close(fd);
+
+    size_t newline = reply.find('\n');
+    user_assert(newline != std::string::npos) << "The Generator server did not reply\n";
+    std::cerr << reply.substr(newline + 1);
+    return std::atoi(reply.c_str());
+}
+
+#else
+
+int serve_generators(const std::string &socket_path, int num_threads,
+                     const GeneratorFactoryProvider &generator_factory_provider) {
+    user_error << "The Generator server is not supported on Windows\n";
+    return -1;
+}
+
+int send_generator_request(const std::string &socket_path, int argc, char **argv) {
+    user_error << "The Generator server is not supported on Windows\n";
+    return -1;
+}
+
+#endif
+
 class GeneratorsFromRegistry : public GeneratorFactoryProvider {
 public:
     GeneratorsFromRegistry() = default;
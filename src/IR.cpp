@@ -644,6 +644,7 @@ const char *const intrinsic_op_names[] = {
     "mod_round_to_zero",
     "mul_shift_right",
     "mux",
+    "nontemporal",
     "popcount",
     "prefetch",
     "promise_clamped",
@@ -668,6 +669,7 @@ const char *const intrinsic_op_names[] = {
     "signed_integer_overflow",
     "size_of_halide_buffer_t",
     "sorted_avg",
+    "store_fence",
     "strict_float",
     "stringify",
     "undef",
@@ -559,6 +559,11 @@ struct Call : public ExprNode<Call> {
         mod_round_to_zero,
         mul_shift_right,
         mux,
+
+        // Wraps the value of a Store to ask for it to be written with a
+        // non-temporal (streaming) store that bypasses the caches.
+        nontemporal,
+
         popcount,
         prefetch,
         promise_clamped,
@@ -588,6 +593,11 @@ struct Call : public ExprNode<Call> {
 
         // Compute (arg[0] + arg[1]) / 2, assuming arg[0] < arg[1].
         sorted_avg,
+
+        // Order all preceding stores, including non-temporal ones, before
+        // any subsequent memory accesses.
+        store_fence,
+
         strict_float,
         stringify,
         undef,
@@ -1,7 +1,9 @@
+#include <condition_variable>
 #include <cstdint>
 #include <mutex>
 #include <set>
 #include <string>
+#include <thread>
 
 #ifdef _WIN32
 #ifdef _MSC_VER
@@ -334,7 +336,7 @@ void JITModule::compile_module(std::unique_ptr<llvm::Module> m, const string &fu
     // Build TargetMachine
     llvm::orc::JITTargetMachineBuilder tm_builder(llvm::Triple(m->getTargetTriple()));
     tm_builder.setOptions(options);
-    tm_builder.setCodeGenOptLevel(CodeGenOpt::Aggressive);
+    tm_builder.setCodeGenOptLevel(is_fast_jit_tier(target) ? CodeGenOpt::None : CodeGenOpt::Aggressive);
     if (target.arch == Target::Arch::RISCV) {
         tm_builder.setCodeModel(llvm::CodeModel::Medium);
     }
@@ -929,7 +931,9 @@ JITModule &make_module(llvm::Module *for_module, Target target,
 
         std::vector<std::string> halide_exports(halide_exports_unique.begin(), halide_exports_unique.end());
 
-        runtime.compile_module(std::move(module), "", target, deps, halide_exports);
+        // The shared runtime outlives any one pipeline, so always
+        // optimize it fully.
+        runtime.compile_module(std::move(module), "", target.without_feature(Target::TieredJIT), deps, halide_exports);
 
         if (runtime_kind == MainShared) {
             runtime_internal_handlers.custom_print =
@@ -1184,6 +1188,99 @@ Target JITCache::get_compiled_jit_target() const {
     return jit_target;
 }
 
+namespace {
+
+// The background compilations that are still running. They don't hold up
+// the JITCaches that started them, but exiting waits for them, so that
+// none of them is still using LLVM while it is torn down.
+struct BackgroundCompiles {
+    std::mutex mutex;
+    std::condition_variable done;
+    int running = 0;
+
+    ~BackgroundCompiles() {
+        std::unique_lock<std::mutex> lock(mutex);
+        done.wait(lock, [&]() { return running == 0; });
+    }
+};
+
+BackgroundCompiles &background_compiles() {
+    static BackgroundCompiles compiles;
+    return compiles;
+}
+
+std::atomic<int> tier_up_swaps{0};
+
+}  // namespace
+
+// The part of a JITTierUp that the compiling thread also holds on to, so
+// that it can outlive the JITTierUp.
+struct JITTierUpState {
+    // The entry point that calls go through. It starts out as the one
+    // of the quickly compiled module.
+    std::atomic<JITModule::argv_wrapper> argv_function;
+    // Set once nothing can call the optimized code any more.
+    std::atomic<bool> cancelled{false};
+    JITModule optimized;
+
+    explicit JITTierUpState(JITModule::argv_wrapper initial)
+        : argv_function(initial) {
+    }
+};
+
+struct JITTierUp {
+    std::shared_ptr<JITTierUpState> state;
+
+    ~JITTierUp() {
+        // Don't wait for the compilation. If it hasn't started yet it
+        // won't, and otherwise its result is thrown away.
+        state->cancelled = true;
+    }
+};
+
+int jit_tier_up_swaps() {
+    return tier_up_swaps;
+}
+
+void JITCache::compile_in_background(const Module &m, const LoweredFunc &fn,
+                                     const std::vector<JITModule> &dependencies) {
+    auto state = std::make_shared<JITTierUpState>(jit_module.argv_function());
+    tier_up = std::make_shared<JITTierUp>();
+    tier_up->state = state;
+    {
+        BackgroundCompiles &compiles = background_compiles();
+        std::lock_guard<std::mutex> lock(compiles.mutex);
+        compiles.running++;
+    }
+    std::thread([state, m, fn, deps = dependencies]() mutable {
+        if (!state->cancelled) {
+#ifdef HALIDE_WITH_EXCEPTIONS
+            try {
+#endif
+                JITModule optimized(m, fn, deps);
+                if (!state->cancelled) {
+                    state->optimized = std::move(optimized);
+                    state->argv_function.store(state->optimized.argv_function());
+                    tier_up_swaps++;
+                    debug(2) << "Swapped in optimized code for " << fn.name << "\n";
+                }
+#ifdef HALIDE_WITH_EXCEPTIONS
+            } catch (Halide::Error &err) {
+                // Keep calling the quickly compiled code.
+                debug(1) << "Background compilation of " << fn.name << " failed: " << err.what() << "\n";
+            }
+#endif
+        }
+        // Release everything that refers to LLVM before saying we're done.
+        state.reset();
+        deps.clear();
+        BackgroundCompiles &compiles = background_compiles();
+        std::lock_guard<std::mutex> lock(compiles.mutex);
+        compiles.running--;
+        compiles.done.notify_all();
+    }).detach();
+}
+
 int JITCache::call_jit_code(const Target &target, const void *const *args) {
 #if defined(__has_feature)
 #if __has_feature(memory_sanitizer)
@@ -1197,7 +1294,7 @@ int JITCache::call_jit_code(const Target &target, const void *const *args) {
         internal_assert(wasm_module.contents.defined());
         return wasm_module.run(args);
     } else {
-        auto argv_wrapper = jit_module.argv_function();
+        auto argv_wrapper = tier_up ? tier_up->state->argv_function.load() : jit_module.argv_function();
         internal_assert(argv_wrapper != nullptr);
         return argv_wrapper(args);
     }
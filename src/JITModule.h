@@ -283,6 +283,12 @@ public:
 
 void *get_symbol_address(const char *s);
 
+struct JITTierUp;
+
+/** The number of times Target::TieredJIT has swapped the optimized code
+ * of a pipeline in for its quickly compiled code, in this process. */
+int jit_tier_up_swaps();
+
 struct JITCache {
     Target jit_target;
     // Arguments for all inputs and outputs
@@ -290,6 +296,9 @@ struct JITCache {
     std::map<std::string, JITExtern> jit_externs;
     JITModule jit_module;
     WasmModule wasm_module;
+    // With Target::TieredJIT, the optimized code that replaces
+    // jit_module once it has been compiled in the background.
+    std::shared_ptr<JITTierUp> tier_up;
 
     JITCache() = default;
     JITCache(Target jit_target,
@@ -302,6 +311,13 @@ struct JITCache {
 
     int call_jit_code(const Target &target, const void *const *args);
 
+    /** Compile a module on a background thread, and call it instead
+     * of jit_module once it is ready. Destroying the last copy of this
+     * JITCache doesn't wait for the compilation; its result is just
+     * discarded. Exiting the process does wait for it. */
+    void compile_in_background(const Module &m, const LoweredFunc &fn,
+                               const std::vector<JITModule> &dependencies);
+
     void finish_profiling(JITUserContext *context);
 };
 
@@ -3,6 +3,11 @@
 #include "LLVM_Headers.h"
 #include "Target.h"
 
+#include <algorithm>
+#include <iostream>
+#include <map>
+#include <mutex>
+
 namespace Halide {
 
 using std::string;
@@ -781,8 +786,10 @@ std::unique_ptr<llvm::Module> link_with_wasm_jit_runtime(llvm::LLVMContext *c, c
     return std::move(modules[0]);
 }
 
+namespace {
+
 /** Create an llvm module containing the support code for a given target. */
-std::unique_ptr<llvm::Module> get_initial_module_for_target(Target t, llvm::LLVMContext *c, bool for_shared_jit_runtime, bool just_gpu) {
+std::unique_ptr<llvm::Module> link_initial_module_for_target(Target t, llvm::LLVMContext *c, bool for_shared_jit_runtime, bool just_gpu) {
     enum InitialModuleType {
         ModuleAOT,
         ModuleAOTNoRuntime,
@@ -1266,6 +1273,139 @@ std::unique_ptr<llvm::Module> get_initial_module_for_target(Target t, llvm::LLVM
     return std::move(modules[0]);
 }
 
+// A linked initial module, serialized so that it can be loaded into any
+// LLVMContext.
+struct CachedInitialModule {
+    llvm::SmallVector<char, 0> bitcode;
+    std::string id;
+};
+
+struct InitialModuleCacheEntry {
+    int requests = 0;
+    uint64_t last_use = 0;
+    std::shared_ptr<const CachedInitialModule> module;
+};
+
+struct InitialModuleCache {
+    // At most this many target/kind combinations are tracked. Past that,
+    // the least recently requested one is dropped along with its module.
+    static constexpr size_t max_entries = 8;
+
+    std::mutex mutex;
+    std::map<std::string, InitialModuleCacheEntry> entries;
+    uint64_t clock = 0;
+    // How many times the runtime modules have actually been linked.
+    int links = 0;
+
+    // Must be called with the mutex held.
+    InitialModuleCacheEntry &lookup(const std::string &key) {
+        auto it = entries.find(key);
+        if (it == entries.end()) {
+            if (entries.size() >= max_entries) {
+                entries.erase(std::min_element(entries.begin(), entries.end(),
+                                               [](const auto &a, const auto &b) {
+                                                   return a.second.last_use < b.second.last_use;
+                                               }));
+            }
+            it = entries.emplace(key, InitialModuleCacheEntry()).first;
+        }
+        it->second.last_use = ++clock;
+        return it->second;
+    }
+};
+
+InitialModuleCache &initial_module_cache() {
+    static InitialModuleCache cache;
+    return cache;
+}
+
+}  // namespace
+
+// Linking the initial module means parsing and linking dozens of runtime
+// modules, and is a fixed cost of every compile. The result depends only
+// on the target and the kind of module, so it can be kept as bitcode, and
+// later requests can just parse that into their own context. Serializing it
+// isn't free either, and most processes compile for each target once, so
+// it's only kept from the second request for the same target and kind.
+std::unique_ptr<llvm::Module> get_initial_module_for_target(Target t, llvm::LLVMContext *c, bool for_shared_jit_runtime, bool just_gpu) {
+    InitialModuleCache &cache = initial_module_cache();
+
+    const std::string key = t.to_string() +
+                            (for_shared_jit_runtime ? "/shared" : "") +
+                            (just_gpu ? "/gpu" : "");
+    std::shared_ptr<const CachedInitialModule> cached;
+    bool keep = false;
+    {
+        std::lock_guard<std::mutex> lock(cache.mutex);
+        InitialModuleCacheEntry &e = cache.lookup(key);
+        cached = e.module;
+        keep = !cached && ++e.requests > 1;
+        if (!cached) {
+            cache.links++;
+        }
+    }
+
+    if (cached) {
+        return parse_bitcode_file(llvm::StringRef(cached->bitcode.data(), cached->bitcode.size()),
+                                  c, cached->id.c_str());
+    }
+
+    std::unique_ptr<llvm::Module> module = link_initial_module_for_target(t, c, for_shared_jit_runtime, just_gpu);
+
+    if (keep) {
+        auto entry = std::make_shared<CachedInitialModule>();
+        entry->id = module->getModuleIdentifier();
+        llvm::raw_svector_ostream stream(entry->bitcode);
+        llvm::WriteBitcodeToFile(*module, stream);
+        std::lock_guard<std::mutex> lock(cache.mutex);
+        InitialModuleCacheEntry &e = cache.lookup(key);
+        if (!e.module) {
+            e.module = std::move(entry);
+        }
+    }
+
+    return module;
+}
+
+void llvm_runtime_linker_test() {
+    // A feature combination nothing else in this process asks for, so
+    // that the cache entry starts out empty.
+    const Target t = get_host_target().with_feature(Target::NoBoundsQuery).with_feature(Target::NoAsserts);
+
+    const auto links = []() {
+        InitialModuleCache &cache = initial_module_cache();
+        std::lock_guard<std::mutex> lock(cache.mutex);
+        return cache.links;
+    };
+    const auto initial_module_ir = [&]() {
+        llvm::LLVMContext context;
+        std::unique_ptr<llvm::Module> module = get_initial_module_for_target(t, &context);
+        std::string ir;
+        llvm::raw_string_ostream stream(ir);
+        module->print(stream, nullptr);
+        return stream.str();
+    };
+
+    const int links_before = links();
+
+    // The first two requests link; the second one keeps the result.
+    const std::string first = initial_module_ir();
+    const std::string second = initial_module_ir();
+    internal_assert(links() == links_before + 2)
+        << "Expected the runtime to be linked twice, but it was linked " << links() - links_before << " times\n";
+
+    // Later requests for the same target reuse it without linking again.
+    const std::string third = initial_module_ir();
+    const std::string fourth = initial_module_ir();
+    internal_assert(links() == links_before + 2)
+        << "The cached runtime module was linked again\n";
+
+    internal_assert(first == second && second == third && third == fourth)
+        << "The cached runtime module differs from the linked one\n";
+
+    std::cout << "LLVM runtime linker test passed\n";
+}
+
 #ifdef WITH_NVPTX
 std::unique_ptr<llvm::Module> get_initial_module_for_ptx_device(Target target, llvm::LLVMContext *c) {
     std::vector<std::unique_ptr<llvm::Module>> modules;
@@ -40,6 +40,8 @@ void add_bitcode_to_module(llvm::LLVMContext *context, llvm::Module &module,
 std::unique_ptr<llvm::Module> link_with_wasm_jit_runtime(llvm::LLVMContext *c, const Target &t,
                                                          std::unique_ptr<llvm::Module> extra_module);
 
+void llvm_runtime_linker_test();
+
 }  // namespace Internal
 }  // namespace Halide
 
@@ -192,6 +192,17 @@ class LoopCarryOverLoop : public IRMutator {
     const Scope<> &in_consume;
 
     int max_carried_values;
+    int register_bits;
+
+    /** The number of registers needed to hold a value of the given
+     * type. If we don't know the register size, every value counts as
+     * one register. */
+    int registers_used(Type t) const {
+        if (register_bits <= 0) {
+            return 1;
+        }
+        return std::max(1, (t.bits() * t.lanes() + register_bits - 1) / register_bits);
+    }
 
     using IRMutator::visit;
 
@@ -364,17 +375,28 @@ class LoopCarryOverLoop : public IRMutator {
         // spray stack spills everywhere. This is ugly, because we're
         // relying on a heuristic.
         vector<vector<int>> trimmed;
-        size_t sz = 0;
+        int budget = max_carried_values;
         for (const vector<int> &c : chains) {
-            if (sz + c.size() > (size_t)max_carried_values) {
-                if (sz < (size_t)max_carried_values - 1) {
-                    // Take a partial chain
-                    trimmed.emplace_back(c.begin(), c.begin() + max_carried_values - sz);
+            size_t n = 0;
+            int cost = 0;
+            while (n < c.size()) {
+                int c_n = registers_used(loads[c[n]][0]->type);
+                if (cost + c_n > budget) {
+                    break;
                 }
+                cost += c_n;
+                n++;
+            }
+            if (n < 2) {
+                // A chain of one value doesn't carry anything.
+                break;
+            }
+            // Take the chain, or as much of it as fits.
+            trimmed.emplace_back(c.begin(), c.begin() + n);
+            budget -= cost;
+            if (n < c.size()) {
                 break;
             }
-            trimmed.push_back(c);
-            sz += c.size();
         }
         chains.swap(trimmed);
 
@@ -493,8 +515,8 @@ class LoopCarryOverLoop : public IRMutator {
     }
 
 public:
-    LoopCarryOverLoop(const string &var, const Scope<> &s, int max_carried_values)
-        : in_consume(s), max_carried_values(max_carried_values) {
+    LoopCarryOverLoop(const string &var, const Scope<> &s, int max_carried_values, int register_bits)
+        : in_consume(s), max_carried_values(max_carried_values), register_bits(register_bits) {
         linear.push(var, 1);
     }
 
@@ -512,6 +534,7 @@ class LoopCarry : public IRMutator {
     using IRMutator::visit;
 
     int max_carried_values;
+    int register_bits;
     Scope<> in_consume;
 
     Stmt visit(const ProducerConsumer *op) override {
@@ -528,7 +551,7 @@ class LoopCarry : public IRMutator {
         if (op->for_type == ForType::Serial && !is_const_one(op->extent)) {
             Stmt stmt;
             Stmt body = mutate(op->body);
-            LoopCarryOverLoop carry(op->name, in_consume, max_carried_values);
+            LoopCarryOverLoop carry(op->name, in_consume, max_carried_values, register_bits);
             body = carry.mutate(body);
             if (body.same_as(op->body)) {
                 stmt = op;
@@ -551,15 +574,15 @@ class LoopCarry : public IRMutator {
     }
 
 public:
-    LoopCarry(int max_carried_values)
-        : max_carried_values(max_carried_values) {
+    LoopCarry(int max_carried_values, int register_bits)
+        : max_carried_values(max_carried_values), register_bits(register_bits) {
     }
 };
 
 }  // namespace
 
-Stmt loop_carry(Stmt s, int max_carried_values) {
-    s = LoopCarry(max_carried_values).mutate(s);
+Stmt loop_carry(Stmt s, int max_carried_values, int register_bits) {
+    s = LoopCarry(max_carried_values, register_bits).mutate(s);
     return s;
 }
 
@@ -10,9 +10,11 @@ namespace Internal {
  * induction variables instead of redoing the load. If the loads are
  * predicated, the predicates need to match. Can be an optimization or
  * pessimization depending on how good the L1 cache is on the architecture
- * and how many memory issue slots there are. Currently only intended
- * for Hexagon. */
-Stmt loop_carry(Stmt, int max_carried_values = 8);
+ * and how many memory issue slots there are. At most
+ * max_carried_values registers are used for carried values. If
+ * register_bits is non-zero, values wider than a register count as
+ * several registers; otherwise each value counts as one. */
+Stmt loop_carry(Stmt, int max_carried_values = 8, int register_bits = 0);
 
 }  // namespace Internal
 }  // namespace Halide
@@ -17,6 +17,7 @@
 #include "CSE.h"
 #include "CanonicalizeGPUVars.h"
 #include "ClampUnsafeAccesses.h"
+#include "CoalesceAllocations.h"
 #include "CompilerLogger.h"
 #include "Debug.h"
 #include "DebugArguments.h"
@@ -43,6 +44,7 @@
 #include "LowerParallelTasks.h"
 #include "LowerWarpShuffles.h"
 #include "Memoization.h"
+#include "NontemporalStores.h"
 #include "OffloadGPULoops.h"
 #include "PartitionLoops.h"
 #include "Prefetch.h"
@@ -230,6 +232,12 @@ void lower_impl(const vector<Function> &output_funcs,
     s = debug_to_file(s, outputs, env);
     log("Lowering after injecting debug_to_file calls:", s);
 
+    if (t.has_feature(Target::AutoPrefetch)) {
+        debug(1) << "Injecting automatic prefetches...\n";
+        s = inject_auto_prefetch(s, env);
+        log("Lowering after injecting automatic prefetches:", s);
+    }
+
     debug(1) << "Injecting prefetches...\n";
     s = inject_prefetch(s, env);
     log("Lowering after injecting prefetches:", s);
@@ -386,6 +394,12 @@ void lower_impl(const vector<Function> &output_funcs,
         log("Lowering after injecting warp shuffles:", s);
     }
 
+    if (t.has_feature(Target::CoalesceAllocations)) {
+        debug(1) << "Coalescing allocations...\n";
+        s = coalesce_allocations(s, t);
+        log("Lowering after coalescing allocations:", s);
+    }
+
     debug(1) << "Simplifying...\n";
     s = common_subexpression_elimination(s);
 
@@ -420,6 +434,10 @@ void lower_impl(const vector<Function> &output_funcs,
     s = hoist_prefetches(s);
     log("Lowering after hoisting prefetches:", s);
 
+    debug(1) << "Injecting non-temporal stores...\n";
+    s = inject_nontemporal_stores(s, env);
+    log("Lowering after injecting non-temporal stores:", s);
+
     debug(1) << "Lowering after final simplification:\n"
              << s << "\n\n";
 
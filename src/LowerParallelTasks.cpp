@@ -155,6 +155,29 @@ int calculate_min_threads(const Stmt &body) {
     return min_threads.result;
 }
 
+// Does a Stmt contain any Fork or Acquire nodes, which can only be
+// run as tasks on the Halide thread pool.
+class UsesAsyncTasks : public IRVisitor {
+    using IRVisitor::visit;
+
+    void visit(const Fork *op) override {
+        result = true;
+    }
+
+    void visit(const Acquire *op) override {
+        result = true;
+    }
+
+public:
+    bool result = false;
+};
+
+bool uses_async_tasks(const Stmt &body) {
+    UsesAsyncTasks uses;
+    body.accept(&uses);
+    return uses.result;
+}
+
 struct LowerParallelTasks : public IRMutator {
 
     /** Codegen a call to do_parallel_tasks */
@@ -176,6 +199,14 @@ struct LowerParallelTasks : public IRMutator {
     Stmt visit(const For *op) override {
         const Acquire *acquire = op->body.as<Acquire>();
 
+        // When emitting C++ with OpenMP, plain parallel loops are left
+        // for CodeGen_C to turn into "omp parallel for".
+        if (op->for_type == ForType::Parallel &&
+            target.has_feature(Target::COpenMP) &&
+            !uses_async_tasks(op->body)) {
+            return IRMutator::visit(op);
+        }
+
         if (op->for_type == ForType::Parallel ||
             (op->for_type == ForType::Serial &&
              acquire &&
@@ -0,0 +1,103 @@
+#include <set>
+
+#include "Function.h"
+#include "IRMutator.h"
+#include "IROperator.h"
+#include "NontemporalStores.h"
+
+namespace Halide {
+namespace Internal {
+
+using std::map;
+using std::set;
+using std::string;
+
+namespace {
+
+Stmt store_fence() {
+    return Evaluate::make(Call::make(Int(32), Call::store_fence, {}, Call::Intrinsic));
+}
+
+class InjectNontemporalStores : public IRMutator {
+    using IRMutator::visit;
+
+    // The Funcs scheduled with store_nontemporal, and the buffers
+    // that back them.
+    const set<string> &funcs, &buffers;
+
+    // How many productions of such Funcs we are inside.
+    int in_production = 0;
+
+    Stmt visit(const ProducerConsumer *op) override {
+        if (op->is_producer && funcs.count(op->name)) {
+            in_production++;
+            Stmt body = mutate(op->body);
+            in_production--;
+            body = Block::make(body, store_fence());
+            return ProducerConsumer::make(op->name, op->is_producer, body);
+        } else {
+            return IRMutator::visit(op);
+        }
+    }
+
+    Stmt visit(const For *op) override {
+        if (op->device_api != DeviceAPI::None &&
+            op->device_api != DeviceAPI::Host) {
+            // Device code gets compiled by other backends.
+            return op;
+        }
+        Stmt body = mutate(op->body);
+        if (in_production && op->for_type == ForType::Parallel) {
+            // Each task must drain its own streaming stores before
+            // the parallel loop completes.
+            body = Block::make(body, store_fence());
+        }
+        if (body.same_as(op->body)) {
+            return op;
+        }
+        return For::make(op->name, op->min, op->extent, op->for_type, op->device_api, body);
+    }
+
+    Stmt visit(const Store *op) override {
+        Stmt stmt = IRMutator::visit(op);
+        if (buffers.count(op->name)) {
+            op = stmt.as<Store>();
+            internal_assert(op);
+            Expr value = Call::make(op->value.type(), Call::nontemporal, {op->value}, Call::PureIntrinsic);
+            stmt = Store::make(op->name, value, op->index, op->param, op->predicate, op->alignment);
+        }
+        return stmt;
+    }
+
+public:
+    InjectNontemporalStores(const set<string> &funcs, const set<string> &buffers)
+        : funcs(funcs), buffers(buffers) {
+    }
+};
+
+}  // namespace
+
+Stmt inject_nontemporal_stores(const Stmt &s, const map<string, Function> &env) {
+    set<string> funcs, buffers;
+    for (const auto &it : env) {
+        const Function &f = it.second;
+        if (!f.schedule().nontemporal()) {
+            continue;
+        }
+        funcs.insert(f.name());
+        if (f.outputs() > 1) {
+            for (int i = 0; i < f.outputs(); i++) {
+                buffers.insert(f.name() + "." + std::to_string(i));
+            }
+        } else {
+            buffers.insert(f.name());
+        }
+    }
+    if (funcs.empty()) {
+        return s;
+    }
+    return InjectNontemporalStores(funcs, buffers).mutate(s);
+}
+
+}  // namespace Internal
+}  // namespace Halide
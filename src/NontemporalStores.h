@@ -0,0 +1,30 @@
+#ifndef HALIDE_NONTEMPORAL_STORES_H
+#define HALIDE_NONTEMPORAL_STORES_H
+
+/** \file
+ * Defines the lowering pass that marks the stores to Funcs scheduled
+ * with Func::store_nontemporal.
+ */
+
+#include <map>
+#include <string>
+
+#include "Expr.h"
+
+namespace Halide {
+namespace Internal {
+
+class Function;
+
+/** Wrap the values stored to Funcs scheduled with store_nontemporal in
+ * the nontemporal intrinsic, which tells codegen to use streaming
+ * stores, and inject a store_fence at the end of their production and
+ * at the end of each parallel task within it. Stores inside device
+ * loops are left alone. Must run after the last pass that inspects
+ * the values of stores. */
+Stmt inject_nontemporal_stores(const Stmt &s, const std::map<std::string, Function> &env);
+
+}  // namespace Internal
+}  // namespace Halide
+
+#endif
@@ -14,6 +14,7 @@
 #include "Scope.h"
 #include "Simplify.h"
 #include "Substitute.h"
+#include <algorithm>
 #include <unordered_map>
 #include <utility>
 
@@ -24,6 +25,7 @@ namespace {
 
 class OptimizeShuffles : public IRMutator {
     int lut_alignment;
+    int max_lut_bytes;
     Scope<Interval> bounds;
     std::vector<std::pair<std::string, Expr>> lets;
 
@@ -83,18 +85,24 @@ class OptimizeShuffles : public IRMutator {
             // TODO(psuriana): We shouldn't mess with predicated load for now.
             return IRMutator::visit(op);
         }
-        if (!op->type.is_vector() || op->index.as<Ramp>()) {
+        if (!op->type.is_vector() || op->type.is_bool() || op->index.as<Ramp>()) {
             // Don't handle scalar or simple vector loads.
             return IRMutator::visit(op);
         }
 
+        // The largest LUT we can shuffle from, in elements.
+        int max_lut_size = 256;
+        if (max_lut_bytes > 0) {
+            max_lut_size = std::min(max_lut_size, max_lut_bytes / op->type.bytes());
+        }
+
         Expr index = mutate(op->index);
         Interval unaligned_index_bounds = bounds_of_expr_in_scope(index, bounds);
         if (unaligned_index_bounds.is_bounded()) {
             // We want to try both the unaligned and aligned
             // bounds. The unaligned bounds might fit in 256 elements,
             // while the aligned bounds do not.
-            int align = lut_alignment / op->type.bytes();
+            int align = std::max(1, lut_alignment / op->type.bytes());
             Interval aligned_index_bounds = {
                 (unaligned_index_bounds.min / align) * align,
                 ((unaligned_index_bounds.max + align) / align) * align - 1};
@@ -105,17 +113,22 @@ class OptimizeShuffles : public IRMutator {
                 index_span = common_subexpression_elimination(index_span);
                 index_span = simplify(index_span);
 
-                if (can_prove(index_span < 256)) {
+                if (can_prove(index_span < max_lut_size) &&
+                    (align > 1 || as_const_int(index_span))) {
                     // This is a lookup within an up to 256 element array. We
-                    // can use dynamic_shuffle for this.
-                    int const_extent = as_const_int(index_span) ? *as_const_int(index_span) + 1 : 256;
+                    // can use dynamic_shuffle for this. If we aren't padding
+                    // the allocation, the span must be known so that we don't
+                    // load past the end of the table.
+                    int const_extent = as_const_int(index_span) ? *as_const_int(index_span) + 1 : max_lut_size;
                     Expr base = simplify(index_bounds.min);
 
                     // Load all of the possible indices loaded from the
                     // LUT. Note that for clamped ramps, this loads up to 1
                     // vector past the max, so we will add padding to the
                     // allocation accordingly (if we're the one that made it).
-                    allocations_to_pad.insert(op->name);
+                    if (align > 1) {
+                        allocations_to_pad.insert(op->name);
+                    }
                     Expr lut = Load::make(op->type.with_lanes(const_extent), op->name,
                                           Ramp::make(base, 1, const_extent),
                                           op->image, op->param, const_true(const_extent), alignment);
@@ -138,14 +151,14 @@ class OptimizeShuffles : public IRMutator {
     }
 
 public:
-    OptimizeShuffles(int lut_alignment)
-        : lut_alignment(lut_alignment) {
+    OptimizeShuffles(int lut_alignment, int max_lut_bytes)
+        : lut_alignment(lut_alignment), max_lut_bytes(max_lut_bytes) {
     }
 };
 }  // namespace
 
-Stmt optimize_shuffles(Stmt s, int lut_alignment) {
-    s = OptimizeShuffles(lut_alignment).mutate(s);
+Stmt optimize_shuffles(Stmt s, int lut_alignment, int max_lut_bytes) {
+    s = OptimizeShuffles(lut_alignment, max_lut_bytes).mutate(s);
     return s;
 }
 
@@ -12,8 +12,10 @@ namespace Halide {
 namespace Internal {
 
 /* Replace indirect loads with dynamic_shuffle intrinsics where
-possible. */
-Stmt optimize_shuffles(Stmt s, int lut_alignment);
+possible. The LUT is loaded from an address aligned to lut_alignment
+bytes if that keeps it under 256 elements. If max_lut_bytes is
+non-zero, LUTs are also limited to that many bytes. */
+Stmt optimize_shuffles(Stmt s, int lut_alignment, int max_lut_bytes = 0);
 
 }  // namespace Internal
 }  // namespace Halide
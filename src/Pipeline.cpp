@@ -1,12 +1,19 @@
 #include <algorithm>
 #include <atomic>
+#include <exception>
+#include <mutex>
+#include <set>
+#include <thread>
 #include <utility>
 
 #include "Argument.h"
 #include "Callable.h"
 #include "CodeGen_Internal.h"
+#include "DirtyRegion.h"
 #include "FindCalls.h"
 #include "Func.h"
+#include "IRMutator.h"
+#include "ImageParam.h"
 #include "IRVisitor.h"
 #include "InferArguments.h"
 #include "LLVM_Output.h"
@@ -15,6 +22,7 @@
 #include "Pipeline.h"
 #include "PrintLoopNest.h"
 #include "RealizationOrder.h"
+#include "Simplify.h"
 #include "WasmExecutor.h"
 
 using namespace Halide::Internal;
@@ -50,6 +58,73 @@ std::map<OutputFileType, std::string> static_library_outputs(const string &filen
     return outputs;
 }
 
+// A copy of a module with the same contents, to be compiled for a
+// different target.
+Module retarget_module(const Module &m, const Target &t) {
+    Module result(m.name(), t, m.get_metadata_name_map());
+    for (const auto &b : m.buffers()) {
+        result.append(b);
+    }
+    for (const auto &f : m.functions()) {
+        result.append(f);
+    }
+    for (const auto &sub : m.submodules()) {
+        result.append(sub);
+    }
+    result.set_any_strict_float(m.any_strict_float());
+    return result;
+}
+
+// Replace the values of the lets that unpack the mins, extents and
+// strides of buffer arguments with constants.
+class SubstituteBufferShapes : public IRMutator {
+    const std::map<std::string, int> &shape;
+
+    using IRMutator::visit;
+
+    Stmt visit(const LetStmt *op) override {
+        auto it = shape.find(op->name);
+        if (it != shape.end()) {
+            return LetStmt::make(op->name, it->second, mutate(op->body));
+        }
+        return IRMutator::visit(op);
+    }
+
+public:
+    SubstituteBufferShapes(const std::map<std::string, int> &shape)
+        : shape(shape) {
+    }
+};
+
+// A copy of a lowered JIT module specialized to the shapes of the
+// buffers passed to its entry point in argv. The lets are substituted in
+// every function, since the closures of parallel tasks unpack their own
+// copies of them.
+Module specialize_to_shapes(const Module &m, const std::string &entry_point, const void *const *argv) {
+    std::map<std::string, int> shape;
+    const LoweredFunc entry = m.get_function_by_name(entry_point);
+    for (size_t i = 0; i < entry.args.size(); i++) {
+        const LoweredArgument &arg = entry.args[i];
+        if (!arg.is_buffer()) {
+            continue;
+        }
+        const halide_buffer_t *buf = (const halide_buffer_t *)argv[i];
+        for (int d = 0; d < buf->dimensions; d++) {
+            const std::string dim = std::to_string(d);
+            shape[arg.name + ".min." + dim] = buf->dim[d].min;
+            shape[arg.name + ".extent." + dim] = buf->dim[d].extent;
+            shape[arg.name + ".stride." + dim] = buf->dim[d].stride;
+        }
+    }
+
+    Module result = retarget_module(m, m.target());
+    SubstituteBufferShapes substitute_shapes(shape);
+    for (LoweredFunc &f : result.functions()) {
+        f.body = simplify(substitute_shapes.mutate(f.body));
+    }
+    return result;
+}
+
 std::map<OutputFileType, std::string> object_file_outputs(const string &filename_prefix, const Target &target) {
     auto ext = get_output_info(target);
     std::map<OutputFileType, std::string> outputs = {
@@ -104,6 +179,36 @@ public:
     JITCallArgs &operator=(JITCallArgs &&other) = delete;
 };
 
+/** The compute_root intermediates of a Pipeline, kept in buffers
+ * between calls to realize_dirty_region. Each cached Func, and the
+ * output, is computed by a Pipeline of its own that reads the other
+ * cached Funcs from their buffers. These Pipelines are made from a copy
+ * of the Funcs, so later changes to their schedules are not seen until
+ * the cache is invalidated. */
+struct DirtyRegionCache {
+    struct Stage {
+        std::string name;
+        Pipeline pipeline;
+        // The buffer of a cached Func, and the ImageParam the other
+        // stages read it through. Both are undefined for the output.
+        ImageParam param;
+        Buffer<> buffer;
+    };
+
+    // The cached Funcs in realization order, followed by the output.
+    // Empty if nothing can be cached.
+    vector<Stage> stages;
+
+    // The stages have been made.
+    bool built = false;
+
+    // The buffers have been filled for outputs with this shape, by code
+    // compiled for this target.
+    bool filled = false;
+    Region region;
+    Target target;
+};
+
 }  // namespace Internal
 
 struct PipelineContents {
@@ -115,10 +220,14 @@ struct PipelineContents {
     // Cached jit-compiled code
     JITCache jit_cache;
 
+    // Intermediate buffers kept by realize_dirty_region
+    DirtyRegionCache dirty_region_cache;
+
     /** Clear all cached state */
     void invalidate_cache() {
         module = Module("", Target());
         jit_cache = JITCache();
+        dirty_region_cache = DirtyRegionCache();
     }
 
     // The outputs
@@ -214,6 +323,7 @@ vector<Func> Pipeline::outputs() const {
 }
 
 /* static */
+// Only use this while holding plugin_mutex().
 std::map<std::string, AutoSchedulerFn> &Pipeline::get_autoscheduler_map() {
     static std::map<std::string, AutoSchedulerFn> autoschedulers = {};
     return autoschedulers;
@@ -221,6 +331,7 @@ std::map<std::string, AutoSchedulerFn> &Pipeline::get_autoscheduler_map() {
 
 /* static */
 AutoSchedulerFn Pipeline::find_autoscheduler(const std::string &autoscheduler_name) {
+    std::lock_guard<std::recursive_mutex> lock(plugin_mutex());
     const auto &m = get_autoscheduler_map();
     auto it = m.find(autoscheduler_name);
     if (it == m.end()) {
@@ -252,6 +363,7 @@ AutoSchedulerResults Pipeline::apply_autoscheduler(const Target &target, const A
 
 /* static */
 void Pipeline::add_autoscheduler(const std::string &autoscheduler_name, const AutoSchedulerFn &autoscheduler) {
+    std::lock_guard<std::recursive_mutex> lock(plugin_mutex());
     auto &m = get_autoscheduler_map();
     user_assert(m.find(autoscheduler_name) == m.end()) << "'" << autoscheduler_name << "' is already registered as an autoscheduler.\n";
     m[autoscheduler_name] = autoscheduler;
@@ -603,13 +715,21 @@ Callable Pipeline::compile_to_callable(const std::vector<Argument> &args_in, con
 
     Module module = compile_to_module(args, generate_function_name(), target).resolve_submodules();
 
-    auto jit_cache = compile_jit_cache(module, std::move(args), contents->outputs, get_jit_externs(), target);
+    auto jit_cache = compile_jit_cache(module, args, contents->outputs, get_jit_externs(), target);
+
+    // Used by Callable::specialize_on_shapes().
+    auto compile_specialized = [module, args, outputs = contents->outputs,
+                                jit_externs = get_jit_externs(), target](const void *const *argv) {
+        std::string name = sanitize_function_name(outputs[0].name());
+        Module specialized = specialize_to_shapes(module, name, argv);
+        return compile_jit_cache(specialized, args, outputs, jit_externs, target);
+    };
 
     // Save the jit_handlers and jit_externs as they were at the time this
     // Callable was created, in case the Pipeline's version is mutated in
     // between creation and call -- we want the Callable to remain immutable
     // after creation, regardless of what you do to the Func.
-    return Callable(module.name(), jit_handlers(), get_jit_externs(), std::move(jit_cache));
+    return Callable(module.name(), jit_handlers(), get_jit_externs(), std::move(jit_cache), std::move(compile_specialized));
 }
 
 /*static*/ JITCache Pipeline::compile_jit_cache(const Module &module,
@@ -660,7 +780,19 @@ Callable Pipeline::compile_to_callable(const std::vector<Argument> &args_in, con
         jit_module = JITModule(module, f, externs_jit_module);
     }
 
-    return JITCache(jit_target, std::move(args), std::move(jit_externs), std::move(jit_module), std::move(wasm_module));
+    const bool tiered = jit_target.arch != Target::WebAssembly && is_fast_jit_tier(module.target());
+    JITCache cache(jit_target, std::move(args), std::move(jit_externs), std::move(jit_module), std::move(wasm_module));
+    if (tiered) {
+        // jit_module was compiled with little optimization so that it
+        // can be called right away. Compile it again properly on
+        // another thread and switch over to that once it is done. Note
+        // that a pipeline used as an extern by another JIT pipeline
+        // keeps the address of the quickly compiled version.
+        Module optimized = retarget_module(module, module.target().without_feature(Target::TieredJIT));
+        auto f = optimized.get_function_by_name(sanitize_function_name(outputs[0].name()));
+        cache.compile_in_background(optimized, f, externs_jit_module);
+    }
+    return cache;
 }
 
 void Pipeline::set_jit_externs(const std::map<std::string, JITExtern> &externs) {
@@ -1132,6 +1264,497 @@ void Pipeline::infer_input_bounds(JITUserContext *context,
     }
 }
 
+void Pipeline::realize_tiled(const std::vector<int32_t> &sizes,
+                             const std::vector<int32_t> &tile_sizes,
+                             const std::map<std::string, TileReader> &readers,
+                             const TileWriter &writer,
+                             size_t max_memory_bytes,
+                             int max_threads,
+                             const Target &t) {
+    user_assert(defined()) << "Can't realize an undefined Pipeline\n";
+    user_assert(sizes.size() == tile_sizes.size())
+        << "realize_tiled() was given " << tile_sizes.size() << " tile sizes for a "
+        << sizes.size() << "-dimensional output.\n";
+    for (const auto &out : contents->outputs) {
+        user_assert((int)sizes.size() == out.dimensions())
+            << "Func " << out.name() << " is defined with " << out.dimensions()
+            << " dimensions, but realize_tiled() is requesting a realization with "
+            << sizes.size() << " dimensions.\n";
+    }
+    for (size_t d = 0; d < sizes.size(); d++) {
+        user_assert(sizes[d] > 0 && tile_sizes[d] > 0)
+            << "realize_tiled() requires positive sizes and tile sizes.\n";
+    }
+
+    Target target = t;
+    if (target.has_unknowns()) {
+        target = get_compiled_jit_target();
+        if (target.has_unknowns()) {
+            target = get_jit_target_from_environment();
+        }
+    }
+    user_assert(!target.has_feature(Target::NoBoundsQuery))
+        << "You may not call realize_tiled() with Target::NoBoundsQuery set.\n";
+    compile_jit(target);
+    const Target &jit_target = contents->jit_cache.jit_target;
+
+    // The inputs that are read in one tile at a time.
+    std::vector<std::pair<size_t, const TileReader *>> tiled_inputs;
+    std::set<std::string> unused_readers;
+    for (const auto &it : readers) {
+        unused_readers.insert(it.first);
+    }
+    for (size_t i = 0; i < contents->inferred_args.size(); i++) {
+        const Parameter &p = contents->inferred_args[i].param;
+        if (p.defined() && p.is_buffer() && !p.buffer().defined()) {
+            auto it = readers.find(p.name());
+            user_assert(it != readers.end())
+                << "realize_tiled() was not given a reader for the unbound input " << p.name() << ".\n";
+            tiled_inputs.emplace_back(i, &it->second);
+            unused_readers.erase(p.name());
+        }
+    }
+    user_assert(unused_readers.empty())
+        << "realize_tiled() was given a reader for " << *unused_readers.begin()
+        << ", which is not an unbound input of the Pipeline.\n";
+
+    const int dims = (int)sizes.size();
+    std::vector<int64_t> tiles_per_dim(dims);
+    int64_t num_tiles = 1;
+    for (int d = 0; d < dims; d++) {
+        tiles_per_dim[d] = (sizes[d] + tile_sizes[d] - 1) / tile_sizes[d];
+        num_tiles *= tiles_per_dim[d];
+    }
+
+    // Realize one tile, and return the size in bytes of the input and
+    // output buffers it used.
+    auto run_tile = [&](int64_t index) -> size_t {
+        std::vector<int> mins(dims), extents(dims);
+        for (int d = 0; d < dims; d++) {
+            int64_t tile = index % tiles_per_dim[d];
+            index /= tiles_per_dim[d];
+            extents[d] = std::min(tile_sizes[d], sizes[d]);
+            mins[d] = (int)std::min<int64_t>(tile * tile_sizes[d], sizes[d] - extents[d]);
+        }
+
+        vector<Buffer<>> bufs;
+        for (const auto &out : contents->outputs) {
+            for (Type type : out.output_types()) {
+                Buffer<> buf(type, extents);
+                buf.set_min(mins);
+                bufs.push_back(std::move(buf));
+            }
+        }
+        Realization r(std::move(bufs));
+
+        JITUserContext context{};
+        JITUserContext *context_ptr = &context;
+        JITFuncCallContext jit_context(&context, jit_handlers());
+
+        RealizationArg outputs(r);
+        JITCallArgs args(contents->inferred_args.size() + outputs.size());
+        prepare_jit_call_arguments(outputs, jit_target, &context_ptr, true, args);
+
+        // Find the region of each input that this tile needs, as
+        // infer_input_bounds does.
+        std::vector<Runtime::Buffer<>> query(tiled_inputs.size()), orig(tiled_inputs.size());
+        for (size_t k = 0; k < tiled_inputs.size(); k++) {
+            const Parameter &p = contents->inferred_args[tiled_inputs[k].first].param;
+            query[k] = Runtime::Buffer<>(p.type(), nullptr, std::vector<int>(p.dimensions(), 0));
+            args.store[tiled_inputs[k].first] = query[k].raw_buffer();
+        }
+        const int max_iters = 16;
+        int iter = 0;
+        for (; iter < max_iters && !tiled_inputs.empty(); iter++) {
+            for (size_t k = 0; k < query.size(); k++) {
+                orig[k] = query[k];
+            }
+            int exit_status = call_jit_code(jit_target, args);
+            jit_context.finalize(exit_status);
+            bool changed = false;
+            for (size_t k = 0; k < query.size(); k++) {
+                for (int d = 0; d < query[k].dimensions(); d++) {
+                    changed |= (query[k].dim(d).min() != orig[k].dim(d).min() ||
+                                query[k].dim(d).extent() != orig[k].dim(d).extent() ||
+                                query[k].dim(d).stride() != orig[k].dim(d).stride());
+                }
+            }
+            if (!changed) {
+                break;
+            }
+        }
+        user_assert(iter < max_iters)
+            << "Inferring input bounds of a tile in realize_tiled() didn't converge after "
+            << max_iters << " iterations. There may be unsatisfiable constraints\n";
+
+        size_t bytes = 0;
+        for (size_t i = 0; i < r.size(); i++) {
+            bytes += r[i].size_in_bytes();
+        }
+
+        std::vector<Buffer<>> input_tiles;
+        for (size_t k = 0; k < tiled_inputs.size(); k++) {
+            query[k].allocate();
+            input_tiles.emplace_back(std::move(query[k]));
+            const std::string &name = contents->inferred_args[tiled_inputs[k].first].param.name();
+            int result = (*tiled_inputs[k].second)(input_tiles.back());
+            user_assert(result == 0)
+                << "The reader for input " << name << " of realize_tiled() failed with error " << result << "\n";
+            args.store[tiled_inputs[k].first] = input_tiles.back().raw_buffer();
+            bytes += input_tiles.back().size_in_bytes();
+        }
+
+        int exit_status = call_jit_code(jit_target, args);
+        jit_context.finalize(exit_status);
+
+        int result = writer(r);
+        user_assert(result == 0)
+            << "The writer for realize_tiled() failed with error " << result << "\n";
+        return bytes;
+    };
+
+    // Run the first tile alone, to find out how many can fit in memory
+    // at once.
+    size_t tile_bytes = run_tile(0);
+    int num_threads = max_threads > 0 ? max_threads : (int)std::max(1u, std::thread::hardware_concurrency());
+    if (max_memory_bytes > 0 && tile_bytes > 0) {
+        num_threads = (int)std::min<size_t>(num_threads, std::max<size_t>(1, max_memory_bytes / tile_bytes));
+    }
+    num_threads = (int)std::min<int64_t>(num_threads, num_tiles - 1);
+    debug(2) << "realize_tiled() running " << num_tiles << " tiles of " << tile_bytes
+             << " bytes on " << num_threads << " threads\n";
+
+    std::atomic<int64_t> next_tile{1};
+    std::atomic<bool> failed{false};
+    std::exception_ptr error;
+    std::mutex error_mutex;
+    auto worker = [&]() {
+        while (!failed) {
+            int64_t index = next_tile++;
+            if (index >= num_tiles) {
+                break;
+            }
+#ifdef HALIDE_WITH_EXCEPTIONS
+            try {
+#endif
+                run_tile(index);
+#ifdef HALIDE_WITH_EXCEPTIONS
+            } catch (...) {
+                std::lock_guard<std::mutex> lock(error_mutex);
+                if (!error) {
+                    error = std::current_exception();
+                }
+                failed = true;
+            }
+#endif
+        }
+    };
+
+    std::vector<std::thread> threads;
+    for (int i = 1; i < num_threads; i++) {
+        threads.emplace_back(worker);
+    }
+    if (num_threads > 0) {
+        worker();
+    }
+    for (auto &thread : threads) {
+        thread.join();
+    }
+#ifdef HALIDE_WITH_EXCEPTIONS
+    if (error) {
+        std::rethrow_exception(error);
+    }
+#endif
+}
+
+namespace {
+
+// Does every definition of a Func write to the site given by its pure
+// vars? Only then can any region of it be computed on its own.
+bool defines_pure_vars_only(const Function &f) {
+    for (const Definition &def : f.updates()) {
+        for (size_t i = 0; i < def.args().size(); i++) {
+            const Variable *v = def.args()[i].as<Variable>();
+            if (!v || v->name != f.args()[i]) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+// Make the stages realize_dirty_region uses to keep the compute_root
+// intermediates of a Pipeline between calls. A Func is cached if it is
+// computed and stored at root, has a single value and no extern
+// definition, writes only to its pure vars, and no other Func is
+// scheduled within its loops.
+vector<DirtyRegionCache::Stage> make_dirty_region_stages(const Function &output,
+                                                         const JITHandlers &handlers) {
+    std::map<string, Function> env = find_transitive_calls(output);
+    vector<string> order = topological_order({output}, env);
+
+    // Inspect the schedule of a copy, so that the LoopLevels can be
+    // locked without touching the user's Funcs, as lowering does.
+    std::set<string> cached;
+    {
+        std::map<string, Function> copy = deep_copy({output}, env).second;
+        for (auto &it : copy) {
+            it.second.lock_loop_levels();
+        }
+        for (const auto &it : copy) {
+            const Function &f = it.second;
+            if (f.name() != output.name() &&
+                f.outputs() == 1 &&
+                !f.has_extern_definition() &&
+                defines_pure_vars_only(f) &&
+                f.wrappers().empty() &&
+                f.schedule().compute_level().is_root() &&
+                f.schedule().store_level().is_root()) {
+                cached.insert(f.name());
+            }
+        }
+        for (const auto &it : copy) {
+            const Function &f = it.second;
+            for (const LoopLevel &l : {f.schedule().compute_level(), f.schedule().store_level()}) {
+                if (!l.is_inlined() && !l.is_root()) {
+                    cached.erase(l.func());
+                }
+            }
+            vector<Definition> definitions = {f.definition()};
+            definitions.insert(definitions.end(), f.updates().begin(), f.updates().end());
+            for (const Definition &def : definitions) {
+                const LoopLevel &l = def.defined() ? def.schedule().fuse_level().level : LoopLevel::inlined();
+                if (!l.is_inlined() && !l.is_root()) {
+                    cached.erase(l.func());
+                    cached.erase(f.name());
+                }
+            }
+        }
+    }
+
+    // The other stages read each cached Func through an ImageParam.
+    vector<DirtyRegionCache::Stage> stages;
+    std::map<string, Func> readers;
+    for (const string &name : order) {
+        if (!cached.count(name)) {
+            continue;
+        }
+        const Function &f = env.at(name);
+        DirtyRegionCache::Stage stage;
+        stage.name = name;
+        stage.param = ImageParam(f.output_types()[0], f.dimensions(), unique_name(name + "_cache"));
+        vector<Var> args;
+        for (const string &arg : f.args()) {
+            args.emplace_back(arg);
+        }
+        Func reader(unique_name(name + "_cached"));
+        reader(args) = stage.param(args);
+        readers.emplace(name, reader);
+        stages.push_back(std::move(stage));
+    }
+    if (stages.empty()) {
+        return {};
+    }
+    stages.emplace_back();
+    stages.back().name = output.name();
+
+    for (DirtyRegionCache::Stage &stage : stages) {
+        const Function &f = env.at(stage.name);
+        auto [outputs, stage_env] = deep_copy({f}, find_transitive_calls(f));
+        std::map<FunctionPtr, FunctionPtr> substitutions;
+        for (const auto &it : stage_env) {
+            auto r = readers.find(it.first);
+            if (it.first != stage.name && r != readers.end()) {
+                substitutions.emplace(it.second.get_contents(), r->second.function().get_contents());
+            }
+        }
+        for (auto &it : stage_env) {
+            it.second.substitute_calls(substitutions);
+        }
+        stage.pipeline = Pipeline(Func(outputs[0]));
+        stage.pipeline.jit_handlers() = handlers;
+    }
+    return stages;
+}
+
+// Size the buffers of the cached stages to what their consumers read
+// when the outputs are realized in full, and compute them.
+void fill_dirty_region_cache(DirtyRegionCache &cache, const Realization &outputs, const Target &target) {
+    const size_t num_cached = cache.stages.size() - 1;
+
+    // Walk the stages consumers first, taking the union of the regions
+    // of each cached Func that its consumers read.
+    std::map<string, vector<std::pair<int, int>>> required;
+    for (size_t i = cache.stages.size(); i-- > 0;) {
+        DirtyRegionCache::Stage &stage = cache.stages[i];
+        for (size_t j = 0; j < num_cached; j++) {
+            cache.stages[j].param.reset();
+        }
+        if (i < num_cached) {
+            auto it = required.find(stage.name);
+            internal_assert(it != required.end()) << "Nothing reads cached Func " << stage.name << "\n";
+            vector<int> mins, extents;
+            for (const auto &r : it->second) {
+                mins.push_back(r.first);
+                extents.push_back(r.second - r.first + 1);
+            }
+            stage.buffer = Buffer<>(stage.param.type(), extents);
+            stage.buffer.set_min(mins);
+            stage.pipeline.infer_input_bounds(stage.buffer, target);
+        } else {
+            Realization query = outputs;
+            stage.pipeline.infer_input_bounds(query, target);
+        }
+        for (size_t j = 0; j < num_cached; j++) {
+            const DirtyRegionCache::Stage &producer = cache.stages[j];
+            Buffer<> b = producer.param.get();
+            if (!b.defined()) {
+                continue;
+            }
+            auto inserted = required.emplace(producer.name, vector<std::pair<int, int>>());
+            vector<std::pair<int, int>> &r = inserted.first->second;
+            for (int d = 0; d < b.dimensions(); d++) {
+                if (inserted.second) {
+                    r.emplace_back(b.dim(d).min(), b.dim(d).max());
+                } else {
+                    r[d].first = std::min(r[d].first, b.dim(d).min());
+                    r[d].second = std::max(r[d].second, b.dim(d).max());
+                }
+            }
+        }
+    }
+
+    // Compute the cached Funcs in full, producers first.
+    for (size_t j = 0; j < num_cached; j++) {
+        DirtyRegionCache::Stage &stage = cache.stages[j];
+        stage.param.set(stage.buffer);
+        stage.pipeline.realize(stage.buffer, target);
+    }
+    cache.filled = true;
+}
+
+// Clamp a dirty box to a buffer. Returns an empty Region if they don't
+// overlap.
+Region clamp_dirty_box(const Box &dirty, const Buffer<> &buf) {
+    Region region;
+    for (int d = 0; d < buf.dimensions(); d++) {
+        int lo = buf.dim(d).min();
+        int hi = buf.dim(d).max();
+        const Interval &i = dirty[d];
+        if (i.is_empty()) {
+            return {};
+        }
+        if (i.has_lower_bound()) {
+            if (const int64_t *m = as_const_int(simplify(i.min))) {
+                lo = (int)std::max<int64_t>(lo, *m);
+            }
+        }
+        if (i.has_upper_bound()) {
+            if (const int64_t *m = as_const_int(simplify(i.max))) {
+                hi = (int)std::min<int64_t>(hi, *m);
+            }
+        }
+        if (lo > hi) {
+            return {};
+        }
+        region.emplace_back(lo, hi - lo + 1);
+    }
+    return region;
+}
+
+Buffer<> crop_to_region(const Buffer<> &buf, const Region &region) {
+    Buffer<> cropped(*buf.raw_buffer());
+    for (int d = 0; d < cropped.dimensions(); d++) {
+        cropped.crop(d, *as_const_int(region[d].min), *as_const_int(region[d].extent));
+    }
+    return cropped;
+}
+
+}  // namespace
+
+Region Pipeline::realize_dirty_region(const Realization &outputs,
+                                     const std::string &input,
+                                     const Region &changed,
+                                     const Target &target) {
+    user_assert(defined()) << "Can't realize an undefined Pipeline\n";
+    user_assert(contents->outputs.size() == 1)
+        << "realize_dirty_region() requires a Pipeline with a single output Func.\n";
+    user_assert(outputs.size() > 0)
+        << "realize_dirty_region() requires at least one output buffer.\n";
+
+    const Function &output = contents->outputs[0];
+    Box changed_box;
+    for (const Range &r : changed) {
+        changed_box.push_back(Interval(r.min, simplify(r.min + r.extent - 1)));
+    }
+    std::map<string, Box> dirty = dirty_regions(output, input, changed_box);
+    debug(2) << "Dirty region of " << output.name() << ": " << dirty[output.name()] << "\n";
+
+    const Buffer<> &first = outputs[0];
+    user_assert((int)dirty[output.name()].size() == first.dimensions())
+        << "Func " << output.name() << " is defined with " << dirty[output.name()].size()
+        << " dimensions, but realize_dirty_region() was given a buffer with "
+        << first.dimensions() << " dimensions.\n";
+
+    // Bring the cached intermediates up to date. Custom lowering passes,
+    // requirements and JIT externs apply to this Pipeline only, so with
+    // any of those nothing is cached.
+    DirtyRegionCache &cache = contents->dirty_region_cache;
+    if (!cache.built) {
+        if (contents->custom_lowering_passes.empty() &&
+            contents->requirements.empty() &&
+            contents->jit_externs.empty()) {
+            cache.stages = make_dirty_region_stages(output, contents->jit_handlers);
+        }
+        cache.built = true;
+    }
+    if (!cache.stages.empty()) {
+        Region shape;
+        for (int d = 0; d < first.dimensions(); d++) {
+            shape.emplace_back(first.dim(d).min(), first.dim(d).extent());
+        }
+        bool same_shape = cache.filled && cache.target == target && cache.region.size() == shape.size();
+        for (size_t d = 0; same_shape && d < shape.size(); d++) {
+            same_shape = can_prove(cache.region[d].min == shape[d].min &&
+                                   cache.region[d].extent == shape[d].extent);
+        }
+        if (!same_shape) {
+            debug(2) << "Filling the intermediate buffers of " << output.name() << "\n";
+            fill_dirty_region_cache(cache, outputs, target);
+            cache.region = shape;
+            cache.target = target;
+        } else {
+            for (size_t i = 0; i + 1 < cache.stages.size(); i++) {
+                DirtyRegionCache::Stage &stage = cache.stages[i];
+                Region region = clamp_dirty_box(dirty[stage.name], stage.buffer);
+                if (region.empty()) {
+                    continue;
+                }
+                debug(2) << "Recomputing the dirty region of " << stage.name << "\n";
+                Buffer<> cropped = crop_to_region(stage.buffer, region);
+                stage.pipeline.realize(cropped, target);
+            }
+        }
+    }
+
+    Region region = clamp_dirty_box(dirty[output.name()], first);
+    if (region.empty()) {
+        return {};
+    }
+
+    vector<Buffer<>> cropped;
+    for (size_t i = 0; i < outputs.size(); i++) {
+        cropped.push_back(crop_to_region(outputs[i], region));
+    }
+    Realization r(std::move(cropped));
+    if (cache.stages.empty()) {
+        realize(r, target);
+    } else {
+        cache.stages.back().pipeline.realize(r, target);
+    }
+    return region;
+}
+
 void Pipeline::infer_input_bounds(const std::vector<int32_t> &sizes, const Target &target) {
     infer_input_bounds(nullptr, sizes, target);
 }
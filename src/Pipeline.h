@@ -441,6 +441,62 @@ public:
                             const Target &target = get_jit_target_from_environment());
     // @}
 
+    /** Fills in a tile of an input to realize_tiled(). The buffer
+     * covers the region of the input that the tile needs. Returns zero
+     * on success. */
+    using TileReader = std::function<int(Buffer<> &tile)>;
+
+    /** Receives a finished tile of the output of realize_tiled(), with
+     * one buffer per output. Returns zero on success. */
+    using TileWriter = std::function<int(const Realization &tile)>;
+
+    /** Evaluate this Pipeline over an output of the given size one tile
+     * at a time, so that neither the whole output nor the whole of any
+     * input has to be in memory at once. For each tile, bounds inference
+     * finds the region needed of every unbound ImageParam, and the
+     * reader with the name of that ImageParam fills it in. Each finished
+     * tile is passed to the writer. Readers and the writer may be called
+     * from several threads at once.
+     *
+     * Up to max_threads tiles are run at once (by default, one per
+     * core). If max_memory_bytes is nonzero, fewer are run if their
+     * input and output buffers would not fit in it together. Memory
+     * that the pipeline allocates internally is not counted. Tiles at
+     * the far edges are shifted inwards to keep them whole, so they can
+     * overlap their neighbors. */
+    void realize_tiled(const std::vector<int32_t> &sizes,
+                       const std::vector<int32_t> &tile_sizes,
+                       const std::map<std::string, TileReader> &readers,
+                       const TileWriter &writer,
+                       size_t max_memory_bytes = 0,
+                       int max_threads = 0,
+                       const Target &target = Target());
+
+    /** Recompute only the part of some existing output buffers that may
+     * have changed since a region of one of the inputs (an ImageParam or
+     * Func, given by name) changed. The affected region is found from
+     * the algorithm, and is conservative: in dimensions where it can't be
+     * bounded, the whole extent of the outputs is recomputed. Returns
+     * the region that was recomputed, which is empty if the outputs
+     * don't depend on the changed region. The Pipeline must have a
+     * single output Func.
+     *
+     * Intermediate Funcs that are computed at root are kept in buffers
+     * of their own between calls, and only their affected regions are
+     * recomputed; the first call, or a call with outputs of a different
+     * shape or a different target, computes them in full. This holds
+     * for Funcs with a single value and no extern definition, whose
+     * updates write only to their pure vars, and that no other Func is
+     * scheduled within. Every change to the inputs (including Params)
+     * after the first call must be passed to realize_dirty_region, or
+     * invalidate_cache() called. The schedule in effect at the first
+     * call is kept too: after changing the schedule of any of the Funcs,
+     * call invalidate_cache(). */
+    Region realize_dirty_region(const Realization &outputs,
+                                const std::string &input,
+                                const Region &changed,
+                                const Target &target = Target());
+
     /** Infer the arguments to the Pipeline, sorted into a canonical order:
      * all buffers (sorted alphabetically by name), followed by all non-buffers
      * (sorted alphabetically by name).
@@ -430,6 +430,198 @@ class HoistPrefetches : public IRMutator {
     }
 };
 
+// Is this a loop that remains a loop after lowering, rather than
+// becoming vector code or being unrolled?
+bool is_real_loop(const For *op) {
+    return op->for_type != ForType::Vectorized && op->for_type != ForType::Unrolled;
+}
+
+// Find the depth of the loop nest in a loop body, whether the schedule
+// already prefetches in it, and a rough estimate of how long one
+// iteration of the loop takes, in IR nodes evaluated.
+class AnalyzeLoopBody : public IRGraphVisitor {
+    using IRGraphVisitor::visit;
+
+    int current_depth = 0;
+
+    void include(const Expr &e) override {
+        cost++;
+        IRGraphVisitor::include(e);
+    }
+
+    void visit(const For *op) override {
+        // Assume loops of unknown extent run for a while.
+        const int64_t *extent = as_const_int(op->extent);
+        int64_t trip_count = op->for_type == ForType::Vectorized ? 1 : extent ? *extent : 256;
+        int64_t outer_cost = cost;
+        cost = 0;
+        if (is_real_loop(op)) {
+            current_depth++;
+            depth = std::max(depth, current_depth);
+            IRGraphVisitor::visit(op);
+            current_depth--;
+        } else {
+            IRGraphVisitor::visit(op);
+        }
+        cost = outer_cost + cost * trip_count;
+    }
+
+    void visit(const Prefetch *op) override {
+        has_prefetch = true;
+        IRGraphVisitor::visit(op);
+    }
+
+public:
+    int depth = 0;
+    bool has_prefetch = false;
+    int64_t cost = 0;
+};
+
+// Find the inputs and compute_root Funcs loaded in a loop body in a
+// dimension other than the innermost storage dimension with an index
+// that depends on the loop variable. Consecutive iterations of the
+// loop load from different rows of these, which defeats the hardware
+// prefetchers.
+class FindRowCrossingLoads : public IRVisitor {
+    using IRVisitor::visit;
+
+    const map<string, Function> &env;
+    const Scope<> &realized;
+    Scope<> varying;
+    set<string> written;
+
+    template<typename LetOrLetStmt>
+    void visit_let(const LetOrLetStmt *op) {
+        op->value.accept(this);
+        ScopedBinding<> bind(expr_uses_vars(op->value, varying), varying, op->name);
+        op->body.accept(this);
+    }
+
+    void visit(const Let *op) override {
+        visit_let(op);
+    }
+
+    void visit(const LetStmt *op) override {
+        visit_let(op);
+    }
+
+    void visit(const Provide *op) override {
+        written.insert(op->name);
+        IRVisitor::visit(op);
+    }
+
+    void visit(const Call *op) override {
+        IRVisitor::visit(op);
+
+        size_t dense_dim = 0;
+        vector<Type> types;
+        if (op->call_type == Call::Halide && realized.contains(op->name)) {
+            const Function &f = env.at(op->name);
+            if (f.args().empty()) {
+                return;
+            }
+            const string &innermost = f.schedule().storage_dims()[0].var;
+            dense_dim = std::find(f.args().begin(), f.args().end(), innermost) - f.args().begin();
+            types = f.output_types();
+        } else if (op->call_type == Call::Image && op->param.defined()) {
+            types = {op->param.type()};
+        } else {
+            return;
+        }
+
+        for (size_t i = 0; i < op->args.size(); i++) {
+            if (i != dense_dim && expr_uses_vars(op->args[i], varying)) {
+                loads.emplace(op->name, std::make_pair(types, op->param));
+                return;
+            }
+        }
+    }
+
+public:
+    FindRowCrossingLoads(const map<string, Function> &env, const Scope<> &realized, const string &var)
+        : env(env), realized(realized) {
+        varying.push(var);
+    }
+
+    // The buffers to prefetch, with their types and the parameter for
+    // inputs.
+    map<string, std::pair<vector<Type>, Parameter>> loads;
+
+    void remove_written() {
+        for (const string &name : written) {
+            loads.erase(name);
+        }
+    }
+};
+
+class InjectAutoPrefetch : public IRMutator {
+    using IRMutator::visit;
+
+    const map<string, Function> &env;
+    Scope<> realized;
+
+    // Roughly the latency of a miss to main memory, in IR nodes
+    // evaluated.
+    const int64_t miss_latency = 300;
+    const int max_distance = 8;
+
+    Stmt visit(const Realize *op) override {
+        auto it = env.find(op->name);
+        bool is_root = it != env.end() && it->second.schedule().compute_level().is_root();
+        ScopedBinding<> bind(is_root, realized, op->name);
+        return IRMutator::visit(op);
+    }
+
+    Stmt visit(const For *op) override {
+        if (op->device_api != DeviceAPI::None && op->device_api != DeviceAPI::Host) {
+            return op;
+        }
+
+        AnalyzeLoopBody analysis;
+        op->body.accept(&analysis);
+        if (analysis.has_prefetch) {
+            // The schedule already prefetches in this loop nest.
+            return op;
+        }
+
+        Stmt body = mutate(op->body);
+
+        // Only the innermost and innermost-but-one loops are
+        // interesting. Further out, the loads are too far apart for
+        // the prefetches to still be in cache when they are used.
+        const int64_t *extent = as_const_int(op->extent);
+        if (op->for_type == ForType::Serial &&
+            analysis.depth <= 1 &&
+            (!extent || *extent > 1)) {
+            FindRowCrossingLoads finder(env, realized, op->name);
+            op->body.accept(&finder);
+            finder.remove_written();
+
+            // Fetch far enough ahead to hide the latency of a miss.
+            int64_t cost = std::max<int64_t>(analysis.cost, 1);
+            int distance = (int)std::min<int64_t>((miss_latency + cost - 1) / cost, max_distance);
+
+            for (const auto &it : finder.loads) {
+                debug(3) << "Automatically prefetching " << it.first << " at " << op->name
+                         << " + " << distance << "\n";
+                PrefetchDirective p = {it.first, op->name, op->name, distance,
+                                       PrefetchBoundStrategy::Clamp, it.second.second};
+                body = Prefetch::make(it.first, it.second.first, Region(), p, const_true(), std::move(body));
+            }
+        }
+
+        if (body.same_as(op->body)) {
+            return op;
+        }
+        return For::make(op->name, op->min, op->extent, op->for_type, op->device_api, std::move(body));
+    }
+
+public:
+    InjectAutoPrefetch(const map<string, Function> &env)
+        : env(env) {
+    }
+};
+
 }  // anonymous namespace
 
 Stmt inject_placeholder_prefetch(const Stmt &s, const map<string, Function> &env,
@@ -439,6 +631,10 @@ Stmt inject_placeholder_prefetch(const Stmt &s, const map<string, Function> &env
     return stmt;
 }
 
+Stmt inject_auto_prefetch(const Stmt &s, const map<string, Function> &env) {
+    return InjectAutoPrefetch(env).mutate(s);
+}
+
 Stmt inject_prefetch(const Stmt &s, const map<string, Function> &env) {
     CollectExternalBufferBounds finder;
     s.accept(&finder);
@@ -26,6 +26,14 @@ struct Stmt;
 Stmt inject_placeholder_prefetch(const Stmt &s, const std::map<std::string, Function> &env,
                                  const std::string &prefix,
                                  const std::vector<PrefetchDirective> &prefetches);
+/** Inject placeholder prefetches of the inputs and compute_root Funcs
+ * that the innermost and innermost-but-one serial loops load from a
+ * different row on each iteration. The prefetch distance is estimated
+ * from the cost of the loop body. Loop nests with prefetches from the
+ * schedule are left alone. Used when the target has the AutoPrefetch
+ * feature. */
+Stmt inject_auto_prefetch(const Stmt &s, const std::map<std::string, Function> &env);
+
 /** Compute the actual region to be prefetched and place it to the
  * placholder prefetch. Wrap the prefetch call with condition when
  * applicable. */
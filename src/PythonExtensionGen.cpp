@@ -163,7 +163,7 @@ bool unpack_buffer(PyObject *py_obj,
     py_buf_valid = false;
 
     memset(&py_buf, 0, sizeof(py_buf));
-    if (PyObject_GetBuffer(py_obj, &py_buf, PyBUF_FORMAT | PyBUF_STRIDED_RO | PyBUF_ANY_CONTIGUOUS | py_getbuffer_flags) < 0) {
+    if (PyObject_GetBuffer(py_obj, &py_buf, PyBUF_FORMAT | PyBUF_STRIDED_RO | py_getbuffer_flags) < 0) {
         PyErr_Format(PyExc_ValueError, "Invalid argument %s: Expected %d dimensions, got %d", name, dimensions, py_buf.ndim);
         return false;
     }
@@ -173,40 +173,56 @@ bool unpack_buffer(PyObject *py_obj,
         PyErr_Format(PyExc_ValueError, "Invalid argument %s: Expected %d dimensions, got %d", name, dimensions, py_buf.ndim);
         return false;
     }
-    /* We'll get a buffer that's either:
-     * C_CONTIGUOUS (last dimension varies the fastest, i.e., has stride=1) or
-     * F_CONTIGUOUS (first dimension varies the fastest, i.e., has stride=1).
-     * The latter is preferred, since it's already in the format that Halide
-     * needs. It can can be achieved in numpy by passing order='F' during array
-     * creation. However, if we do get a C_CONTIGUOUS buffer, flip the dimensions
-     * (transpose) so we can process it without having to reallocate.
+    /* We always wrap the caller's memory in place, never copy it: any strides
+     * (including negative ones, and views that are neither C nor Fortran
+     * contiguous) can be described by a halide_buffer_t.
+     *
+     * F_CONTIGUOUS buffers (first dimension varies the fastest, i.e., has
+     * stride=1) are already in the format that Halide needs. It can can be
+     * achieved in numpy by passing order='F' during array creation. However,
+     * if we get a C_CONTIGUOUS buffer (last dimension varies the fastest),
+     * flip the dimensions (transpose) so we can process it without having to
+     * reallocate. Other strided views are flipped the same way unless their
+     * first dimension is the one with the smaller stride.
      */
+    const auto abs_stride = [&py_buf](int d) {
+        return py_buf.strides[d] < 0 ? -py_buf.strides[d] : py_buf.strides[d];
+    };
+    const bool is_f_contiguous = PyBuffer_IsContiguous(&py_buf, 'F');
+    const bool is_c_contiguous = !is_f_contiguous && PyBuffer_IsContiguous(&py_buf, 'C');
     int i, j, j_step;
-    if (PyBuffer_IsContiguous(&py_buf, 'F')) {
+    if (is_f_contiguous ||
+        (!is_c_contiguous && py_buf.ndim > 0 && abs_stride(0) < abs_stride(py_buf.ndim - 1))) {
         j = 0;
         j_step = 1;
-    } else if (PyBuffer_IsContiguous(&py_buf, 'C')) {
+    } else {
         j = py_buf.ndim - 1;
         j_step = -1;
-    } else {
-        /* Python checks all dimensions and strides, so this typically indicates
-         * a bug in the array's buffer protocol. */
-        PyErr_Format(PyExc_ValueError, "Invalid buffer: neither C nor Fortran contiguous");
-        return false;
     }
     for (i = 0; i < py_buf.ndim; ++i, j += j_step) {
-        halide_dim[i].min = 0;
-        halide_dim[i].stride = (int)(py_buf.strides[j] / py_buf.itemsize);  // strides is in bytes
-        halide_dim[i].extent = (int)py_buf.shape[j];
-        halide_dim[i].flags = 0;
-        if (py_buf.suboffsets && py_buf.suboffsets[i] >= 0) {
+        if (py_buf.suboffsets && py_buf.suboffsets[j] >= 0) {
             // Halide doesn't support arrays of pointers. But we should never see this
             // anyway, since we specified PyBUF_STRIDED.
             PyErr_Format(PyExc_ValueError, "Invalid buffer: suboffsets not supported");
             return false;
         }
+        // strides is in bytes
+        const Py_ssize_t stride = py_buf.strides[j] / py_buf.itemsize;
+        if (py_buf.strides[j] % py_buf.itemsize != 0 ||
+            stride < INT_MIN || stride > INT_MAX || py_buf.shape[j] > INT_MAX) {
+            PyErr_Format(PyExc_ValueError, "Invalid argument %s: unsupported stride %zd or extent %zd in dimension %d",
+                         name, py_buf.strides[j], py_buf.shape[j], i);
+            return false;
+        }
+        halide_dim[i].min = 0;
+        halide_dim[i].stride = (int)stride;
+        halide_dim[i].extent = (int)py_buf.shape[j];
+        halide_dim[i].flags = 0;
     }
-    if (halide_dim[py_buf.ndim - 1].extent * halide_dim[py_buf.ndim - 1].stride * py_buf.itemsize != py_buf.len) {
+    // A zero-dimensional buffer is a single scalar; there is no outermost
+    // dimension to check its length against.
+    if ((is_f_contiguous || is_c_contiguous) && py_buf.ndim > 0 &&
+        halide_dim[py_buf.ndim - 1].extent * halide_dim[py_buf.ndim - 1].stride * py_buf.itemsize != py_buf.len) {
         PyErr_Format(PyExc_ValueError, "Invalid buffer: length %ld, but computed length %ld",
                      py_buf.len, py_buf.shape[0] * py_buf.strides[0]);
         return false;
@@ -221,6 +221,7 @@ struct FuncScheduleContents {
     MemoryType memory_type = MemoryType::Auto;
     bool memoized = false;
     bool async = false;
+    bool nontemporal = false;
     Expr memoize_eviction_key;
 
     FuncScheduleContents()
@@ -341,6 +342,7 @@ FuncSchedule FuncSchedule::deep_copy(
     copy.contents->memoized = contents->memoized;
     copy.contents->memoize_eviction_key = contents->memoize_eviction_key;
     copy.contents->async = contents->async;
+    copy.contents->nontemporal = contents->nontemporal;
 
     // Deep-copy wrapper functions.
     for (const auto &iter : contents->wrappers) {
@@ -384,6 +386,14 @@ bool FuncSchedule::async() const {
     return contents->async;
 }
 
+bool &FuncSchedule::nontemporal() {
+    return contents->nontemporal;
+}
+
+bool FuncSchedule::nontemporal() const {
+    return contents->nontemporal;
+}
+
 std::vector<StorageDim> &FuncSchedule::storage_dims() {
     return contents->storage_dims;
 }
@@ -577,6 +577,10 @@ public:
     bool &async();
     bool async() const;
 
+    /** Are stores to this Function done with non-temporal hints */
+    bool &nontemporal();
+    bool nontemporal() const;
+
     /** The list and order of dimensions used to store this
      * function. The first dimension in the vector corresponds to the
      * innermost dimension for storage (i.e. which dimension is
@@ -4,6 +4,7 @@
 #include "CSE.h"
 #include "CompilerLogger.h"
 #include "IRMutator.h"
+#include "IRVisitor.h"
 #include "Substitute.h"
 
 namespace Halide {
@@ -89,6 +90,46 @@ void Simplify::found_buffer_reference(const string &name, size_t dimensions) {
     }
 }
 
+namespace {
+
+class RecordUnsimplifiedUses : public IRGraphVisitor {
+    using IRGraphVisitor::visit;
+
+    Simplify *simplify;
+
+    void visit(const Variable *op) override {
+        if (simplify->var_info.contains(op->name)) {
+            simplify->var_info.ref(op->name).old_uses++;
+        }
+    }
+
+    void visit(const Load *op) override {
+        simplify->found_buffer_reference(op->name);
+        IRGraphVisitor::visit(op);
+    }
+
+    void visit(const Call *op) override {
+        if (op->call_type == Call::Image || op->call_type == Call::Halide) {
+            simplify->found_buffer_reference(op->name, op->args.size());
+        }
+        IRGraphVisitor::visit(op);
+    }
+
+public:
+    RecordUnsimplifiedUses(Simplify *s)
+        : simplify(s) {
+    }
+};
+
+}  // namespace
+
+Expr Simplify::out_of_budget(const Expr &e, ExprInfo *b) {
+    clear_bounds_info(b);
+    RecordUnsimplifiedUses uses(this);
+    e.accept(&uses);
+    return e;
+}
+
 bool Simplify::const_float(const Expr &e, double *f) {
     if (const double *p = as_const_float(e)) {
         *f = *p;
@@ -10,6 +10,7 @@
 #include "IRMatch.h"
 #include "IRVisitor.h"
 #include "Scope.h"
+#include "WorkBudget.h"
 
 // Because this file is only included by the simplify methods and
 // doesn't go into Halide.h, we're free to use any old names for our
@@ -124,7 +125,7 @@ public:
         const std::string spaces(debug_indent, ' ');
         debug(1) << spaces << "Simplifying Expr: " << e << "\n";
         debug_indent++;
-        Expr new_e = Super::dispatch(e, b);
+        Expr new_e = budget.spend(e) ? Super::dispatch(e, b) : out_of_budget(e, b);
         debug_indent--;
         if (!new_e.same_as(e)) {
             debug(1)
@@ -138,7 +139,11 @@ public:
 #else
     HALIDE_ALWAYS_INLINE
     Expr mutate(const Expr &e, ExprInfo *b) {
-        // This gets inlined into every call to mutate, so do not add any code here.
+        // This gets inlined into every call to mutate, so do not add any
+        // code here beyond the work budget check.
+        if (!budget.spend(e)) {
+            return out_of_budget(e, b);
+        }
         return Super::dispatch(e, b);
     }
 #endif
@@ -147,6 +152,7 @@ public:
     Stmt mutate(const Stmt &s) {
         const std::string spaces(debug_indent, ' ');
         debug(1) << spaces << "Simplifying Stmt: " << s << "\n";
+        budget.reset();
         debug_indent++;
         Stmt new_s = Super::dispatch(s);
         debug_indent--;
@@ -159,6 +165,7 @@ public:
     }
 #else
     Stmt mutate(const Stmt &s) {
+        budget.reset();
         return Super::dispatch(s);
     }
 #endif
@@ -166,6 +173,16 @@ public:
     bool remove_dead_code;
     bool no_float_simplify = false;
 
+    // Bounds the work done on the Exprs of any one Stmt (or on a
+    // single Expr passed to simplify()). Once it runs out, the rest of
+    // the Expr is left as-is.
+    WorkBudget budget{"simplify"};
+
+    // Give up on simplifying e, returning it unchanged. The uses of any
+    // enclosing lets and buffers within e are still recorded, so that
+    // their definitions aren't removed as dead code.
+    Expr out_of_budget(const Expr &e, ExprInfo *b);
+
     HALIDE_ALWAYS_INLINE
     bool may_simplify(const Type &t) const {
         return !no_float_simplify || !t.is_float();
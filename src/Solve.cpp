@@ -7,6 +7,7 @@
 #include "IRMutator.h"
 #include "Simplify.h"
 #include "Substitute.h"
+#include "WorkBudget.h"
 
 namespace Halide {
 namespace Internal {
@@ -43,6 +44,13 @@ public:
     Expr mutate(const Expr &e) override {
         map<Expr, CacheEntry, ExprCompare>::iterator iter = cache.find(e);
         if (iter == cache.end()) {
+            if (!budget.spend(e)) {
+                // Give up, leaving the rest of the expression
+                // unsolved. Assume it uses the variable.
+                failed = true;
+                uses_var = true;
+                return e;
+            }
             // Not in the cache, call the base class version.
             debug(4) << "Mutating " << e << " (" << uses_var << ")\n";
             bool old_uses_var = uses_var;
@@ -79,6 +87,9 @@ private:
     };
     map<Expr, CacheEntry, ExprCompare> cache;
 
+    // Bounds the work done solving one expression.
+    WorkBudget budget{"solve"};
+
     // Internal lets. Already mutated.
     Scope<CacheEntry> scope;
 
@@ -966,12 +977,19 @@ class SolveForInterval : public IRVisitor {
     // that solution over and over, taming the exponential beast.
     std::map<Expr, Interval, IRDeepCompare> cache_f, cache_t;
 
+    // Bounds the number of sub-expressions solved.
+    WorkBudget budget{"solve_for_interval"};
+
     // Solve an expression, or set result to the previously found solution.
     void cached_solve(const Expr &cond) {
         auto &cache = target ? cache_t : cache_f;
         auto it = cache.find(cond);
         if (it == cache.end()) {
             // Cache miss
+            if (!budget.spend(cond)) {
+                fail();
+                return;
+            }
             already_solved = false;
             cond.accept(this);
             already_solved = true;
@@ -540,6 +540,12 @@ const std::map<std::string, Target::Feature> feature_name_map = {
     {"vk_v12", Target::VulkanV12},
     {"vk_v13", Target::VulkanV13},
     {"semihosting", Target::Semihosting},
+    {"no_loop_carry", Target::NoLoopCarry},
+    {"auto_prefetch", Target::AutoPrefetch},
+    {"tiered_jit", Target::TieredJIT},
+    {"c_openmp", Target::COpenMP},
+    {"coalesce_allocations", Target::CoalesceAllocations},
+    {"lut_shuffles", Target::LUTShuffles},
     // NOTE: When adding features to this map, be sure to update PyEnums.cpp as well.
 };
 
@@ -167,6 +167,12 @@ struct Target {
         VulkanV12 = halide_target_feature_vulkan_version12,
         VulkanV13 = halide_target_feature_vulkan_version13,
         Semihosting = halide_target_feature_semihosting,
+        NoLoopCarry = halide_target_feature_no_loop_carry,
+        AutoPrefetch = halide_target_feature_auto_prefetch,
+        TieredJIT = halide_target_feature_tiered_jit,
+        COpenMP = halide_target_feature_c_openmp,
+        CoalesceAllocations = halide_target_feature_coalesce_allocations,
+        LUTShuffles = halide_target_feature_lut_shuffles,
         FeatureEnd = halide_target_feature_end
     };
     Target() = default;
@@ -930,9 +930,15 @@ int ctz64(uint64_t x) {
 #endif
 }
 
+std::recursive_mutex &plugin_mutex() {
+    static std::recursive_mutex mutex;
+    return mutex;
+}
+
 }  // namespace Internal
 
 void load_plugin(const std::string &lib_name) {
+    std::lock_guard<std::recursive_mutex> lock(Internal::plugin_mutex());
 #ifdef _WIN32
     std::string lib_path = lib_name;
     if (lib_path.find('.') == std::string::npos) {
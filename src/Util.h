@@ -17,6 +17,7 @@
 #include <cstring>
 #include <functional>
 #include <limits>
+#include <mutex>
 #include <string>
 #include <utility>
 #include <vector>
@@ -87,6 +88,12 @@ void load_plugin(const std::string &lib_name);
 
 namespace Internal {
 
+/** A lock held while a plugin is loaded, and while the autoschedulers
+ * that plugins register are added or looked up, so that these can
+ * happen on several threads at once (e.g. in a Generator server). It is
+ * recursive because loading a plugin registers its autoschedulers. */
+std::recursive_mutex &plugin_mutex();
+
 /** Some numeric conversions are UB if the value won't fit in the result;
  * safe_numeric_cast<>() is meant as a drop-in replacement for a C/C++ cast
  * that adds well-defined behavior for the UB cases, attempting to mimic
@@ -15,7 +15,7 @@
 #include "Func.h"
 #include "ImageParam.h"
 #include "JITModule.h"
-#if WITH_WABT || WITH_V8
+#if WITH_WABT || WITH_V8 || WITH_WASM_C_API
 #include "LLVM_Headers.h"
 #endif
 #include "LLVM_Output.h"
@@ -37,6 +37,10 @@
 #include "wabt/stream.h"
 #endif
 
+#if WITH_WASM_C_API
+#include "wasm.h"
+#endif
+
 // clang-format off
 // These includes are order-dependent, don't let clang-format reorder them
 #ifdef WITH_V8
@@ -45,7 +49,7 @@
 #endif  // WITH_V8
 // clang-format on
 
-#if WITH_WABT || WITH_V8
+#if WITH_WABT || WITH_V8 || WITH_WASM_C_API
 #if LLVM_VERSION >= 170
 LLD_HAS_DRIVER(wasm)
 #endif
@@ -69,7 +73,7 @@ static_assert(V8_API_VERSION >= 98,
               "Halide requires V8 v9.8 or later when compiling WITH_V8.");
 #endif
 
-#if WITH_WABT || WITH_V8
+#if WITH_WABT || WITH_V8 || WITH_WASM_C_API
 
 namespace {
 
@@ -2163,204 +2167,1011 @@ void add_extern_callbacks(const Local<Context> &context,
 
 #endif  // WITH_V8
 
-}  // namespace
-
-// clang-format off
-
-#if WITH_WABT
-using HostCallbackMap = std::unordered_map<std::string, wabt::interp::HostFunc::Callback>;
+#if WITH_WASM_C_API
 
-#define DEFINE_CALLBACK(f)                { #f, wabt_jit_##f##_callback },
-#define DEFINE_POSIX_MATH_CALLBACK(t, f)  { #f, wabt_posix_math_1<t, ::f> },
-#define DEFINE_POSIX_MATH_CALLBACK2(t, f) { #f, wabt_posix_math_2<t, ::f> },
+// Unlike the WABT interpreter, the engines behind the wasm-c-api run compiled
+// code, which we must not unwind through with a C++ exception. Errors raised
+// while wasm code is running are stashed here, and reported once the call
+// into wasm has returned.
+struct WasmCApiContext {
+    wasm_store_t *store = nullptr;
+    wasm_memory_t *memory = nullptr;
+    BDMalloc *bdmalloc = nullptr;
+    JITUserContext *jit_user_context = nullptr;
+    std::string pending_error;
+};
 
-#endif
+uint8_t *get_wasm_memory_base(WasmCApiContext &capi_context) {
+    return (uint8_t *)wasm_memory_data(capi_context.memory);
+}
 
-#ifdef WITH_V8
-using HostCallbackMap = std::unordered_map<std::string, FunctionCallback>;
+wasm32_ptr_t capi_malloc(WasmCApiContext &capi_context, size_t size) {
+    wasm32_ptr_t p = capi_context.bdmalloc->alloc_region(size);
+    if (!p) {
+        constexpr int kWasmPageSize = 65536;
+        const int32_t pages_needed = (size + kWasmPageSize - 1) / 65536;
+        wdebug(1) << "attempting to grow by pages: " << pages_needed << "\n";
 
-#define DEFINE_CALLBACK(f)                { #f, wasm_jit_##f##_callback },
-#define DEFINE_POSIX_MATH_CALLBACK(t, f)  { #f, wasm_jit_posix_math_callback<t, ::f> },
-#define DEFINE_POSIX_MATH_CALLBACK2(t, f)  { #f, wasm_jit_posix_math2_callback<t, ::f> },
-#endif
+        const bool grew = wasm_memory_grow(capi_context.memory, pages_needed);
+        internal_assert(grew) << "wasm_memory_grow() failed";
 
-const HostCallbackMap &get_host_callback_map() {
+        capi_context.bdmalloc->grow_total_size(wasm_memory_data_size(capi_context.memory));
+        p = capi_context.bdmalloc->alloc_region(size);
+    }
 
-    static HostCallbackMap m = {
-        // General runtime functions.
+    wdebug(2) << "allocation of " << size << " at: " << p << "\n";
+    return p;
+}
 
-        DEFINE_CALLBACK(__cxa_atexit)
-        DEFINE_CALLBACK(__extendhfsf2)
-        DEFINE_CALLBACK(__truncsfhf2)
-        DEFINE_CALLBACK(abort)
-        DEFINE_CALLBACK(fclose)
-        DEFINE_CALLBACK(fileno)
-        DEFINE_CALLBACK(fopen)
-        DEFINE_CALLBACK(free)
-        DEFINE_CALLBACK(fwrite)
-        DEFINE_CALLBACK(getenv)
-        DEFINE_CALLBACK(halide_error)
-        DEFINE_CALLBACK(halide_print)
-        DEFINE_CALLBACK(halide_trace_helper)
-        DEFINE_CALLBACK(malloc)
-        DEFINE_CALLBACK(memcmp)
-        DEFINE_CALLBACK(memcpy)
-        DEFINE_CALLBACK(memmove)
-        DEFINE_CALLBACK(memset)
-        DEFINE_CALLBACK(strlen)
-        DEFINE_CALLBACK(write)
+void capi_free(WasmCApiContext &capi_context, wasm32_ptr_t ptr) {
+    wdebug(2) << "freeing ptr at: " << ptr << "\n";
+    capi_context.bdmalloc->free_region(ptr);
+}
 
-        // Posix math.
-        DEFINE_POSIX_MATH_CALLBACK(double, acos)
-        DEFINE_POSIX_MATH_CALLBACK(double, acosh)
-        DEFINE_POSIX_MATH_CALLBACK(double, asin)
-        DEFINE_POSIX_MATH_CALLBACK(double, asinh)
-        DEFINE_POSIX_MATH_CALLBACK(double, atan)
-        DEFINE_POSIX_MATH_CALLBACK(double, atanh)
-        DEFINE_POSIX_MATH_CALLBACK(double, cos)
-        DEFINE_POSIX_MATH_CALLBACK(double, cosh)
-        DEFINE_POSIX_MATH_CALLBACK(double, exp)
-        DEFINE_POSIX_MATH_CALLBACK(double, log)
-        DEFINE_POSIX_MATH_CALLBACK(double, round)
-        DEFINE_POSIX_MATH_CALLBACK(double, sin)
-        DEFINE_POSIX_MATH_CALLBACK(double, sinh)
-        DEFINE_POSIX_MATH_CALLBACK(double, tan)
-        DEFINE_POSIX_MATH_CALLBACK(double, tanh)
+wasm_trap_t *make_trap(WasmCApiContext &capi_context, const std::string &message) {
+    wasm_message_t m;
+    wasm_name_new_from_string_nt(&m, message.c_str());
+    wasm_trap_t *trap = wasm_trap_new(capi_context.store, &m);
+    wasm_name_delete(&m);
+    return trap;
+}
 
-        DEFINE_POSIX_MATH_CALLBACK(float, acosf)
-        DEFINE_POSIX_MATH_CALLBACK(float, acoshf)
-        DEFINE_POSIX_MATH_CALLBACK(float, asinf)
-        DEFINE_POSIX_MATH_CALLBACK(float, asinhf)
-        DEFINE_POSIX_MATH_CALLBACK(float, atanf)
-        DEFINE_POSIX_MATH_CALLBACK(float, atanhf)
-        DEFINE_POSIX_MATH_CALLBACK(float, cosf)
-        DEFINE_POSIX_MATH_CALLBACK(float, coshf)
-        DEFINE_POSIX_MATH_CALLBACK(float, expf)
-        DEFINE_POSIX_MATH_CALLBACK(float, logf)
-        DEFINE_POSIX_MATH_CALLBACK(float, roundf)
-        DEFINE_POSIX_MATH_CALLBACK(float, sinf)
-        DEFINE_POSIX_MATH_CALLBACK(float, sinhf)
-        DEFINE_POSIX_MATH_CALLBACK(float, tanf)
-        DEFINE_POSIX_MATH_CALLBACK(float, tanhf)
+std::string trap_message(wasm_trap_t *trap) {
+    wasm_message_t m;
+    wasm_trap_message(trap, &m);
+    std::string s(m.data, m.size);
+    wasm_name_delete(&m);
+    // The message is NUL-terminated, which we don't want in a std::string.
+    while (!s.empty() && s.back() == 0) {
+        s.pop_back();
+    }
+    return s;
+}
 
-        DEFINE_POSIX_MATH_CALLBACK2(float, atan2f)
-        DEFINE_POSIX_MATH_CALLBACK2(double, atan2)
-        DEFINE_POSIX_MATH_CALLBACK2(float, fminf)
-        DEFINE_POSIX_MATH_CALLBACK2(double, fmin)
-        DEFINE_POSIX_MATH_CALLBACK2(float, fmaxf)
-        DEFINE_POSIX_MATH_CALLBACK2(double, fmax)
-        DEFINE_POSIX_MATH_CALLBACK2(float, powf)
-        DEFINE_POSIX_MATH_CALLBACK2(double, pow)
-    };
+std::string to_string(const wasm_name_t *name) {
+    return std::string(name->data, name->size);
+}
 
-    return m;
+JITUserContext *get_jit_user_context(WasmCApiContext &capi_context, const wasm_val_t &arg) {
+    int32_t ucon_magic = arg.of.i32;
+    if (ucon_magic == 0) {
+        return nullptr;
+    }
+    wassert(ucon_magic == kMagicJitUserContextValue);
+    JITUserContext *jit_user_context = capi_context.jit_user_context;
+    wassert(jit_user_context);
+    return jit_user_context;
 }
 
-#undef DEFINE_CALLBACK
-#undef DEFINE_POSIX_MATH_CALLBACK
-#undef DEFINE_POSIX_MATH_CALLBACK2
+// Given a halide_buffer_t on the host, allocate a wasm_halide_buffer_t in wasm
+// memory space and copy all relevant data. The resulting buf is laid out in
+// contiguous memory, and can be free with a single free().
+wasm32_ptr_t hostbuf_to_wasmbuf(WasmCApiContext &capi_context, const halide_buffer_t *src) {
+    if (!src) {
+        return 0;
+    }
 
-// clang-format on
+    wassert(src->device == 0);
+    wassert(src->device_interface == nullptr);
 
-#endif  // WITH_WABT || WITH_V8
+    // Assume our malloc() has everything 32-byte aligned,
+    // and insert enough padding for host to also be 32-byte aligned.
+    const size_t dims_size_in_bytes = sizeof(halide_dimension_t) * src->dimensions;
+    const size_t dims_offset = sizeof(wasm_halide_buffer_t);
+    const size_t mem_needed_base = sizeof(wasm_halide_buffer_t) + dims_size_in_bytes;
+    const size_t host_offset = align_up(mem_needed_base);
+    const size_t host_size_in_bytes = src->size_in_bytes();
+    const size_t mem_needed = host_offset + host_size_in_bytes;
 
-struct WasmModuleContents {
-    mutable RefCount ref_count;
+    const wasm32_ptr_t dst_ptr = capi_malloc(capi_context, mem_needed);
+    wassert(dst_ptr);
 
-    const Target target;
-    const std::vector<Argument> arguments;
-    std::map<std::string, Halide::JITExtern> jit_externs;
-    std::vector<JITModule> extern_deps;
-    JITModule trampolines;
+    uint8_t *base = get_wasm_memory_base(capi_context);
 
-#if WITH_WABT || WITH_V8
-    BDMalloc bdmalloc;
-#endif  // WITH_WABT || WITH_V8
+    wasm_halide_buffer_t *dst = (wasm_halide_buffer_t *)(base + dst_ptr);
+    dst->device = 0;
+    dst->device_interface = 0;
+    dst->host = src->host ? (dst_ptr + host_offset) : 0;
+    dst->flags = src->flags;
+    dst->type = src->type;
+    dst->dimensions = src->dimensions;
+    dst->dim = src->dimensions ? (dst_ptr + dims_offset) : 0;
+    dst->padding = 0;
 
-#if WITH_WABT
-    wabt::interp::Store store;
-    wabt::interp::Module::Ptr module;
-    wabt::interp::Instance::Ptr instance;
-    wabt::interp::Thread::Options thread_options;
-    wabt::interp::Memory::Ptr memory;
-#endif
+    if (src->dim) {
+        memcpy(base + dst->dim, src->dim, dims_size_in_bytes);
+    }
+    if (src->host) {
+        memcpy(base + dst->host, src->host, host_size_in_bytes);
+    }
 
-#ifdef WITH_V8
-    v8::Isolate *isolate = nullptr;
-    v8::ArrayBuffer::Allocator *array_buffer_allocator = nullptr;
-    v8::Persistent<v8::Context> v8_context;
-    v8::Persistent<v8::Function> v8_function;
-#endif
+    return dst_ptr;
+}
 
-    WasmModuleContents(
-        const Module &halide_module,
-        const std::vector<Argument> &arguments,
-        const std::string &fn_name,
-        const std::map<std::string, Halide::JITExtern> &jit_externs,
-        const std::vector<JITModule> &extern_deps);
+// Given a pointer to a wasm_halide_buffer_t in wasm memory space,
+// allocate a Buffer<> on the host and copy all relevant data.
+void wasmbuf_to_hostbuf(WasmCApiContext &capi_context, wasm32_ptr_t src_ptr, Halide::Runtime::Buffer<> &dst) {
+    wassert(src_ptr);
 
-    int run(const void *const *args);
+    uint8_t *base = get_wasm_memory_base(capi_context);
 
-    ~WasmModuleContents() = default;
-};
+    wasm_halide_buffer_t *src = (wasm_halide_buffer_t *)(base + src_ptr);
 
-// clang-format off
-WasmModuleContents::WasmModuleContents(
-    const Module &halide_module,
-    const std::vector<Argument> &arguments,
-    const std::string &fn_name,
-    const std::map<std::string, Halide::JITExtern> &jit_externs,
-    const std::vector<JITModule> &extern_deps)
-    : target(halide_module.target())
-      , arguments(arguments)
-      , jit_externs(jit_externs)
-      , extern_deps(extern_deps)
-      , trampolines(JITModule::make_trampolines_module(get_host_target(), jit_externs, kTrampolineSuffix, extern_deps))
-#if WITH_WABT
-      , store(wabt::interp::Store(calc_features(halide_module.target())))
-#endif
-// clang-format on
-{
+    wassert(src->device == 0);
+    wassert(src->device_interface == 0);
 
-#if WITH_WABT || WITH_V8
-    wdebug(1) << "Compiling wasm function " << fn_name << "\n";
-#endif  // WITH_WABT || WITH_V8
+    halide_buffer_t dst_tmp;
+    dst_tmp.device = 0;
+    dst_tmp.device_interface = nullptr;
+    dst_tmp.host = nullptr;
+    dst_tmp.flags = src->flags;
+    dst_tmp.type = src->type;
+    dst_tmp.dimensions = src->dimensions;
+    dst_tmp.dim = src->dim ? (halide_dimension_t *)(base + src->dim) : nullptr;
+    dst_tmp.padding = nullptr;
 
-#if WITH_WABT
-    user_assert(!target.has_feature(Target::WasmThreads)) << "wasm_threads requires Emscripten (or a similar compiler); it will never be supported under JIT.";
-    user_assert(!target.has_feature(Target::WebGPU)) << "wasm_webgpu requires Emscripten (or a similar compiler); it will never be supported under JIT.";
+    dst = Halide::Runtime::Buffer<>(dst_tmp);
+    if (src->host) {
+        // Don't use dst.copy(); it can tweak strides in ways that matter.
+        dst.allocate();
+        const size_t host_size_in_bytes = dst.raw_buffer()->size_in_bytes();
+        memcpy(dst.raw_buffer()->host, base + src->host, host_size_in_bytes);
+    }
+}
 
-    // Compile halide into wasm bytecode.
-    std::vector<char> final_wasm = compile_to_wasm(halide_module, fn_name);
+// Given a wasm_halide_buffer_t, copy possibly-changed data into a halide_buffer_t.
+// Both buffers are asserted to match in type and dimensions.
+void copy_wasmbuf_to_existing_hostbuf(WasmCApiContext &capi_context, wasm32_ptr_t src_ptr, halide_buffer_t *dst) {
+    wassert(src_ptr && dst);
 
-    // Create a wabt Module for it.
-    wabt::MemoryStream log_stream;
-    constexpr bool kReadDebugNames = true;
-    constexpr bool kStopOnFirstError = true;
-    constexpr bool kFailOnCustomSectionError = true;
-    wabt::ReadBinaryOptions options(store.features(),
-                                    &log_stream,
-                                    kReadDebugNames,
-                                    kStopOnFirstError,
-                                    kFailOnCustomSectionError);
-    wabt::Errors errors;
-    wabt::interp::ModuleDesc module_desc;
-    wabt::Result r = wabt::interp::ReadBinaryInterp("<internal>",
-                                                    final_wasm.data(),
-                                                    final_wasm.size(),
-                                                    options,
-                                                    &errors,
-                                                    &module_desc);
-    internal_assert(Succeeded(r))
-        << "ReadBinaryInterp failed:\n"
-        << wabt::FormatErrorsToString(errors, wabt::Location::Type::Binary) << "\n"
-        << "  log: " << to_string(log_stream) << "\n";
+    uint8_t *base = get_wasm_memory_base(capi_context);
 
-    if (WASM_DEBUG_LEVEL >= 2) {
-        wabt::MemoryStream dis_stream;
-        module_desc.istream.Disassemble(&dis_stream);
-        wdebug(WASM_DEBUG_LEVEL) << "Disassembly:\n"
-                                 << to_string(dis_stream) << "\n";
+    wasm_halide_buffer_t *src = (wasm_halide_buffer_t *)(base + src_ptr);
+    wassert(src->device == 0);
+    wassert(src->device_interface == 0);
+    wassert(src->dimensions == dst->dimensions);
+    wassert(src->type == dst->type);
+
+    if (src->dimensions) {
+        memcpy(dst->dim, base + src->dim, sizeof(halide_dimension_t) * src->dimensions);
+    }
+    if (src->host) {
+        size_t host_size_in_bytes = dst->size_in_bytes();
+        memcpy(dst->host, base + src->host, host_size_in_bytes);
+    }
+
+    dst->device = 0;
+    dst->device_interface = nullptr;
+    dst->flags = src->flags;
+}
+
+// Given a halide_buffer_t, copy possibly-changed data into a wasm_halide_buffer_t.
+// Both buffers are asserted to match in type and dimensions.
+void copy_hostbuf_to_existing_wasmbuf(WasmCApiContext &capi_context, const halide_buffer_t *src, wasm32_ptr_t dst_ptr) {
+    wassert(src && dst_ptr);
+
+    uint8_t *base = get_wasm_memory_base(capi_context);
+
+    wasm_halide_buffer_t *dst = (wasm_halide_buffer_t *)(base + dst_ptr);
+    wassert(src->device == 0);
+    wassert(src->device_interface == 0);
+    wassert(src->dimensions == dst->dimensions);
+    wassert(src->type == dst->type);
+
+    if (src->dimensions) {
+        memcpy(base + dst->dim, src->dim, sizeof(halide_dimension_t) * src->dimensions);
+    }
+    if (src->host) {
+        size_t host_size_in_bytes = src->size_in_bytes();
+        memcpy(base + dst->host, src->host, host_size_in_bytes);
+    }
+
+    dst->device = 0;
+    dst->device_interface = 0;
+    dst->flags = src->flags;
+}
+
+// --------------------------------------------------
+// Helpers for converting to/from wasm_val_t
+// --------------------------------------------------
+
+inline wasm_val_t make_wasm_val(int32_t v) {
+    wasm_val_t r;
+    r.kind = WASM_I32;
+    r.of.i32 = v;
+    return r;
+}
+
+inline wasm_val_t make_wasm_val(int64_t v) {
+    wasm_val_t r;
+    r.kind = WASM_I64;
+    r.of.i64 = v;
+    return r;
+}
+
+inline wasm_val_t make_wasm_val(float v) {
+    wasm_val_t r;
+    r.kind = WASM_F32;
+    r.of.f32 = v;
+    return r;
+}
+
+inline wasm_val_t make_wasm_val(double v) {
+    wasm_val_t r;
+    r.kind = WASM_F64;
+    r.of.f64 = v;
+    return r;
+}
+
+template<typename T>
+struct LoadWasmVal {
+    inline wasm_val_t operator()(const void *src) {
+        if constexpr (std::is_floating_point<T>::value) {
+            return make_wasm_val(*(const T *)src);
+        } else if constexpr (sizeof(T) == 8) {
+            return make_wasm_val(*(const int64_t *)src);
+        } else {
+            return make_wasm_val((int32_t) * (const T *)src);
+        }
+    }
+};
+
+template<>
+inline wasm_val_t LoadWasmVal<bool>::operator()(const void *src) {
+    return make_wasm_val((int32_t) * (const uint8_t *)src);
+}
+
+template<>
+inline wasm_val_t LoadWasmVal<void *>::operator()(const void *src) {
+    // Halide 'handle' types are always uint64, even on 32-bit systems
+    return make_wasm_val(*(const int64_t *)src);
+}
+
+template<>
+inline wasm_val_t LoadWasmVal<float16_t>::operator()(const void *src) {
+    return make_wasm_val((int32_t) * (const uint16_t *)src);
+}
+
+template<>
+inline wasm_val_t LoadWasmVal<bfloat16_t>::operator()(const void *src) {
+    return make_wasm_val((int32_t) * (const uint16_t *)src);
+}
+
+inline wasm_val_t load_wasm_val(const Type &t, const void *src) {
+    return dynamic_type_dispatch<LoadWasmVal>(t, src);
+}
+
+template<typename T>
+struct StoreWasmVal {
+    inline void operator()(const wasm_val_t &src, void *dst) {
+        if constexpr (std::is_same<T, float>::value) {
+            *(T *)dst = src.of.f32;
+        } else if constexpr (std::is_same<T, double>::value) {
+            *(T *)dst = src.of.f64;
+        } else if constexpr (sizeof(T) == 8) {
+            *(int64_t *)dst = src.of.i64;
+        } else {
+            *(T *)dst = (T)src.of.i32;
+        }
+    }
+};
+
+template<>
+inline void StoreWasmVal<bool>::operator()(const wasm_val_t &src, void *dst) {
+    *(uint8_t *)dst = (uint8_t)src.of.i32;
+}
+
+template<>
+inline void StoreWasmVal<void *>::operator()(const wasm_val_t &src, void *dst) {
+    // Halide 'handle' types are always uint64, even on 32-bit systems
+    *(int64_t *)dst = src.of.i64;
+}
+
+template<>
+inline void StoreWasmVal<float16_t>::operator()(const wasm_val_t &src, void *dst) {
+    *(uint16_t *)dst = (uint16_t)src.of.i32;
+}
+
+template<>
+inline void StoreWasmVal<bfloat16_t>::operator()(const wasm_val_t &src, void *dst) {
+    *(uint16_t *)dst = (uint16_t)src.of.i32;
+}
+
+inline void store_wasm_val(const Type &t, const wasm_val_t &src, void *dst) {
+    dynamic_type_dispatch<StoreWasmVal>(t, src, dst);
+}
+
+template<typename T>
+inline T get_wasm_val(const wasm_val_t &src) {
+    T r;
+    StoreWasmVal<T>()(src, &r);
+    return r;
+}
+
+// --------------------------------------------------
+// Host Callback Functions
+// --------------------------------------------------
+
+template<typename T, T some_func(T)>
+wasm_trap_t *capi_posix_math_1(void *env, const wasm_val_vec_t *args, wasm_val_vec_t *results) {
+    wassert(args->size == 1);
+    const T in = get_wasm_val<T>(args->data[0]);
+    results->data[0] = make_wasm_val(some_func(in));
+    return nullptr;
+}
+
+template<typename T, T some_func(T, T)>
+wasm_trap_t *capi_posix_math_2(void *env, const wasm_val_vec_t *args, wasm_val_vec_t *results) {
+    wassert(args->size == 2);
+    const T in1 = get_wasm_val<T>(args->data[0]);
+    const T in2 = get_wasm_val<T>(args->data[1]);
+    results->data[0] = make_wasm_val(some_func(in1, in2));
+    return nullptr;
+}
+
+#define CAPI_HOST_CALLBACK(x) \
+    wasm_trap_t *capi_jit_##x##_callback(void *env, const wasm_val_vec_t *args, wasm_val_vec_t *results)
+
+#define CAPI_HOST_CALLBACK_UNIMPLEMENTED(x)                                                                       \
+    CAPI_HOST_CALLBACK(x) {                                                                                       \
+        return make_trap(*(WasmCApiContext *)env, "WebAssembly JIT does not yet support the " #x "() call."); \
+    }
+
+CAPI_HOST_CALLBACK(__cxa_atexit) {
+    // nothing
+    results->data[0] = make_wasm_val((int32_t)0);
+    return nullptr;
+}
+
+CAPI_HOST_CALLBACK(__extendhfsf2) {
+    const uint16_t in = (uint16_t)args->data[0].of.i32;
+    const float out = (float)float16_t::make_from_bits(in);
+    results->data[0] = make_wasm_val(out);
+    return nullptr;
+}
+
+CAPI_HOST_CALLBACK(__truncsfhf2) {
+    const float in = args->data[0].of.f32;
+    const uint16_t out = float16_t(in).to_bits();
+    results->data[0] = make_wasm_val((int32_t)out);
+    return nullptr;
+}
+
+CAPI_HOST_CALLBACK(abort) {
+    abort();
+    return nullptr;
+}
+
+CAPI_HOST_CALLBACK_UNIMPLEMENTED(fclose)
+
+CAPI_HOST_CALLBACK_UNIMPLEMENTED(fileno)
+
+CAPI_HOST_CALLBACK_UNIMPLEMENTED(fopen)
+
+CAPI_HOST_CALLBACK(free) {
+    WasmCApiContext &capi_context = *(WasmCApiContext *)env;
+
+    wasm32_ptr_t p = args->data[0].of.i32;
+    if (p) {
+        p -= kExtraMallocSlop;
+    }
+    capi_free(capi_context, p);
+    return nullptr;
+}
+
+CAPI_HOST_CALLBACK_UNIMPLEMENTED(fwrite)
+
+CAPI_HOST_CALLBACK(getenv) {
+    WasmCApiContext &capi_context = *(WasmCApiContext *)env;
+
+    const int32_t s = args->data[0].of.i32;
+
+    char *e = getenv((char *)get_wasm_memory_base(capi_context) + s);
+
+    // TODO: this string is leaked
+    if (e) {
+        wasm32_ptr_t r = capi_malloc(capi_context, strlen(e) + 1);
+        // Re-fetch the base, as the malloc may have grown the memory.
+        strcpy((char *)get_wasm_memory_base(capi_context) + r, e);
+        results->data[0] = make_wasm_val(r);
+    } else {
+        results->data[0] = make_wasm_val((int32_t)0);
+    }
+    return nullptr;
+}
+
+CAPI_HOST_CALLBACK(halide_print) {
+    WasmCApiContext &capi_context = *(WasmCApiContext *)env;
+
+    wassert(args->size == 2);
+
+    JITUserContext *jit_user_context = get_jit_user_context(capi_context, args->data[0]);
+    const int32_t str_address = args->data[1].of.i32;
+
+    const char *str = (const char *)get_wasm_memory_base(capi_context) + str_address;
+
+    if (jit_user_context && jit_user_context->handlers.custom_print != nullptr) {
+        (*jit_user_context->handlers.custom_print)(jit_user_context, str);
+    } else {
+        std::cout << str;
+    }
+    return nullptr;
+}
+
+CAPI_HOST_CALLBACK(halide_trace_helper) {
+    WasmCApiContext &capi_context = *(WasmCApiContext *)env;
+
+    wassert(args->size == 12);
+
+    uint8_t *base = get_wasm_memory_base(capi_context);
+
+    JITUserContext *jit_user_context = get_jit_user_context(capi_context, args->data[0]);
+
+    const wasm32_ptr_t func_name_ptr = args->data[1].of.i32;
+    const wasm32_ptr_t value_ptr = args->data[2].of.i32;
+    const wasm32_ptr_t coordinates_ptr = args->data[3].of.i32;
+    const int type_code = args->data[4].of.i32;
+    const int type_bits = args->data[5].of.i32;
+    const int type_lanes = args->data[6].of.i32;
+    const int trace_code = args->data[7].of.i32;
+    const int parent_id = args->data[8].of.i32;
+    const int value_index = args->data[9].of.i32;
+    const int dimensions = args->data[10].of.i32;
+    const wasm32_ptr_t trace_tag_ptr = args->data[11].of.i32;
+
+    wassert(dimensions >= 0 && dimensions < 1024);  // not a hard limit, just a sanity check
+
+    halide_trace_event_t event;
+    event.func = (const char *)(base + func_name_ptr);
+    event.value = value_ptr ? ((void *)(base + value_ptr)) : nullptr;
+    event.coordinates = coordinates_ptr ? ((int32_t *)(base + coordinates_ptr)) : nullptr;
+    event.trace_tag = (const char *)(base + trace_tag_ptr);
+    event.type.code = (halide_type_code_t)type_code;
+    event.type.bits = (uint8_t)type_bits;
+    event.type.lanes = (uint16_t)type_lanes;
+    event.event = (halide_trace_event_code_t)trace_code;
+    event.parent_id = parent_id;
+    event.value_index = value_index;
+    event.dimensions = dimensions;
+
+    int32_t result = 0;
+    if (jit_user_context && jit_user_context->handlers.custom_trace != nullptr) {
+        result = (*jit_user_context->handlers.custom_trace)(jit_user_context, &event);
+    } else {
+        debug(0) << "Dropping trace event due to lack of trace handler.\n";
+    }
+
+    results->data[0] = make_wasm_val(result);
+    return nullptr;
+}
+
+CAPI_HOST_CALLBACK(halide_error) {
+    WasmCApiContext &capi_context = *(WasmCApiContext *)env;
+
+    wassert(args->size == 2);
+
+    JITUserContext *jit_user_context = get_jit_user_context(capi_context, args->data[0]);
+    const int32_t str_address = args->data[1].of.i32;
+
+    const char *str = (const char *)get_wasm_memory_base(capi_context) + str_address;
+
+    if (jit_user_context && jit_user_context->handlers.custom_error != nullptr) {
+        (*jit_user_context->handlers.custom_error)(jit_user_context, str);
+    } else if (capi_context.pending_error.empty()) {
+        // Reported by WasmModuleContents::run(), once we are out of wasm code.
+        capi_context.pending_error = str;
+    }
+    return nullptr;
+}
+
+CAPI_HOST_CALLBACK(malloc) {
+    WasmCApiContext &capi_context = *(WasmCApiContext *)env;
+
+    size_t size = args->data[0].of.i32 + kExtraMallocSlop;
+    wasm32_ptr_t p = capi_malloc(capi_context, size);
+    if (p) {
+        p += kExtraMallocSlop;
+    }
+    results->data[0] = make_wasm_val(p);
+    return nullptr;
+}
+
+CAPI_HOST_CALLBACK(memcpy) {
+    WasmCApiContext &capi_context = *(WasmCApiContext *)env;
+
+    const int32_t dst = args->data[0].of.i32;
+    const int32_t src = args->data[1].of.i32;
+    const int32_t n = args->data[2].of.i32;
+
+    uint8_t *base = get_wasm_memory_base(capi_context);
+
+    memcpy(base + dst, base + src, n);
+
+    results->data[0] = make_wasm_val(dst);
+    return nullptr;
+}
+
+CAPI_HOST_CALLBACK(memmove) {
+    WasmCApiContext &capi_context = *(WasmCApiContext *)env;
+
+    const int32_t dst = args->data[0].of.i32;
+    const int32_t src = args->data[1].of.i32;
+    const int32_t n = args->data[2].of.i32;
+
+    uint8_t *base = get_wasm_memory_base(capi_context);
+
+    memmove(base + dst, base + src, n);
+
+    results->data[0] = make_wasm_val(dst);
+    return nullptr;
+}
+
+CAPI_HOST_CALLBACK(memset) {
+    WasmCApiContext &capi_context = *(WasmCApiContext *)env;
+
+    const int32_t s = args->data[0].of.i32;
+    const int32_t c = args->data[1].of.i32;
+    const int32_t n = args->data[2].of.i32;
+
+    uint8_t *base = get_wasm_memory_base(capi_context);
+    memset(base + s, c, n);
+
+    results->data[0] = make_wasm_val(s);
+    return nullptr;
+}
+
+CAPI_HOST_CALLBACK(memcmp) {
+    WasmCApiContext &capi_context = *(WasmCApiContext *)env;
+
+    const int32_t s1 = args->data[0].of.i32;
+    const int32_t s2 = args->data[1].of.i32;
+    const int32_t n = args->data[2].of.i32;
+
+    uint8_t *base = get_wasm_memory_base(capi_context);
+
+    const int32_t r = memcmp(base + s1, base + s2, n);
+
+    results->data[0] = make_wasm_val(r);
+    return nullptr;
+}
+
+CAPI_HOST_CALLBACK(strlen) {
+    WasmCApiContext &capi_context = *(WasmCApiContext *)env;
+    const int32_t s = args->data[0].of.i32;
+
+    uint8_t *base = get_wasm_memory_base(capi_context);
+    int32_t r = strlen((char *)base + s);
+
+    results->data[0] = make_wasm_val(r);
+    return nullptr;
+}
+
+CAPI_HOST_CALLBACK_UNIMPLEMENTED(write)
+
+#undef CAPI_HOST_CALLBACK
+#undef CAPI_HOST_CALLBACK_UNIMPLEMENTED
+
+// --------------------------------------------------
+// Extern callbacks
+// --------------------------------------------------
+
+struct CApiExternCallback {
+    WasmCApiContext *capi_context;
+    std::vector<ExternArgType> arg_types;
+    TrampolineFn trampoline_fn;
+    std::string name;
+};
+
+wasm_trap_t *capi_extern_callback_wrapper(void *env, const wasm_val_vec_t *args, wasm_val_vec_t *results) {
+    const CApiExternCallback &callback = *(const CApiExternCallback *)env;
+    WasmCApiContext &capi_context = *callback.capi_context;
+    const std::vector<ExternArgType> &arg_types = callback.arg_types;
+
+    wassert(arg_types.size() >= 1);
+    const size_t arg_types_len = arg_types.size() - 1;
+    const ExternArgType &ret_type = arg_types[0];
+
+    // There's wasted space here, but that's ok.
+    std::vector<Halide::Runtime::Buffer<>> buffers(arg_types_len);
+    std::vector<uint64_t> scalars(arg_types_len, 0);
+    std::vector<void *> trampoline_args(arg_types_len, nullptr);
+
+    for (size_t i = 0; i < arg_types_len; ++i) {
+        const auto &a = arg_types[i + 1];
+        if (a.is_ucon) {
+            // The user context is passed as our magic int32 value (see
+            // WasmModuleContents::run); the value itself doesn't matter.
+            wassert(args->data[i].of.i32 == 0 || args->data[i].of.i32 == kMagicJitUserContextValue);
+            store_wasm_val(Int(32), args->data[i], &scalars[i]);
+            trampoline_args[i] = &scalars[i];
+        } else if (a.is_buffer) {
+            const wasm32_ptr_t buf_ptr = args->data[i].of.i32;
+            wasmbuf_to_hostbuf(capi_context, buf_ptr, buffers[i]);
+            trampoline_args[i] = buffers[i].raw_buffer();
+        } else {
+            store_wasm_val(a.type, args->data[i], &scalars[i]);
+            trampoline_args[i] = &scalars[i];
+        }
+    }
+
+    // The return value (if any) is always scalar.
+    uint64_t ret_val = 0;
+    const bool has_retval = !ret_type.is_void;
+    internal_assert(!ret_type.is_buffer);
+    if (has_retval) {
+        trampoline_args.push_back(&ret_val);
+    }
+    (*callback.trampoline_fn)(trampoline_args.data());
+
+    if (has_retval) {
+        results->data[0] = load_wasm_val(ret_type.type, (void *)&ret_val);
+    }
+
+    // Progagate buffer data backwards. Note that for arbitrary extern functions,
+    // we have no idea which buffers might be "input only", so we copy all data for all of them.
+    for (size_t i = 0; i < arg_types_len; ++i) {
+        const auto &a = arg_types[i + 1];
+        if (a.is_buffer) {
+            const wasm32_ptr_t buf_ptr = args->data[i].of.i32;
+            copy_hostbuf_to_existing_wasmbuf(capi_context, buffers[i].raw_buffer(), buf_ptr);
+        }
+    }
+
+    return nullptr;
+}
+
+// Imports that we can't resolve are bound to this, so that a module
+// that imports (but never calls) something unsupported can still run.
+wasm_trap_t *capi_unresolved_callback(void *env, const wasm_val_vec_t *args, wasm_val_vec_t *results) {
+    const CApiExternCallback &callback = *(const CApiExternCallback *)env;
+    return make_trap(*callback.capi_context, "Call to unresolved wasm import: " + callback.name);
+}
+
+wasm_engine_t *get_wasm_engine() {
+    // Engines are thread-safe, and expensive to create, so share one.
+    static wasm_engine_t *engine = wasm_engine_new();
+    internal_assert(engine) << "wasm_engine_new() failed\n";
+    return engine;
+}
+
+// Should this module run on the wasm-c-api engine, rather than the
+// WABT interpreter? When both are available, WABT stays the default.
+bool use_wasm_c_api_engine() {
+#if WITH_WABT
+    std::string engine = get_env_variable("HL_WASM_ENGINE");
+    if (engine == "wasm_c_api") {
+        return true;
+    }
+    user_assert(engine.empty() || engine == "wabt")
+        << "HL_WASM_ENGINE must be \"wabt\" or \"wasm_c_api\", not \"" << engine << "\"\n";
+    return false;
+#else
+    return true;
+#endif
+}
+
+// clang-format off
+
+using CApiHostCallbackMap = std::unordered_map<std::string, wasm_func_callback_with_env_t>;
+
+const CApiHostCallbackMap &get_wasm_c_api_host_callback_map() {
+
+    static CApiHostCallbackMap m = {
+        // General runtime functions.
+
+        { "__cxa_atexit", capi_jit___cxa_atexit_callback },
+        { "__extendhfsf2", capi_jit___extendhfsf2_callback },
+        { "__truncsfhf2", capi_jit___truncsfhf2_callback },
+        { "abort", capi_jit_abort_callback },
+        { "fclose", capi_jit_fclose_callback },
+        { "fileno", capi_jit_fileno_callback },
+        { "fopen", capi_jit_fopen_callback },
+        { "free", capi_jit_free_callback },
+        { "fwrite", capi_jit_fwrite_callback },
+        { "getenv", capi_jit_getenv_callback },
+        { "halide_error", capi_jit_halide_error_callback },
+        { "halide_print", capi_jit_halide_print_callback },
+        { "halide_trace_helper", capi_jit_halide_trace_helper_callback },
+        { "malloc", capi_jit_malloc_callback },
+        { "memcmp", capi_jit_memcmp_callback },
+        { "memcpy", capi_jit_memcpy_callback },
+        { "memmove", capi_jit_memmove_callback },
+        { "memset", capi_jit_memset_callback },
+        { "strlen", capi_jit_strlen_callback },
+        { "write", capi_jit_write_callback },
+
+        // Posix math.
+        { "acos", capi_posix_math_1<double, ::acos> },
+        { "acosh", capi_posix_math_1<double, ::acosh> },
+        { "asin", capi_posix_math_1<double, ::asin> },
+        { "asinh", capi_posix_math_1<double, ::asinh> },
+        { "atan", capi_posix_math_1<double, ::atan> },
+        { "atanh", capi_posix_math_1<double, ::atanh> },
+        { "cos", capi_posix_math_1<double, ::cos> },
+        { "cosh", capi_posix_math_1<double, ::cosh> },
+        { "exp", capi_posix_math_1<double, ::exp> },
+        { "log", capi_posix_math_1<double, ::log> },
+        { "round", capi_posix_math_1<double, ::round> },
+        { "sin", capi_posix_math_1<double, ::sin> },
+        { "sinh", capi_posix_math_1<double, ::sinh> },
+        { "tan", capi_posix_math_1<double, ::tan> },
+        { "tanh", capi_posix_math_1<double, ::tanh> },
+
+        { "acosf", capi_posix_math_1<float, ::acosf> },
+        { "acoshf", capi_posix_math_1<float, ::acoshf> },
+        { "asinf", capi_posix_math_1<float, ::asinf> },
+        { "asinhf", capi_posix_math_1<float, ::asinhf> },
+        { "atanf", capi_posix_math_1<float, ::atanf> },
+        { "atanhf", capi_posix_math_1<float, ::atanhf> },
+        { "cosf", capi_posix_math_1<float, ::cosf> },
+        { "coshf", capi_posix_math_1<float, ::coshf> },
+        { "expf", capi_posix_math_1<float, ::expf> },
+        { "logf", capi_posix_math_1<float, ::logf> },
+        { "roundf", capi_posix_math_1<float, ::roundf> },
+        { "sinf", capi_posix_math_1<float, ::sinf> },
+        { "sinhf", capi_posix_math_1<float, ::sinhf> },
+        { "tanf", capi_posix_math_1<float, ::tanf> },
+        { "tanhf", capi_posix_math_1<float, ::tanhf> },
+
+        { "atan2f", capi_posix_math_2<float, ::atan2f> },
+        { "atan2", capi_posix_math_2<double, ::atan2> },
+        { "fminf", capi_posix_math_2<float, ::fminf> },
+        { "fmin", capi_posix_math_2<double, ::fmin> },
+        { "fmaxf", capi_posix_math_2<float, ::fmaxf> },
+        { "fmax", capi_posix_math_2<double, ::fmax> },
+        { "powf", capi_posix_math_2<float, ::powf> },
+        { "pow", capi_posix_math_2<double, ::pow> },
+    };
+
+    return m;
+}
+
+// clang-format on
+
+#endif  // WITH_WASM_C_API
+
+}  // namespace
+
+// clang-format off
+
+#if WITH_WABT || WITH_V8
+
+#if WITH_WABT
+using HostCallbackMap = std::unordered_map<std::string, wabt::interp::HostFunc::Callback>;
+
+#define DEFINE_CALLBACK(f)                { #f, wabt_jit_##f##_callback },
+#define DEFINE_POSIX_MATH_CALLBACK(t, f)  { #f, wabt_posix_math_1<t, ::f> },
+#define DEFINE_POSIX_MATH_CALLBACK2(t, f) { #f, wabt_posix_math_2<t, ::f> },
+
+#endif
+
+#ifdef WITH_V8
+using HostCallbackMap = std::unordered_map<std::string, FunctionCallback>;
+
+#define DEFINE_CALLBACK(f)                { #f, wasm_jit_##f##_callback },
+#define DEFINE_POSIX_MATH_CALLBACK(t, f)  { #f, wasm_jit_posix_math_callback<t, ::f> },
+#define DEFINE_POSIX_MATH_CALLBACK2(t, f)  { #f, wasm_jit_posix_math2_callback<t, ::f> },
+#endif
+
+const HostCallbackMap &get_host_callback_map() {
+
+    static HostCallbackMap m = {
+        // General runtime functions.
+
+        DEFINE_CALLBACK(__cxa_atexit)
+        DEFINE_CALLBACK(__extendhfsf2)
+        DEFINE_CALLBACK(__truncsfhf2)
+        DEFINE_CALLBACK(abort)
+        DEFINE_CALLBACK(fclose)
+        DEFINE_CALLBACK(fileno)
+        DEFINE_CALLBACK(fopen)
+        DEFINE_CALLBACK(free)
+        DEFINE_CALLBACK(fwrite)
+        DEFINE_CALLBACK(getenv)
+        DEFINE_CALLBACK(halide_error)
+        DEFINE_CALLBACK(halide_print)
+        DEFINE_CALLBACK(halide_trace_helper)
+        DEFINE_CALLBACK(malloc)
+        DEFINE_CALLBACK(memcmp)
+        DEFINE_CALLBACK(memcpy)
+        DEFINE_CALLBACK(memmove)
+        DEFINE_CALLBACK(memset)
+        DEFINE_CALLBACK(strlen)
+        DEFINE_CALLBACK(write)
+
+        // Posix math.
+        DEFINE_POSIX_MATH_CALLBACK(double, acos)
+        DEFINE_POSIX_MATH_CALLBACK(double, acosh)
+        DEFINE_POSIX_MATH_CALLBACK(double, asin)
+        DEFINE_POSIX_MATH_CALLBACK(double, asinh)
+        DEFINE_POSIX_MATH_CALLBACK(double, atan)
+        DEFINE_POSIX_MATH_CALLBACK(double, atanh)
+        DEFINE_POSIX_MATH_CALLBACK(double, cos)
+        DEFINE_POSIX_MATH_CALLBACK(double, cosh)
+        DEFINE_POSIX_MATH_CALLBACK(double, exp)
+        DEFINE_POSIX_MATH_CALLBACK(double, log)
+        DEFINE_POSIX_MATH_CALLBACK(double, round)
+        DEFINE_POSIX_MATH_CALLBACK(double, sin)
+        DEFINE_POSIX_MATH_CALLBACK(double, sinh)
+        DEFINE_POSIX_MATH_CALLBACK(double, tan)
+        DEFINE_POSIX_MATH_CALLBACK(double, tanh)
+
+        DEFINE_POSIX_MATH_CALLBACK(float, acosf)
+        DEFINE_POSIX_MATH_CALLBACK(float, acoshf)
+        DEFINE_POSIX_MATH_CALLBACK(float, asinf)
+        DEFINE_POSIX_MATH_CALLBACK(float, asinhf)
+        DEFINE_POSIX_MATH_CALLBACK(float, atanf)
+        DEFINE_POSIX_MATH_CALLBACK(float, atanhf)
+        DEFINE_POSIX_MATH_CALLBACK(float, cosf)
+        DEFINE_POSIX_MATH_CALLBACK(float, coshf)
+        DEFINE_POSIX_MATH_CALLBACK(float, expf)
+        DEFINE_POSIX_MATH_CALLBACK(float, logf)
+        DEFINE_POSIX_MATH_CALLBACK(float, roundf)
+        DEFINE_POSIX_MATH_CALLBACK(float, sinf)
+        DEFINE_POSIX_MATH_CALLBACK(float, sinhf)
+        DEFINE_POSIX_MATH_CALLBACK(float, tanf)
+        DEFINE_POSIX_MATH_CALLBACK(float, tanhf)
+
+        DEFINE_POSIX_MATH_CALLBACK2(float, atan2f)
+        DEFINE_POSIX_MATH_CALLBACK2(double, atan2)
+        DEFINE_POSIX_MATH_CALLBACK2(float, fminf)
+        DEFINE_POSIX_MATH_CALLBACK2(double, fmin)
+        DEFINE_POSIX_MATH_CALLBACK2(float, fmaxf)
+        DEFINE_POSIX_MATH_CALLBACK2(double, fmax)
+        DEFINE_POSIX_MATH_CALLBACK2(float, powf)
+        DEFINE_POSIX_MATH_CALLBACK2(double, pow)
+    };
+
+    return m;
+}
+
+#undef DEFINE_CALLBACK
+#undef DEFINE_POSIX_MATH_CALLBACK
+#undef DEFINE_POSIX_MATH_CALLBACK2
+
+#endif  // WITH_WABT || WITH_V8
+
+// clang-format on
+
+#endif  // WITH_WABT || WITH_V8 || WITH_WASM_C_API
+
+struct WasmModuleContents {
+    mutable RefCount ref_count;
+
+    const Target target;
+    const std::vector<Argument> arguments;
+    std::map<std::string, Halide::JITExtern> jit_externs;
+    std::vector<JITModule> extern_deps;
+    JITModule trampolines;
+
+#if WITH_WABT || WITH_V8 || WITH_WASM_C_API
+    BDMalloc bdmalloc;
+#endif  // WITH_WABT || WITH_V8 || WITH_WASM_C_API
+
+#if WITH_WABT
+    wabt::interp::Store store;
+    wabt::interp::Module::Ptr module;
+    wabt::interp::Instance::Ptr instance;
+    wabt::interp::Thread::Options thread_options;
+    wabt::interp::Memory::Ptr memory;
+#endif
+
+#ifdef WITH_V8
+    v8::Isolate *isolate = nullptr;
+    v8::ArrayBuffer::Allocator *array_buffer_allocator = nullptr;
+    v8::Persistent<v8::Context> v8_context;
+    v8::Persistent<v8::Function> v8_function;
+#endif
+
+#if WITH_WASM_C_API
+    // Only set if this module runs on the wasm-c-api engine.
+    wasm_store_t *capi_store = nullptr;
+    wasm_module_t *capi_module = nullptr;
+    wasm_instance_t *capi_instance = nullptr;
+    wasm_extern_vec_t capi_exports = WASM_EMPTY_VEC;
+    wasm_func_t *capi_function = nullptr;
+    WasmCApiContext capi_context;
+    std::vector<std::unique_ptr<CApiExternCallback>> capi_extern_callbacks;
+
+    void init_with_wasm_c_api(const Module &halide_module, const std::string &fn_name);
+    int run_with_wasm_c_api(const void *const *args);
+#endif
+
+    WasmModuleContents(
+        const Module &halide_module,
+        const std::vector<Argument> &arguments,
+        const std::string &fn_name,
+        const std::map<std::string, Halide::JITExtern> &jit_externs,
+        const std::vector<JITModule> &extern_deps);
+
+    int run(const void *const *args);
+
+#if WITH_WASM_C_API
+    ~WasmModuleContents();
+#else
+    ~WasmModuleContents() = default;
+#endif
+};
+
+#if WITH_WASM_C_API
+WasmModuleContents::~WasmModuleContents() {
+    wasm_extern_vec_delete(&capi_exports);
+    if (capi_instance) {
+        wasm_instance_delete(capi_instance);
+    }
+    if (capi_module) {
+        wasm_module_delete(capi_module);
+    }
+    if (capi_store) {
+        wasm_store_delete(capi_store);
+    }
+}
+#endif  // WITH_WASM_C_API
+
+// clang-format off
+WasmModuleContents::WasmModuleContents(
+    const Module &halide_module,
+    const std::vector<Argument> &arguments,
+    const std::string &fn_name,
+    const std::map<std::string, Halide::JITExtern> &jit_externs,
+    const std::vector<JITModule> &extern_deps)
+    : target(halide_module.target())
+      , arguments(arguments)
+      , jit_externs(jit_externs)
+      , extern_deps(extern_deps)
+      , trampolines(JITModule::make_trampolines_module(get_host_target(), jit_externs, kTrampolineSuffix, extern_deps))
+#if WITH_WABT
+      , store(wabt::interp::Store(calc_features(halide_module.target())))
+#endif
+// clang-format on
+{
+
+#if WITH_WABT || WITH_V8 || WITH_WASM_C_API
+    wdebug(1) << "Compiling wasm function " << fn_name << "\n";
+#endif  // WITH_WABT || WITH_V8 || WITH_WASM_C_API
+
+#if WITH_WASM_C_API
+    if (use_wasm_c_api_engine()) {
+        init_with_wasm_c_api(halide_module, fn_name);
+        return;
+    }
+#endif  // WITH_WASM_C_API
+
+#if WITH_WABT
+    user_assert(!target.has_feature(Target::WasmThreads)) << "wasm_threads requires Emscripten (or a similar compiler); it will never be supported under JIT.";
+    user_assert(!target.has_feature(Target::WebGPU)) << "wasm_webgpu requires Emscripten (or a similar compiler); it will never be supported under JIT.";
+
+    // Compile halide into wasm bytecode.
+    std::vector<char> final_wasm = compile_to_wasm(halide_module, fn_name);
+
+    // Create a wabt Module for it.
+    wabt::MemoryStream log_stream;
+    constexpr bool kReadDebugNames = true;
+    constexpr bool kStopOnFirstError = true;
+    constexpr bool kFailOnCustomSectionError = true;
+    wabt::ReadBinaryOptions options(store.features(),
+                                    &log_stream,
+                                    kReadDebugNames,
+                                    kStopOnFirstError,
+                                    kFailOnCustomSectionError);
+    wabt::Errors errors;
+    wabt::interp::ModuleDesc module_desc;
+    wabt::Result r = wabt::interp::ReadBinaryInterp("<internal>",
+                                                    final_wasm.data(),
+                                                    final_wasm.size(),
+                                                    options,
+                                                    &errors,
+                                                    &module_desc);
+    internal_assert(Succeeded(r))
+        << "ReadBinaryInterp failed:\n"
+        << wabt::FormatErrorsToString(errors, wabt::Location::Type::Binary) << "\n"
+        << "  log: " << to_string(log_stream) << "\n";
+
+    if (WASM_DEBUG_LEVEL >= 2) {
+        wabt::MemoryStream dis_stream;
+        module_desc.istream.Disassemble(&dis_stream);
+        wdebug(WASM_DEBUG_LEVEL) << "Disassembly:\n"
+                                 << to_string(dis_stream) << "\n";
     }
 
     module = wabt::interp::Module::New(store, module_desc);
@@ -2537,7 +3348,196 @@ WasmModuleContents::WasmModuleContents(
 #endif
 }
 
+#if WITH_WASM_C_API
+void WasmModuleContents::init_with_wasm_c_api(const Module &halide_module, const std::string &fn_name) {
+    user_assert(!target.has_feature(Target::WasmThreads)) << "wasm_threads requires Emscripten (or a similar compiler); it will never be supported under JIT.";
+    user_assert(!target.has_feature(Target::WebGPU)) << "wasm_webgpu requires Emscripten (or a similar compiler); it will never be supported under JIT.";
+
+    // Compile halide into wasm bytecode.
+    std::vector<char> final_wasm = compile_to_wasm(halide_module, fn_name);
+
+    // The engine compiles the bytecode to native code here, once, rather
+    // than interpreting it on every call to run().
+    capi_store = wasm_store_new(get_wasm_engine());
+    internal_assert(capi_store) << "wasm_store_new() failed\n";
+    capi_context.store = capi_store;
+    capi_context.bdmalloc = &bdmalloc;
+
+    wasm_byte_vec_t binary;
+    wasm_byte_vec_new(&binary, final_wasm.size(), final_wasm.data());
+    capi_module = wasm_module_new(capi_store, &binary);
+    wasm_byte_vec_delete(&binary);
+    internal_assert(capi_module) << "wasm_module_new() failed\n";
+
+    // Bind all imports to our callbacks.
+    wasm_importtype_vec_t import_types;
+    wasm_module_imports(capi_module, &import_types);
+
+    std::vector<wasm_extern_t *> imports;
+    const CApiHostCallbackMap &host_callback_map = get_wasm_c_api_host_callback_map();
+    for (size_t i = 0; i < import_types.size; i++) {
+        const wasm_importtype_t *import = import_types.data[i];
+        const std::string module_name = to_string(wasm_importtype_module(import));
+        const std::string name = to_string(wasm_importtype_name(import));
+        wdebug(1) << "import=" << module_name << "." << name << "\n";
+
+        const wasm_externtype_t *type = wasm_importtype_type(import);
+        internal_assert(wasm_externtype_kind(type) == WASM_EXTERN_FUNC && module_name == "env")
+            << "Unsupported wasm import: " << module_name << "." << name << "\n";
+        const wasm_functype_t *func_type = wasm_externtype_as_functype_const(type);
+
+        wasm_func_t *func = nullptr;
+        auto it = host_callback_map.find(name);
+        if (it != host_callback_map.end()) {
+            func = wasm_func_new_with_env(capi_store, func_type, it->second, &capi_context, nullptr);
+        } else {
+            // If it's not one of the standard host callbacks, assume it must be
+            // a define_extern, and look for it in the jit_externs.
+            auto callback = std::make_unique<CApiExternCallback>();
+            callback->capi_context = &capi_context;
+            callback->name = name;
+            if (build_extern_arg_types(name, jit_externs, trampolines, callback->trampoline_fn, callback->arg_types)) {
+                func = wasm_func_new_with_env(capi_store, func_type, capi_extern_callback_wrapper, callback.get(), nullptr);
+            } else {
+                func = wasm_func_new_with_env(capi_store, func_type, capi_unresolved_callback, callback.get(), nullptr);
+            }
+            capi_extern_callbacks.push_back(std::move(callback));
+        }
+        imports.push_back(wasm_func_as_extern(func));
+    }
+    wasm_importtype_vec_delete(&import_types);
+
+    wasm_extern_vec_t import_vec;
+    wasm_extern_vec_new(&import_vec, imports.size(), imports.data());
+    wasm_trap_t *trap = nullptr;
+    capi_instance = wasm_instance_new(capi_store, capi_module, &import_vec, &trap);
+    wasm_extern_vec_delete(&import_vec);
+    if (trap) {
+        std::string message = trap_message(trap);
+        wasm_trap_delete(trap);
+        internal_error << "Error initializing module: " << message << "\n";
+    }
+    internal_assert(capi_instance) << "wasm_instance_new() failed\n";
+
+    wasm_exporttype_vec_t export_types;
+    wasm_module_exports(capi_module, &export_types);
+    wasm_instance_exports(capi_instance, &capi_exports);
+    internal_assert(export_types.size == capi_exports.size);
+
+    int32_t heap_base = -1;
+    for (size_t i = 0; i < export_types.size; i++) {
+        const std::string name = to_string(wasm_exporttype_name(export_types.data[i]));
+        wasm_extern_t *e = capi_exports.data[i];
+        if (name == "__heap_base") {
+            internal_assert(wasm_extern_kind(e) == WASM_EXTERN_GLOBAL);
+            wasm_val_t v;
+            wasm_global_get(wasm_extern_as_global(e), &v);
+            heap_base = v.of.i32;
+            wdebug(1) << "__heap_base is " << heap_base << "\n";
+        } else if (name == "memory") {
+            internal_assert(wasm_extern_kind(e) == WASM_EXTERN_MEMORY);
+            internal_assert(!capi_context.memory) << "Expected exactly one memory object";
+            capi_context.memory = wasm_extern_as_memory(e);
+            wdebug(1) << "heap_size is " << wasm_memory_data_size(capi_context.memory) << "\n";
+        } else if (name == fn_name) {
+            internal_assert(wasm_extern_kind(e) == WASM_EXTERN_FUNC);
+            capi_function = wasm_extern_as_func(e);
+        }
+    }
+    wasm_exporttype_vec_delete(&export_types);
+
+    internal_assert(heap_base >= 0) << "__heap_base not found";
+    internal_assert(capi_context.memory && wasm_memory_data_size(capi_context.memory) > 0) << "memory size is unlikely";
+    internal_assert(capi_function) << "Exported function " << fn_name << " not found";
+
+    bdmalloc.init(wasm_memory_data_size(capi_context.memory), heap_base);
+}
+
+int WasmModuleContents::run_with_wasm_c_api(const void *const *args) {
+    std::vector<wasm32_ptr_t> wbufs(arguments.size(), 0);
+    std::vector<wasm_val_t> capi_args;
+
+    capi_context.jit_user_context = nullptr;
+    capi_context.pending_error.clear();
+
+    for (size_t i = 0; i < arguments.size(); i++) {
+        const Argument &arg = arguments[i];
+        const void *arg_ptr = args[i];
+        if (arg.is_buffer()) {
+            halide_buffer_t *buf = (halide_buffer_t *)const_cast<void *>(arg_ptr);
+            // It's OK for this to be null (let Halide asserts handle it)
+            wasm32_ptr_t wbuf = hostbuf_to_wasmbuf(capi_context, buf);
+            wbufs[i] = wbuf;
+            capi_args.push_back(make_wasm_val(wbuf));
+        } else {
+            if (arg.name == "__user_context") {
+                capi_args.push_back(make_wasm_val(kMagicJitUserContextValue));
+                capi_context.jit_user_context = *(JITUserContext **)const_cast<void *>(arg_ptr);
+            } else {
+                capi_args.push_back(load_wasm_val(arg.type, arg_ptr));
+            }
+        }
+    }
+
+    wasm_val_vec_t arg_vec, result_vec;
+    wasm_val_vec_new(&arg_vec, capi_args.size(), capi_args.data());
+    wasm_val_vec_new_uninitialized(&result_vec, 1);
+
+    wasm_trap_t *trap = wasm_func_call(capi_function, &arg_vec, &result_vec);
+    int32_t result = -1;
+    std::string trap_msg;
+    if (trap) {
+        trap_msg = trap_message(trap);
+        wasm_trap_delete(trap);
+    } else {
+        result = result_vec.data[0].of.i32;
+    }
+    wasm_val_vec_delete(&arg_vec);
+    wasm_val_vec_delete(&result_vec);
+
+    wdebug(1) << "Result is " << result << "\n";
+
+    if (!trap_msg.empty()) {
+        internal_error << "Error running wasm: " << trap_msg << "\n";
+    }
+
+    if (result == 0) {
+        // Update any output buffers
+        for (size_t i = 0; i < arguments.size(); i++) {
+            const Argument &arg = arguments[i];
+            const void *arg_ptr = args[i];
+            if (arg.is_buffer()) {
+                halide_buffer_t *buf = (halide_buffer_t *)const_cast<void *>(arg_ptr);
+                copy_wasmbuf_to_existing_hostbuf(capi_context, wbufs[i], buf);
+            }
+        }
+    }
+
+    for (wasm32_ptr_t p : wbufs) {
+        capi_free(capi_context, p);
+    }
+
+    // Don't do this: things allocated by Halide runtime might need to persist
+    // between multiple invocations of the same function.
+    // bdmalloc.reset();
+
+    capi_context.jit_user_context = nullptr;
+    if (!capi_context.pending_error.empty()) {
+        std::string error;
+        std::swap(error, capi_context.pending_error);
+        halide_runtime_error << error;
+    }
+    return result;
+}
+#endif  // WITH_WASM_C_API
+
 int WasmModuleContents::run(const void *const *args) {
+#if WITH_WASM_C_API
+    if (capi_instance) {
+        return run_with_wasm_c_api(args);
+    }
+#endif  // WITH_WASM_C_API
+
 #if WITH_WABT
     const auto &module_desc = module->desc();
 
@@ -2720,7 +3720,7 @@ void destroy<WasmModuleContents>(const WasmModuleContents *p) {
 
 /*static*/
 bool WasmModule::can_jit_target(const Target &target) {
-#if WITH_WABT || WITH_V8
+#if WITH_WABT || WITH_V8 || WITH_WASM_C_API
     if (target.arch == Target::WebAssembly) {
         return true;
     }
@@ -2735,7 +3735,7 @@ WasmModule WasmModule::compile(
     const std::string &fn_name,
     const std::map<std::string, Halide::JITExtern> &jit_externs,
     const std::vector<JITModule> &extern_deps) {
-#if defined(WITH_WABT) || defined(WITH_V8)
+#if defined(WITH_WABT) || defined(WITH_V8) || defined(WITH_WASM_C_API)
     WasmModule wasm_module;
     wasm_module.contents = new WasmModuleContents(module, arguments, fn_name, jit_externs, extern_deps);
     return wasm_module;
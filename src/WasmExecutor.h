@@ -7,7 +7,8 @@
  * Bindings for parameters, extern calls, etc. are established and the
  * Wasm code is executed. Allows calls to realize to work
  * exactly as if native code had been run, but via a JavaScript/Wasm VM.
- * Currently, only the WABT interpreter is supported.
+ * The wasm can be run by the WABT interpreter, by V8, or compiled to
+ * native code by any engine implementing the standard wasm-c-api.
  */
 
 #include "Argument.h"
@@ -0,0 +1,44 @@
+#include "WorkBudget.h"
+#include "CompilerLogger.h"
+#include "Debug.h"
+#include "Util.h"
+
+#include <atomic>
+#include <cstdlib>
+
+namespace Halide {
+namespace Internal {
+
+namespace {
+
+std::atomic<uint64_t> &work_budget() {
+    static std::atomic<uint64_t> budget{[]() -> uint64_t {
+        std::string env = get_env_variable("HL_WORK_BUDGET");
+        return env.empty() ? 0 : std::strtoull(env.c_str(), nullptr, 10);
+    }()};
+    return budget;
+}
+
+}  // namespace
+
+uint64_t get_work_budget() {
+    return work_budget().load(std::memory_order_relaxed);
+}
+
+void set_work_budget(uint64_t budget) {
+    work_budget().store(budget, std::memory_order_relaxed);
+}
+
+void WorkBudget::exhausted(const Expr &e) {
+    if (reported) {
+        return;
+    }
+    reported = true;
+    debug(2) << analysis << " exceeded its work budget of " << limit << " steps on: " << e << "\n";
+    if (auto *logger = get_compiler_logger()) {
+        logger->record_work_budget_exceeded(analysis, e);
+    }
+}
+
+}  // namespace Internal
+}  // namespace Halide
@@ -0,0 +1,65 @@
+#ifndef HALIDE_WORK_BUDGET_H
+#define HALIDE_WORK_BUDGET_H
+
+/** \file
+ * Defines a cap on the work expensive compile-time analyses may do on a
+ * single expression before falling back to a conservative answer.
+ */
+
+#include <cstdint>
+
+#include "Expr.h"
+
+namespace Halide {
+namespace Internal {
+
+/** Get the number of steps the simplifier, bounds inference, or the
+ * solver may take on a single top-level expression before giving up and
+ * returning a conservative result. Zero (the default) means no limit. The
+ * initial value is read from the environment variable HL_WORK_BUDGET. */
+uint64_t get_work_budget();
+
+/** Set the work budget for analyses started from now on. Zero means no
+ * limit. */
+void set_work_budget(uint64_t budget);
+
+/** Counts the steps taken by one instance of an analysis against the
+ * work budget. The first time the budget runs out the expression being
+ * analyzed is reported to the active CompilerLogger, if any. */
+class WorkBudget {
+public:
+    explicit WorkBudget(const char *analysis)
+        : analysis(analysis), limit(get_work_budget()) {
+    }
+
+    /** Account for one step of the analysis of e. Returns false if the
+     * budget is exhausted, in which case the caller should return a
+     * conservative result for e instead of analyzing it further. */
+    HALIDE_ALWAYS_INLINE bool spend(const Expr &e) {
+        if (limit == 0 || ++work <= limit) {
+            return true;
+        }
+        exhausted(e);
+        return false;
+    }
+
+    /** Start counting from zero again, e.g. for the next top-level
+     * expression. */
+    void reset() {
+        work = 0;
+        reported = false;
+    }
+
+private:
+    void exhausted(const Expr &e);
+
+    const char *analysis;
+    uint64_t limit;
+    uint64_t work = 0;
+    bool reported = false;
+};
+
+}  // namespace Internal
+}  // namespace Halide
+
+#endif
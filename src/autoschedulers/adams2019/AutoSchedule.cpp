@@ -66,6 +66,7 @@
 #include "NetworkSize.h"
 #include "ParamParser.h"
 #include "PerfectHashMap.h"
+#include "SearchBudget.h"
 #include "State.h"
 #include "Timer.h"
 
@@ -232,7 +233,8 @@ IntrusivePtr<State> optimal_schedule_pass(FunctionDAG &dag,
                                           int num_passes,
                                           ProgressBar &tick,
                                           std::unordered_set<uint64_t> &permitted_hashes,
-                                          Cache *cache) {
+                                          Cache *cache,
+                                          SearchBudget &budget) {
 
     if (cost_model) {
         configure_pipeline_features(dag, params, cost_model);
@@ -290,7 +292,8 @@ IntrusivePtr<State> optimal_schedule_pass(FunctionDAG &dag,
                                              num_passes,
                                              tick,
                                              permitted_hashes,
-                                             cache);
+                                             cache,
+                                             budget);
             } else {
                 internal_error << "Ran out of legal states with beam size " << params.beam_size << "\n";
             }
@@ -300,8 +303,16 @@ IntrusivePtr<State> optimal_schedule_pass(FunctionDAG &dag,
             aslog(1) << "*** Warning: Huge number of states generated (" << pending.size() << ").\n";
         }
 
+        // Once the time budget is spent, finish this pass greedily so
+        // that we still end up with a complete schedule.
+        int beam_size = params.beam_size;
+        if (budget.expired()) {
+            beam_size = 1;
+            budget.greedy_decisions++;
+        }
+
         expanded = 0;
-        while (expanded < params.beam_size && !pending.empty()) {
+        while (expanded < beam_size && !pending.empty()) {
 
             IntrusivePtr<State> state{pending.pop()};
 
@@ -456,16 +467,38 @@ IntrusivePtr<State> optimal_schedule(FunctionDAG &dag,
         num_passes = std::atoi(num_passes_str.c_str());
     }
 
+    SearchBudget budget(params.time_limit_ms);
+    Adams2019Params pass_params = params;
+    double last_pass_seconds = 0;
+    int passes_completed = 0;
+
     for (int i = 0; i < num_passes; i++) {
+        if (budget.limited() && i > 0) {
+            // Pass time scales roughly linearly with beam size, so
+            // shrink the beam to fit in the time remaining, and stop
+            // once the beam would become too narrow to be useful.
+            double remaining = budget.remaining_seconds();
+            if (remaining < last_pass_seconds) {
+                int beam_size = (int)(pass_params.beam_size * remaining / last_pass_seconds);
+                if (beam_size < 2) {
+                    break;
+                }
+                aslog(1) << "Shrinking beam size to " << beam_size << " to fit the time limit\n";
+                pass_params.beam_size = beam_size;
+            }
+        }
+
         ProgressBar tick;
 
         Timer timer;
 
-        auto pass = optimal_schedule_pass(dag, outputs, params, cost_model,
-                                          rng, i, num_passes, tick, permitted_hashes, &cache);
+        auto pass = optimal_schedule_pass(dag, outputs, pass_params, cost_model,
+                                          rng, i, num_passes, tick, permitted_hashes, &cache, budget);
 
         std::chrono::duration<double> total_time = timer.elapsed();
         auto milli = std::chrono::duration_cast<std::chrono::milliseconds>(total_time).count();
+        last_pass_seconds = total_time.count();
+        passes_completed++;
 
         tick.clear();
 
@@ -490,16 +523,33 @@ IntrusivePtr<State> optimal_schedule(FunctionDAG &dag,
 
     aslog(1) << "Best cost: " << best->cost << "\n";
 
+    if (budget.limited()) {
+        auto milli = std::chrono::duration_cast<std::chrono::milliseconds>(budget.elapsed()).count();
+        aslog(1) << "Search took " << milli << " ms of a " << params.time_limit_ms
+                 << " ms time limit and completed " << passes_completed << " of " << num_passes << " passes";
+        if (budget.greedy_decisions > 0) {
+            aslog(1) << ", making the last " << budget.greedy_decisions << " decisions greedily";
+        }
+        aslog(1) << "\n";
+    }
+
     if (options.cache_blocks) {
         aslog(1) << "Cache (block) hits: " << cache.cache_hits << "\n";
         aslog(1) << "Cache (block) misses: " << cache.cache_misses << "\n";
     }
 
+    if (options.cache_features) {
+        aslog(1) << "Cache (features) hits: " << LoopNest::feature_cache_hits << "\n";
+        aslog(1) << "Cache (features) misses: " << LoopNest::feature_cache_misses << "\n";
+    }
+
     return best;
 }
 
 // Keep track of how many times we evaluated a state.
 int State::cost_calculations = 0;
+int64_t LoopNest::feature_cache_hits = 0;
+int64_t LoopNest::feature_cache_misses = 0;
 
 // The main entrypoint to generate a schedule for a pipeline.
 void generate_schedule(const std::vector<Function> &outputs,
@@ -516,11 +566,14 @@ void generate_schedule(const std::vector<Function> &outputs,
     aslog(1) << "Adams2019.disable_memoized_features:" << params.disable_memoized_features << "\n";
     aslog(1) << "Adams2019.disable_memoized_blocks:" << params.disable_memoized_blocks << "\n";
     aslog(1) << "Adams2019.memory_limit:" << params.memory_limit << "\n";
+    aslog(1) << "Adams2019.time_limit_ms:" << params.time_limit_ms << "\n";
 
     // Start a timer
     HALIDE_TIC;
 
     State::cost_calculations = 0;
+    LoopNest::feature_cache_hits = 0;
+    LoopNest::feature_cache_misses = 0;
 
     std::mt19937 rng((uint32_t)params.random_dropout_seed);
 
@@ -599,6 +652,7 @@ struct Adams2019 {
             parser.parse("disable_memoized_features", &params.disable_memoized_features);
             parser.parse("disable_memoized_blocks", &params.disable_memoized_blocks);
             parser.parse("memory_limit", &params.memory_limit);
+            parser.parse("time_limit_ms", &params.time_limit_ms);
             parser.finish();
         }
         Autoscheduler::generate_schedule(outputs, target, params, results);
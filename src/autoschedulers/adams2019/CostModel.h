@@ -53,6 +53,13 @@ struct Adams2019Params {
     /** If >= 0, only consider schedules that allocate at most this much memory (measured in bytes).
      * Formerly HL_AUTOSCHEDULE_MEMORY_LIMIT */
     int64_t memory_limit = -1;
+
+    /** If > 0, a wall-clock budget for the schedule search, in milliseconds.
+     * Once it is spent, the current pass finishes greedily and no further
+     * coarse-to-fine passes are started, so the best complete schedule found
+     * so far is returned. Later passes shrink their beam to fit the time that
+     * remains. */
+    int64_t time_limit_ms = 0;
 };
 
 }  // namespace Autoscheduler
@@ -46,6 +46,23 @@ bool ends_with(const std::string &str, const std::string &suffix) {
 
 }  // namespace
 
+// Pick the number of schedules to evaluate per call into the cost
+// model. Larger batches amortize the per-call overhead and give the
+// inference pipeline more parallel work, but the schedule feature queue
+// grows with the number of stages, so only small pipelines get larger
+// batches, keeping the queue at around 4MB. Training enqueues up to 1024
+// schedules before calling backprop, so never go below that.
+int DefaultCostModel::pick_batch_size(int max_num_stages) {
+    const int min_batch_size = 1024, max_batch_size = 4096;
+    const int64_t target_queue_floats = 1024 * 1024;
+    const int64_t fits = target_queue_floats / ((int64_t)head2_w * std::max(max_num_stages, 1));
+    int batch_size = min_batch_size;
+    while (batch_size < max_batch_size && batch_size * 2 <= fits) {
+        batch_size *= 2;
+    }
+    return batch_size;
+}
+
 void DefaultCostModel::set_pipeline_features(const Internal::Autoscheduler::FunctionDAG &dag,
                                              const Internal::Autoscheduler::Adams2019Params &params) {
 
@@ -142,13 +159,12 @@ void DefaultCostModel::enqueue(int ns, Runtime::Buffer<float> *schedule_feats, d
         << "schedule features has more stages (" << num_stages
         << ") than pipeline features (" << max_num_stages << ")\n";
 
-    const int batch_size = 1024;
     if (!schedule_feat_queue.data() ||
         schedule_feat_queue.dim(2).extent() < max_num_stages) {
         internal_assert(cursor == 0);
+        batch_size = pick_batch_size(max_num_stages);
         schedule_feat_queue = Runtime::Buffer<float>(batch_size, head2_w, max_num_stages);
-        if (!costs.data()) {
-            internal_assert(!cost_ptrs.data());
+        if (!costs.data() || costs.dim(0).extent() < batch_size) {
             costs = Runtime::Buffer<float>(batch_size);
             cost_ptrs = Runtime::Buffer<double *>(batch_size);
         }
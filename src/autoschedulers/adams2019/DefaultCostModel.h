@@ -19,6 +19,9 @@ private:
     Runtime::Buffer<float> schedule_feat_queue, pipeline_feat_queue, costs;
     Runtime::Buffer<double *> cost_ptrs;
     int cursor, num_stages, num_cores;
+    // How many schedules are queued before the cost model is run. Picked
+    // from the size of the pipeline when the queue is allocated.
+    int batch_size = 0;
 
     const std::string weights_in_path, weights_out_path;
     const bool randomize_weights;
@@ -65,6 +68,10 @@ public:
     // Save/Load the model weights to/from disk.
     void save_weights();
     void load_weights();
+
+    // The number of schedules queued per call into the cost model, for
+    // a pipeline with the given number of stages.
+    static int pick_batch_size(int max_num_stages);
 };
 
 std::unique_ptr<DefaultCostModel> make_default_cost_model(const std::string &weights_in_dir = "",
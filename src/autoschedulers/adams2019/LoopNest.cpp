@@ -333,6 +333,7 @@ void LoopNest::compute_features(const FunctionDAG &dag,
                     int64_t working_set_c{0};
                     c->compute_working_set_from_features(&working_set_c, features);
                     working_set_here += working_set_c;
+                    feature_cache_hits++;
                     continue;  // no need to recompute fetures
                 }
             }
@@ -341,6 +342,7 @@ void LoopNest::compute_features(const FunctionDAG &dag,
 
             if (use_cached_features) {
                 // Cache these features for future reference.
+                feature_cache_misses++;
                 c->features_cache[hash_of_producers].make_large(dag.nodes[0].stages[0].max_id);
                 c->memoize_features(c->features_cache[hash_of_producers], features);
             }
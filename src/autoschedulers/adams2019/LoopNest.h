@@ -266,6 +266,13 @@ struct LoopNest {
     // hash of producers -> StageMap
     mutable std::map<uint64_t, StageMap<ScheduleFeatures>> features_cache;
 
+    // The number of root-level children whose featurization was reused
+    // from (or had to be added to) features_cache, across all states.
+    // Only one stage changes per decision, so in a healthy search the
+    // hits should dominate.
+    static int64_t feature_cache_hits;
+    static int64_t feature_cache_misses;
+
     // Same as copy_from (above) but also copies the two caches.
     void copy_from_including_features(const LoopNest &n);
 
@@ -0,0 +1,188 @@
+#include <algorithm>
+#include <cstring>
+
+#include "Featurization.h"
+#include "SampleStream.h"
+
+namespace Halide {
+namespace Internal {
+
+namespace {
+
+constexpr uint32_t kSignature = 0x73736c68;
+
+struct RecordHeader {
+    uint32_t signature;
+    uint32_t pipeline_features_version;
+    uint32_t schedule_features_version;
+    int32_t pipeline_id;
+    int32_t schedule_id;
+    float runtime_ms;
+    uint32_t num_stages;
+    uint32_t has_pipeline_features;
+    uint64_t pipeline_hash;
+};
+
+static_assert(sizeof(RecordHeader) == 40, "Unexpected padding in RecordHeader");
+
+bool host_is_big_endian() {
+    const uint32_t one = 1;
+    uint8_t first_byte;
+    memcpy(&first_byte, &one, 1);
+    return first_byte == 0;
+}
+
+// Convert values between host order and the little-endian order of the
+// stream, in place. This is its own inverse.
+template<typename T>
+void swap_to_little_endian(T *values, size_t count) {
+    if (!host_is_big_endian()) {
+        return;
+    }
+    for (size_t i = 0; i < count; i++) {
+        uint8_t bytes[sizeof(T)];
+        memcpy(bytes, &values[i], sizeof(T));
+        std::reverse(bytes, bytes + sizeof(T));
+        memcpy(&values[i], bytes, sizeof(T));
+    }
+}
+
+void swap_to_little_endian(RecordHeader &h) {
+    swap_to_little_endian(&h.signature, 1);
+    swap_to_little_endian(&h.pipeline_features_version, 1);
+    swap_to_little_endian(&h.schedule_features_version, 1);
+    swap_to_little_endian(&h.pipeline_id, 1);
+    swap_to_little_endian(&h.schedule_id, 1);
+    swap_to_little_endian(&h.runtime_ms, 1);
+    swap_to_little_endian(&h.num_stages, 1);
+    swap_to_little_endian(&h.has_pipeline_features, 1);
+    swap_to_little_endian(&h.pipeline_hash, 1);
+}
+
+}  // namespace
+
+uint64_t hash_floats(uint64_t h, const float *begin, const float *end) {
+    while (begin != end) {
+        uint32_t bits;
+        memcpy(&bits, begin, sizeof(bits));
+        // From boost
+        h ^= (bits + 0x9e3779b9 + (h << 6) + (h >> 2));
+        begin++;
+    }
+    return h;
+}
+
+bool SampleStreamWriter::append(const uint8_t *featurization, size_t size,
+                                float runtime_ms, int32_t pipeline_id, int32_t schedule_id) {
+    const size_t num_schedule_features = ScheduleFeatures::num_features();
+    const size_t num_pipeline_features = PipelineFeatures::num_features();
+    const size_t stage_size = (num_schedule_features + num_pipeline_features) * sizeof(float);
+    if (size == 0 || size % stage_size != 0) {
+        return false;
+    }
+    const size_t num_stages = size / stage_size;
+
+    // Split the featurization, which interleaves the schedule and
+    // pipeline features of each stage.
+    std::vector<float> schedule_features(num_stages * num_schedule_features);
+    std::vector<float> pipeline_features(num_stages * num_pipeline_features);
+    for (size_t i = 0; i < num_stages; i++) {
+        const uint8_t *stage = featurization + i * stage_size;
+        memcpy(&schedule_features[i * num_schedule_features], stage,
+               num_schedule_features * sizeof(float));
+        memcpy(&pipeline_features[i * num_pipeline_features],
+               stage + num_schedule_features * sizeof(float),
+               num_pipeline_features * sizeof(float));
+    }
+
+    RecordHeader header;
+    header.signature = kSignature;
+    header.pipeline_features_version = PipelineFeatures::version();
+    header.schedule_features_version = ScheduleFeatures::version();
+    header.pipeline_id = pipeline_id;
+    header.schedule_id = schedule_id;
+    header.runtime_ms = runtime_ms;
+    header.num_stages = (uint32_t)num_stages;
+    header.pipeline_hash = hash_floats(num_stages, pipeline_features.data(),
+                                       pipeline_features.data() + pipeline_features.size());
+    header.has_pipeline_features = pipelines_written.count(header.pipeline_hash) ? 0 : 1;
+
+    RecordHeader stored = header;
+    swap_to_little_endian(stored);
+    swap_to_little_endian(schedule_features.data(), schedule_features.size());
+    swap_to_little_endian(pipeline_features.data(), pipeline_features.size());
+
+    out.write((const char *)&stored, sizeof(stored));
+    out.write((const char *)schedule_features.data(), schedule_features.size() * sizeof(float));
+    if (header.has_pipeline_features) {
+        out.write((const char *)pipeline_features.data(), pipeline_features.size() * sizeof(float));
+    }
+    if (out.fail()) {
+        return false;
+    }
+    pipelines_written.insert(header.pipeline_hash);
+    return true;
+}
+
+bool SampleStreamReader::next(StreamSample &sample) {
+    RecordHeader header;
+    in.read((char *)&header, sizeof(header));
+    if (in.gcount() == 0 && in.eof()) {
+        return false;
+    }
+    if (in.fail()) {
+        error_message = "Truncated record header";
+        return false;
+    }
+    swap_to_little_endian(header);
+    if (header.signature != kSignature) {
+        error_message = "Bad record signature";
+        return false;
+    }
+    if (header.pipeline_features_version != PipelineFeatures::version() ||
+        header.schedule_features_version != ScheduleFeatures::version()) {
+        error_message = "Record was written with different feature versions";
+        return false;
+    }
+    if (header.num_stages == 0 || header.has_pipeline_features > 1) {
+        error_message = "Malformed record header";
+        return false;
+    }
+
+    const size_t num_stages = header.num_stages;
+    sample.pipeline_id = header.pipeline_id;
+    sample.schedule_id = header.schedule_id;
+    sample.runtime_ms = header.runtime_ms;
+    sample.num_stages = (int)num_stages;
+    sample.pipeline_hash = header.pipeline_hash;
+    sample.schedule_features.resize(num_stages * ScheduleFeatures::num_features());
+    in.read((char *)sample.schedule_features.data(), sample.schedule_features.size() * sizeof(float));
+    if (in.fail()) {
+        error_message = "Truncated schedule features";
+        return false;
+    }
+    swap_to_little_endian(sample.schedule_features.data(), sample.schedule_features.size());
+
+    if (header.has_pipeline_features) {
+        std::vector<float> pipeline_features(num_stages * PipelineFeatures::num_features());
+        in.read((char *)pipeline_features.data(), pipeline_features.size() * sizeof(float));
+        if (in.fail()) {
+            error_message = "Truncated pipeline features";
+            return false;
+        }
+        swap_to_little_endian(pipeline_features.data(), pipeline_features.size());
+        pipelines[header.pipeline_hash] = std::move(pipeline_features);
+    }
+
+    auto it = pipelines.find(header.pipeline_hash);
+    if (it == pipelines.end() ||
+        it->second.size() != num_stages * PipelineFeatures::num_features()) {
+        error_message = "Record refers to pipeline features not present in the stream";
+        return false;
+    }
+    sample.pipeline_features = &it->second;
+    return true;
+}
+
+}  // namespace Internal
+}  // namespace Halide
@@ -0,0 +1,108 @@
+#ifndef SAMPLE_STREAM_H
+#define SAMPLE_STREAM_H
+
+#include <cstdint>
+#include <iostream>
+#include <map>
+#include <set>
+#include <string>
+#include <vector>
+
+namespace Halide {
+namespace Internal {
+
+// A compact alternative to one .sample file per benchmarked schedule,
+// meant for collecting measurements from deployed pipelines. A .samples
+// stream is a sequence of self-contained records, so streams can be
+// appended to by many writers and concatenated with 'cat'. The pipeline
+// features, which make up most of a featurization and are identical for
+// every schedule of a pipeline, are only written the first time a writer
+// sees each pipeline.
+//
+// Structure of a record:
+//
+//    uint32 signature                    always 0x73736c68 ('hlss')
+//    uint32 PipelineFeatures::version
+//    uint32 ScheduleFeatures::version
+//    int32  pipeline_id
+//    int32  schedule_id
+//    float32 runtime, in milliseconds
+//    uint32 num_stages
+//    uint32 has_pipeline_features        0 or 1
+//    uint64 pipeline_hash
+//    float32x(num_stages * ScheduleFeatures::num_features()) schedule features
+//    float32x(num_stages * PipelineFeatures::num_features()) pipeline features, if has_pipeline_features
+//
+//    (all values little-endian, whatever the byte order of the host)
+
+// Hash the bits of a range of floats, starting from 'h'. Used to identify
+// pipelines by their features, and schedules by theirs.
+uint64_t hash_floats(uint64_t h, const float *begin, const float *end);
+
+struct StreamSample {
+    int32_t pipeline_id = 0;
+    int32_t schedule_id = 0;
+    float runtime_ms = 0;
+    int num_stages = 0;
+    uint64_t pipeline_hash = 0;
+    // Stage-major, ScheduleFeatures::num_features() per stage.
+    std::vector<float> schedule_features;
+    // Stage-major, PipelineFeatures::num_features() per stage. Owned
+    // by the reader, and shared by all samples of the same pipeline.
+    const std::vector<float> *pipeline_features = nullptr;
+};
+
+class SampleStreamWriter {
+    std::ostream &out;
+    std::set<uint64_t> pipelines_written;
+
+public:
+    explicit SampleStreamWriter(std::ostream &out)
+        : out(out) {
+    }
+
+    // Append a measurement of a schedule. 'featurization' is in the form
+    // produced by the autoscheduler (see AutoSchedulerResults::featurization,
+    // or the .featurization file emitted by a generator), and 'runtime_ms'
+    // is the measured runtime of the pipeline, e.g. as reported by the
+    // Halide profiler. Returns false if the featurization is malformed or
+    // the write failed.
+    bool append(const uint8_t *featurization, size_t size,
+                float runtime_ms, int32_t pipeline_id, int32_t schedule_id);
+
+    bool append(const std::vector<uint8_t> &featurization,
+                float runtime_ms, int32_t pipeline_id, int32_t schedule_id) {
+        return append(featurization.data(), featurization.size(), runtime_ms, pipeline_id, schedule_id);
+    }
+
+    // Don't write the pipeline features of the pipeline with this hash
+    // again, because the stream being appended to already has them (see
+    // StreamSample::pipeline_hash).
+    void mark_pipeline_written(uint64_t pipeline_hash) {
+        pipelines_written.insert(pipeline_hash);
+    }
+};
+
+class SampleStreamReader {
+    std::istream &in;
+    std::map<uint64_t, std::vector<float>> pipelines;
+    std::string error_message;
+
+public:
+    explicit SampleStreamReader(std::istream &in)
+        : in(in) {
+    }
+
+    // Read the next sample. Returns false at the end of the stream, or if
+    // the stream is malformed, in which case error() is non-empty.
+    bool next(StreamSample &sample);
+
+    const std::string &error() const {
+        return error_message;
+    }
+};
+
+}  // namespace Internal
+}  // namespace Halide
+
+#endif  // SAMPLE_STREAM_H
@@ -2,6 +2,7 @@
 #define HL_TIMER_H
 
 #include <chrono>
+#include <cstdint>
 #include <set>
 #include <string>
 #include <vector>
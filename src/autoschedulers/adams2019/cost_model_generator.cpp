@@ -496,6 +496,9 @@ public:
             // inference. Scheduling a couple of convs is easy.
             Var no;
             prediction_output.specialize(batch_size < 8).split(n, no, n, 1);
+            // DefaultCostModel queues hundreds to thousands of
+            // schedules per call, so use coarser tasks for big batches.
+            prediction_output.specialize(batch_size >= 1024).split(n, no, n, 32).parallel(no);
             prediction_output.compute_root().split(n, no, n, 8).parallel(no);
             prediction_output.bound(n, 0, batch_size);
 
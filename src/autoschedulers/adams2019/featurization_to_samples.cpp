@@ -0,0 +1,67 @@
+#include <cstdint>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <vector>
+
+#include "SampleStream.h"
+
+// Append a featurization + a runtime + some ids to a .samples stream. This
+// is the streaming equivalent of featurization_to_sample, for collecting
+// measurements of deployed pipelines to feed to finetune_cost_model.
+int main(int argc, char **argv) {
+    if (argc != 6) {
+        std::cout << "Usage: featurization_to_samples in.featurization runtime pipeline_id schedule_id out.samples\n";
+        return -1;
+    }
+
+    std::ifstream src(argv[1], std::ios::binary);
+    if (!src) {
+        std::cerr << "Unable to open input file: " << argv[1] << "\n";
+        return -1;
+    }
+    std::vector<uint8_t> featurization((std::istreambuf_iterator<char>(src)),
+                                       std::istreambuf_iterator<char>());
+
+    // Each invocation uses a new writer, so find the pipelines whose
+    // features the stream already has, so as not to write them again.
+    std::vector<uint64_t> pipelines_written;
+    {
+        std::ifstream existing(argv[5], std::ios::binary);
+        if (existing) {
+            Halide::Internal::SampleStreamReader reader(existing);
+            Halide::Internal::StreamSample sample;
+            while (reader.next(sample)) {
+                pipelines_written.push_back(sample.pipeline_hash);
+            }
+            if (!reader.error().empty()) {
+                std::cerr << "Unable to append to " << argv[5] << ": " << reader.error() << "\n";
+                return -1;
+            }
+        }
+    }
+
+    std::ofstream dst(argv[5], std::ios::binary | std::ios::app);
+    if (!dst) {
+        std::cerr << "Unable to open output file: " << argv[5] << "\n";
+        return -1;
+    }
+
+    // Input runtime value is presumed to be in seconds,
+    // but samples store times in milliseconds.
+    float r = atof(argv[2]) * 1000.f;
+    int32_t pid = atoi(argv[3]);
+    int32_t sid = atoi(argv[4]);
+
+    Halide::Internal::SampleStreamWriter writer(dst);
+    for (uint64_t pipeline_hash : pipelines_written) {
+        writer.mark_pipeline_written(pipeline_hash);
+    }
+    if (!writer.append(featurization, r, pid, sid)) {
+        std::cerr << "Unable to append " << argv[1] << " to " << argv[5] << "\n";
+        return -1;
+    }
+
+    return 0;
+}
@@ -0,0 +1,316 @@
+// Fine-tune the weights of the cost model from streams of measurements
+// (see SampleStream.h), e.g. collected from deployed pipelines. Unlike
+// retrain_cost_model, which loads every sample up front and makes many
+// passes over them, this takes a training step on a pipeline as soon as
+// enough new measurements of it have arrived, and only keeps a bounded
+// window of recent schedules per pipeline in memory.
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <cstring>
+#include <deque>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "cmdline.h"
+
+#include "DefaultCostModel.h"
+#include "Featurization.h"
+#include "HalideBuffer.h"
+#include "NetworkSize.h"
+#include "SampleStream.h"
+
+namespace {
+
+using namespace Halide;
+
+using Halide::Internal::hash_floats;
+using Halide::Internal::PipelineFeatures;
+using Halide::Internal::SampleStreamReader;
+using Halide::Internal::ScheduleFeatures;
+using Halide::Internal::StreamSample;
+using Halide::Runtime::Buffer;
+using std::string;
+using std::vector;
+
+static_assert(ScheduleFeatures::num_features() == head2_w,
+              "Schedule features don't match the network size");
+static_assert(PipelineFeatures::num_features() == (head1_w + 1) * head1_h,
+              "Pipeline features don't match the network size");
+
+// The most schedules that DefaultCostModel will take in one batch.
+constexpr int kMaxBatch = 1024;
+
+struct Flags {
+    float learning_rate = 0.00001f;
+    string initial_weights_path;
+    string weights_out_path;
+    int num_cores = 32;
+    int window = kMaxBatch;
+    int step_every = 16;
+    int epochs = 0;
+    vector<string> inputs;
+
+    Flags(int argc, char **argv) {
+        cmdline::parser a;
+
+        const char *kNoDesc = "";
+
+        constexpr bool kOptional = false;
+        a.add<float>("rate", '\0', kNoDesc, kOptional, learning_rate);
+        a.add<string>("initial_weights", '\0', kNoDesc, kOptional, "");
+        a.add<string>("weights_out");
+        a.add<int>("num_cores", '\0', kNoDesc, kOptional, num_cores);
+        a.add<int>("window", '\0', "Schedules of each pipeline to keep for training", kOptional, window);
+        a.add<int>("step_every", '\0', "New measurements of a pipeline between training steps", kOptional, step_every);
+        a.add<int>("epochs", '\0', "Passes over the retained schedules after the streams end", kOptional, epochs);
+        a.footer("[in.samples ...]");
+
+        a.parse_check(argc, argv);  // exits if parsing fails
+
+        learning_rate = a.get<float>("rate");
+        initial_weights_path = a.get<string>("initial_weights");
+        weights_out_path = a.get<string>("weights_out");
+        num_cores = a.get<int>("num_cores");
+        window = a.get<int>("window");
+        step_every = a.get<int>("step_every");
+        epochs = a.get<int>("epochs");
+        inputs = a.rest();
+
+        if (weights_out_path.empty()) {
+            std::cerr << "--weights_out must be specified.\n";
+            std::cerr << a.usage();
+            exit(1);
+        }
+        if (window < 2 || window > kMaxBatch) {
+            std::cerr << "--window must be between 2 and " << kMaxBatch << ".\n";
+            std::cerr << a.usage();
+            exit(1);
+        }
+        if (step_every < 1 || num_cores < 1 || epochs < 0 || !(learning_rate > 0)) {
+            std::cerr << "--rate, --num_cores and --step_every must be positive.\n";
+            std::cerr << a.usage();
+            exit(1);
+        }
+    }
+};
+
+struct Schedule {
+    Buffer<float> schedule_features;
+    float runtime;  // in msec, the fastest measurement seen
+    double prediction = 0;
+};
+
+struct Pipeline {
+    int num_stages = 0;
+    Buffer<float> pipeline_features;
+    std::map<uint64_t, Schedule> schedules;
+    // Schedule hashes, oldest first
+    std::deque<uint64_t> order;
+    int new_measurements = 0;
+};
+
+class Trainer {
+    const Flags &flags;
+    std::unique_ptr<DefaultCostModel> model;
+    std::map<uint64_t, Pipeline> pipelines;
+
+    // Running statistics, decayed at each report
+    float loss_sum = 0, loss_count = 0;
+    float good_pairs = 0, bad_pairs = 0;
+
+public:
+    size_t num_read = 0, num_rejected = 0, num_steps = 0;
+
+    explicit Trainer(const Flags &flags)
+        : flags(flags),
+          model(make_default_cost_model(flags.initial_weights_path, flags.weights_out_path, false)) {
+    }
+
+    void add(const StreamSample &s) {
+        num_read++;
+        if (!(s.runtime_ms > 0) || s.runtime_ms > 100000) {
+            // Don't try to predict runtime over 100s
+            num_rejected++;
+            return;
+        }
+        for (float f : s.schedule_features) {
+            if (f < 0 || f > 1e14 || std::isnan(f)) {
+                // Something must have overflowed
+                num_rejected++;
+                return;
+            }
+        }
+
+        Pipeline &p = pipelines[s.pipeline_hash];
+        if (!p.pipeline_features.data()) {
+            p.num_stages = s.num_stages;
+            p.pipeline_features = Buffer<float>(head1_w, head1_h, s.num_stages);
+            // Skip the first seven pipeline features, which are a mask of
+            // the types in use.
+            const float *src = s.pipeline_features->data();
+            for (int i = 0; i < s.num_stages; i++) {
+                for (int x = 0; x < head1_w; x++) {
+                    for (int y = 0; y < head1_h; y++) {
+                        p.pipeline_features(x, y, i) = src[i * PipelineFeatures::num_features() + (x + 1) * 7 + y];
+                    }
+                }
+            }
+        } else if (p.num_stages != s.num_stages) {
+            num_rejected++;
+            return;
+        }
+
+        const float *begin = s.schedule_features.data();
+        const uint64_t schedule_hash = hash_floats(0, begin, begin + s.schedule_features.size());
+        auto it = p.schedules.find(schedule_hash);
+        if (it != p.schedules.end()) {
+            it->second.runtime = std::min(it->second.runtime, s.runtime_ms);
+        } else {
+            Schedule sched;
+            sched.schedule_features = Buffer<float>(head2_w, s.num_stages);
+            memcpy(sched.schedule_features.data(), begin, s.schedule_features.size() * sizeof(float));
+            sched.runtime = s.runtime_ms;
+            p.schedules.emplace(schedule_hash, std::move(sched));
+            p.order.push_back(schedule_hash);
+            if ((int)p.order.size() > flags.window) {
+                p.schedules.erase(p.order.front());
+                p.order.pop_front();
+            }
+        }
+
+        if (++p.new_measurements >= flags.step_every) {
+            step(p);
+        }
+    }
+
+    // Take one training step on all retained schedules of a pipeline.
+    void step(Pipeline &p) {
+        p.new_measurements = 0;
+        // The loss ranks schedules relative to the fastest one, so there
+        // needs to be at least two distinct schedules.
+        if (p.schedules.size() < 2) {
+            return;
+        }
+
+        model->reset();
+        model->set_pipeline_features(p.pipeline_features, flags.num_cores);
+
+        Buffer<float> runtimes((int)p.schedules.size());
+        int j = 0;
+        for (auto &it : p.schedules) {
+            Buffer<float> buf;
+            model->enqueue(p.num_stages, &buf, &it.second.prediction);
+            buf.copy_from(it.second.schedule_features);
+            runtimes(j++) = it.second.runtime;
+        }
+
+        float loss = model->backprop(runtimes, flags.learning_rate);
+        assert(!std::isnan(loss));
+        loss_sum += loss;
+        loss_count++;
+        num_steps++;
+
+        // Count how many schedules more than 30% slower than the fastest
+        // one the model (before this step) predicted to be slower.
+        const Schedule *ref = nullptr;
+        for (const auto &it : p.schedules) {
+            if (!ref || it.second.runtime < ref->runtime) {
+                ref = &it.second;
+            }
+        }
+        for (const auto &it : p.schedules) {
+            if (it.second.runtime > ref->runtime * 1.3f) {
+                if (it.second.prediction >= ref->prediction) {
+                    good_pairs++;
+                } else {
+                    bad_pairs++;
+                }
+            }
+        }
+
+        if (num_steps % 100 == 0) {
+            report();
+        }
+    }
+
+    void epoch() {
+        for (auto &it : pipelines) {
+            step(it.second);
+        }
+    }
+
+    void report() {
+        std::cout << "Steps: " << num_steps
+                  << " Loss: " << (loss_count > 0 ? loss_sum / loss_count : 0.0f)
+                  << " Rate: " << (good_pairs + bad_pairs > 0 ? good_pairs / (good_pairs + bad_pairs) : 0.0f)
+                  << "\n";
+        loss_sum *= 0.9f;
+        loss_count *= 0.9f;
+        good_pairs *= 0.9f;
+        bad_pairs *= 0.9f;
+    }
+
+    size_t num_pipelines() const {
+        return pipelines.size();
+    }
+
+    void save_weights() {
+        model->save_weights();
+    }
+};
+
+}  // namespace
+
+int main(int argc, char **argv) {
+    Flags flags(argc, argv);
+    if (flags.inputs.empty()) {
+        flags.inputs.emplace_back("-");
+    }
+
+    std::cout.setf(std::ios::fixed, std::ios::floatfield);
+    std::cout.precision(4);
+
+    Trainer trainer(flags);
+    for (const string &path : flags.inputs) {
+        std::ifstream file;
+        if (path != "-") {
+            file.open(path, std::ios::binary);
+            if (!file) {
+                std::cerr << "Unable to open input file: " << path << "\n";
+                return 1;
+            }
+        }
+        SampleStreamReader reader(path == "-" ? std::cin : file);
+        StreamSample sample;
+        while (reader.next(sample)) {
+            trainer.add(sample);
+        }
+        if (!reader.error().empty()) {
+            // Streams may have been cut short by a crashing writer; keep
+            // what was read so far.
+            std::cout << path << ": " << reader.error() << ", skipping the rest of the stream\n";
+        }
+    }
+
+    for (int e = 0; e < flags.epochs; e++) {
+        trainer.epoch();
+    }
+
+    std::cout << "Samples read: " << trainer.num_read
+              << " rejected: " << trainer.num_rejected
+              << " distinct pipelines: " << trainer.num_pipelines() << "\n";
+    trainer.report();
+
+    if (trainer.num_steps == 0) {
+        std::cout << "No pipeline has two distinct schedules, weights left unchanged\n";
+        return 0;
+    }
+    trainer.save_weights();
+    return 0;
+}
@@ -0,0 +1,41 @@
+#include "DefaultCostModel.h"
+#include "NetworkSize.h"
+
+#include <cstdio>
+
+using namespace Halide;
+
+int main(int argc, char **argv) {
+    // Small pipelines get the largest batches.
+    if (DefaultCostModel::pick_batch_size(1) != 4096) {
+        printf("Expected a batch size of 4096 for one stage, got %d\n", DefaultCostModel::pick_batch_size(1));
+        return 1;
+    }
+    // Large pipelines are clamped to the training batch size.
+    if (DefaultCostModel::pick_batch_size(100000) != 1024) {
+        printf("Expected a batch size of 1024 for 100000 stages, got %d\n", DefaultCostModel::pick_batch_size(100000));
+        return 1;
+    }
+
+    int last = 4096;
+    for (int stages = 0; stages <= 1000; stages++) {
+        const int b = DefaultCostModel::pick_batch_size(stages);
+        if (b < 1024 || b > 4096 || (b & (b - 1)) != 0) {
+            printf("Batch size %d for %d stages is not a power of two in [1024, 4096]\n", b, stages);
+            return 1;
+        }
+        if (b > last) {
+            printf("Batch size grew from %d to %d at %d stages\n", last, b, stages);
+            return 1;
+        }
+        // Batches above the minimum must keep the queue at around 4MB.
+        if (b > 1024 && (int64_t)b * head2_w * stages > 1024 * 1024) {
+            printf("Batch size %d for %d stages makes the queue too large\n", b, stages);
+            return 1;
+        }
+        last = b;
+    }
+
+    printf("Success!\n");
+    return 0;
+}
@@ -0,0 +1,148 @@
+#include "Featurization.h"
+#include "SampleStream.h"
+
+#include <cstdio>
+#include <cstring>
+#include <sstream>
+
+using namespace Halide::Internal;
+
+namespace {
+
+// Make a featurization in the form produced by the autoscheduler: the
+// schedule features of each stage followed by its pipeline features.
+std::vector<uint8_t> make_featurization(int num_stages, float pipeline_seed, float schedule_seed) {
+    const int num_schedule_features = ScheduleFeatures::num_features();
+    const int num_pipeline_features = PipelineFeatures::num_features();
+    std::vector<float> floats;
+    for (int s = 0; s < num_stages; s++) {
+        for (int i = 0; i < num_schedule_features; i++) {
+            floats.push_back(schedule_seed + s * 100 + i);
+        }
+        for (int i = 0; i < num_pipeline_features; i++) {
+            floats.push_back(pipeline_seed + s * 100 + i);
+        }
+    }
+    std::vector<uint8_t> bytes(floats.size() * sizeof(float));
+    memcpy(bytes.data(), floats.data(), bytes.size());
+    return bytes;
+}
+
+bool check_sample(const StreamSample &sample, const std::vector<uint8_t> &featurization,
+                  float runtime_ms, int32_t pipeline_id, int32_t schedule_id) {
+    const int num_schedule_features = ScheduleFeatures::num_features();
+    const int num_pipeline_features = PipelineFeatures::num_features();
+    const float *f = (const float *)featurization.data();
+    if (sample.pipeline_id != pipeline_id ||
+        sample.schedule_id != schedule_id ||
+        sample.runtime_ms != runtime_ms) {
+        printf("Mismatched ids or runtime for pipeline %d schedule %d\n", pipeline_id, schedule_id);
+        return false;
+    }
+    for (int s = 0; s < sample.num_stages; s++) {
+        const float *stage = f + s * (num_schedule_features + num_pipeline_features);
+        if (memcmp(&sample.schedule_features[s * num_schedule_features], stage,
+                   num_schedule_features * sizeof(float)) != 0 ||
+            memcmp(&(*sample.pipeline_features)[s * num_pipeline_features], stage + num_schedule_features,
+                   num_pipeline_features * sizeof(float)) != 0) {
+            printf("Mismatched features for pipeline %d schedule %d stage %d\n", pipeline_id, schedule_id, s);
+            return false;
+        }
+    }
+    return true;
+}
+
+}  // namespace
+
+int main(int argc, char **argv) {
+    const std::vector<uint8_t> a0 = make_featurization(3, 1.f, 1000.f);
+    const std::vector<uint8_t> a1 = make_featurization(3, 1.f, 2000.f);
+    const std::vector<uint8_t> b0 = make_featurization(2, 5.f, 3000.f);
+
+    std::stringstream stream;
+    SampleStreamWriter writer(stream);
+    if (!writer.append(a0, 1.5f, 7, 0) ||
+        !writer.append(b0, 2.5f, 8, 0)) {
+        printf("Failed to append to the stream\n");
+        return 1;
+    }
+    // Records are little-endian on every host, so the signature is
+    // always stored as the bytes 'hlss'.
+    if (stream.str().compare(0, 4, "hlss") != 0) {
+        printf("The record header isn't little-endian\n");
+        return 1;
+    }
+    const size_t size_before = stream.str().size();
+    if (!writer.append(a1, 3.5f, 7, 1)) {
+        printf("Failed to append to the stream\n");
+        return 1;
+    }
+    // The pipeline features of a pipeline seen before aren't written again.
+    const size_t schedule_bytes = 3 * ScheduleFeatures::num_features() * sizeof(float);
+    if (stream.str().size() - size_before != 40 + schedule_bytes) {
+        printf("Pipeline features were written twice\n");
+        return 1;
+    }
+    // Malformed featurizations are rejected.
+    if (writer.append(a0.data(), a0.size() - 1, 1.f, 7, 2)) {
+        printf("Appended a malformed featurization\n");
+        return 1;
+    }
+
+    // A separate writer that knows the stream already has pipeline b only
+    // writes its schedule features; the result can be concatenated.
+    std::stringstream more;
+    SampleStreamWriter more_writer(more);
+    StreamSample sample;
+    {
+        std::stringstream copy(stream.str());
+        SampleStreamReader reader(copy);
+        while (reader.next(sample)) {
+            more_writer.mark_pipeline_written(sample.pipeline_hash);
+        }
+    }
+    const std::vector<uint8_t> b1 = make_featurization(2, 5.f, 4000.f);
+    if (!more_writer.append(b1, 4.5f, 8, 1) ||
+        more.str().size() != 40 + 2 * ScheduleFeatures::num_features() * sizeof(float)) {
+        printf("Pipeline features were written again by a second writer\n");
+        return 1;
+    }
+
+    std::stringstream all(stream.str() + more.str());
+    SampleStreamReader reader(all);
+    const struct {
+        const std::vector<uint8_t> &featurization;
+        float runtime_ms;
+        int32_t pipeline_id, schedule_id;
+    } expected[] = {
+        {a0, 1.5f, 7, 0},
+        {b0, 2.5f, 8, 0},
+        {a1, 3.5f, 7, 1},
+        {b1, 4.5f, 8, 1},
+    };
+    for (const auto &e : expected) {
+        if (!reader.next(sample)) {
+            printf("Failed to read sample %d of pipeline %d: %s\n", e.schedule_id, e.pipeline_id, reader.error().c_str());
+            return 1;
+        }
+        if (!check_sample(sample, e.featurization, e.runtime_ms, e.pipeline_id, e.schedule_id)) {
+            return 1;
+        }
+    }
+    if (reader.next(sample) || !reader.error().empty()) {
+        printf("Expected the end of the stream\n");
+        return 1;
+    }
+
+    // A record that refers to pipeline features that aren't in the stream
+    // is an error.
+    std::stringstream orphan(more.str());
+    SampleStreamReader orphan_reader(orphan);
+    if (orphan_reader.next(sample) || orphan_reader.error().empty()) {
+        printf("Expected an error for missing pipeline features\n");
+        return 1;
+    }
+
+    printf("Success!\n");
+    return 0;
+}
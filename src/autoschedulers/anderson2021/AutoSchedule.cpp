@@ -66,6 +66,7 @@
 #include "NetworkSize.h"
 #include "ParamParser.h"
 #include "PerfectHashMap.h"
+#include "SearchBudget.h"
 #include "State.h"
 
 #ifdef _WIN32
@@ -158,7 +159,8 @@ struct AutoSchedule {
                                               int pass_idx,
                                               int num_passes,
                                               ProgressBar &tick,
-                                              std::unordered_set<uint64_t> &permitted_hashes);
+                                              std::unordered_set<uint64_t> &permitted_hashes,
+                                              SearchBudget &budget);
 
     // Performance coarse-to-fine beam search and return the best state found.
     IntrusivePtr<State> optimal_schedule(int beam_size);
@@ -218,7 +220,8 @@ IntrusivePtr<State> AutoSchedule::optimal_schedule_pass(int beam_size,
                                                         int pass_idx,
                                                         int num_passes,
                                                         ProgressBar &tick,
-                                                        std::unordered_set<uint64_t> &permitted_hashes) {
+                                                        std::unordered_set<uint64_t> &permitted_hashes,
+                                                        SearchBudget &budget) {
     StateQueue q, pending;
 
     // The initial state, with no decisions made
@@ -277,7 +280,8 @@ IntrusivePtr<State> AutoSchedule::optimal_schedule_pass(int beam_size,
                                              pass_idx,
                                              num_passes,
                                              tick,
-                                             permitted_hashes);
+                                             permitted_hashes,
+                                             budget);
             } else {
                 internal_error << "Ran out of legal states with beam size " << beam_size << "\n";
             }
@@ -287,8 +291,16 @@ IntrusivePtr<State> AutoSchedule::optimal_schedule_pass(int beam_size,
             aslog(1) << "Warning: Huge number of states generated (" << pending.size() << ").\n";
         }
 
+        // Once the time budget is spent, finish this pass greedily so
+        // that we still end up with a complete schedule.
+        int step_beam_size = beam_size;
+        if (budget.expired()) {
+            step_beam_size = 1;
+            budget.greedy_decisions++;
+        }
+
         expanded = 0;
-        while (expanded < beam_size && !pending.empty()) {
+        while (expanded < step_beam_size && !pending.empty()) {
 
             IntrusivePtr<State> state{pending.pop()};
 
@@ -516,10 +528,34 @@ IntrusivePtr<State> AutoSchedule::optimal_schedule(int beam_size) {
         --num_passes;
     }
 
+    SearchBudget budget(params.time_limit_ms);
+    double last_pass_seconds = 0;
+    int passes_completed = 0;
+
     for (; pass_idx < num_passes; pass_idx++) {
+        if (budget.limited() && best.defined()) {
+            // Pass time scales roughly linearly with beam size, so
+            // shrink the beam to fit in the time remaining, and stop
+            // once the beam would become too narrow to be useful.
+            double remaining = budget.remaining_seconds();
+            if (remaining < last_pass_seconds) {
+                int shrunk_beam_size = (int)(beam_size * remaining / last_pass_seconds);
+                if (shrunk_beam_size < 2) {
+                    break;
+                }
+                aslog(1) << "Shrinking beam size to " << shrunk_beam_size << " to fit the time limit\n";
+                beam_size = shrunk_beam_size;
+            }
+        }
+
         ProgressBar tick;
 
-        auto pass = optimal_schedule_pass(beam_size, pass_idx, num_passes, tick, permitted_hashes);
+        Timer timer;
+        auto pass = optimal_schedule_pass(beam_size, pass_idx, num_passes, tick, permitted_hashes, budget);
+        last_pass_seconds = timer.elapsed().count();
+        if (pass_idx >= 0) {
+            passes_completed++;
+        }
 
         tick.clear();
 
@@ -543,6 +579,16 @@ IntrusivePtr<State> AutoSchedule::optimal_schedule(int beam_size) {
 
     aslog(1) << "Best cost: " << best->cost << "\n";
 
+    if (budget.limited()) {
+        auto milli = std::chrono::duration_cast<std::chrono::milliseconds>(budget.elapsed()).count();
+        aslog(1) << "Search took " << milli << " ms of a " << params.time_limit_ms
+                 << " ms time limit and completed " << passes_completed << " of " << num_passes << " passes";
+        if (budget.greedy_decisions > 0) {
+            aslog(1) << ", making the last " << budget.greedy_decisions << " decisions greedily";
+        }
+        aslog(1) << "\n";
+    }
+
     return best;
 }
 
@@ -571,6 +617,7 @@ void generate_schedule(const std::vector<Function> &outputs,
     aslog(1) << "Anderson2021Params.shared_memory_sm_limit_kb:" << params.shared_memory_sm_limit_kb << "\n";
     aslog(1) << "Anderson2021Params.active_block_limit:" << params.active_block_limit << "\n";
     aslog(1) << "Anderson2021Params.active_warp_limit:" << params.active_warp_limit << "\n";
+    aslog(1) << "Anderson2021Params.time_limit_ms:" << params.time_limit_ms << "\n";
 
     // Start a timer
     HALIDE_TIC;
@@ -704,6 +751,7 @@ struct Anderson2021 {
             parser.parse("shared_memory_sm_limit_kb", &params.shared_memory_sm_limit_kb);
             parser.parse("active_block_limit", &params.active_block_limit);
             parser.parse("active_warp_limit", &params.active_warp_limit);
+            parser.parse("time_limit_ms", &params.time_limit_ms);
             parser.finish();
         }
         Autoscheduler::generate_schedule(outputs, target, params, results);
@@ -82,6 +82,13 @@ struct Anderson2021Params {
     /** TODO: document me
      * Formerly HL_ACTIVE_WARP_LIMIT */
     int active_warp_limit = 64;
+
+    /** If > 0, a wall-clock budget for the schedule search, in milliseconds.
+     * Once it is spent, the current pass finishes greedily and no further
+     * coarse-to-fine passes are started, so the best complete schedule found
+     * so far is returned. Later passes shrink their beam to fit the time that
+     * remains. */
+    int64_t time_limit_ms = 0;
 };
 
 }  // namespace Autoscheduler
@@ -2,6 +2,7 @@
 #define STATISTICS_H
 
 #include <chrono>
+#include <cstdint>
 #include <set>
 #include <string>
 #include <vector>
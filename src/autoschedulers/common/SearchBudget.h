@@ -0,0 +1,47 @@
+#ifndef SEARCH_BUDGET_H
+#define SEARCH_BUDGET_H
+
+#include <chrono>
+#include <cstdint>
+
+namespace Halide {
+namespace Internal {
+namespace Autoscheduler {
+
+// A wall-clock budget for the schedule search of the beam-search
+// autoschedulers, started when it is constructed. A limit of zero or less
+// means the search is unbounded.
+struct SearchBudget {
+    std::chrono::time_point<std::chrono::steady_clock> start = std::chrono::steady_clock::now();
+    double limit_seconds;
+
+    // The number of beam search steps that were taken greedily because
+    // the budget had already been spent.
+    int greedy_decisions = 0;
+
+    explicit SearchBudget(int64_t limit_ms)
+        : limit_seconds(limit_ms / 1000.0) {
+    }
+
+    std::chrono::duration<double> elapsed() const {
+        return std::chrono::steady_clock::now() - start;
+    }
+
+    bool limited() const {
+        return limit_seconds > 0;
+    }
+
+    double remaining_seconds() const {
+        return limit_seconds - elapsed().count();
+    }
+
+    bool expired() const {
+        return limited() && remaining_seconds() <= 0;
+    }
+};
+
+}  // namespace Autoscheduler
+}  // namespace Internal
+}  // namespace Halide
+
+#endif  // SEARCH_BUDGET_H
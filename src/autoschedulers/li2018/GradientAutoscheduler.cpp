@@ -12,6 +12,15 @@ namespace {
 struct GradientAutoschedulerParams {
     /** Maximum level of parallelism available. */
     int parallelism = 16;
+
+    /** If nonzero, a stencil-like producer with a single consumer is computed
+     * inside the parallel tasks of its consumer instead of at root (CPU only). */
+    int enable_fusion = 0;
+
+    /** A producer is only computed inside the parallel tasks of its consumer
+     * if the region of it each task computes, overlap included, is at most
+     * this many times the region the task computes of the consumer. */
+    double fusion_max_recompute = 1.25;
 };
 
 std::map<std::string, Box> inference_bounds(const std::vector<Function> &functions,
@@ -328,8 +337,16 @@ void parallelize_vars_and_rvars_gpu(
     }
 }
 
+// The parallel loop over the pure vars of a stage, whose iterations are the
+// parallel tasks, and the extent in each pure var of the region one task
+// computes. The loop is empty if the pure vars were not parallelized.
+struct ParallelTasks {
+    std::string var;
+    std::vector<int> extents;
+};
+
 template<typename FuncOrStage>
-void parallelize_vars_and_rvars_cpu(
+ParallelTasks parallelize_vars_and_rvars_cpu(
     const GradientAutoschedulerParams &params,
     FuncOrStage func_or_stage,
     int natural_vector_size,
@@ -484,9 +501,12 @@ void parallelize_vars_and_rvars_cpu(
         }
     }
 
+    ParallelTasks tasks;
     if (!fused_var.empty()) {
         // Parallelize vars
+        int task_size = 1;
         if (num_threads_var > params.parallelism * 8) {
+            task_size = num_threads_var / (params.parallelism * 8);
             func_or_stage.parallel(Var(fused_var),
                                    num_threads_var / (params.parallelism * 8),
                                    tail);
@@ -498,6 +518,19 @@ void parallelize_vars_and_rvars_cpu(
             func_or_stage.parallel(Var(fused_var));
             schedule_source << "    .parallel(" << fused_var << ")\n";
         }
+        tasks.var = fused_var;
+        // The iterations of a task are consecutive in the fused loop, which
+        // is made of all the vars, innermost first.
+        for (int i = 0; i < (int)vars.size(); i++) {
+            int iterations = var_bounds[i];
+            int width = 1;
+            if (i == vectorized_dim) {
+                iterations = (var_bounds[i] + split_size - 1) / split_size;
+                width = split_size;
+            }
+            tasks.extents.push_back(std::min(std::min(task_size, iterations) * width, var_bounds[i]));
+            task_size = (task_size + iterations - 1) / iterations;
+        }
     }
     if (!fused_rvar.empty()) {
         // Parallelize rvars
@@ -530,10 +563,13 @@ void parallelize_vars_and_rvars_cpu(
         schedule_source << "    .vectorize("
                         << vectorized_rvar << ")\n";
     }
+    return tasks;
 }
 
+// Returns the loop over parallel tasks on CPU (see
+// parallelize_vars_and_rvars_cpu). Always empty on GPU.
 template<typename FuncOrStage>
-void parallelize_vars_and_rvars(
+ParallelTasks parallelize_vars_and_rvars(
     const GradientAutoschedulerParams &params,
     FuncOrStage func_or_stage,
     int natural_vector_size,
@@ -546,7 +582,7 @@ void parallelize_vars_and_rvars(
     bool is_gpu,
     std::ostringstream &schedule_source) {
     if (is_gpu) {
-        return parallelize_vars_and_rvars_gpu(
+        parallelize_vars_and_rvars_gpu(
             params,
             func_or_stage,
             is_pure_def,
@@ -556,6 +592,7 @@ void parallelize_vars_and_rvars(
             rvar_bounds,
             tail,
             schedule_source);
+        return ParallelTasks();
     } else {
         return parallelize_vars_and_rvars_cpu(
             params,
@@ -571,18 +608,23 @@ void parallelize_vars_and_rvars(
     }
 }
 
-void apply_schedule(const GradientAutoschedulerParams &params,
-                    const Target &target,
-                    Func func,
-                    int update_id,
-                    const std::vector<int> &var_bounds,
-                    bool is_gpu,
-                    std::ostringstream &schedule_source) {
+// Schedule the pure definition (update_id == -1) or an update of 'func'.
+// Returns the loop over parallel tasks of that stage, if any (see
+// parallelize_vars_and_rvars_cpu).
+ParallelTasks apply_schedule(const GradientAutoschedulerParams &params,
+                             const Target &target,
+                             Func func,
+                             int update_id,
+                             const std::vector<int> &var_bounds,
+                             bool is_gpu,
+                             std::ostringstream &schedule_source) {
+    ParallelTasks task_loop;
+    bool rfactored = false;
     if (update_id == -1) {
         func.compute_root();
         schedule_source << func.name() << ".compute_root()\n";
         if (func.dimensions() > 0) {
-            parallelize_vars_and_rvars(
+            task_loop = parallelize_vars_and_rvars(
                 params,
                 func,
                 natural_vector_size(target, func.values()[0].type()),
@@ -725,6 +767,8 @@ void apply_schedule(const GradientAutoschedulerParams &params,
                         // Update rvars
                         rvars = outer_rvars;
                         rvar_bounds = outer_rvar_sizes;
+                        // The calls of this update are now made by 'interim'.
+                        rfactored = true;
                     }
                 }
             }
@@ -759,7 +803,7 @@ void apply_schedule(const GradientAutoschedulerParams &params,
             is_gpu ? gpu_min_parallelism : cpu_min_parallelism;
         if (parallelism >= min_parallelism) {
             schedule_source << func.name() << ".update(" << update_id << ")\n";
-            parallelize_vars_and_rvars(
+            task_loop = parallelize_vars_and_rvars(
                 params,
                 func.update(update_id),
                 natural_vector_size(target, func.values()[0].type()),
@@ -786,7 +830,7 @@ void apply_schedule(const GradientAutoschedulerParams &params,
             }
             if (is_associative) {
                 schedule_source << func.name() << ".update(" << update_id << ")\n";
-                parallelize_vars_and_rvars(
+                task_loop = parallelize_vars_and_rvars(
                     params,
                     func.update(update_id),
                     natural_vector_size(target, func.values()[0].type()),
@@ -801,7 +845,7 @@ void apply_schedule(const GradientAutoschedulerParams &params,
             } else {
                 // Fall back to pure var parallelization
                 schedule_source << func.name() << ".update(" << update_id << ")\n";
-                parallelize_vars_and_rvars(
+                task_loop = parallelize_vars_and_rvars(
                     params,
                     func.update(update_id),
                     natural_vector_size(target, func.values()[0].type()),
@@ -817,6 +861,198 @@ void apply_schedule(const GradientAutoschedulerParams &params,
         }
     }
     schedule_source << ";\n";
+    return rfactored ? ParallelTasks() : task_loop;
+}
+
+// Checks the calls to 'producer' from a definition whose left-hand side is
+// the pure vars 'vars': they are stencil-like if every argument is the
+// corresponding var plus an offset that doesn't depend on the vars (a
+// constant or an RVar), and pointwise if all those offsets are zero.
+class StencilCalls : public IRVisitor {
+    using IRVisitor::visit;
+
+    void visit(const Call *op) override {
+        IRVisitor::visit(op);
+        if (op->call_type != Call::Halide || op->name != producer) {
+            return;
+        }
+        found = true;
+        if (op->args.size() != vars.size()) {
+            is_stencil = false;
+            is_pointwise = false;
+            return;
+        }
+        for (size_t i = 0; i < vars.size(); i++) {
+            Expr offset = simplify(op->args[i] - Variable::make(Int(32), vars[i]));
+            if (!is_const_zero(offset)) {
+                is_pointwise = false;
+            }
+            if (expr_uses_vars(offset, var_scope)) {
+                is_stencil = false;
+            }
+        }
+    }
+
+    const std::string &producer;
+    const std::vector<std::string> &vars;
+    Scope<> var_scope;
+
+public:
+    bool found = false;
+    bool is_stencil = true;
+    bool is_pointwise = true;
+
+    StencilCalls(const std::string &producer, const std::vector<std::string> &vars)
+        : producer(producer), vars(vars) {
+        for (const std::string &v : vars) {
+            var_scope.push(v);
+        }
+    }
+};
+
+// Returns whether the left-hand side of 'def' is the pure vars of 'f'.
+bool defines_pure_vars(const Function &f, const Definition &def) {
+    for (size_t i = 0; i < def.args().size(); i++) {
+        const Variable *v = def.args()[i].as<Variable>();
+        if (v == nullptr || v->name != f.args()[i]) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// If 'producer' can be computed inside the parallel tasks of its consumer,
+// return the name of that consumer and the index of the stage that calls
+// it, otherwise return an empty name. This is the case if the producer has
+// a single consumer that calls it as a stencil from a single stage, and
+// every update of the producer accumulates over its whole pure domain,
+// like the 'f(x) = 0; f(x) += ...' adjoints of stencils built by
+// propagate_adjoints.
+std::pair<std::string, int> fusion_consumer(const Function &producer,
+                                            const std::map<std::string, Function> &env,
+                                            const std::set<std::string> &output_set) {
+    const std::pair<std::string, int> no_fusion{"", -1};
+    if (output_set.count(producer.name()) ||
+        producer.has_extern_definition()) {
+        return no_fusion;
+    }
+    for (const Definition &def : producer.updates()) {
+        StencilCalls self_calls(producer.name(), producer.args());
+        def.accept(&self_calls);
+        if (!defines_pure_vars(producer, def) || !self_calls.is_pointwise) {
+            return no_fusion;
+        }
+    }
+
+    std::string consumer;
+    for (const auto &it : env) {
+        if (it.first == producer.name()) {
+            continue;
+        }
+        if (find_direct_calls(it.second).count(producer.name())) {
+            if (!consumer.empty()) {
+                return no_fusion;
+            }
+            consumer = it.first;
+        }
+    }
+    if (consumer.empty()) {
+        return no_fusion;
+    }
+
+    const Function &c = env.at(consumer);
+    if (c.dimensions() != producer.dimensions() ||
+        c.has_extern_definition()) {
+        return no_fusion;
+    }
+    int stage = -1;
+    for (int i = 0; i <= (int)c.updates().size(); i++) {
+        const Definition &def = i == 0 ? c.definition() : c.update(i - 1);
+        StencilCalls calls(producer.name(), c.args());
+        def.accept(&calls);
+        if (!calls.found) {
+            continue;
+        }
+        if (stage != -1 ||
+            !calls.is_stencil ||
+            !defines_pure_vars(c, def)) {
+            return no_fusion;
+        }
+        stage = i;
+    }
+    if (stage == -1) {
+        return no_fusion;
+    }
+    return {consumer, stage};
+}
+
+// The loop over parallel tasks of a stage of a Func, and the bounds of
+// that Func.
+struct TaskLoop {
+    Function func;
+    int stage;
+    ParallelTasks tasks;
+    std::vector<int> bounds;
+};
+
+// Estimate how many times the region of a producer that one task of
+// 'task_loop' computes, overlap with the neighbouring tasks included, is
+// larger than the region of the Func that owns the loop that the task
+// computes. The overlap in each dimension is how much larger the bounds of
+// the producer are than the bounds of that Func.
+double recompute_ratio(const TaskLoop &task_loop, const std::vector<int> &producer_bounds) {
+    double ratio = 1.0;
+    for (size_t i = 0; i < task_loop.tasks.extents.size(); i++) {
+        const int extent = std::max(task_loop.tasks.extents[i], 1);
+        const int overlap = std::max(producer_bounds[i] - task_loop.bounds[i], 0);
+        ratio *= (double)(extent + overlap) / extent;
+    }
+    return ratio;
+}
+
+// Compute all stages of 'producer' at each iteration of 'task_loop' and
+// vectorize them within the task.
+void apply_fused_schedule(const Target &target,
+                          Func producer,
+                          const TaskLoop &task_loop,
+                          const std::vector<int> &var_bounds,
+                          std::ostringstream &schedule_source) {
+    producer.compute_at(LoopLevel(task_loop.func, Var(task_loop.tasks.var), task_loop.stage));
+    if (task_loop.stage == (int)task_loop.func.updates().size()) {
+        schedule_source << producer.name() << ".compute_at("
+                        << task_loop.func.name() << ","
+                        << task_loop.tasks.var << ")\n";
+    } else {
+        // compute_at(func, var) refers to the loops of the last stage.
+        schedule_source << producer.name() << ".compute_at(LoopLevel("
+                        << task_loop.func.name() << ","
+                        << task_loop.tasks.var << ","
+                        << task_loop.stage << "))\n";
+    }
+    const int vector_size = natural_vector_size(target, producer.values()[0].type());
+    const bool vectorize = producer.dimensions() > 0 && var_bounds[0] >= vector_size;
+    if (vectorize) {
+        // The extent within a task isn't known here, so guard the tail.
+        producer.vectorize(producer.args()[0], vector_size, TailStrategy::GuardWithIf);
+        schedule_source << "    .vectorize("
+                        << producer.args()[0].name() << ","
+                        << vector_size << ","
+                        << TailStrategy::GuardWithIf << ")\n";
+    }
+    schedule_source << ";\n";
+    // The updates have the pure vars on their left-hand side (see
+    // fusion_consumer), so they can be vectorized the same way.
+    for (int update_id = 0; update_id < producer.num_update_definitions(); update_id++) {
+        if (vectorize) {
+            producer.update(update_id).vectorize(producer.args()[0], vector_size, TailStrategy::GuardWithIf);
+            schedule_source << producer.name() << ".update(" << update_id << ")\n"
+                            << "    .vectorize("
+                            << producer.args()[0].name() << ","
+                            << vector_size << ","
+                            << TailStrategy::GuardWithIf << ")\n"
+                            << ";\n";
+        }
+    }
 }
 
 }  // namespace
@@ -909,6 +1145,12 @@ void generate_schedule(const std::vector<Function> &outputs,
     }
 
     std::ostringstream schedule_source;
+    // The loop over parallel tasks of each stage of the Funcs scheduled so
+    // far, empty for stages without one.
+    std::map<std::string, std::vector<ParallelTasks>> task_loops;
+    // The task loop each Func computed inside the tasks of a consumer is
+    // computed at.
+    std::map<std::string, TaskLoop> fused_task_loops;
     // Traverse from the consumers to the producers
     for (auto it = order.rbegin(); it != order.rend(); it++) {
         Func func(env[*it]);
@@ -916,12 +1158,47 @@ void generate_schedule(const std::vector<Function> &outputs,
         // Get the bounds in integer constant by substitute all the parameters' estimates.
         Box bounds = func_bounds[*it];
         std::vector<int> int_bounds = get_int_bounds(bounds);
+        // Rather than materializing a stencil-like intermediate (such as
+        // the adjoint of a convolution) at root, compute it inside the
+        // parallel tasks of the stage of its consumer that calls it. If
+        // the consumer is itself computed inside the tasks of another Func,
+        // compute the producer there as well, so that whole chains of
+        // stencils share the same tasks. Tasks overlap by the footprint of
+        // the stencil, so only do so if that doesn't recompute too much.
+        if (params.enable_fusion && !target.has_gpu_feature()) {
+            const auto &consumer = fusion_consumer(env[*it], env, output_set);
+            const auto &fused = fused_task_loops.find(consumer.first);
+            const auto &loops = task_loops.find(consumer.first);
+            const TaskLoop *task_loop = nullptr;
+            TaskLoop consumer_task_loop;
+            if (fused != fused_task_loops.end()) {
+                task_loop = &fused->second;
+            } else if (loops != task_loops.end() &&
+                       !loops->second[consumer.second].var.empty()) {
+                consumer_task_loop = {env[consumer.first], consumer.second, loops->second[consumer.second],
+                                      get_int_bounds(func_bounds[consumer.first])};
+                task_loop = &consumer_task_loop;
+            }
+            if (task_loop != nullptr &&
+                recompute_ratio(*task_loop, int_bounds) > params.fusion_max_recompute) {
+                debug(1) << "[gradient_autoscheduler] Not fusing " << *it << " into " << consumer.first
+                         << " as its tasks would recompute too much of it\n";
+                task_loop = nullptr;
+            }
+            if (task_loop != nullptr) {
+                debug(1) << "[gradient_autoscheduler] Fusing " << *it << " into " << consumer.first << "\n";
+                apply_fused_schedule(target, func, *task_loop, int_bounds, schedule_source);
+                fused_task_loops[*it] = *task_loop;
+                continue;
+            }
+        }
+        std::vector<ParallelTasks> &loops = task_loops[*it];
         // Scheduling pure definition
-        apply_schedule(params, target, func, -1, int_bounds, target.has_gpu_feature(), schedule_source);
+        loops.push_back(apply_schedule(params, target, func, -1, int_bounds, target.has_gpu_feature(), schedule_source));
         // Scheduling the updates
         for (int update_id = 0;
              update_id < func.num_update_definitions(); update_id++) {
-            apply_schedule(params, target, func, update_id, int_bounds, target.has_gpu_feature(), schedule_source);
+            loops.push_back(apply_schedule(params, target, func, update_id, int_bounds, target.has_gpu_feature(), schedule_source));
         }
     }
 
@@ -941,6 +1218,8 @@ struct Li2018 {
         {
             ParamParser parser(params_in.extra);
             parser.parse("parallelism", &params.parallelism);
+            parser.parse("enable_fusion", &params.enable_fusion);
+            parser.parse("fusion_max_recompute", &params.fusion_max_recompute);
             parser.finish();
         }
         generate_schedule(outputs, target, params, results);
@@ -1,9 +1,14 @@
 #include "HalidePlugin.h"
 
 #include <algorithm>
+#include <atomic>
+#include <exception>
 #include <map>
+#include <memory>
+#include <mutex>
 #include <regex>
 #include <set>
+#include <thread>
 #include <utility>
 
 #include "Halide.h"
@@ -32,8 +37,57 @@ struct ArchParams {
     /** Indicates how much more expensive is the cost of a load compared to
      * the cost of an arithmetic operation at last level cache. */
     float balance = 40;
+
+    /** Number of threads used to evaluate grouping choices. This is a
+     * property of the machine running the autoscheduler rather than of the
+     * target. If zero, use the number of hardware threads available. The
+     * schedule found doesn't depend on it. */
+    int search_threads = 1;
 };
 
+// Call 'f(i)' for every i in [0, n), spread across up to 'num_threads'
+// threads (including the calling thread). The first exception thrown by
+// any call is rethrown on the calling thread once all threads are done.
+template<typename F>
+void parallel_for_each_index(int n, int num_threads, F f) {
+    num_threads = std::min(num_threads, n);
+    if (num_threads <= 1) {
+        for (int i = 0; i < n; i++) {
+            f(i);
+        }
+        return;
+    }
+
+    std::atomic<int> next{0};
+    std::mutex error_mutex;
+    std::exception_ptr error;
+    auto worker = [&]() {
+        for (int i = next++; i < n; i = next++) {
+            try {
+                f(i);
+            } catch (...) {
+                std::lock_guard<std::mutex> lock(error_mutex);
+                if (!error) {
+                    error = std::current_exception();
+                }
+                next = n;
+            }
+        }
+    };
+
+    vector<std::thread> threads;
+    for (int t = 1; t < num_threads; t++) {
+        threads.emplace_back(worker);
+    }
+    worker();
+    for (auto &t : threads) {
+        t.join();
+    }
+    if (error) {
+        std::rethrow_exception(error);
+    }
+}
+
 // Substitute parameter estimates into the exprs describing the box bounds.
 void substitute_estimates_box(Box &box) {
     box.used = substitute_var_estimates(box.used);
@@ -202,8 +256,10 @@ struct DependenceAnalysis {
         }
     };
     // Cache for bounds queries (bound queries with the same parameters are
-    // common during the grouping process).
+    // common during the grouping process). Grouping choices are evaluated
+    // concurrently, so accesses are guarded by 'regions_required_cache_mutex'.
     map<RegionsRequiredQuery, vector<RegionsRequired>> regions_required_cache;
+    std::unique_ptr<std::mutex> regions_required_cache_mutex = std::make_unique<std::mutex>();
 
     DependenceAnalysis(const map<string, Function> &env, const vector<string> &order,
                        const FuncValueBounds &func_val_bounds)
@@ -400,13 +456,16 @@ DependenceAnalysis::regions_required(const Function &f, int stage_num,
 
     // Check the cache if we've already computed this previously.
     RegionsRequiredQuery query(f.name(), stage_num, prods, only_regions_computed);
-    const auto &iter = regions_required_cache.find(query);
-    if (iter != regions_required_cache.end()) {
-        const auto &it = std::find_if(iter->second.begin(), iter->second.end(),
-                                      [&bounds](const RegionsRequired &r) { return (r.bounds == bounds); });
-        if (it != iter->second.end()) {
-            internal_assert((iter->first == query) && (it->bounds == bounds));
-            return it->regions;
+    {
+        std::lock_guard<std::mutex> lock(*regions_required_cache_mutex);
+        const auto &iter = regions_required_cache.find(query);
+        if (iter != regions_required_cache.end()) {
+            const auto &it = std::find_if(iter->second.begin(), iter->second.end(),
+                                          [&bounds](const RegionsRequired &r) { return (r.bounds == bounds); });
+            if (it != iter->second.end()) {
+                internal_assert((iter->first == query) && (it->bounds == bounds));
+                return it->regions;
+            }
         }
     }
 
@@ -600,7 +659,10 @@ DependenceAnalysis::regions_required(const Function &f, int stage_num,
         concrete_regions[f_reg.first] = concrete_box;
     }
 
-    regions_required_cache[query].emplace_back(bounds, concrete_regions);
+    {
+        std::lock_guard<std::mutex> lock(*regions_required_cache_mutex);
+        regions_required_cache[query].emplace_back(bounds, concrete_regions);
+    }
     return concrete_regions;
 }
 
@@ -1444,6 +1506,32 @@ map<string, Expr> Partitioner::evaluate_reuse(const FStage &stg,
 vector<pair<Partitioner::GroupingChoice, Partitioner::GroupConfig>>
 Partitioner::choose_candidate_grouping(const vector<pair<string, string>> &cands,
                                        Partitioner::Level level) {
+    // Evaluate all the choices that haven't been evaluated for grouping
+    // before. The evaluations are independent of each other, so they are
+    // spread across threads, and the results are added to the cache.
+    vector<GroupingChoice> new_choices;
+    {
+        set<GroupingChoice> seen;
+        for (const auto &p : cands) {
+            const Function &prod_f = get_element(dep_analysis.env, p.first);
+            FStage prod(prod_f, prod_f.updates().size());
+            for (const FStage &c : get_element(children, prod)) {
+                GroupingChoice cand_choice(prod_f.name(), c);
+                if (!grouping_cache.count(cand_choice) && seen.insert(cand_choice).second) {
+                    new_choices.push_back(cand_choice);
+                }
+            }
+        }
+    }
+    vector<GroupConfig> new_configs(new_choices.size());
+    int num_threads = arch_params.search_threads > 0 ? arch_params.search_threads : (int)std::thread::hardware_concurrency();
+    parallel_for_each_index((int)new_choices.size(), num_threads, [&](int i) {
+        new_configs[i] = evaluate_choice(new_choices[i], level);
+    });
+    for (size_t i = 0; i < new_choices.size(); i++) {
+        grouping_cache.emplace(new_choices[i], new_configs[i]);
+    }
+
     vector<pair<GroupingChoice, GroupConfig>> best_grouping;
     Expr best_benefit = make_zero(Int(64));
     for (const auto &p : cands) {
@@ -1456,20 +1544,8 @@ Partitioner::choose_candidate_grouping(const vector<pair<string, string>> &cands
         FStage prod(prod_f, final_stage);
 
         for (const FStage &c : get_element(children, prod)) {
-            GroupConfig best_config;
             GroupingChoice cand_choice(prod_f.name(), c);
-
-            // Check if the candidate has been evaluated for grouping before
-            const auto &iter = grouping_cache.find(cand_choice);
-            if (iter != grouping_cache.end()) {
-                best_config = iter->second;
-            } else {
-                best_config = evaluate_choice(cand_choice, level);
-                // Cache the result of the evaluation for the pair
-                grouping_cache.emplace(cand_choice, best_config);
-            }
-
-            grouping.emplace_back(cand_choice, best_config);
+            grouping.emplace_back(cand_choice, get_element(grouping_cache, cand_choice));
         }
 
         bool no_redundant_work = false;
@@ -3417,6 +3493,7 @@ struct Mullapudi2016 {
             parser.parse("parallelism", &arch_params.parallelism);
             parser.parse("last_level_cache_size", &arch_params.last_level_cache_size);
             parser.parse("balance", &arch_params.balance);
+            parser.parse("search_threads", &arch_params.search_threads);
             parser.finish();
         }
         results.schedule_source = generate_schedules(pipeline_outputs, target, arch_params);
@@ -0,0 +1,170 @@
+// Measure the machine parameters used by the Mullapudi2016 cost model on
+// the host, and print them as generator arguments, e.g.
+//
+//   autoscheduler.parallelism=16 autoscheduler.last_level_cache_size=33554432 autoscheduler.balance=38.5
+//
+// so they can be pasted onto a generator command line (or captured by the
+// build system) instead of relying on the defaults.
+//
+// The cost model charges a load 1 + footprint * balance / last_level_cache_size
+// arithmetic operations, clamped at 'balance'. So:
+//
+// - last_level_cache_size is estimated as the largest working set that
+//   can be randomly accessed while paying less than half of the DRAM
+//   latency.
+//
+// - balance is the cost of a load from a working set much larger than
+//   the last level cache, relative to the cost of an arithmetic operation.
+//   Loads are timed with several independent dependency chains to model
+//   the memory-level parallelism that real loop nests have. Arithmetic is
+//   timed on scalar code, as the cost model counts scalar operations; the
+//   build turns off auto-vectorization for this file.
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <numeric>
+#include <random>
+#include <thread>
+#include <vector>
+
+namespace {
+
+using Clock = std::chrono::high_resolution_clock;
+
+// Defeats dead-code elimination of the benchmark loops.
+volatile uint64_t sink;
+
+constexpr size_t cache_line_size = 64;
+constexpr int num_chains = 8;
+
+// Average time in nanoseconds of one load from a random cache line of a
+// working set of 'bytes' bytes. 'num_chains' independent pointer chases
+// run at once.
+double random_load_ns(size_t bytes, std::mt19937 &rng) {
+    const size_t stride = cache_line_size / sizeof(size_t);
+    const size_t num_lines = std::max<size_t>(bytes / cache_line_size, num_chains * 2);
+
+    // Link the cache lines into a single random cycle.
+    std::vector<size_t> order(num_lines);
+    std::iota(order.begin(), order.end(), 0);
+    std::shuffle(order.begin(), order.end(), rng);
+    std::vector<size_t> next(num_lines * stride);
+    for (size_t i = 0; i < num_lines; i++) {
+        next[order[i] * stride] = order[(i + 1) % num_lines] * stride;
+    }
+
+    size_t cursors[num_chains];
+    for (int c = 0; c < num_chains; c++) {
+        cursors[c] = order[c * num_lines / num_chains] * stride;
+    }
+
+    // Touch every line once before timing, and do enough loads that
+    // small working sets still take a measurable amount of time.
+    const size_t warmup = num_lines / num_chains;
+    const size_t steps = std::max<size_t>(num_lines, 1 << 22) / num_chains;
+    for (size_t i = 0; i < warmup; i++) {
+        for (size_t &c : cursors) {
+            c = next[c];
+        }
+    }
+
+    auto start = Clock::now();
+    for (size_t i = 0; i < steps; i++) {
+        for (size_t &c : cursors) {
+            c = next[c];
+        }
+    }
+    std::chrono::duration<double, std::nano> elapsed = Clock::now() - start;
+
+    uint64_t checksum = 0;
+    for (size_t c : cursors) {
+        checksum += c;
+    }
+    sink = checksum;
+
+    return elapsed.count() / (steps * num_chains);
+}
+
+// Average time in nanoseconds of one scalar arithmetic operation, measured
+// on a loop of independent float multiply-adds held in registers. This
+// must not be vectorized, or it measures the cost of a fraction of an
+// operation.
+double arith_op_ns() {
+    const int iters = 1 << 26;
+    float acc[num_chains];
+    for (int c = 0; c < num_chains; c++) {
+        acc[c] = (float)c;
+    }
+    // Read the constants through a volatile so they aren't folded.
+    volatile float vm = 0.999f, va = 0.001f;
+    const float m = vm, a = va;
+
+    auto start = Clock::now();
+    for (int i = 0; i < iters; i++) {
+        for (float &x : acc) {
+            x = x * m + a;
+        }
+    }
+    std::chrono::duration<double, std::nano> elapsed = Clock::now() - start;
+
+    float total = 0;
+    for (float x : acc) {
+        total += x;
+    }
+    sink = (uint64_t)total;
+
+    // Each multiply-add counts as two operations.
+    return elapsed.count() / ((double)iters * num_chains * 2);
+}
+
+}  // namespace
+
+int main(int argc, char **argv) {
+    if (argc > 2) {
+        fprintf(stderr, "Usage: %s [max_working_set_mb]\n", argv[0]);
+        return 1;
+    }
+    const size_t max_bytes = (argc == 2 ? (size_t)std::atoll(argv[1]) : 256) * 1024 * 1024;
+    if (max_bytes < 4 * 1024 * 1024) {
+        fprintf(stderr, "max_working_set_mb must be at least 4\n");
+        return 1;
+    }
+
+    std::mt19937 rng(0);
+
+    // Sweep working set sizes from 256KB up to max_bytes, in steps of sqrt(2).
+    std::vector<size_t> sizes;
+    std::vector<double> latencies;
+    for (double b = 256 * 1024; b <= (double)max_bytes; b *= std::sqrt(2.0)) {
+        size_t bytes = (size_t)b & ~(cache_line_size - 1);
+        double ns = random_load_ns(bytes, rng);
+        fprintf(stderr, "Working set %10zu bytes: %6.2f ns per load\n", bytes, ns);
+        sizes.push_back(bytes);
+        latencies.push_back(ns);
+    }
+
+    // The last level cache ends at the largest working set whose latency
+    // is less than half that of the largest working set, which we assume
+    // mostly misses in the cache.
+    const double slow = latencies.back();
+    size_t last_level_cache_size = sizes.front();
+    for (size_t i = 0; i < sizes.size(); i++) {
+        if (latencies[i] < slow / 2) {
+            last_level_cache_size = sizes[i];
+        }
+    }
+
+    const double arith = arith_op_ns();
+    fprintf(stderr, "Arithmetic: %.4f ns per operation\n", arith);
+    const double balance = slow / arith;
+
+    const unsigned parallelism = std::max(1u, std::thread::hardware_concurrency());
+
+    printf("autoscheduler.parallelism=%u autoscheduler.last_level_cache_size=%zu autoscheduler.balance=%.1f\n",
+           parallelism, last_level_cache_size, balance);
+    return 0;
+}
@@ -45,6 +45,22 @@
 #define HALIDE_RUNTIME_BUFFER_CHECK_INDICES 0
 #endif
 
+// Passing a ParallelPolicy to the element-wise methods runs them on a
+// pool of std::threads. Define this to 0 for toolchains without thread
+// support (such as libstdc++ built without gthreads), in which case the
+// policy is ignored and the calling thread does all of the work.
+#ifndef HALIDE_RUNTIME_BUFFER_USE_THREADS
+#if defined(__GLIBCXX__) && !defined(_GLIBCXX_HAS_GTHREADS)
+#define HALIDE_RUNTIME_BUFFER_USE_THREADS 0
+#else
+#define HALIDE_RUNTIME_BUFFER_USE_THREADS 1
+#endif
+#endif
+
+#if HALIDE_RUNTIME_BUFFER_USE_THREADS
+#include <thread>
+#endif
+
 #ifndef HALIDE_RUNTIME_BUFFER_ALLOCATION_ALIGNMENT
 // Conservatively align buffer allocations to 128 bytes by default.
 // This is enough alignment for all the platforms currently in use.
@@ -186,6 +202,22 @@ struct DeviceRefCount {
 
 constexpr int AnyDims = -1;
 
+/** Pass a ParallelPolicy as the first argument to Buffer::for_each_value,
+ * for_each_element, fill, copy_from, or convert_from to split the work
+ * into slices of the buffer that are processed on several threads. The
+ * callable passed to for_each_value or for_each_element must then be safe
+ * to call concurrently on distinct elements. */
+struct ParallelPolicy {
+    /** The number of threads to use, including the calling thread. Zero
+     * means one per hardware thread. */
+    int num_threads = 0;
+
+    /** Buffers with fewer elements than twice this are processed by the
+     * calling thread alone. Larger buffers are split into tasks of about
+     * this many elements. */
+    size_t min_elements_per_task = 1 << 16;
+};
+
 /** A templated Buffer class that wraps halide_buffer_t and adds
  * functionality. When using Halide from C++, this is the preferred
  * way to create input and output buffers. The overhead of using this
@@ -304,6 +336,22 @@ private:
         }
     };
 
+    /** An allocation header for host memory this buffer did not
+     * allocate itself, but has been asked to release. */
+    struct ForeignAllocation : AllocationHeader {
+        void (*release)(void *);
+        void *context;
+        ForeignAllocation(void (*release)(void *), void *context)
+            : AllocationHeader(free_foreign_allocation), release(release), context(context) {
+        }
+    };
+
+    static void free_foreign_allocation(void *p) {
+        ForeignAllocation *a = (ForeignAllocation *)p;
+        a->release(a->context);
+        free(a);
+    }
+
     /** Setup the device ref count for a buffer to indicate it is a crop (or slice, embed, etc) of cropped_from */
     void crop_from(const Buffer<T, Dims, InClassDimStorage> &cropped_from) {
         assert(dev_ref_count == nullptr);
@@ -937,6 +985,17 @@ public:
         decref();
     }
 
+    /** Take ownership of host memory this buffer wraps but did not
+     * allocate, e.g. a memory-mapped file. release(context) is
+     * called once the last Buffer sharing the memory is destroyed or
+     * deallocated. Asserts that this buffer does not already own its
+     * host memory. */
+    void take_host_ownership(void (*release)(void *), void *context) {
+        assert(!owns_host_memory() && buf.host != nullptr);
+        void *storage = malloc(sizeof(ForeignAllocation));
+        alloc = new (storage) ForeignAllocation(release, context);
+    }
+
     /** Drop reference to any owned device memory, possibly freeing it
      * if this buffer held the last reference to it. Asserts that
      * device_dirty is false. */
@@ -1386,21 +1445,97 @@ public:
         assert(!src.device_dirty() && "Cannot call Halide::Runtime::Buffer::copy_from on a device dirty source.");
 
         Buffer<T, Dims, InClassDimStorage> dst(*this);
+        if (crop_to_intersection(dst, src)) {
+            dst.copy_values_from(src);
+        }
+        set_host_dirty();
+    }
+
+    /** A version of copy_from that splits the copy into slices done in
+     * parallel. See ParallelPolicy. */
+    template<typename T2, int D2, int S2>
+    void copy_from(ParallelPolicy policy, Buffer<T2, D2, S2> src) {
+        static_assert(!std::is_const<T>::value, "Cannot call copy_from() on a Buffer<const T>");
+        assert(!device_dirty() && "Cannot call Halide::Runtime::Buffer::copy_from on a device dirty destination.");
+        assert(!src.device_dirty() && "Cannot call Halide::Runtime::Buffer::copy_from on a device dirty source.");
+
+        Buffer<T, Dims, InClassDimStorage> dst(*this);
+        if (crop_to_intersection(dst, src)) {
+            dst.parallel_slices(policy, dst.dimensions(), [&](int d, int min, int extent) {
+                if (d < 0) {
+                    dst.copy_values_from(src);
+                } else {
+                    Buffer<T, Dims, InClassDimStorage> dst_slice = dst.cropped(d, min, extent);
+                    Buffer<T2, D2, S2> src_slice = src.cropped(d, min, extent);
+                    dst_slice.copy_values_from(src_slice);
+                }
+            });
+        }
+        set_host_dirty();
+    }
 
+    /** Fill a Buffer with the values in some other Buffer of a
+     * different type, converted to T. Like copy_from, this only
+     * touches the region the two Buffers have in common. The inner
+     * loops are simple enough for the compiler to vectorize. Both
+     * Buffers must have a static element type. */
+    template<typename T2, int D2, int S2>
+    void convert_from(Buffer<T2, D2, S2> src) {
+        convert_from(ParallelPolicy{1}, std::move(src));
+    }
+
+    /** A version of convert_from that splits the conversion into slices
+     * done in parallel. See ParallelPolicy. */
+    template<typename T2, int D2, int S2>
+    void convert_from(ParallelPolicy policy, Buffer<T2, D2, S2> src) {
+        static_assert(!std::is_const<T>::value, "Cannot call convert_from() on a Buffer<const T>");
+        static_assert(!T_is_void && !std::is_void<typename std::remove_const<T2>::type>::value,
+                      "convert_from() requires Buffers with a static element type");
+        assert(!device_dirty() && "Cannot call Halide::Runtime::Buffer::convert_from on a device dirty destination.");
+        assert(!src.device_dirty() && "Cannot call Halide::Runtime::Buffer::convert_from on a device dirty source.");
+
+        Buffer<T, Dims, InClassDimStorage> dst(*this);
+        if (crop_to_intersection(dst, src)) {
+            Buffer<const T2, D2, S2> typed_src(src);
+            dst.for_each_value(policy, [](T &dst, T2 src) { dst = static_cast<T>(src); }, typed_src);
+        }
+        set_host_dirty();
+    }
+
+private:
+    /** Crop a and b to the region they have in common. Returns false if
+     * they do not overlap. */
+    template<typename T2, int D2, int S2>
+    static bool crop_to_intersection(Buffer<T, Dims, InClassDimStorage> &a, Buffer<T2, D2, S2> &b) {
         static_assert(Dims == AnyDims || D2 == AnyDims || Dims == D2);
-        assert(src.dimensions() == dst.dimensions());
+        assert(a.dimensions() == b.dimensions());
 
-        // Trim the copy to the region in common
-        const int d = dimensions();
-        for (int i = 0; i < d; i++) {
-            int min_coord = std::max(dst.dim(i).min(), src.dim(i).min());
-            int max_coord = std::min(dst.dim(i).max(), src.dim(i).max());
+        for (int i = 0; i < a.dimensions(); i++) {
+            int min_coord = std::max(a.dim(i).min(), b.dim(i).min());
+            int max_coord = std::min(a.dim(i).max(), b.dim(i).max());
             if (max_coord < min_coord) {
                 // The buffers do not overlap.
-                return;
+                return false;
             }
-            dst.crop(i, min_coord, max_coord - min_coord + 1);
-            src.crop(i, min_coord, max_coord - min_coord + 1);
+            a.crop(i, min_coord, max_coord - min_coord + 1);
+            b.crop(i, min_coord, max_coord - min_coord + 1);
+        }
+        return true;
+    }
+
+    /** Copy the values of src, which must cover the same region as this
+     * Buffer and have elements of the same size, into this Buffer. */
+    template<typename T2, int D2, int S2>
+    void copy_values_from(Buffer<T2, D2, S2> &src) {
+        // If both Buffers are dense with the same memory layout, this is
+        // a single memcpy.
+        bool same_layout = is_dense();
+        for (int i = 0; same_layout && i < dimensions(); i++) {
+            same_layout = dim(i).stride() == src.dim(i).stride();
+        }
+        if (same_layout) {
+            memcpy((void *)begin(), (const void *)src.begin(), size_in_bytes());
+            return;
         }
 
         // If T is void, we need to do runtime dispatch to an
@@ -1409,30 +1544,30 @@ public:
         // into a static dispatch to the right-sized copy.)
         if (T_is_void ? (type().bytes() == 1) : (sizeof(not_void_T) == 1)) {
             using MemType = uint8_t;
-            auto &typed_dst = (Buffer<MemType, Dims, InClassDimStorage> &)dst;
+            auto &typed_dst = (Buffer<MemType, Dims, InClassDimStorage> &)*this;
             auto &typed_src = (Buffer<const MemType, D2, S2> &)src;
             typed_dst.for_each_value([&](MemType &dst, MemType src) { dst = src; }, typed_src);
         } else if (T_is_void ? (type().bytes() == 2) : (sizeof(not_void_T) == 2)) {
             using MemType = uint16_t;
-            auto &typed_dst = (Buffer<MemType, Dims, InClassDimStorage> &)dst;
+            auto &typed_dst = (Buffer<MemType, Dims, InClassDimStorage> &)*this;
             auto &typed_src = (Buffer<const MemType, D2, S2> &)src;
             typed_dst.for_each_value([&](MemType &dst, MemType src) { dst = src; }, typed_src);
         } else if (T_is_void ? (type().bytes() == 4) : (sizeof(not_void_T) == 4)) {
             using MemType = uint32_t;
-            auto &typed_dst = (Buffer<MemType, Dims, InClassDimStorage> &)dst;
+            auto &typed_dst = (Buffer<MemType, Dims, InClassDimStorage> &)*this;
             auto &typed_src = (Buffer<const MemType, D2, S2> &)src;
             typed_dst.for_each_value([&](MemType &dst, MemType src) { dst = src; }, typed_src);
         } else if (T_is_void ? (type().bytes() == 8) : (sizeof(not_void_T) == 8)) {
             using MemType = uint64_t;
-            auto &typed_dst = (Buffer<MemType, Dims, InClassDimStorage> &)dst;
+            auto &typed_dst = (Buffer<MemType, Dims, InClassDimStorage> &)*this;
             auto &typed_src = (Buffer<const MemType, D2, S2> &)src;
             typed_dst.for_each_value([&](MemType &dst, MemType src) { dst = src; }, typed_src);
         } else {
             assert(false && "type().bytes() must be 1, 2, 4, or 8");
         }
-        set_host_dirty();
     }
 
+public:
     /** Make an image that refers to a sub-range of this image along
      * the given dimension. Asserts that the crop region is within
      * the existing bounds: you cannot "crop outwards", even if you know there
@@ -2152,11 +2287,95 @@ public:
 
     Buffer<T, Dims, InClassDimStorage> &fill(not_void_T val) {
         set_host_dirty();
-        for_each_value([=](T &v) { v = val; });
+        if (is_dense() && all_bytes_equal(val)) {
+            memset((void *)begin(), *(const uint8_t *)&val, size_in_bytes());
+        } else {
+            for_each_value([=](T &v) { v = val; });
+        }
+        return *this;
+    }
+
+    Buffer<T, Dims, InClassDimStorage> &fill(ParallelPolicy policy, not_void_T val) {
+        set_host_dirty();
+        parallel_slices(policy, dimensions(), [&](int d, int min, int extent) {
+            if (d < 0) {
+                fill(val);
+            } else {
+                cropped(d, min, extent).fill(val);
+            }
+        });
         return *this;
     }
 
 private:
+    /** Whether the elements of this buffer occupy all of the memory
+     * between begin() and end(), with no gaps or aliasing. */
+    bool is_dense() const {
+        return number_of_elements() * type().bytes() == size_in_bytes();
+    }
+
+    static bool all_bytes_equal(const not_void_T &val) {
+        const uint8_t *bytes = (const uint8_t *)&val;
+        for (size_t i = 1; i < sizeof(val); i++) {
+            if (bytes[i] != bytes[0]) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    /** Split the first max_dims dimensions of this buffer into slices
+     * along the one with the largest stride, and call task(d, min,
+     * extent) for each slice on a pool of threads. If the buffer isn't
+     * worth splitting, or threads aren't available, calls task(-1, 0, 0)
+     * once instead. */
+    template<typename Task>
+    void parallel_slices(const ParallelPolicy &policy, int max_dims, Task &&task) const {
+#if !HALIDE_RUNTIME_BUFFER_USE_THREADS
+        (void)policy;
+        (void)max_dims;
+        task(-1, 0, 0);
+#else
+        int d = -1;
+        size_t elements = 1;
+        for (int i = 0; i < max_dims; i++) {
+            elements *= dim(i).extent();
+            if (dim(i).extent() > 1 &&
+                (d < 0 || std::abs(dim(i).stride()) > std::abs(dim(d).stride()))) {
+                d = i;
+            }
+        }
+        size_t tasks = 1;
+        if (d >= 0 && policy.min_elements_per_task > 0) {
+            tasks = std::min((size_t)dim(d).extent(), elements / policy.min_elements_per_task);
+        }
+        int threads = policy.num_threads > 0 ? policy.num_threads : (int)std::thread::hardware_concurrency();
+        threads = (int)std::min((size_t)std::max(threads, 1), tasks);
+        if (threads <= 1) {
+            task(-1, 0, 0);
+            return;
+        }
+
+        const int slice = (int)((dim(d).extent() + tasks - 1) / tasks);
+        const int num_slices = (dim(d).extent() + slice - 1) / slice;
+        std::atomic<int> next{0};
+        auto worker = [&]() {
+            for (int i = next++; i < num_slices; i = next++) {
+                const int min = dim(d).min() + i * slice;
+                task(d, min, std::min(slice, dim(d).max() - min + 1));
+            }
+        };
+        std::vector<std::thread> pool;
+        for (int i = 1; i < threads; i++) {
+            pool.emplace_back(worker);
+        }
+        worker();
+        for (auto &t : pool) {
+            t.join();
+        }
+#endif
+    }
+
     /** Helper functions for for_each_value. */
     // @{
     template<int N>
@@ -2323,8 +2542,34 @@ public:
         for_each_value_impl(f, std::forward<Args>(other_buffers)...);
         return *this;
     }
+
+    /** Versions of for_each_value that split the buffers into slices
+     * processed in parallel. See ParallelPolicy. */
+    template<typename Fn, typename... Args, int N = sizeof...(Args) + 1>
+    const Buffer<T, Dims, InClassDimStorage> &for_each_value(ParallelPolicy policy, Fn &&f, Args &&...other_buffers) const {
+        for_each_value_parallel_impl(policy, f, other_buffers...);
+        return *this;
+    }
+
+    template<typename Fn, typename... Args, int N = sizeof...(Args) + 1>
+    Buffer<T, Dims, InClassDimStorage> &for_each_value(ParallelPolicy policy, Fn &&f, Args &&...other_buffers) {
+        for_each_value_parallel_impl(policy, f, other_buffers...);
+        return *this;
+    }
     // @}
 
+private:
+    template<typename Fn, typename... Args>
+    void for_each_value_parallel_impl(const ParallelPolicy &policy, Fn &&f, Args &...other_buffers) const {
+        parallel_slices(policy, dimensions(), [&](int d, int min, int extent) {
+            if (d < 0) {
+                for_each_value_impl(f, other_buffers...);
+            } else {
+                cropped(d, min, extent).for_each_value_impl(f, other_buffers.cropped(d, min, extent)...);
+            }
+        });
+    }
+
 private:
     // Helper functions for for_each_element
     struct for_each_element_task_dim {
@@ -2526,8 +2771,49 @@ public:
         for_each_element_impl(f);
         return *this;
     }
+
+    /** Versions of for_each_element that split the buffer into slices
+     * processed in parallel. See ParallelPolicy. */
+    template<typename Fn>
+    const Buffer<T, Dims, InClassDimStorage> &for_each_element(ParallelPolicy policy, Fn &&f) const {
+        for_each_element_parallel_impl(policy, f);
+        return *this;
+    }
+
+    template<typename Fn>
+    Buffer<T, Dims, InClassDimStorage> &for_each_element(ParallelPolicy policy, Fn &&f) {
+        for_each_element_parallel_impl(policy, f);
+        return *this;
+    }
     // @}
 
+private:
+    /** The number of dimensions for_each_element iterates over for a
+     * callable, using the same int vs double trick as above. */
+    template<typename Fn,
+             typename = decltype(std::declval<Fn>()((const int *)nullptr))>
+    static int for_each_element_dims(int, int dims, Fn &&) {
+        return dims;
+    }
+
+    template<typename Fn>
+    static int for_each_element_dims(double, int dims, Fn &&f) {
+        return std::min(dims, num_args(0, std::forward<Fn>(f)));
+    }
+
+    template<typename Fn>
+    void for_each_element_parallel_impl(const ParallelPolicy &policy, Fn &&f) const {
+        // Only split dimensions that the callable iterates over.
+        const int dims = for_each_element_dims(0, dimensions(), f);
+        parallel_slices(policy, dims, [&](int d, int min, int extent) {
+            if (d < 0) {
+                for_each_element_impl(f);
+            } else {
+                cropped(d, min, extent).for_each_element_impl(f);
+            }
+        });
+    }
+
 private:
     template<typename Fn>
     struct FillHelper {
@@ -1403,6 +1403,12 @@ typedef enum halide_target_feature_t {
     halide_target_feature_vulkan_version12,       ///< Enable Vulkan v1.2 runtime target support.
     halide_target_feature_vulkan_version13,       ///< Enable Vulkan v1.3 runtime target support.
     halide_target_feature_semihosting,            ///< Used together with Target::NoOS for the baremetal target built with semihosting library and run with semihosting mode where minimum I/O communication with a host PC is available.
+    halide_target_feature_no_loop_carry,          ///< Don't carry loaded values across loop iterations in registers on x86 and ARM.
+    halide_target_feature_auto_prefetch,          ///< Insert software prefetches for strided and row-crossing accesses to inputs and compute_root Funcs.
+    halide_target_feature_tiered_jit,             ///< When JIT-compiling, first compile with minimal optimization, then swap in fully optimized code compiled in the background.
+    halide_target_feature_c_openmp,               ///< When emitting C++ source, run parallel loops with OpenMP instead of the Halide thread pool.
+    halide_target_feature_coalesce_allocations,   ///< Pack heap allocations with disjoint lifetimes into a single arena.
+    halide_target_feature_lut_shuffles,           ///< On x86 and ARM, turn vector gathers from small tables into byte shuffles of the table.
     halide_target_feature_end                     ///< A sentinel. Every target is considered to have this feature, and setting this feature does nothing.
 } halide_target_feature_t;
 
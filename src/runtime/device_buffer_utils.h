@@ -169,6 +169,204 @@ WEAK device_copy make_device_to_host_copy(const halide_buffer_t *buf) {
     return make_buffer_copy(buf, false, buf, true);
 }
 
+// Copies between two host buffers don't have to go through a driver,
+// so we can do better than one memcpy per contiguous chunk. Small
+// chunks (single elements) are moved with loops specialized to their
+// size, copies that permute the strides (e.g. transposes, or
+// interleaved <-> planar) are walked in blocks so that both the reads
+// and the writes stay in cache, and large copies are split across the
+// thread pool.
+
+// Copies of at least this many bytes are done in parallel, in tasks of
+// roughly this size.
+#define HOST_COPY_PARALLEL_TASK_BYTES (1 << 20)
+
+// The side, in elements, of the square blocks that copies permuting
+// the strides are done in.
+#define HOST_COPY_BLOCK_SIZE 32
+
+// Drop the size-1 dimensions of a copy and merge any dimension into
+// the previous one if they are densely nested in both the source and
+// destination. Returns the number of dimensions left.
+WEAK int compact_host_copy(device_copy &c) {
+    int dims = 0;
+    for (int i = 0; i < MAX_COPY_DIMS; i++) {
+        if (c.extent[i] == 1) {
+            continue;
+        }
+        if (dims > 0 &&
+            c.src_stride_bytes[i] == c.src_stride_bytes[dims - 1] * c.extent[dims - 1] &&
+            c.dst_stride_bytes[i] == c.dst_stride_bytes[dims - 1] * c.extent[dims - 1]) {
+            c.extent[dims - 1] *= c.extent[i];
+            continue;
+        }
+        c.extent[dims] = c.extent[i];
+        c.src_stride_bytes[dims] = c.src_stride_bytes[i];
+        c.dst_stride_bytes[dims] = c.dst_stride_bytes[i];
+        dims++;
+    }
+    for (int i = dims; i < MAX_COPY_DIMS; i++) {
+        c.extent[i] = 1;
+        c.src_stride_bytes[i] = 0;
+        c.dst_stride_bytes[i] = 0;
+    }
+    return dims;
+}
+
+template<int chunk_size>
+ALWAYS_INLINE void host_copy_chunks(uint64_t src, uint64_t dst, uint64_t n,
+                                    uint64_t src_stride, uint64_t dst_stride) {
+    for (uint64_t i = 0; i < n; i++) {
+        memcpy((void *)(dst + i * dst_stride), (const void *)(src + i * src_stride), chunk_size);
+    }
+}
+
+// Copy n chunks along the innermost dimension.
+WEAK void host_copy_row(const device_copy &c, uint64_t src, uint64_t dst, uint64_t n) {
+    const uint64_t src_stride = c.src_stride_bytes[0];
+    const uint64_t dst_stride = c.dst_stride_bytes[0];
+    switch (c.chunk_size) {
+    case 1:
+        host_copy_chunks<1>(src, dst, n, src_stride, dst_stride);
+        break;
+    case 2:
+        host_copy_chunks<2>(src, dst, n, src_stride, dst_stride);
+        break;
+    case 4:
+        host_copy_chunks<4>(src, dst, n, src_stride, dst_stride);
+        break;
+    case 8:
+        host_copy_chunks<8>(src, dst, n, src_stride, dst_stride);
+        break;
+    default:
+        for (uint64_t i = 0; i < n; i++) {
+            memcpy((void *)(dst + i * dst_stride), (const void *)(src + i * src_stride), c.chunk_size);
+        }
+    }
+}
+
+// Find a dimension along which the source is dense, when the
+// destination is dense along the innermost dimension instead. Copying
+// in blocks of those two dimensions makes the copy cache-friendly on
+// both ends. Returns -1 if there is no such dimension.
+WEAK int find_host_copy_transpose_dim(const device_copy &c, int dims) {
+    if (dims < 2 || c.chunk_size > 8 || c.src_stride_bytes[0] == c.chunk_size) {
+        return -1;
+    }
+    for (int d = 1; d < dims; d++) {
+        if (c.src_stride_bytes[d] == c.chunk_size) {
+            return d;
+        }
+    }
+    return -1;
+}
+
+WEAK void host_copy_blocked(const device_copy &c, int t, uint64_t src, uint64_t dst) {
+    for (uint64_t j0 = 0; j0 < c.extent[t]; j0 += HOST_COPY_BLOCK_SIZE) {
+        const uint64_t j1 = min<uint64_t>(j0 + HOST_COPY_BLOCK_SIZE, c.extent[t]);
+        for (uint64_t i0 = 0; i0 < c.extent[0]; i0 += HOST_COPY_BLOCK_SIZE) {
+            const uint64_t n = min<uint64_t>(HOST_COPY_BLOCK_SIZE, c.extent[0] - i0);
+            for (uint64_t j = j0; j < j1; j++) {
+                host_copy_row(c,
+                              src + j * c.src_stride_bytes[t] + i0 * c.src_stride_bytes[0],
+                              dst + j * c.dst_stride_bytes[t] + i0 * c.dst_stride_bytes[0],
+                              n);
+            }
+        }
+    }
+}
+
+// Copy dimensions d and inwards. Dimension t (if not -1) is copied
+// together with the innermost one by host_copy_blocked.
+WEAK void host_copy_helper(const device_copy &c, int d, int t, uint64_t src, uint64_t dst) {
+    if (d == t) {
+        d--;
+    }
+    if (d <= 0) {
+        if (t > 0) {
+            host_copy_blocked(c, t, src, dst);
+        } else if (d == 0) {
+            host_copy_row(c, src, dst, c.extent[0]);
+        } else {
+            memcpy((void *)dst, (const void *)src, c.chunk_size);
+        }
+        return;
+    }
+    for (uint64_t i = 0; i < c.extent[d]; i++) {
+        host_copy_helper(c, d - 1, t, src, dst);
+        src += c.src_stride_bytes[d];
+        dst += c.dst_stride_bytes[d];
+    }
+}
+
+struct host_copy_task {
+    device_copy copy;
+    int dims, transpose_dim;
+    // How many slices of the outermost dimension (or bytes, for
+    // one contiguous chunk) each task copies.
+    uint64_t slice;
+};
+
+WEAK int host_copy_task_fn(void *user_context, int idx, uint8_t *closure) {
+    const host_copy_task *task = (const host_copy_task *)closure;
+    device_copy c = task->copy;
+    const uint64_t begin = (uint64_t)idx * task->slice;
+    if (task->dims == 0) {
+        if (begin < c.chunk_size) {
+            const uint64_t size = min(task->slice, c.chunk_size - begin);
+            memcpy((void *)(c.dst + begin), (const void *)(c.src + c.src_begin + begin), size);
+        }
+    } else {
+        const int d = task->dims - 1;
+        if (begin < c.extent[d]) {
+            const uint64_t src = c.src + c.src_begin + begin * c.src_stride_bytes[d];
+            const uint64_t dst = c.dst + begin * c.dst_stride_bytes[d];
+            c.extent[d] = min(task->slice, c.extent[d] - begin);
+            host_copy_helper(c, d, task->transpose_dim, src, dst);
+        }
+    }
+    return 0;
+}
+
+// Copy between two host allocations. Does the same thing as
+// copy_memory, faster.
+WEAK int host_copy_memory(const device_copy &copy, void *user_context) {
+    // If this is a zero copy buffer, these pointers will be the same.
+    if (copy.src == copy.dst) {
+        debug(user_context) << "host_copy_memory: no copy needed as pointers are the same.\n";
+        return halide_error_code_success;
+    }
+
+    host_copy_task task;
+    task.copy = copy;
+    task.dims = compact_host_copy(task.copy);
+    task.transpose_dim = find_host_copy_transpose_dim(task.copy, task.dims);
+
+    const device_copy &c = task.copy;
+    uint64_t total_bytes = c.chunk_size;
+    for (int i = 0; i < task.dims; i++) {
+        total_bytes *= c.extent[i];
+    }
+    if (total_bytes == 0) {
+        return halide_error_code_success;
+    }
+
+    // Split the outermost dimension (or the bytes of the only chunk)
+    // into tasks.
+    const uint64_t slices = task.dims == 0 ? c.chunk_size : c.extent[task.dims - 1];
+    const uint64_t tasks = min(slices, total_bytes / HOST_COPY_PARALLEL_TASK_BYTES);
+    if (tasks < 2) {
+        host_copy_helper(c, task.dims - 1, task.transpose_dim, c.src + c.src_begin, c.dst);
+        return halide_error_code_success;
+    }
+    task.slice = (slices + tasks - 1) / tasks;
+    if (task.dims == 0) {
+        task.slice = align_up<uint64_t>(task.slice, 4096);
+    }
+    const int num_tasks = (int)((slices + task.slice - 1) / task.slice);
+    return halide_do_par_for(user_context, host_copy_task_fn, 0, num_tasks, (uint8_t *)&task);
+}
+
 // Caller is expected to verify that src->dimensions == dst->dimensions
 ALWAYS_INLINE int64_t calc_device_crop_byte_offset(const struct halide_buffer_t *src, struct halide_buffer_t *dst) {
     int64_t offset = 0;
@@ -537,8 +537,7 @@ WEAK int halide_buffer_copy_already_locked(void *user_context, struct halide_buf
 
         if (to_host && from_host_valid) {
             device_copy c = make_buffer_copy(src, true, dst, true);
-            copy_memory(c, user_context);
-            result = halide_error_code_success;
+            result = host_copy_memory(c, user_context);
         } else if (to_host && from_device_valid) {
             debug(user_context) << "halide_buffer_copy_already_locked: to host case.\n";
             result = src->device_interface->impl->buffer_copy(user_context, src, nullptr, dst);
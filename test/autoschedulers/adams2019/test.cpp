@@ -1,4 +1,5 @@
 #include "Halide.h"
+#include <chrono>    // std::chrono::steady_clock
 #include <cstdlib>   // setenv (or Windows _putenv_s)
 #include <iostream>  // std::cerr / std::endl
 #include <map>       // std::map
@@ -55,6 +56,56 @@ bool test_caching(Pipeline &p1, Pipeline &p2, const Target &target) {
     return true;
 }
 
+// Check that a search with a tiny time_limit_ms is cut short, and still
+// produces a schedule.
+bool test_time_limit(const Target &target) {
+    const auto search_seconds = [&](const std::string &time_limit_ms) {
+        Var x("x"), y("y");
+        ImageParam im(Float(32), 2);
+        const int N = 8;
+        Func f[N];
+        f[0](x, y) = im(x, y);
+        for (int i = 1; i < N; i++) {
+            Expr e = 0;
+            for (int dy = -1; dy <= 1; dy++) {
+                for (int dx = -1; dx <= 1; dx++) {
+                    e += f[i - 1](x + dx, y + dy);
+                }
+            }
+            f[i](x, y) = e;
+        }
+        f[N - 1].set_estimate(x, 0, 2048).set_estimate(y, 0, 2048);
+        im.set_estimates({{0, 2048}, {0, 2048}});
+
+        AutoschedulerParams params(
+            "Adams2019",
+            {
+                {"parallelism", "32"},
+                {"random_dropout_seed", "1"},
+                {"weights_path", weights_path},
+                {"time_limit_ms", time_limit_ms},
+            });
+        const auto start = std::chrono::steady_clock::now();
+        auto results = Pipeline(f[N - 1]).apply_autoscheduler(target, params);
+        const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+        return results.schedule_source.empty() ? -1.0 : elapsed.count();
+    };
+
+    const double unlimited = search_seconds("0");
+    const double limited = search_seconds("1");
+    if (unlimited < 0 || limited < 0) {
+        std::cerr << "The search produced no schedule" << std::endl;
+        return false;
+    }
+    // A limited search finishes its first pass greedily and starts no more.
+    if (limited > unlimited / 2) {
+        std::cerr << "A search limited to 1 ms took " << limited
+                  << " s, against " << unlimited << " s without a limit" << std::endl;
+        return false;
+    }
+    return true;
+}
+
 int main(int argc, char **argv) {
     if (argc != 3 || !strlen(argv[1]) || !strlen(argv[2])) {
         fprintf(stderr, "Usage: %s <autoscheduler-lib> <weights-path>\n", argv[0]);
@@ -902,6 +953,11 @@ int main(int argc, char **argv) {
         }
     }
 
+    if (!test_time_limit(target)) {
+        std::cerr << "Time limit check failed" << std::endl;
+        return 1;
+    }
+
     std::cout << "adams2019 testing passed\n";
     return 0;
 }
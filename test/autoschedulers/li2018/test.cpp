@@ -154,6 +154,103 @@ int main(int argc, char **argv) {
         //           << result.schedule_source << "\n\n";
     }
 
+    AutoschedulerParams fusion_params = params;
+    fusion_params.extra["enable_fusion"] = "1";
+
+    {  // Gradient of a 2D stencil chain, with fusion enabled. The adjoint of
+       // blur_x is initialized to zero and accumulated by an update, and
+       // should be computed within the parallel tasks of the adjoint of the
+       // input.
+        constexpr int W = 256, H = 256;
+        Func in("in");
+        in(x, y) = cast<float>(x + y);
+        Func blur_x("blur_x");
+        blur_x(x, y) = in(x - 1, y) + in(x, y) + in(x + 1, y);
+        RDom r(-1, 3);
+        Func blur_y("blur_y");
+        blur_y(x, y) = 0.f;
+        blur_y(x, y) += blur_x(x, y + r);
+        Func weight("weight");
+        weight(x, y) = cast<float>((7 * x + 3 * y) % 11);
+        RDom o(0, W, 0, H);
+        Func loss("loss");
+        loss() = 0.f;
+        loss() += blur_y(o.x, o.y) * weight(o.x, o.y);
+
+        Derivative d = propagate_adjoints(loss);
+        Func d_in = d(in);
+        Func d_blur_x = d(blur_x);
+        d_in.set_estimate(x, 0, W)
+            .set_estimate(y, 0, H);
+
+        AutoSchedulerResults result = Pipeline(d_in).apply_autoscheduler(target, fusion_params);
+        // Don't dump to stdout (this is only for debugging)
+        // std::cout << "Schedule for gradient of 2D stencil chain:\n"
+        //           << result.schedule_source << "\n\n";
+
+        Buffer<float> grad = d_in.realize({W, H});
+
+        // The loop levels are locked once the pipeline is compiled.
+        const LoopLevel &level = d_blur_x.function().schedule().compute_level();
+        if (level.is_root() || level.is_inlined() || level.func() != d_in.name()) {
+            fprintf(stderr, "%s should be computed within the tasks of %s, but is computed at %s\n",
+                    d_blur_x.name().c_str(), d_in.name().c_str(), level.to_string().c_str());
+            return 1;
+        }
+
+        // d loss / d in(x, y) is the sum of the weights in the 3x3 window
+        // around (x, y) that is within the bounds of blur_y.
+        for (int j = 0; j < H; j++) {
+            for (int i = 0; i < W; i++) {
+                float correct = 0.f;
+                for (int dy = -1; dy <= 1; dy++) {
+                    for (int dx = -1; dx <= 1; dx++) {
+                        if (i + dx >= 0 && i + dx < W && j + dy >= 0 && j + dy < H) {
+                            correct += (7 * (i + dx) + 3 * (j + dy)) % 11;
+                        }
+                    }
+                }
+                if (grad(i, j) != correct) {
+                    fprintf(stderr, "grad(%d, %d) = %f instead of %f\n", i, j, grad(i, j), correct);
+                    return 1;
+                }
+            }
+        }
+    }
+
+    // 2D stencil chain, with fusion enabled. The tasks of blur_y are only a
+    // row or two, so computing blur_x within them would compute at least
+    // twice as much of it, which is only allowed with a larger
+    // fusion_max_recompute.
+    for (const char *max_recompute : {"1.25", "4"}) {
+        Func in("in");
+        in(x, y) = cast<float>(x + y);
+        Func blur_x("blur_x");
+        blur_x(x, y) = in(x - 1, y) + in(x, y) + in(x + 1, y);
+        Func blur_y("blur_y");
+        blur_y(x, y) = blur_x(x, y - 1) + blur_x(x, y) + blur_x(x, y + 1);
+        blur_y.set_estimate(x, 0, 256)
+            .set_estimate(y, 0, 256);
+
+        AutoschedulerParams recompute_params = fusion_params;
+        recompute_params.extra["fusion_max_recompute"] = max_recompute;
+        AutoSchedulerResults result = Pipeline(blur_y).apply_autoscheduler(target, recompute_params);
+        // Don't dump to stdout (this is only for debugging)
+        // std::cout << "Schedule for 2D stencil chain:\n"
+        //           << result.schedule_source << "\n\n";
+
+        blur_y.realize({256, 256});
+
+        const LoopLevel &level = blur_x.function().schedule().compute_level();
+        const bool should_fuse = std::string(max_recompute) == "4";
+        if (should_fuse != (level.func() == blur_y.name())) {
+            fprintf(stderr, "With fusion_max_recompute=%s, %s should%s be computed within the tasks of %s, but is computed at %s\n",
+                    max_recompute, blur_x.name().c_str(), should_fuse ? "" : " not",
+                    blur_y.name().c_str(), level.to_string().c_str());
+            return 1;
+        }
+    }
+
     printf("Success!\n");
     return 0;
 }
@@ -0,0 +1,113 @@
+#include "Halide.h"
+#include "halide_test_dirs.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <thread>
+
+using namespace Halide;
+
+namespace {
+
+class Blur : public Generator<Blur> {
+public:
+    GeneratorParam<int> radius{"radius", 1};
+
+    Input<Buffer<float, 2>> input{"input"};
+    Output<Buffer<float, 2>> output{"output"};
+
+    void generate() {
+        Var x("x"), y("y");
+        Func blur_x("blur_x");
+        blur_x(x, y) = (input(x - radius, y) + input(x, y) + input(x + radius, y)) / 3;
+        output(x, y) = (blur_x(x, y - radius) + blur_x(x, y) + blur_x(x, y + radius)) / 3;
+
+        input.set_estimates({{0, 1024}, {0, 1024}});
+        output.set_estimates({{0, 1024}, {0, 1024}});
+    }
+};
+
+// Run gengen with the given arguments, as a build system would.
+int gengen(std::vector<std::string> args) {
+    args.insert(args.begin(), "gengen");
+    std::vector<char *> argv;
+    for (auto &a : args) {
+        argv.push_back(&a[0]);
+    }
+    return Internal::generate_filter_main((int)argv.size(), argv.data());
+}
+
+}  // namespace
+
+HALIDE_REGISTER_GENERATOR(Blur, blur)
+
+int main(int argc, char **argv) {
+#ifdef _WIN32
+    printf("[SKIP] The Generator server is not supported on Windows.\n");
+    return 0;
+#else
+    if (get_jit_target_from_environment().arch == Target::WebAssembly) {
+        printf("[SKIP] Autoschedulers do not support WebAssembly.\n");
+        return 0;
+    }
+
+    if (argc != 2) {
+        fprintf(stderr, "Usage: %s <autoscheduler-lib>\n", argv[0]);
+        return 1;
+    }
+    const std::string plugin = argv[1];
+
+    const std::string dir = Internal::get_test_tmp_dir();
+    const std::string socket_path = dir + "mullapudi2016_generator_server.sock";
+    const std::string target = get_host_target().to_string();
+
+    // The environment of the clients applies to their requests.
+    setenv("HL_EXTRA_OUTPUTS", "stmt", 1);
+
+    std::thread server([&]() {
+        if (gengen({"--serve", socket_path, "4"}) != 0) {
+            printf("The Generator server failed\n");
+            exit(1);
+        }
+    });
+
+    // Several clients at once, each of which loads the plugin and
+    // autoschedules a different variant with it.
+    const int num_clients = 6;
+    std::vector<std::thread> clients;
+    std::vector<int> results(num_clients, -1);
+    for (int i = 0; i < num_clients; i++) {
+        const std::string name = "mullapudi2016_blur_" + std::to_string(i);
+        for (const char *ext : {".o", ".h", ".schedule.h", ".stmt"}) {
+            Internal::ensure_no_file_exists(dir + name + ext);
+        }
+        clients.emplace_back([&, i, name]() {
+            results[i] = gengen({"--client", socket_path, "-g", "blur", "-f", name, "-o", dir, "-p", plugin,
+                                 "-e", "object,c_header,schedule", "target=" + target,
+                                 "autoscheduler=Mullapudi2016", "radius=" + std::to_string(i + 1)});
+        });
+    }
+    for (auto &t : clients) {
+        t.join();
+    }
+    for (int i = 0; i < num_clients; i++) {
+        if (results[i] != 0) {
+            printf("Request %d failed with %d\n", i, results[i]);
+            return 1;
+        }
+        const std::string name = "mullapudi2016_blur_" + std::to_string(i);
+        for (const char *ext : {".o", ".h", ".schedule.h", ".stmt"}) {
+            Internal::assert_file_exists(dir + name + ext);
+        }
+    }
+
+    if (gengen({"--client", socket_path, "--shutdown"}) != 0) {
+        printf("Shutting down the server failed\n");
+        return 1;
+    }
+    server.join();
+
+    printf("Success!\n");
+    return 0;
+#endif
+}
@@ -0,0 +1,91 @@
+#include "Halide.h"
+
+using namespace Halide;
+
+namespace {
+
+// A few stencil chains with shared producers, so that the grouping search
+// has many candidate merges to evaluate in each round.
+Pipeline make_pipeline(const Buffer<float> &input) {
+    Var x("x"), y("y");
+
+    Func in_b("in_b");
+    in_b = BoundaryConditions::repeat_edge(input);
+
+    Func blur_x("blur_x"), blur_y("blur_y");
+    blur_x(x, y) = (in_b(x - 1, y) + in_b(x, y) + in_b(x + 1, y)) / 3;
+    blur_y(x, y) = (blur_x(x, y - 1) + blur_x(x, y) + blur_x(x, y + 1)) / 3;
+
+    Func sharp("sharp"), diff_x("diff_x"), diff_y("diff_y");
+    sharp(x, y) = 2 * in_b(x, y) - blur_y(x, y);
+    diff_x(x, y) = sharp(x + 1, y) - sharp(x - 1, y);
+    diff_y(x, y) = sharp(x, y + 1) - sharp(x, y - 1);
+
+    Func out("out");
+    out(x, y) = diff_x(x, y) * diff_x(x, y) + diff_y(x, y) * diff_y(x, y) + blur_y(x, y);
+
+    out.set_estimate(x, 0, input.width()).set_estimate(y, 0, input.height());
+
+    return Pipeline(out);
+}
+
+}  // namespace
+
+int main(int argc, char **argv) {
+    if (get_jit_target_from_environment().arch == Target::WebAssembly) {
+        printf("[SKIP] Autoschedulers do not support WebAssembly.\n");
+        return 0;
+    }
+
+    if (argc != 2) {
+        fprintf(stderr, "Usage: %s <autoscheduler-lib>\n", argv[0]);
+        return 1;
+    }
+
+    load_plugin(argv[1]);
+
+    Buffer<float> input(640, 480);
+    for (int y = 0; y < input.height(); y++) {
+        for (int x = 0; x < input.width(); x++) {
+            input(x, y) = (float)(rand() & 0xff);
+        }
+    }
+
+    Target target = get_jit_target_from_environment();
+
+    // The grouping search must pick the same schedule no matter how many
+    // threads evaluate the candidates.
+    std::string serial_schedule;
+    Buffer<float> serial_out;
+    for (const char *threads : {"1", "4", "0"}) {
+        Pipeline p = make_pipeline(input);
+        AutoschedulerParams params = {"Mullapudi2016", {{"search_threads", threads}}};
+        AutoSchedulerResults results = p.apply_autoscheduler(target, params);
+        Buffer<float> out = p.realize({input.width(), input.height()});
+
+        if (serial_schedule.empty()) {
+            serial_schedule = results.schedule_source;
+            serial_out = out;
+            continue;
+        }
+
+        if (results.schedule_source != serial_schedule) {
+            printf("Schedule with search_threads=%s differs from the serial one:\n%s\nvs\n%s\n",
+                   threads, results.schedule_source.c_str(), serial_schedule.c_str());
+            return 1;
+        }
+
+        for (int y = 0; y < out.height(); y++) {
+            for (int x = 0; x < out.width(); x++) {
+                if (out(x, y) != serial_out(x, y)) {
+                    printf("out(%d, %d) = %f instead of %f with search_threads=%s\n",
+                           x, y, out(x, y), serial_out(x, y), threads);
+                    return 1;
+                }
+            }
+        }
+    }
+
+    printf("Success!\n");
+    return 0;
+}
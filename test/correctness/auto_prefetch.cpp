@@ -0,0 +1,113 @@
+#include "Halide.h"
+
+#include <stdio.h>
+
+using namespace Halide;
+using namespace Halide::Internal;
+
+class CountPrefetches : public IRVisitor {
+    using IRVisitor::visit;
+
+    void visit(const Call *op) override {
+        if (op->is_intrinsic(Call::prefetch)) {
+            const Variable *base = op->args[0].as<Variable>();
+            if (base) {
+                prefetches[base->name]++;
+            }
+        }
+        IRVisitor::visit(op);
+    }
+
+public:
+    std::map<std::string, int> prefetches;
+};
+
+std::map<std::string, int> count_prefetches(Func f, const std::vector<Argument> &args, const Target &t) {
+    Module m = f.compile_to_module(args, "", t);
+    CountPrefetches counter;
+    for (const auto &lf : m.functions()) {
+        lf.body.accept(&counter);
+    }
+    return counter.prefetches;
+}
+
+int main(int argc, char **argv) {
+    Target t = get_jit_target_from_environment();
+    Target auto_t = t.with_feature(Target::AutoPrefetch);
+
+    Var x("x"), y("y");
+
+    // A vertical stencil crosses rows of its input on every iteration
+    // of y, so the next rows should be prefetched.
+    {
+        ImageParam in(Float(32), 2, "in");
+        Func blur("blur");
+        blur(x, y) = in(x, y) + in(x, y + 1) + in(x, y + 2);
+        blur.vectorize(x, 8);
+
+        if (!count_prefetches(blur, {in}, t).empty()) {
+            printf("There should be no prefetches without auto_prefetch\n");
+            return 1;
+        }
+        if (count_prefetches(blur, {in}, auto_t)["in"] == 0) {
+            printf("Rows of the input to blur were not prefetched\n");
+            return 1;
+        }
+
+        Buffer<float> input(256, 258);
+        input.for_each_element([&](int x, int y) { input(x, y) = (float)(x * 7 + y * 3); });
+        in.set(input);
+        Buffer<float> out = blur.realize({256, 256}, auto_t);
+        for (int y = 0; y < out.height(); y++) {
+            for (int x = 0; x < out.width(); x++) {
+                float correct = input(x, y) + input(x, y + 1) + input(x, y + 2);
+                if (out(x, y) != correct) {
+                    printf("blur(%d, %d) = %f instead of %f\n", x, y, out(x, y), correct);
+                    return 1;
+                }
+            }
+        }
+    }
+
+    // A transpose of a compute_root Func walks down its columns in the
+    // innermost loop, which should be prefetched too.
+    {
+        Func f("f"), g("g");
+        f(x, y) = x + y * 256;
+        g(x, y) = f(y, x);
+        f.compute_root();
+
+        if (count_prefetches(g, {}, auto_t)["f"] == 0) {
+            printf("Columns of f were not prefetched\n");
+            return 1;
+        }
+
+        Buffer<int> out = g.realize({256, 256}, auto_t);
+        for (int y = 0; y < out.height(); y++) {
+            for (int x = 0; x < out.width(); x++) {
+                int correct = y + x * 256;
+                if (out(x, y) != correct) {
+                    printf("g(%d, %d) = %d instead of %d\n", x, y, out(x, y), correct);
+                    return 1;
+                }
+            }
+        }
+    }
+
+    // Loop nests that the schedule already prefetches in are left alone.
+    {
+        ImageParam a(Float(32), 2, "a"), b(Float(32), 2, "b");
+        Func h("h");
+        h(x, y) = a(x, y + 1) + b(x, y + 1);
+        h.prefetch(a, y, y, 2);
+
+        std::map<std::string, int> prefetches = count_prefetches(h, {a, b}, auto_t);
+        if (prefetches["a"] == 0 || prefetches["b"] != 0) {
+            printf("Automatic prefetches were added to a scheduled prefetch\n");
+            return 1;
+        }
+    }
+
+    printf("Success!\n");
+    return 0;
+}
@@ -0,0 +1,165 @@
+#include "Halide.h"
+#include "halide_test_dirs.h"
+
+#include <cstdlib>
+#include <fstream>
+#include <sstream>
+#include <stdio.h>
+
+using namespace Halide;
+
+std::string compile_to_c_source(Func f, const std::string &name, const Target &t) {
+    std::string filename = Internal::get_test_tmp_dir() + name + ".halide_generated.cpp";
+    Internal::ensure_no_file_exists(filename);
+    f.compile_to_c(filename, {}, name, t);
+    Internal::assert_file_exists(filename);
+
+    std::ifstream in(filename);
+    std::ostringstream source;
+    source << in.rdbuf();
+    return source.str();
+}
+
+bool contains(const std::string &source, const std::string &s) {
+    return source.find(s) != std::string::npos;
+}
+
+#if defined(HALIDE_TEST_CXX) && defined(HALIDE_TEST_OPENMP_FLAGS)
+// Build the C source emitted for f, compiled with OpenMP and linked against
+// a standalone runtime, into a program that realizes f over a w x h int32
+// buffer and writes it to a file. Run it, and return what it wrote.
+bool run_with_openmp(Func f, const std::string &name, const Target &t, int w, int h, Buffer<int> *result) {
+    const std::string dir = Internal::get_test_tmp_dir();
+    const std::string source = dir + name + ".cpp";
+    const std::string runtime = dir + name + "_runtime.o";
+    const std::string program = dir + name;
+    const std::string output = dir + name + ".bin";
+    for (const auto &file : {source, runtime, program, output}) {
+        Internal::ensure_no_file_exists(file);
+    }
+
+    {
+        std::ofstream out(source);
+        out << compile_to_c_source(f, name, t)
+            << "\n"
+            << "int main(int argc, char **argv) {\n"
+            << "    static int32_t data[" << w * h << "];\n"
+            << "    halide_dimension_t dims[2] = {{0, " << w << ", 1, 0}, {0, " << h << ", " << w << ", 0}};\n"
+            << "    halide_buffer_t buf = {};\n"
+            << "    buf.host = (uint8_t *)data;\n"
+            << "    buf.type = halide_type_t(halide_type_int, 32);\n"
+            << "    buf.dimensions = 2;\n"
+            << "    buf.dim = dims;\n"
+            << "    if (" << name << "(&buf) != 0) return 1;\n"
+            << "    FILE *f = fopen(argv[1], \"wb\");\n"
+            << "    if (!f || fwrite(data, sizeof(data), 1, f) != 1) return 1;\n"
+            << "    return fclose(f);\n"
+            << "}\n";
+    }
+    compile_standalone_runtime(runtime, t.without_feature(Target::COpenMP));
+
+    const std::string compile = std::string(HALIDE_TEST_CXX) + " -std=c++17 -O1 " + HALIDE_TEST_OPENMP_FLAGS +
+                                " " + source + " " + runtime + " -o " + program + " " +
+                                HALIDE_TEST_OPENMP_LIBS + " -lpthread -ldl";
+    if (system(compile.c_str()) != 0) {
+        printf("Failed to compile the C output: %s\n", compile.c_str());
+        return false;
+    }
+    const std::string run = program + " " + output;
+    if (system(run.c_str()) != 0) {
+        printf("Running the C output failed: %s\n", run.c_str());
+        return false;
+    }
+
+    *result = Buffer<int>(w, h);
+    std::ifstream in(output, std::ios::binary);
+    in.read((char *)result->data(), result->size_in_bytes());
+    if (!in) {
+        printf("Could not read the output of %s\n", program.c_str());
+        return false;
+    }
+    return true;
+}
+#endif
+
+int main(int argc, char **argv) {
+    Target t = get_host_target();
+    Target omp_t = t.with_feature(Target::COpenMP);
+
+    Var x("x"), y("y");
+
+    // A plain parallel loop becomes an OpenMP parallel loop, rather than
+    // a closure run on the Halide thread pool.
+    {
+        Func f("f");
+        f(x, y) = x + y;
+        f.vectorize(x, 8).parallel(y);
+
+        std::string source = compile_to_c_source(f, "c_openmp_pool", t);
+        if (!contains(source, "halide_do_par_for") || contains(source, "omp parallel for")) {
+            printf("Without c_openmp, parallel loops should use the Halide thread pool\n");
+            return 1;
+        }
+
+        source = compile_to_c_source(f, "c_openmp_parallel", omp_t);
+        if (contains(source, "halide_do_par_for") || !contains(source, "#pragma omp parallel for")) {
+            printf("With c_openmp, parallel loops should be emitted as OpenMP pragmas\n");
+            return 1;
+        }
+    }
+
+    // A parallel loop containing async producers still needs the Halide
+    // thread pool.
+    {
+        Func g("g"), h("h");
+        g(x, y) = x * y;
+        h(x, y) = g(x, y) + g(x + 1, y);
+        g.compute_at(h, y).async();
+        h.parallel(y);
+
+        std::string source = compile_to_c_source(h, "c_openmp_async", omp_t);
+        if (contains(source, "omp parallel for")) {
+            printf("Parallel loops with async producers should not use OpenMP\n");
+            return 1;
+        }
+    }
+
+    // The OpenMP code computes the same thing as the serial code. The
+    // parallel loop allocates a producer per iteration, and has a tail
+    // that needs a guard.
+    {
+#if defined(HALIDE_TEST_CXX) && defined(HALIDE_TEST_OPENMP_FLAGS)
+        const auto define = [&](Func g, Func h) {
+            g(x, y) = x * 3 - y * 5;
+            h(x, y) = g(x - 1, y) * 2 + g(x + 1, y) * 7 + g(x, y);
+        };
+        Func g("g"), h("h");
+        define(g, h);
+        g.compute_at(h, y).vectorize(x, 8);
+        h.vectorize(x, 8).parallel(y, 3);
+
+        Func serial_g("serial_g"), serial_h("serial_h");
+        define(serial_g, serial_h);
+
+        const int w = 123, h_extent = 77;
+        Buffer<int> correct = serial_h.realize({w, h_extent});
+        Buffer<int> result;
+        if (!run_with_openmp(h, "c_openmp_run", omp_t, w, h_extent, &result)) {
+            return 1;
+        }
+        for (int yi = 0; yi < h_extent; yi++) {
+            for (int xi = 0; xi < w; xi++) {
+                if (result(xi, yi) != correct(xi, yi)) {
+                    printf("result(%d, %d) = %d instead of %d\n", xi, yi, result(xi, yi), correct(xi, yi));
+                    return 1;
+                }
+            }
+        }
+#else
+        printf("Not running the OpenMP output: no OpenMP-capable compiler was configured.\n");
+#endif
+    }
+
+    printf("Success!\n");
+    return 0;
+}
@@ -0,0 +1,94 @@
+#include "Halide.h"
+#include <stdio.h>
+
+using namespace Halide;
+
+namespace {
+
+bool check(const Callable &c, Buffer<float> in, int w, int h) {
+    Buffer<float> out(w, h);
+    int result = c(in, 2.0f, out);
+    if (result != 0) {
+        printf("Callable failed with %d for a %dx%d output\n", result, w, h);
+        return false;
+    }
+    for (int y = 0; y < h; y++) {
+        for (int x = 0; x < w; x++) {
+            float correct = (in(x, y) + in(x + 1, y) + in(x, y + 1)) * 2.0f;
+            if (out(x, y) != correct) {
+                printf("out(%d, %d) = %f instead of %f for a %dx%d output\n",
+                       x, y, out(x, y), correct, w, h);
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+}  // namespace
+
+int main(int argc, char **argv) {
+    ImageParam in(Float(32), 2, "in");
+    Param<float> scale("scale");
+    Var x("x"), y("y");
+
+    Func f("f");
+    f(x, y) = (in(x, y) + in(x + 1, y) + in(x, y + 1)) * scale;
+    f.vectorize(x, 8, TailStrategy::GuardWithIf).parallel(y);
+
+    Callable generic = f.compile_to_callable({in, scale});
+    Callable c = generic.specialize_on_shapes(2, 2);
+
+    Buffer<float> big(130, 70);
+    big.for_each_element([&](int x, int y) { big(x, y) = (float)(x * 3 - y * 5); });
+
+    // A crop of the big buffer, which has a non-dense row stride.
+    Buffer<float> small(*big.raw_buffer());
+    small.crop(0, 0, 21);
+    small.crop(1, 0, 11);
+
+    // Cycle through more hot shapes than there are variants, so that
+    // variants are compiled, used, and evicted.
+    const int shapes[][2] = {{64, 32}, {129, 69}, {20, 10}};
+    for (int i = 0; i < 12; i++) {
+        const int *s = shapes[(i / 3) % 3];
+        Buffer<float> input = (s[0] == 20) ? small : big;
+        if (!check(c, input, s[0], s[1])) {
+            return 1;
+        }
+    }
+
+    // Each shape is compiled on its second call in a row, and run
+    // specialized from then on. The first shape is evicted by the third,
+    // so it is compiled again when it comes back.
+    auto stats = c.shape_specialization_stats();
+    if (stats.variants_compiled != 4 || stats.specialized_calls != 8) {
+        printf("Compiled %d variants and made %d specialized calls instead of 4 and 8\n",
+               stats.variants_compiled, stats.specialized_calls);
+        return 1;
+    }
+
+    // Shapes seen only once run the generic code.
+    for (int w = 1; w < 8; w++) {
+        if (!check(c, big, w * 9, w + 3)) {
+            return 1;
+        }
+    }
+    stats = c.shape_specialization_stats();
+    if (stats.variants_compiled != 4 || stats.specialized_calls != 8) {
+        printf("Shapes seen once were specialized\n");
+        return 1;
+    }
+
+    // The Callable it was made from is unchanged.
+    if (!check(generic, big, 64, 32)) {
+        return 1;
+    }
+    if (generic.shape_specialization_stats().variants_compiled != 0) {
+        printf("The generic Callable compiled a variant\n");
+        return 1;
+    }
+
+    printf("Success!\n");
+    return 0;
+}
@@ -0,0 +1,116 @@
+#include "Halide.h"
+#include <map>
+#include <sstream>
+#include <stdio.h>
+
+using namespace Halide;
+
+// Track the heap memory the pipeline uses.
+int mallocs = 0;
+size_t live_bytes = 0, peak_bytes = 0;
+std::map<void *, size_t> sizes;
+
+void *my_malloc(JITUserContext *user_context, size_t x) {
+    mallocs++;
+    void *orig = malloc(x + 128);
+    void *ptr = (void *)((((size_t)orig + 128) >> 7) << 7);
+    ((void **)ptr)[-1] = orig;
+    sizes[ptr] = x;
+    live_bytes += x;
+    peak_bytes = std::max(peak_bytes, live_bytes);
+    return ptr;
+}
+
+void my_free(JITUserContext *user_context, void *ptr) {
+    live_bytes -= sizes[ptr];
+    sizes.erase(ptr);
+    free(((void **)ptr)[-1]);
+}
+
+int main(int argc, char **argv) {
+    Target t = get_jit_target_from_environment();
+    if (t.arch == Target::WebAssembly) {
+        printf("[SKIP] WebAssembly JIT does not support custom allocators.\n");
+        return 0;
+    }
+
+    const int size = 1 << 16;
+    const int stages = 8;
+
+    // A chain of stencils, each computed at root. Only two
+    // consecutive stages are live at once, so they should be packed
+    // into an arena with two slots.
+    Var x;
+    std::vector<Func> f(stages);
+    f[0](x) = cast<float>(x % 17);
+    for (int i = 1; i < stages; i++) {
+        f[i](x) = f[i - 1](x) + f[i - 1](x + 1);
+        f[i - 1].compute_root();
+    }
+
+    f[stages - 1].jit_handlers().custom_malloc = my_malloc;
+    f[stages - 1].jit_handlers().custom_free = my_free;
+
+    // Coalescing is off unless the target asks for it.
+    Buffer<float> out = f[stages - 1].realize({size});
+    if (mallocs != stages - 1) {
+        printf("Expected %d allocations without coalesce_allocations, got %d\n",
+               stages - 1, mallocs);
+        return 1;
+    }
+
+    t = t.with_feature(Target::CoalesceAllocations);
+    mallocs = 0;
+    peak_bytes = 0;
+    out = f[stages - 1].realize({size}, t);
+
+    for (int i = 0; i < size; i++) {
+        // Each stage is a sum of binomially weighted values of the first.
+        float correct = 0;
+        int weight = 1;
+        for (int j = 0; j < stages; j++) {
+            correct += weight * (float)((i + j) % 17);
+            weight = weight * (stages - 1 - j) / (j + 1);
+        }
+        if (out(i) != correct) {
+            printf("out(%d) = %f instead of %f\n", i, out(i), correct);
+            return 1;
+        }
+    }
+
+    if (live_bytes != 0) {
+        printf("Leaked %d bytes\n", (int)live_bytes);
+        return 1;
+    }
+
+    if (t.bits == 64) {
+        if (mallocs != 1) {
+            printf("Expected the intermediates to be allocated in a single arena, "
+                   "but halide_malloc was called %d times\n",
+                   mallocs);
+            return 1;
+        }
+        // Two slots of a little over size floats each.
+        const size_t expected_peak = 2 * (size + stages) * sizeof(float) + 2 * 128;
+        if (peak_bytes > expected_peak) {
+            printf("Peak memory usage was %d bytes instead of at most %d bytes\n",
+                   (int)peak_bytes, (int)expected_peak);
+            return 1;
+        }
+
+        // The arena is reported to the compiler logger.
+        Internal::set_compiler_logger(std::make_unique<Internal::JSONCompilerLogger>());
+        f[stages - 1].compile_to_module(f[stages - 1].infer_arguments(), "coalesced", t);
+        std::ostringstream log;
+        Internal::get_compiler_logger()->emit_to_stream(log);
+        Internal::set_compiler_logger(nullptr);
+        if (log.str().find("\"coalesced_allocations\"") == std::string::npos ||
+            log.str().find("\"allocations\" : " + std::to_string(stages - 1)) == std::string::npos) {
+            printf("The coalesced allocations were not logged:\n%s\n", log.str().c_str());
+            return 1;
+        }
+    }
+
+    printf("Success!\n");
+    return 0;
+}
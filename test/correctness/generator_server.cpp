@@ -0,0 +1,101 @@
+#include "Halide.h"
+#include "halide_test_dirs.h"
+
+#include <cstdio>
+#include <thread>
+
+using namespace Halide;
+
+namespace {
+
+class Brighten : public Generator<Brighten> {
+public:
+    GeneratorParam<int> amount{"amount", 1};
+
+    Input<Buffer<uint8_t, 2>> input{"input"};
+    Output<Buffer<uint8_t, 2>> output{"output"};
+
+    void generate() {
+        Var x("x"), y("y");
+        output(x, y) = input(x, y) + cast<uint8_t>(amount);
+    }
+};
+
+// Run gengen with the given arguments, as a build system would.
+int gengen(std::vector<std::string> args) {
+    args.insert(args.begin(), "gengen");
+    std::vector<char *> argv;
+    for (auto &a : args) {
+        argv.push_back(&a[0]);
+    }
+    return Internal::generate_filter_main((int)argv.size(), argv.data());
+}
+
+}  // namespace
+
+HALIDE_REGISTER_GENERATOR(Brighten, brighten)
+
+int main(int argc, char **argv) {
+#ifdef _WIN32
+    printf("[SKIP] The Generator server is not supported on Windows.\n");
+    return 0;
+#endif
+
+    const std::string dir = Internal::get_test_tmp_dir();
+    const std::string socket_path = dir + "generator_server.sock";
+    const std::string target = get_host_target().to_string();
+
+    std::thread server([&]() {
+        if (gengen({"--serve", socket_path, "4"}) != 0) {
+            printf("The Generator server failed\n");
+            exit(1);
+        }
+    });
+
+    // Several clients at once, each building a different variant.
+    const int num_clients = 6;
+    std::vector<std::thread> clients;
+    std::vector<int> results(num_clients, -1);
+    for (int i = 0; i < num_clients; i++) {
+        const std::string name = "brighten_" + std::to_string(i);
+        Internal::ensure_no_file_exists(dir + name + ".o");
+        Internal::ensure_no_file_exists(dir + name + ".h");
+        clients.emplace_back([&, i, name]() {
+            results[i] = gengen({"--client", socket_path, "-g", "brighten", "-f", name, "-o", dir,
+                                 "-e", "object,c_header", "target=" + target, "amount=" + std::to_string(i)});
+        });
+    }
+    for (auto &t : clients) {
+        t.join();
+    }
+    for (int i = 0; i < num_clients; i++) {
+        if (results[i] != 0) {
+            printf("Request %d failed with %d\n", i, results[i]);
+            return 1;
+        }
+        Internal::assert_file_exists(dir + "brighten_" + std::to_string(i) + ".o");
+        Internal::assert_file_exists(dir + "brighten_" + std::to_string(i) + ".h");
+    }
+
+    // A bad request fails, but leaves the server running, as long as
+    // errors can be caught.
+    if (exceptions_enabled() &&
+        gengen({"--client", socket_path, "-g", "no_such_generator", "-o", dir, "target=" + target}) == 0) {
+        printf("A request for a missing Generator should have failed\n");
+        return 1;
+    }
+    if (exceptions_enabled() &&
+        gengen({"--client", socket_path, "-g", "brighten", "-o", dir, "-e", "c_header", "target=" + target}) != 0) {
+        printf("The server should still be running after a failed request\n");
+        return 1;
+    }
+
+    if (gengen({"--client", socket_path, "--shutdown"}) != 0) {
+        printf("Shutting down the server failed\n");
+        return 1;
+    }
+    server.join();
+
+    printf("Success!\n");
+    return 0;
+}
@@ -0,0 +1,107 @@
+// Don't include Halide.h: it is not necessary for this test.
+#include "HalideBuffer.h"
+
+#include <atomic>
+#include <stdio.h>
+
+using namespace Halide::Runtime;
+
+int value(int x, int y, int c) {
+    return x * 3 + y * 5 + c * 7;
+}
+
+int main(int argc, char **argv) {
+    const int W = 640, H = 480;
+    // Small tasks, so that even these small buffers get split up.
+    const ParallelPolicy policy{4, 1000};
+
+    Buffer<float> planar(W, H, 3);
+    planar.for_each_element(policy, [&](int x, int y, int c) {
+        planar(x, y, c) = (float)value(x, y, c);
+    });
+
+    // Each element should be visited exactly once, including when the
+    // callable takes fewer args than the buffer has dimensions.
+    {
+        Buffer<int> counts(W, H, 3);
+        counts.fill(policy, 0);
+        counts.for_each_element(policy, [&](const int *pos) {
+            counts(pos)++;
+        });
+        std::atomic<int> visits{0};
+        counts.for_each_element(policy, [&](int x, int y) {
+            counts(x, y, 0)++;
+            visits++;
+        });
+        if (visits != W * H) {
+            printf("Visited %d rows of a %d x %d buffer\n", (int)visits, W, H);
+            return -1;
+        }
+        counts.for_each_element([&](int x, int y, int c) {
+            int correct = c == 0 ? 2 : 1;
+            if (counts(x, y, c) != correct) {
+                printf("counts(%d, %d, %d) = %d instead of %d\n", x, y, c, counts(x, y, c), correct);
+                abort();
+            }
+        });
+    }
+
+    // Copies between planar and interleaved layouts, and the dense case.
+    {
+        Buffer<float> interleaved = Buffer<float>::make_interleaved(W, H, 3);
+        interleaved.copy_from(policy, planar);
+        Buffer<float> dense(W, H, 3);
+        dense.copy_from(policy, interleaved);
+        Buffer<float> serial(W, H, 3);
+        serial.copy_from(interleaved);
+        dense.for_each_value(policy, [&](float a, float b, float c) {
+            if (a != b || a != c) {
+                printf("Copies disagree: %f %f %f\n", a, b, c);
+                abort();
+            }
+        },
+                             planar, serial);
+    }
+
+    // Type-converting copies, and only over the region in common.
+    {
+        Buffer<uint8_t> narrow(W + 10, H, 3);
+        narrow.fill(255);
+        narrow.set_min(-5, 0);
+        narrow.convert_from(policy, planar);
+        Buffer<double> wide(W / 2, H / 2, 3);
+        wide.convert_from(narrow);
+        narrow.for_each_element([&](int x, int y, int c) {
+            uint8_t correct = (x < 0 || x >= W) ? 255 : (uint8_t)value(x, y, c);
+            if (narrow(x, y, c) != correct) {
+                printf("narrow(%d, %d, %d) = %d instead of %d\n", x, y, c, narrow(x, y, c), correct);
+                abort();
+            }
+        });
+        wide.for_each_element([&](int x, int y, int c) {
+            if (wide(x, y, c) != (uint8_t)value(x, y, c)) {
+                printf("wide(%d, %d, %d) = %f\n", x, y, c, wide(x, y, c));
+                abort();
+            }
+        });
+    }
+
+    // Filling with a value whose bytes are all the same uses memset,
+    // which must still fill crops correctly.
+    {
+        Buffer<int> buf(W, H);
+        buf.fill(1);
+        Buffer<int> crop = buf.cropped(0, 10, 20);
+        crop.fill(-1);
+        buf.for_each_element([&](int x, int y) {
+            int correct = (x >= 10 && x < 30) ? -1 : 1;
+            if (buf(x, y) != correct) {
+                printf("buf(%d, %d) = %d instead of %d\n", x, y, buf(x, y), correct);
+                abort();
+            }
+        });
+    }
+
+    printf("Success!\n");
+    return 0;
+}
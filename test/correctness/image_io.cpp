@@ -185,7 +185,7 @@ void do_test() {
     luma_buf.copy_from(color_buf);
     luma_buf.slice(2);
 
-    std::vector<std::string> formats = {"ppm", "pgm", "tmp", "mat", "tiff"};
+    std::vector<std::string> formats = {"ppm", "pgm", "tmp", "mat", "npy", "tiff"};
 #ifndef HALIDE_NO_JPEG
     formats.push_back("jpg");
 #endif
@@ -227,6 +227,207 @@ void do_test() {
     }
 }
 
+void test_load_batch() {
+    std::vector<Buffer<uint8_t>> bufs;
+    std::vector<std::string> filenames;
+    for (int i = 0; i < 8; i++) {
+        Buffer<uint8_t> buf(64 + i, 32, 3);
+        buf.for_each_element([&](int x, int y, int c) { buf(x, y, c) = (uint8_t)(x * 3 + y * 5 + c * 7 + i); });
+        std::string filename = Internal::get_test_tmp_dir() + "test_load_batch_" + std::to_string(i) + (i % 2 ? ".ppm" : ".mat");
+        Tools::save_image(buf, filename);
+        bufs.push_back(buf);
+        filenames.push_back(filename);
+    }
+
+    std::vector<Buffer<uint8_t>> loaded;
+    if (!Tools::load_batch(filenames, &loaded, 4) || loaded.size() != bufs.size()) {
+        std::cout << "load_batch failed\n";
+        abort();
+    }
+    for (size_t i = 0; i < bufs.size(); i++) {
+        bufs[i].for_each_element([&](int x, int y, int c) {
+            if (loaded[i](x, y, c) != bufs[i](x, y, c)) {
+                std::cout << "load_batch loaded the wrong value from " << filenames[i] << "\n";
+                abort();
+            }
+        });
+    }
+
+    filenames.push_back(Internal::get_test_tmp_dir() + "test_load_batch_missing.ppm");
+    if (Tools::load_batch(filenames, &loaded)) {
+        std::cout << "load_batch should fail if any file is missing\n";
+        abort();
+    }
+}
+
+void test_threaded_rows() {
+    // Big enough that the rows are split into several tasks.
+    Buffer<uint16_t> buf(600, 500, 3);
+    buf.for_each_element([&](int x, int y, int c) { buf(x, y, c) = (uint16_t)(x * 97 + y * 31 + c * 13); });
+
+    Tools::set_image_io_num_threads(4);
+    for (const char *format : {"ppm", "png"}) {
+#ifdef HALIDE_NO_PNG
+        if (std::string(format) == "png") {
+            continue;
+        }
+#endif
+        std::string filename = Internal::get_test_tmp_dir() + "test_threaded_rows." + format;
+        Tools::save_image(buf, filename);
+        Buffer<uint16_t> loaded = Tools::load_image(filename);
+        buf.for_each_element([&](int x, int y, int c) {
+            if (loaded(x, y, c) != buf(x, y, c)) {
+                std::cout << "Loading " << filename << " with threads gave the wrong value at "
+                          << x << ", " << y << ", " << c << "\n";
+                abort();
+            }
+        });
+    }
+    Tools::set_image_io_num_threads(1);
+}
+
+// Write a four-dimensional f as a Fortran-order .npy file, which
+// save_image never makes. The numpy shape is the same as for the C-order
+// file save_image writes, but the first numpy axis, which is the last
+// Halide dimension, is innermost.
+void save_fortran_order_npy(const Buffer<float> &f, const std::string &filename) {
+    std::string header = "{'descr': '<f4', 'fortran_order': True, 'shape': (";
+    for (int d = f.dimensions() - 1; d >= 0; d--) {
+        header += std::to_string(f.dim(d).extent()) + (d > 0 ? ", " : "");
+    }
+    header += "), }";
+    header.resize((10 + header.size() + 1 + 63) / 64 * 64 - 10 - 1, ' ');
+    header += '\n';
+
+    std::ofstream o(filename, std::ios::binary);
+    o.write("\x93NUMPY\x01\x00", 8);
+    o.put((char)(header.size() & 0xff));
+    o.put((char)(header.size() >> 8));
+    o.write(header.data(), header.size());
+    for (int x = 0; x < f.dim(0).extent(); x++) {
+        for (int y = 0; y < f.dim(1).extent(); y++) {
+            for (int z = 0; z < f.dim(2).extent(); z++) {
+                for (int w = 0; w < f.dim(3).extent(); w++) {
+                    float v = f(x, y, z, w);
+                    o.write((const char *)&v, sizeof(v));
+                }
+            }
+        }
+    }
+}
+
+void test_npy() {
+    // Types and dimensionalities the image formats above don't cover,
+    // loaded both by copying and by mapping the file.
+    Buffer<float> f(7, 5, 3, 2);
+    f.for_each_element([&](const int *pos) { f(pos) = pos[0] * 0.5f + pos[1] * 7 + pos[2] * 100 + pos[3] * 1000; });
+    Buffer<bool> b(9);
+    b.for_each_element([&](int x) { b(x) = (x % 3) == 0; });
+    Buffer<int64_t> s = Buffer<int64_t>::make_scalar();
+    s() = -1234567890123LL;
+
+    std::string dir = Internal::get_test_tmp_dir();
+    Tools::save_image(f, dir + "test_npy_f32.npy");
+    Tools::save_image(b, dir + "test_npy_bool.npy");
+    Tools::save_image(s, dir + "test_npy_scalar.npy");
+
+    save_fortran_order_npy(f, dir + "test_npy_f32_fortran.npy");
+
+    for (bool mapped : {false, true}) {
+        Buffer<float> f2, f3;
+        Buffer<bool> b2;
+        Buffer<int64_t> s2;
+        bool ok = mapped ? (Tools::load_mapped(dir + "test_npy_f32.npy", &f2) &&
+                            Tools::load_mapped(dir + "test_npy_bool.npy", &b2) &&
+                            Tools::load_mapped(dir + "test_npy_scalar.npy", &s2)) :
+                           (Tools::load(dir + "test_npy_f32.npy", &f2) &&
+                            Tools::load(dir + "test_npy_bool.npy", &b2) &&
+                            Tools::load(dir + "test_npy_scalar.npy", &s2));
+        ok = ok && (mapped ? Tools::load_mapped(dir + "test_npy_f32_fortran.npy", &f3) :
+                             Tools::load(dir + "test_npy_f32_fortran.npy", &f3));
+        if (!ok || f2.dimensions() != 4 || f3.dimensions() != 4 || b2.dimensions() != 1 || s2.dimensions() != 0) {
+            std::cout << "Failed to load .npy files (mapped = " << mapped << ")\n";
+            abort();
+        }
+        // The C-order and Fortran-order files hold the same numpy array, so
+        // they load as the same image.
+        for (int d = 0; d < 4; d++) {
+            if (f3.dim(d).extent() != f.dim(d).extent()) {
+                std::cout << "Fortran-order .npy loaded with the wrong shape (mapped = " << mapped << ")\n";
+                abort();
+            }
+        }
+        f.for_each_element([&](const int *pos) {
+            if (f2(pos) != f(pos)) {
+                std::cout << "Wrong float value loaded from .npy (mapped = " << mapped << ")\n";
+                abort();
+            }
+            if (f3(pos) != f(pos)) {
+                std::cout << "Wrong float value loaded from Fortran-order .npy (mapped = " << mapped << ")\n";
+                abort();
+            }
+        });
+        b.for_each_element([&](int x) {
+            if (b2(x) != b(x)) {
+                std::cout << "Wrong bool value loaded from .npy (mapped = " << mapped << ")\n";
+                abort();
+            }
+        });
+        if (s2() != s()) {
+            std::cout << "Wrong scalar loaded from .npy (mapped = " << mapped << ")\n";
+            abort();
+        }
+    }
+}
+
+void test_chunked() {
+    // Write a chunked file in tiles that don't line up with its chunks,
+    // then read back the whole thing and an interleaved region of it.
+    std::string filename = Internal::get_test_tmp_dir() + "test_chunked.chunked";
+    Tools::ChunkedFileInfo info{halide_type_of<int>(), {-5, 10, 0}, {103, 77, 3}, {16, 10, 2}};
+    if (!Tools::create_chunked(filename, info)) {
+        std::cout << "create_chunked failed\n";
+        abort();
+    }
+
+    auto value = [](int x, int y, int c) { return x * 1000 + y * 10 + c; };
+    for (int ty = 10; ty < 87; ty += 20) {
+        for (int tx = -5; tx < 98; tx += 33) {
+            Buffer<int> tile(std::min(33, 98 - tx), std::min(20, 87 - ty), 3);
+            tile.set_min(tx, ty, 0);
+            tile.for_each_element([&](int x, int y, int c) { tile(x, y, c) = value(x, y, c); });
+            if (!Tools::save_chunked_region(tile, filename)) {
+                std::cout << "save_chunked_region failed\n";
+                abort();
+            }
+        }
+    }
+
+    Buffer<int> all(103, 77, 3);
+    all.set_min(-5, 10, 0);
+    Buffer<int> region = Buffer<int>::make_interleaved(20, 7, 2);
+    region.set_min(40, 50, 1);
+    for (Buffer<int> *buf : {&all, &region}) {
+        if (!Tools::load_chunked_region(filename, buf)) {
+            std::cout << "load_chunked_region failed\n";
+            abort();
+        }
+        buf->for_each_element([&](int x, int y, int c) {
+            if ((*buf)(x, y, c) != value(x, y, c)) {
+                std::cout << "load_chunked_region loaded the wrong value at " << x << ", " << y << ", " << c << "\n";
+                abort();
+            }
+        });
+    }
+
+    Buffer<int> outside(10, 10, 3);
+    outside.set_min(100, 10, 0);
+    if (Tools::load_chunked_region(filename, &outside)) {
+        std::cout << "load_chunked_region should fail outside the bounds of the file\n";
+        abort();
+    }
+}
+
 void test_mat_header() {
     // Test if the .mat file header writes the correct file size
     std::ostringstream o;
@@ -259,6 +460,10 @@ int main(int argc, char **argv) {
     do_test<uint8_t>();
     do_test<uint16_t>();
     test_mat_header();
+    test_load_batch();
+    test_threaded_rows();
+    test_npy();
+    test_chunked();
     printf("Success!\n");
     return 0;
 }
@@ -0,0 +1,138 @@
+#include "Halide.h"
+#include <stdio.h>
+
+using namespace Halide;
+
+int call_counter = 0;
+extern "C" HALIDE_EXPORT_SYMBOL int count(int x) {
+    call_counter++;
+    return x;
+}
+HalideExtern_1(int, count, int);
+
+int main(int argc, char **argv) {
+    ImageParam in(Int(32), 2, "in");
+    Var x("x"), y("y");
+
+    // A two-stage stencil with a compute_root intermediate, which counts
+    // the sites of it that are computed.
+    Func blur_x("blur_x"), blur_y("blur_y");
+    blur_x(x, y) = count(in(x - 1, y) + in(x, y) + in(x + 1, y));
+    blur_y(x, y) = blur_x(x, y - 1) + 2 * blur_x(x, y) + blur_x(x, y + 1);
+    blur_x.compute_root();
+    blur_y.vectorize(x, 8);
+
+    Pipeline p(blur_y);
+
+    const int W = 512, H = 256;
+    Buffer<int> input(W + 2, H + 2);
+    input.set_min(-1, -1);
+    input.for_each_element([&](int x, int y) { input(x, y) = x * 3 + y * 7; });
+    in.set(input);
+
+    Buffer<int> out(W, H);
+    p.realize(out);
+
+    // Paint over a small rectangle of the input.
+    const int x0 = 100, y0 = 50, w = 10, h = 4;
+    for (int yy = y0; yy < y0 + h; yy++) {
+        for (int xx = x0; xx < x0 + w; xx++) {
+            input(xx, yy) = 1000 + xx - yy;
+        }
+    }
+
+    Region region = p.realize_dirty_region(Realization(out), "in", {{x0, w}, {y0, h}});
+
+    // The region recomputed is the rectangle grown by the stencil.
+    const int expected[2][2] = {{x0 - 1, w + 2}, {y0 - 1, h + 2}};
+    if (region.size() != 2) {
+        printf("Expected a two-dimensional region to be recomputed\n");
+        return 1;
+    }
+    for (int d = 0; d < 2; d++) {
+        int min = (int)*Internal::as_const_int(region[d].min);
+        int extent = (int)*Internal::as_const_int(region[d].extent);
+        if (min != expected[d][0] || extent != expected[d][1]) {
+            printf("Recomputed [%d, %d) in dimension %d instead of [%d, %d)\n",
+                   min, min + extent, d, expected[d][0], expected[d][0] + expected[d][1]);
+            return 1;
+        }
+    }
+
+    Buffer<int> correct = p.realize({W, H});
+    for (int yy = 0; yy < H; yy++) {
+        for (int xx = 0; xx < W; xx++) {
+            if (out(xx, yy) != correct(xx, yy)) {
+                printf("out(%d, %d) = %d instead of %d\n", xx, yy, out(xx, yy), correct(xx, yy));
+                return 1;
+            }
+        }
+    }
+
+    // blur_x is kept between calls, so a second change recomputes only
+    // the sites of it that depend on the change.
+    const int x1 = 300, y1 = 200, w1 = 6, h1 = 3;
+    for (int yy = y1; yy < y1 + h1; yy++) {
+        for (int xx = x1; xx < x1 + w1; xx++) {
+            input(xx, yy) = 2000 + xx * yy;
+        }
+    }
+    call_counter = 0;
+    p.realize_dirty_region(Realization(out), "in", {{x1, w1}, {y1, h1}});
+    if (call_counter != (w1 + 2) * h1) {
+        printf("Computed %d sites of blur_x instead of %d\n", call_counter, (w1 + 2) * h1);
+        return 1;
+    }
+
+    correct = p.realize({W, H});
+    for (int yy = 0; yy < H; yy++) {
+        for (int xx = 0; xx < W; xx++) {
+            if (out(xx, yy) != correct(xx, yy)) {
+                printf("After the second change, out(%d, %d) = %d instead of %d\n",
+                       xx, yy, out(xx, yy), correct(xx, yy));
+                return 1;
+            }
+        }
+    }
+
+    // Compiling for a different target recomputes blur_x in full.
+    const Target t = get_jit_target_from_environment().with_feature(Target::NoAsserts);
+    const int x2 = 20, y2 = 120, w2 = 5, h2 = 5;
+    for (int yy = y2; yy < y2 + h2; yy++) {
+        for (int xx = x2; xx < x2 + w2; xx++) {
+            input(xx, yy) = 3000 - xx - yy;
+        }
+    }
+    call_counter = 0;
+    p.realize_dirty_region(Realization(out), "in", {{x2, w2}, {y2, h2}}, t);
+    if (call_counter != W * (H + 2)) {
+        printf("After changing the target, computed %d sites of blur_x instead of %d\n",
+               call_counter, W * (H + 2));
+        return 1;
+    }
+
+    correct = p.realize({W, H});
+    for (int yy = 0; yy < H; yy++) {
+        for (int xx = 0; xx < W; xx++) {
+            if (out(xx, yy) != correct(xx, yy)) {
+                printf("After changing the target, out(%d, %d) = %d instead of %d\n",
+                       xx, yy, out(xx, yy), correct(xx, yy));
+                return 1;
+            }
+        }
+    }
+
+    // A change outside of everything the output reads recomputes nothing.
+    call_counter = 0;
+    if (!p.realize_dirty_region(Realization(out), "in", {{W + 10, 4}, {0, 4}}, t).empty()) {
+        printf("A change that does not affect the output recomputed some of it\n");
+        return 1;
+    }
+    if (call_counter != 0) {
+        printf("A change that does not affect the output recomputed %d sites of blur_x\n", call_counter);
+        return 1;
+    }
+
+    printf("Success!\n");
+    return 0;
+}
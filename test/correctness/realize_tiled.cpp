@@ -0,0 +1,87 @@
+#include "Halide.h"
+#include <mutex>
+#include <stdio.h>
+
+using namespace Halide;
+
+namespace {
+
+int input_value(int x, int y) {
+    return (x * 17 + y * 31) & 0xff;
+}
+
+}  // namespace
+
+int main(int argc, char **argv) {
+    ImageParam in(Int(32), 2, "in");
+    Var x("x"), y("y");
+
+    Func blur_x("blur_x"), blur_y("blur_y");
+    blur_x(x, y) = in(x - 1, y) + in(x, y) + in(x + 1, y);
+    blur_y(x, y) = blur_x(x, y - 1) + blur_x(x, y) + blur_x(x, y + 1);
+    blur_x.compute_at(blur_y, y).vectorize(x, 8);
+    blur_y.vectorize(x, 8);
+
+    Pipeline p(blur_y);
+
+    const int width = 1000, height = 700;
+    const int tile_w = 128, tile_h = 96;
+
+    for (size_t max_memory : {(size_t)0, (size_t)1}) {
+        Buffer<int> result(width, height);
+        result.fill(-1);
+        std::mutex mutex;
+        int largest_input_tile = 0;
+        int concurrent = 0, max_concurrent = 0;
+
+        // Synthesize the input tile by tile, as if reading it from disk.
+        auto reader = [&](Buffer<> &tile) -> int {
+            Buffer<int> t = tile.as<int>();
+            t.for_each_element([&](int x, int y) { t(x, y) = input_value(x, y); });
+            std::lock_guard<std::mutex> lock(mutex);
+            largest_input_tile = std::max(largest_input_tile, t.width() * t.height());
+            max_concurrent = std::max(max_concurrent, ++concurrent);
+            return 0;
+        };
+
+        auto writer = [&](const Realization &r) -> int {
+            Buffer<int> t = r[0].as<int>();
+            std::lock_guard<std::mutex> lock(mutex);
+            result.copy_from(t);
+            concurrent--;
+            return 0;
+        };
+
+        p.realize_tiled({width, height}, {tile_w, tile_h}, {{"in", reader}}, writer, max_memory);
+
+        for (int y = 0; y < height; y++) {
+            for (int x = 0; x < width; x++) {
+                int correct = 0;
+                for (int dy = -1; dy <= 1; dy++) {
+                    for (int dx = -1; dx <= 1; dx++) {
+                        correct += input_value(x + dx, y + dy);
+                    }
+                }
+                if (result(x, y) != correct) {
+                    printf("result(%d, %d) = %d instead of %d\n", x, y, result(x, y), correct);
+                    return 1;
+                }
+            }
+        }
+
+        // Only the footprint of one tile should have been read at a time.
+        if (largest_input_tile > (tile_w + 2) * (tile_h + 2)) {
+            printf("An input tile of %d pixels was read\n", largest_input_tile);
+            return 1;
+        }
+
+        // A budget too small for even one tile runs the tiles one at a time.
+        if (max_memory == 1 && max_concurrent != 1) {
+            printf("%d tiles ran at once with a memory budget of one tile\n", max_concurrent);
+            return 1;
+        }
+    }
+
+    printf("Success!\n");
+    return 0;
+}
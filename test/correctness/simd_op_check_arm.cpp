@@ -16,7 +16,7 @@ using namespace std::string_literals;
 class SimdOpCheckARM : public SimdOpCheckTest {
 public:
     SimdOpCheckARM(Target t, int w = 768, int h = 128)
-        : SimdOpCheckTest(t, w, h) {
+        : SimdOpCheckTest(t.with_feature(Target::LUTShuffles), w, h) {
     }
 
     void add_tests() override {
@@ -1090,11 +1090,20 @@ public:
 
         // VTBL X       -       Table Lookup
         // Arm's version of shufps. Allows for arbitrary permutations of a
-        // 64-bit vector. We typically use vrev variants instead.
+        // 64-bit vector. We use it for gathers from small tables.
 
         // VTBX X       -       Table Extension
         // Like vtbl, but doesn't change any elements where the index was
-        // out of bounds. Not sure how we'd use this.
+        // out of bounds. With lut_shuffles, we use it to chain lookups into
+        // tables too large for a single vtbl.
+        if (!target.has_feature(Target::NoNEON)) {
+            for (int w = 1; w <= 4; w++) {
+                check(arm32 ? "vtbl.8" : "tbl", 8 * w, in_u8(u8_1 % 16));
+                check(arm32 ? "vtbl.8" : "tbl", 4 * w, in_u16(u8_1 % 8));
+                check(arm32 ? "vtbl.8" : "tbl", 2 * w, in_f32(u8_1 % 4));
+                check(arm32 ? "vtbx.8" : "tbx", 8 * w, in_u8(u8_1 % 128));
+            }
+        }
 
         // VTRN X       -       Transpose
         // Swaps the even elements of one vector with the odd elements of
@@ -16,7 +16,7 @@ namespace {
 class SimdOpCheckX86 : public SimdOpCheckTest {
 public:
     SimdOpCheckX86(Target t, int w = 768, int h = 128)
-        : SimdOpCheckTest(t, w, h) {
+        : SimdOpCheckTest(t.with_feature(Target::LUTShuffles), w, h) {
         // We only test the skylake variant of avx512 here
         use_avx512 = (target.has_feature(Target::AVX512_Cannonlake) ||
                       target.has_feature(Target::AVX512_Skylake));
@@ -254,6 +254,17 @@ public:
                 check("pabsd", 2 * w, abs(i32_1));
             }
 
+            // With lut_shuffles, gathers from small tables become byte
+            // shuffles, using vpermb if we have AVX512-VBMI.
+            const bool use_vbmi = target.has_feature(Target::AVX512_Cannonlake);
+            const char *lut_op = use_vbmi ? "vpermb" : "pshufb";
+            for (int w = 1; w <= 4; w++) {
+                check(lut_op, 16 * w, in_u8(u8_1 % 16));
+                check(lut_op, 16 * w, in_i8(u8_1 % 64));
+                check(lut_op, 8 * w, in_u16(u8_1 % 8));
+                check(lut_op, 4 * w, in_f32(u8_1 % 16));
+            }
+
             // Horizontal ops. Our support for them uses intrinsics
             // from LLVM 9+.
 
@@ -0,0 +1,105 @@
+#include "Halide.h"
+#include <stdio.h>
+
+using namespace Halide;
+using namespace Halide::Internal;
+
+// Count the stores marked non-temporal and the fences that order them.
+class CountNontemporal : public IRMutator {
+public:
+    std::map<std::string, int> stores;
+    int fences = 0;
+
+private:
+    using IRMutator::visit;
+
+    Stmt visit(const Store *op) override {
+        if (Call::as_intrinsic(op->value, {Call::nontemporal})) {
+            stores[op->name]++;
+        }
+        return IRMutator::visit(op);
+    }
+
+    Expr visit(const Call *op) override {
+        if (op->is_intrinsic(Call::store_fence)) {
+            fences++;
+        }
+        return IRMutator::visit(op);
+    }
+};
+
+int main(int argc, char **argv) {
+    Var x("x"), y("y");
+
+    // A format conversion, written once with streaming stores.
+    {
+        Buffer<uint8_t> in(1024, 64);
+        in.for_each_element([&](int x, int y) { in(x, y) = (uint8_t)(x * 3 + y); });
+
+        Func f("f");
+        f(x, y) = cast<float>(in(x, y)) / 255.0f;
+        f.vectorize(x, 16).parallel(y).store_nontemporal();
+
+        CountNontemporal counter;
+        f.add_custom_lowering_pass(&counter, []() {});
+
+        Buffer<float> out = f.realize({1024, 64});
+
+        for (int y = 0; y < out.height(); y++) {
+            for (int x = 0; x < out.width(); x++) {
+                float correct = in(x, y) / 255.0f;
+                if (out(x, y) != correct) {
+                    printf("out(%d, %d) = %f instead of %f\n", x, y, out(x, y), correct);
+                    return 1;
+                }
+            }
+        }
+
+        if (counter.stores["f"] == 0) {
+            printf("Stores to f were not marked non-temporal\n");
+            return 1;
+        }
+        // One fence per parallel task, and one after the production.
+        if (counter.fences != 2) {
+            printf("Expected 2 fences, got %d\n", counter.fences);
+            return 1;
+        }
+    }
+
+    // An intermediate Tuple-valued Func written in parallel with
+    // streaming stores, and then read back by another stage.
+    {
+        Func g("g"), h("h");
+        g(x, y) = {x + y, x - y};
+        h(x, y) = g(x, y)[0] * g(x, y)[1];
+        g.compute_root().vectorize(x, 8).parallel(y).store_nontemporal();
+        h.vectorize(x, 8);
+
+        CountNontemporal counter;
+        h.add_custom_lowering_pass(&counter, []() {});
+
+        Buffer<int> out = h.realize({256, 256});
+
+        for (int y = 0; y < out.height(); y++) {
+            for (int x = 0; x < out.width(); x++) {
+                int correct = (x + y) * (x - y);
+                if (out(x, y) != correct) {
+                    printf("out(%d, %d) = %d instead of %d\n", x, y, out(x, y), correct);
+                    return 1;
+                }
+            }
+        }
+
+        if (counter.stores["g.0"] == 0 || counter.stores["g.1"] == 0) {
+            printf("Stores to g were not marked non-temporal\n");
+            return 1;
+        }
+        if (counter.stores.count("h")) {
+            printf("Stores to h should not have been marked non-temporal\n");
+            return 1;
+        }
+    }
+
+    printf("Success!\n");
+    return 0;
+}
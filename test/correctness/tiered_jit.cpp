@@ -0,0 +1,87 @@
+#include "Halide.h"
+#include <chrono>
+#include <stdio.h>
+#include <thread>
+
+using namespace Halide;
+
+namespace {
+
+// Wait for the optimized code of at least n pipelines to have been swapped
+// in since the start of the test.
+bool wait_for_swaps(int n) {
+    const auto deadline = std::chrono::steady_clock::now() + std::chrono::minutes(2);
+    while (Internal::jit_tier_up_swaps() < n) {
+        if (std::chrono::steady_clock::now() > deadline) {
+            printf("Only %d of %d optimized pipelines were swapped in\n", Internal::jit_tier_up_swaps(), n);
+            return false;
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    return true;
+}
+
+}  // namespace
+
+int main(int argc, char **argv) {
+    Target t = get_jit_target_from_environment();
+    if (t.arch == Target::WebAssembly) {
+        printf("[SKIP] Tiered compilation is not used for WebAssembly.\n");
+        return 0;
+    }
+    t = t.with_feature(Target::TieredJIT);
+
+    Var x("x"), y("y");
+    Func f("f"), g("g");
+    f(x, y) = x * 3 + y;
+    g(x, y) = f(x, y) + f(x + 1, y) * 2;
+    f.compute_root().vectorize(x, 8);
+    g.vectorize(x, 8).parallel(y);
+
+    // Keep calling the pipeline while the optimized version is compiled
+    // in the background, and after it has been swapped in. The results
+    // must not change when it is.
+    const int swaps = Internal::jit_tier_up_swaps();
+    g.compile_jit(t);
+    for (int i = 0; i < 200; i++) {
+        if (i == 100 && !wait_for_swaps(swaps + 1)) {
+            return 1;
+        }
+        Buffer<int> out = g.realize({64, 64});
+        for (int y = 0; y < out.height(); y++) {
+            for (int x = 0; x < out.width(); x++) {
+                int correct = x * 3 + y + ((x + 1) * 3 + y) * 2;
+                if (out(x, y) != correct) {
+                    printf("out(%d, %d) = %d instead of %d\n", x, y, out(x, y), correct);
+                    return 1;
+                }
+            }
+        }
+    }
+
+    // The same goes for Callables, which may outlive the Pipeline.
+    ImageParam in(Int(32), 1, "in");
+    Func h("h");
+    h(x) = in(x) * in(x);
+    Callable c = h.compile_to_callable({in}, t);
+    Buffer<int> input(128), output(128);
+    input.for_each_element([&](int x) { input(x) = x - 64; });
+    for (int i = 0; i < 200; i++) {
+        if (i == 100 && !wait_for_swaps(swaps + 2)) {
+            return 1;
+        }
+        if (c(input, output) != 0) {
+            printf("Callable failed\n");
+            return 1;
+        }
+        for (int x = 0; x < 128; x++) {
+            if (output(x) != input(x) * input(x)) {
+                printf("output(%d) = %d instead of %d\n", x, output(x), input(x) * input(x));
+                return 1;
+            }
+        }
+    }
+
+    printf("Success!\n");
+    return 0;
+}
@@ -0,0 +1,109 @@
+#include "Halide.h"
+#include <sstream>
+#include <stdio.h>
+
+using namespace Halide;
+using namespace Halide::Internal;
+
+// A long chain of selects and clamps, which takes the simplifier and
+// bounds inference many steps to work through.
+Expr deep_expr(Expr x, int depth) {
+    Expr e = x;
+    for (int i = 0; i < depth; i++) {
+        e = select(x < i, min(e, i) + 1, max(x, i) - 1);
+    }
+    return e;
+}
+
+int deep_value(int x, int depth) {
+    int e = x;
+    for (int i = 0; i < depth; i++) {
+        e = x < i ? std::min(e, i) + 1 : std::max(x, i) - 1;
+    }
+    return e;
+}
+
+int main(int argc, char **argv) {
+    const int depth = 50;
+    Var x("x");
+
+    // Without a budget, the bounds of the chain are tight.
+    {
+        set_work_budget(0);
+        Scope<Interval> scope;
+        scope.push("x", Interval(0, 10));
+        Interval i = bounds_of_expr_in_scope(deep_expr(Variable::make(Int(32), "x"), 8), scope);
+        if (!i.is_bounded()) {
+            printf("Bounds should have been found without a work budget\n");
+            return 1;
+        }
+    }
+
+    // With a small budget, bounds inference gives up and falls back to
+    // the bounds of the type.
+    {
+        set_work_budget(10);
+        Scope<Interval> scope;
+        scope.push("x", Interval(0, 10));
+        Expr e = cast<uint8_t>(deep_expr(Variable::make(Int(32), "x"), depth));
+        Interval i = bounds_of_expr_in_scope(e, scope);
+        set_work_budget(0);
+        if (!i.is_bounded() || !can_prove(i.min <= 0 && i.max >= 255)) {
+            printf("Bounds inference should have fallen back to the bounds of uint8\n");
+            return 1;
+        }
+    }
+
+    // The simplifier leaves what it didn't get to unchanged, but is
+    // still correct.
+    {
+        set_work_budget(10);
+        Expr e = deep_expr(Variable::make(Int(32), "x"), depth);
+        Expr s = simplify(e);
+        set_work_budget(0);
+        for (int v = -5; v < depth + 5; v++) {
+            const int64_t *result = as_const_int(simplify(substitute("x", v, s)));
+            if (!result || *result != deep_value(v, depth)) {
+                printf("Simplifying with a small work budget changed the value at x = %d\n", v);
+                return 1;
+            }
+        }
+    }
+
+    // Whole pipelines still compile and produce the right answer, and
+    // the analyses that gave up are reported to the compiler logger.
+    {
+        set_compiler_logger(std::make_unique<JSONCompilerLogger>());
+        set_work_budget(50);
+
+        Func f("f"), g("g");
+        f(x) = deep_expr(x, depth);
+        g(x) = f(x) + f(x + 1);
+        f.compute_root();
+
+        Buffer<int> out = g.realize({100});
+
+        set_work_budget(0);
+        std::ostringstream log;
+        get_compiler_logger()->emit_to_stream(log);
+        set_compiler_logger(nullptr);
+
+        for (int i = 0; i < out.width(); i++) {
+            int correct = deep_value(i, depth) + deep_value(i + 1, depth);
+            if (out(i) != correct) {
+                printf("out(%d) = %d instead of %d\n", i, out(i), correct);
+                return 1;
+            }
+        }
+
+        if (log.str().find("\"work_budget_exceeded\"") == std::string::npos ||
+            log.str().find("\"simplify\"") == std::string::npos) {
+            printf("The simplifier running out of work budget was not logged:\n%s\n",
+                   log.str().c_str());
+            return 1;
+        }
+    }
+
+    printf("Success!\n");
+    return 0;
+}
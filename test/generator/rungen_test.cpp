@@ -1,3 +1,4 @@
+#include <cmath>
 #include <iostream>
 
 #include "HalideRuntime.h"
@@ -92,6 +93,33 @@ int main(int argc, char **argv) {
         check(out.str() == expected_out);
     }
 
+    {
+        std::vector<double> times;
+        for (int i = 100; i >= 1; i--) {
+            times.push_back(i * 0.001);
+        }
+        LatencyStats stats = compute_latency_stats(times);
+        check(stats.samples == 100);
+        check(stats.min == 0.001 && stats.max == 0.1);
+        check(stats.p50 == 0.05 && stats.p95 == 0.095 && stats.p99 == 0.099);
+        check(std::abs(stats.mean - 0.0505) < 1e-9);
+        check(compute_latency_stats({}).samples == 0);
+    }
+
+    {
+        BenchmarkStats stats;
+        stats.num_threads = 4;
+        stats.best.wall_time = 0.5;
+        stats.latency = compute_latency_stats({0.5, 0.75});
+
+        std::ostringstream json;
+        r.write_benchmark_json(json, {stats});
+        check(json.str().find("\"name\": \"example\"") != std::string::npos);
+        check(json.str().find("\"num_threads\": 4") != std::string::npos);
+        check(json.str().find("\"p99\": 0.75") != std::string::npos);
+        check(json.str().find("perf_counters") == std::string::npos);
+    }
+
     // TODO: add more here; all this does is verify that we can instantiate correctly
     // and that 'describe' parses the metadata as expected.
 
@@ -12,6 +12,7 @@
 #include "IRMatch.h"
 #include "IRPrinter.h"
 #include "Interval.h"
+#include "LLVM_Runtime_Linker.h"
 #include "ModulusRemainder.h"
 #include "Monotonic.h"
 #include "Reduction.h"
@@ -41,6 +42,7 @@ int main(int argc, const char **argv) {
     propagate_estimate_test();
     uniquify_variable_names_test();
     spirv_ir_test();
+    llvm_runtime_linker_test();
 
     printf("Success!\n");
     return 0;
@@ -0,0 +1,109 @@
+#include "Halide.h"
+#include "halide_benchmark.h"
+
+#include <cstdio>
+
+using namespace Halide;
+using namespace Halide::Tools;
+
+// Compare stencils that walk down columns with and without carrying
+// loaded rows across loop iterations in registers.
+
+Var x("x"), y("y"), xo("xo"), xi("xi");
+
+// A separable 3x3 box blur, as in apps/blur, but with the vertical pass
+// walking down strips of columns.
+Func blur(const Buffer<uint16_t> &in, int vec) {
+    Func blur_x("blur_x"), blur_y("blur_y");
+    blur_x(x, y) = (in(x, y) + in(x + 1, y) + in(x + 2, y)) / 3;
+    blur_y(x, y) = (blur_x(x, y) + blur_x(x, y + 1) + blur_x(x, y + 2)) / 3;
+
+    blur_y.split(x, xo, xi, vec * 2).reorder(xi, y, xo).vectorize(xi);
+    blur_x.compute_at(blur_y, xo).vectorize(x, vec);
+    return blur_y;
+}
+
+// A chain of 5-tap vertical stencils, in the spirit of apps/stencil_chain.
+Func stencil_chain(const Buffer<uint16_t> &in, int vec) {
+    const int stages = 4;
+    std::vector<Func> fs;
+    Func prev = lambda(x, y, in(x, y));
+    for (int s = 0; s < stages; s++) {
+        Func f("stage_" + std::to_string(s));
+        Expr e = cast<uint16_t>(0);
+        for (int dy = 0; dy < 5; dy++) {
+            e += prev(x, y + dy) * (dy + 1);
+        }
+        f(x, y) = e >> 4;
+        fs.push_back(f);
+        prev = f;
+    }
+
+    Func out = fs.back();
+    out.split(x, xo, xi, vec).reorder(xi, y, xo).vectorize(xi);
+    for (int s = 0; s < stages - 1; s++) {
+        fs[s].compute_at(out, xo).vectorize(x, vec);
+    }
+    return out;
+}
+
+template<typename Builder>
+bool test(const char *name, Builder build, const Buffer<uint16_t> &in, int vec, const Target &target) {
+    Func with_carry = build(in, vec);
+    Func without_carry = build(in, vec);
+    with_carry.compile_jit(target);
+    without_carry.compile_jit(target.with_feature(Target::NoLoopCarry));
+
+    const int w = in.width() - 32, h = in.height() - 32;
+    Buffer<uint16_t> out_with(w, h), out_without(w, h);
+    with_carry.realize(out_with);
+    without_carry.realize(out_without);
+
+    for (int yy = 0; yy < h; yy++) {
+        for (int xx = 0; xx < w; xx++) {
+            if (out_with(xx, yy) != out_without(xx, yy)) {
+                printf("%s: out(%d, %d) = %d with loop carry, but %d without\n",
+                       name, xx, yy, out_with(xx, yy), out_without(xx, yy));
+                return false;
+            }
+        }
+    }
+
+    double t_with = benchmark([&]() { with_carry.realize(out_with); });
+    double t_without = benchmark([&]() { without_carry.realize(out_without); });
+
+    printf("%s: %f ms with loop carry, %f ms without\n", name, t_with * 1e3, t_without * 1e3);
+
+    // Carrying values trades loads for register pressure. It should
+    // never make things much slower.
+    if (t_with > t_without * 1.2) {
+        printf("%s: loop carry made things slower\n", name);
+        return false;
+    }
+    return true;
+}
+
+int main(int argc, char **argv) {
+    Target target = get_jit_target_from_environment();
+    if (target.arch == Target::WebAssembly) {
+        printf("[SKIP] Performance tests are meaningless and/or misleading under WebAssembly interpreter.\n");
+        return 0;
+    }
+    if (target.arch != Target::X86 && target.arch != Target::ARM) {
+        printf("[SKIP] Loop carrying is only done on x86 and ARM.\n");
+        return 0;
+    }
+
+    Buffer<uint16_t> in(1024 + 32, 1024 + 32);
+    in.for_each_value([](uint16_t &v) { v = rand() & 0xfff; });
+
+    const int vec = target.natural_vector_size<uint16_t>();
+
+    if (!test("blur", blur, in, vec, target) ||
+        !test("stencil_chain", stencil_chain, in, vec, target)) {
+        return 1;
+    }
+
+    printf("Success!\n");
+    return 0;
+}
@@ -0,0 +1,66 @@
+#include "Halide.h"
+#include <cstdio>
+#include <cstdlib>
+
+#include "halide_benchmark.h"
+
+using namespace Halide;
+using namespace Halide::Tools;
+
+// Measures how fast the WebAssembly JIT runs a pipeline, relative to the
+// same pipeline compiled for the host. Run with HL_WASM_ENGINE=wabt or
+// HL_WASM_ENGINE=wasm_c_api to compare the engines, when both are built.
+
+Func make_blur(const Buffer<uint16_t> &input) {
+    Var x("x"), y("y");
+    Func clamped = BoundaryConditions::repeat_edge(input);
+    Func blur_x("blur_x"), blur_y("blur_y");
+    blur_x(x, y) = (clamped(x - 1, y) + clamped(x, y) + clamped(x + 1, y)) / 3;
+    blur_y(x, y) = (blur_x(x, y - 1) + blur_x(x, y) + blur_x(x, y + 1)) / 3;
+
+    blur_x.compute_at(blur_y, y).vectorize(x, 8);
+    blur_y.vectorize(x, 8);
+    return blur_y;
+}
+
+int main(int argc, char **argv) {
+    Target target = get_jit_target_from_environment();
+    if (target.arch != Target::WebAssembly) {
+        printf("[SKIP] This test only measures the WebAssembly JIT.\n");
+        return 0;
+    }
+
+    const int W = 512, H = 512;
+    Buffer<uint16_t> input(W, H);
+    input.for_each_element([&](int x, int y) { input(x, y) = (uint16_t)(rand() & 0xfff); });
+
+    Buffer<uint16_t> wasm_out(W, H), host_out(W, H);
+
+    Pipeline wasm_pipeline(make_blur(input));
+    wasm_pipeline.compile_jit(target);
+
+    Pipeline host_pipeline(make_blur(input));
+    host_pipeline.compile_jit(get_host_target());
+
+    // The interpreter is very slow, so keep the number of runs small.
+    double wasm_time = benchmark(3, 1, [&]() { wasm_pipeline.realize(wasm_out); });
+    double host_time = benchmark(10, 10, [&]() { host_pipeline.realize(host_out); });
+
+    for (int y = 0; y < H; y++) {
+        for (int x = 0; x < W; x++) {
+            if (wasm_out(x, y) != host_out(x, y)) {
+                printf("wasm_out(%d, %d) = %d instead of %d\n", x, y, wasm_out(x, y), host_out(x, y));
+                return 1;
+            }
+        }
+    }
+
+    const char *engine = getenv("HL_WASM_ENGINE");
+    const double megapixels = (double)W * H / 1e6;
+    printf("wasm (%s): %f ms (%f Mpix/s)\n", engine ? engine : "default", wasm_time * 1e3, megapixels / wasm_time);
+    printf("host: %f ms (%f Mpix/s)\n", host_time * 1e3, megapixels / host_time);
+    printf("wasm is %fx slower than host\n", wasm_time / host_time);
+
+    printf("Success!\n");
+    return 0;
+}
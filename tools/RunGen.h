@@ -3,6 +3,8 @@
 #include "halide_benchmark.h"
 #include "halide_image_io.h"
 
+#include <algorithm>
+#include <cmath>
 #include <cstdio>
 #include <cstdlib>
 #include <iomanip>
@@ -13,10 +15,18 @@
 #include <set>
 #include <sstream>
 #include <string>
+#include <thread>
 #include <utility>
 
 #include <vector>
 
+#if defined(__linux__) && __has_include(<linux/perf_event.h>)
+#define HALIDE_RUNGEN_HAS_PERF_EVENTS 1
+#include <linux/perf_event.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
 namespace Halide {
 namespace RunGen {
 
@@ -891,6 +901,191 @@ struct ArgData {
     }
 };
 
+// Options for RunGen::run_for_benchmark(). The defaults just measure
+// the best-case time of a single caller.
+struct BenchmarkOptions {
+    // Minimum time (in seconds) to spend on each measurement.
+    double min_time{Halide::Tools::BenchmarkConfig().min_time};
+
+    // Also time calls individually, and report the distribution of
+    // their latencies.
+    bool latency{false};
+
+    // Number of threads calling the filter at the same time, each with
+    // its own output buffers. Anything other than 1 implies latency.
+    int concurrency{1};
+
+    // Repeat all measurements once per entry, with the thread pool
+    // size set to that entry via halide_set_num_threads(). (This is the
+    // same as re-running with each value of HL_NUM_THREADS.) If empty,
+    // the thread pool size is left alone.
+    std::vector<int> num_threads;
+
+    // Count hardware events during the individually-timed calls. Only
+    // available on Linux, and implies latency.
+    bool perf_counters{false};
+};
+
+// The distribution of the latencies of individual calls, in seconds.
+struct LatencyStats {
+    uint64_t samples{0};
+    double min{0}, mean{0}, p50{0}, p95{0}, p99{0}, max{0};
+};
+
+inline LatencyStats compute_latency_stats(std::vector<double> times) {
+    LatencyStats stats;
+    if (times.empty()) {
+        return stats;
+    }
+    std::sort(times.begin(), times.end());
+    // Nearest-rank percentiles.
+    const auto percentile = [&times](double p) {
+        size_t rank = (size_t)std::ceil(p / 100.0 * times.size());
+        return times[std::max<size_t>(rank, 1) - 1];
+    };
+    stats.samples = times.size();
+    stats.min = times.front();
+    stats.max = times.back();
+    double total = 0;
+    for (double t : times) {
+        total += t;
+    }
+    stats.mean = total / times.size();
+    stats.p50 = percentile(50);
+    stats.p95 = percentile(95);
+    stats.p99 = percentile(99);
+    return stats;
+}
+
+// Hardware event counts, averaged over the calls made while they were
+// being counted.
+struct PerfCounterStats {
+    bool valid{false};
+    double cycles{0}, instructions{0}, cache_references{0}, cache_misses{0}, branch_misses{0};
+
+    double instructions_per_cycle() const {
+        return cycles > 0 ? instructions / cycles : 0;
+    }
+};
+
+// Counts hardware events in this process using perf_event_open(). Threads
+// are only counted if they are created after open() is called, so open the
+// counters before the first call to the filter spins up the thread pool.
+class PerfCounters {
+public:
+    PerfCounters() = default;
+    PerfCounters(const PerfCounters &) = delete;
+    PerfCounters &operator=(const PerfCounters &) = delete;
+
+    ~PerfCounters() {
+        close();
+    }
+
+    // Returns false if any of the counters are unavailable (e.g. on a
+    // non-Linux system, in a VM, or if perf_event_paranoid forbids it).
+    bool open() {
+#ifdef HALIDE_RUNGEN_HAS_PERF_EVENTS
+        static const uint64_t events[kNumEvents] = {
+            PERF_COUNT_HW_CPU_CYCLES,
+            PERF_COUNT_HW_INSTRUCTIONS,
+            PERF_COUNT_HW_CACHE_REFERENCES,
+            PERF_COUNT_HW_CACHE_MISSES,
+            PERF_COUNT_HW_BRANCH_MISSES,
+        };
+        for (int i = 0; i < kNumEvents; i++) {
+            perf_event_attr attr{};
+            attr.size = sizeof(attr);
+            attr.type = PERF_TYPE_HARDWARE;
+            attr.config = events[i];
+            attr.inherit = 1;
+            attr.exclude_kernel = 1;
+            attr.exclude_hv = 1;
+            attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+            fds[i] = (int)syscall(__NR_perf_event_open, &attr, 0, -1, -1, 0);
+            if (fds[i] < 0) {
+                close();
+                return false;
+            }
+        }
+        return true;
+#else
+        return false;
+#endif
+    }
+
+    // Take a snapshot of the counters.
+    std::vector<double> read() const {
+        std::vector<double> values(kNumEvents, 0);
+#ifdef HALIDE_RUNGEN_HAS_PERF_EVENTS
+        for (int i = 0; i < kNumEvents; i++) {
+            uint64_t data[3] = {0, 0, 0};
+            if (fds[i] >= 0 && ::read(fds[i], data, sizeof(data)) == sizeof(data)) {
+                // Scale up the count if the kernel had to multiplex the counters.
+                values[i] = (double)data[0];
+                if (data[2] > 0 && data[2] < data[1]) {
+                    values[i] *= (double)data[1] / (double)data[2];
+                }
+            }
+        }
+#endif
+        return values;
+    }
+
+    // The per-call event counts between two snapshots.
+    static PerfCounterStats difference(const std::vector<double> &before,
+                                       const std::vector<double> &after,
+                                       uint64_t calls) {
+        PerfCounterStats stats;
+        if (calls == 0) {
+            return stats;
+        }
+        const auto per_call = [&](int i) { return (after[i] - before[i]) / calls; };
+        stats.valid = true;
+        stats.cycles = per_call(0);
+        stats.instructions = per_call(1);
+        stats.cache_references = per_call(2);
+        stats.cache_misses = per_call(3);
+        stats.branch_misses = per_call(4);
+        return stats;
+    }
+
+private:
+    static constexpr int kNumEvents = 5;
+    int fds[kNumEvents] = {-1, -1, -1, -1, -1};
+
+    void close() {
+        for (int &fd : fds) {
+#ifdef HALIDE_RUNGEN_HAS_PERF_EVENTS
+            if (fd >= 0) {
+                ::close(fd);
+            }
+#endif
+            fd = -1;
+        }
+    }
+};
+
+// The results of benchmarking with one thread pool size.
+struct BenchmarkStats {
+    // The thread pool size, or zero if it was left alone.
+    int num_threads{0};
+
+    // The number of concurrent callers used to measure latency and
+    // throughput.
+    int concurrency{1};
+
+    // The best-case time of a single caller.
+    Halide::Tools::BenchmarkResult best{0, 0, 0, 0};
+
+    // Only measured if requested; samples is zero otherwise.
+    LatencyStats latency;
+
+    // Aggregate throughput across all callers.
+    double throughput_mpix_per_sec{0};
+
+    PerfCounterStats perf;
+};
+
 class RunGen {
 public:
     using ArgvCall = int (*)(void **);
@@ -1280,37 +1475,126 @@ public:
     }
 
     void run_for_benchmark(double benchmark_min_time) {
-        std::vector<void *> filter_argv = build_filter_argv();
+        BenchmarkOptions options;
+        options.min_time = benchmark_min_time;
+        run_for_benchmark(options);
+    }
 
-        const auto benchmark_inner = [this, &filter_argv]() {
-            // Ignore result since our halide_error() should catch everything.
-            (void)halide_argv_call(&filter_argv[0]);
-            // Ensure that all outputs are finished, otherwise we may just be
-            // measuring how long it takes to do a kernel launch for GPU code.
-            this->device_sync_outputs();
-        };
+    std::vector<BenchmarkStats> run_for_benchmark(const BenchmarkOptions &options) {
+        if (options.concurrency < 1) {
+            fail() << "Benchmark concurrency must be at least 1.";
+        }
+        const bool time_calls = options.latency || options.concurrency > 1 || options.perf_counters;
+
+        // Open the counters before the first call to the filter, so that
+        // they see the threads in the Halide thread pool.
+        PerfCounters counters;
+        const bool use_counters = options.perf_counters && counters.open();
+        if (options.perf_counters && !use_counters) {
+            warn() << "Hardware performance counters are not available on this system.";
+        }
 
-        info() << "Benchmarking filter...";
+        // The first caller uses our own output buffers; the rest get
+        // their own, so that concurrent calls don't write to the same memory.
+        std::vector<Caller> callers;
+        for (int i = 0; i < (time_calls ? options.concurrency : 1); i++) {
+            callers.push_back(make_caller(i > 0));
+        }
 
-        Halide::Tools::BenchmarkConfig config;
-        config.min_time = benchmark_min_time;
-        config.max_time = benchmark_min_time * 4;
-        auto result = Halide::Tools::benchmark(benchmark_inner, config);
+        std::vector<int> sweep = options.num_threads;
+        if (sweep.empty()) {
+            sweep.push_back(0);
+        }
+        int default_num_threads = -1;
+
+        std::vector<BenchmarkStats> results;
+        for (int num_threads : sweep) {
+            BenchmarkStats stats;
+            stats.num_threads = num_threads;
+            stats.concurrency = options.concurrency;
+            if (num_threads > 0) {
+                int previous = halide_set_num_threads(num_threads);
+                if (default_num_threads < 0) {
+                    default_num_threads = previous;
+                }
+                info() << "Benchmarking filter with " << num_threads << " threads...";
+            } else {
+                info() << "Benchmarking filter...";
+            }
 
-        if (!parsable_output) {
-            out() << "Benchmark for " << md->name << " produces best case of " << result.wall_time << " sec/iter (over "
-                  << result.samples << " samples, "
-                  << result.iterations << " iterations, "
-                  << "accuracy " << std::setprecision(2) << (result.accuracy * 100.0) << "%).\n"
-                  << "Best output throughput is " << (megapixels_out() / result.wall_time) << " mpix/sec.\n";
-        } else {
-            out() << md->name << "  BEST_TIME_MSEC_PER_ITER  " << result.wall_time * 1000.f << "\n"
-                  << md->name << "  SAMPLES                  " << result.samples << "\n"
-                  << md->name << "  ITERATIONS               " << result.iterations << "\n"
-                  << md->name << "  TIMING_ACCURACY          " << result.accuracy << "\n"
-                  << md->name << "  THROUGHPUT_MPIX_PER_SEC  " << (megapixels_out() / result.wall_time) << "\n"
-                  << md->name << "  HALIDE_TARGET            " << md->target << "\n";
+            Halide::Tools::BenchmarkConfig config;
+            config.min_time = options.min_time;
+            config.max_time = options.min_time * 4;
+            stats.best = Halide::Tools::benchmark([&]() { callers[0].call(halide_argv_call); }, config);
+            stats.throughput_mpix_per_sec = megapixels_out() / stats.best.wall_time;
+
+            if (time_calls) {
+                double wall_time = 0;
+                std::vector<double> latencies = run_timed_calls(callers, options.min_time, &wall_time,
+                                                                use_counters ? &counters : nullptr, &stats.perf);
+                stats.latency = compute_latency_stats(latencies);
+                stats.throughput_mpix_per_sec = megapixels_out() * latencies.size() / wall_time;
+            }
+
+            report_benchmark(stats, sweep.size() > 1 || num_threads > 0);
+            results.push_back(stats);
+        }
+
+        if (default_num_threads >= 0) {
+            halide_set_num_threads(default_num_threads);
+        }
+        return results;
+    }
+
+    // Emit the results of run_for_benchmark() as a JSON object.
+    void write_benchmark_json(std::ostream &o, const std::vector<BenchmarkStats> &results) const {
+        // JSON has no representation for inf or nan.
+        const auto number = [](double d) {
+            std::ostringstream s;
+            if (std::isfinite(d)) {
+                s << std::setprecision(9) << d;
+            } else {
+                s << "null";
+            }
+            return s.str();
+        };
+        o << "{\n"
+          << "  \"name\": \"" << md->name << "\",\n"
+          << "  \"target\": \"" << md->target << "\",\n"
+          << "  \"megapixels_out\": " << number(megapixels_out()) << ",\n"
+          << "  \"results\": [";
+        for (size_t i = 0; i < results.size(); i++) {
+            const BenchmarkStats &r = results[i];
+            o << (i > 0 ? "," : "") << "\n    {\n"
+              << "      \"num_threads\": " << r.num_threads << ",\n"
+              << "      \"concurrency\": " << r.concurrency << ",\n"
+              << "      \"best_time_sec\": " << number(r.best.wall_time) << ",\n"
+              << "      \"samples\": " << r.best.samples << ",\n"
+              << "      \"iterations\": " << r.best.iterations << ",\n"
+              << "      \"accuracy\": " << number(r.best.accuracy) << ",\n"
+              << "      \"throughput_mpix_per_sec\": " << number(r.throughput_mpix_per_sec);
+            if (r.latency.samples > 0) {
+                o << ",\n      \"latency_sec\": {"
+                  << "\"samples\": " << r.latency.samples << ", "
+                  << "\"min\": " << number(r.latency.min) << ", "
+                  << "\"mean\": " << number(r.latency.mean) << ", "
+                  << "\"p50\": " << number(r.latency.p50) << ", "
+                  << "\"p95\": " << number(r.latency.p95) << ", "
+                  << "\"p99\": " << number(r.latency.p99) << ", "
+                  << "\"max\": " << number(r.latency.max) << "}";
+            }
+            if (r.perf.valid) {
+                o << ",\n      \"perf_counters_per_call\": {"
+                  << "\"cycles\": " << number(r.perf.cycles) << ", "
+                  << "\"instructions\": " << number(r.perf.instructions) << ", "
+                  << "\"instructions_per_cycle\": " << number(r.perf.instructions_per_cycle()) << ", "
+                  << "\"cache_references\": " << number(r.perf.cache_references) << ", "
+                  << "\"cache_misses\": " << number(r.perf.cache_misses) << ", "
+                  << "\"branch_misses\": " << number(r.perf.branch_misses) << "}";
+            }
+            o << "\n    }";
         }
+        o << "\n  ]\n}\n";
     }
 
     struct Output {
@@ -1392,6 +1676,172 @@ public:
     }
 
 private:
+    // Everything needed for one thread to call the filter.
+    struct Caller {
+        std::vector<void *> argv;
+        // Output buffers allocated just for this caller. (The argv points
+        // into these, so they must not be reallocated once filled in.)
+        std::vector<Buffer<>> own_outputs;
+        std::vector<Buffer<> *> outputs;
+
+        void call(ArgvCall argv_call) {
+            // Ignore result since our halide_error() should catch everything.
+            (void)argv_call(&argv[0]);
+            // Ensure that all outputs are finished, otherwise we may just be
+            // measuring how long it takes to do a kernel launch for GPU code.
+            for (auto *b : outputs) {
+                b->device_sync();
+            }
+        }
+    };
+
+    Caller make_caller(bool own_outputs) {
+        Caller caller;
+        caller.argv = build_filter_argv();
+        caller.own_outputs.reserve(args.size());
+        for (auto &arg_pair : args) {
+            auto &arg = arg_pair.second;
+            if (arg.metadata->kind != halide_argument_kind_output_buffer) {
+                continue;
+            }
+            if (own_outputs) {
+                caller.own_outputs.push_back(allocate_buffer(arg.buffer_value.type(), get_shape(arg.buffer_value)));
+                Buffer<> &b = caller.own_outputs.back();
+                b.set_host_dirty(false);
+                caller.argv[arg.index] = b.raw_buffer();
+                caller.outputs.push_back(&b);
+            } else {
+                caller.outputs.push_back(&arg.buffer_value);
+            }
+        }
+        return caller;
+    }
+
+    // Call the filter from all the callers at once, timing each call, for
+    // at least min_time seconds. Returns the latencies of all the calls,
+    // and the wall-clock time taken in *wall_time. If counters is non-null,
+    // *perf gets what they counted over the timed calls alone.
+    std::vector<double> run_timed_calls(std::vector<Caller> &callers, double min_time, double *wall_time,
+                                        PerfCounters *counters, PerfCounterStats *perf) {
+        // Enough calls for the tail percentiles to mean something, but
+        // don't run for much longer than asked to get them.
+        constexpr size_t kMinCalls = 100;
+        const double max_time = min_time * 4;
+
+        // Warm up each caller, so that first-call costs (e.g. allocating
+        // a scratch buffer) don't land in the tail.
+        for (auto &caller : callers) {
+            caller.call(halide_argv_call);
+        }
+
+        std::vector<std::vector<double>> latencies(callers.size());
+        const auto run = [&](size_t i) {
+            const auto start = Halide::Tools::benchmark_now();
+            double elapsed = 0;
+            while (latencies[i].empty() ||
+                   (elapsed < max_time && (elapsed < min_time || latencies[i].size() < kMinCalls))) {
+                const auto call_start = Halide::Tools::benchmark_now();
+                callers[i].call(halide_argv_call);
+                const auto call_end = Halide::Tools::benchmark_now();
+                latencies[i].push_back(Halide::Tools::benchmark_duration_seconds(call_start, call_end));
+                elapsed = Halide::Tools::benchmark_duration_seconds(start, call_end);
+            }
+        };
+
+        // Snapshot the counters after the warm-up, so they only see the
+        // timed calls.
+        std::vector<double> before;
+        if (counters) {
+            before = counters->read();
+        }
+
+        const auto start = Halide::Tools::benchmark_now();
+        std::vector<std::thread> threads;
+        for (size_t i = 1; i < callers.size(); i++) {
+            threads.emplace_back(run, i);
+        }
+        run(0);
+        for (auto &t : threads) {
+            t.join();
+        }
+        *wall_time = Halide::Tools::benchmark_duration_seconds(start, Halide::Tools::benchmark_now());
+
+        std::vector<double> all;
+        for (const auto &l : latencies) {
+            all.insert(all.end(), l.begin(), l.end());
+        }
+        if (counters) {
+            *perf = PerfCounters::difference(before, counters->read(), all.size());
+        }
+        return all;
+    }
+
+    void report_benchmark(const BenchmarkStats &stats, bool show_num_threads) const {
+        const auto &result = stats.best;
+        if (!parsable_output) {
+            std::ostringstream o;
+            if (show_num_threads) {
+                o << "With " << stats.num_threads << " threads:\n";
+            }
+            o << "Benchmark for " << md->name << " produces best case of " << result.wall_time << " sec/iter (over "
+              << result.samples << " samples, "
+              << result.iterations << " iterations, "
+              << "accuracy " << std::setprecision(2) << (result.accuracy * 100.0) << "%).\n";
+            if (stats.latency.samples > 0) {
+                o << std::setprecision(6)
+                  << "Latency over " << stats.latency.samples << " calls from " << stats.concurrency << " callers is "
+                  << "p50 " << stats.latency.p50 << " sec, "
+                  << "p95 " << stats.latency.p95 << " sec, "
+                  << "p99 " << stats.latency.p99 << " sec, "
+                  << "max " << stats.latency.max << " sec.\n"
+                  << "Output throughput is " << stats.throughput_mpix_per_sec << " mpix/sec.\n";
+            } else {
+                o << "Best output throughput is " << stats.throughput_mpix_per_sec << " mpix/sec.\n";
+            }
+            if (stats.perf.valid) {
+                o << std::setprecision(6)
+                  << "Per call: " << stats.perf.cycles << " cycles, "
+                  << stats.perf.instructions << " instructions ("
+                  << stats.perf.instructions_per_cycle() << " IPC), "
+                  << stats.perf.cache_misses << " cache misses of "
+                  << stats.perf.cache_references << " references, "
+                  << stats.perf.branch_misses << " branch misses.\n";
+            }
+            out() << o.str();
+        } else {
+            std::ostringstream o;
+            const auto line = [&](const char *key, auto value) {
+                o << md->name << "  " << std::left << std::setw(25) << key << value << "\n";
+            };
+            if (show_num_threads) {
+                line("NUM_THREADS", stats.num_threads);
+            }
+            line("BEST_TIME_MSEC_PER_ITER", result.wall_time * 1000.f);
+            line("SAMPLES", result.samples);
+            line("ITERATIONS", result.iterations);
+            line("TIMING_ACCURACY", result.accuracy);
+            line("THROUGHPUT_MPIX_PER_SEC", stats.throughput_mpix_per_sec);
+            if (stats.latency.samples > 0) {
+                line("CONCURRENCY", stats.concurrency);
+                line("LATENCY_SAMPLES", stats.latency.samples);
+                line("LATENCY_P50_MSEC", stats.latency.p50 * 1000);
+                line("LATENCY_P95_MSEC", stats.latency.p95 * 1000);
+                line("LATENCY_P99_MSEC", stats.latency.p99 * 1000);
+                line("LATENCY_MAX_MSEC", stats.latency.max * 1000);
+            }
+            if (stats.perf.valid) {
+                line("CYCLES_PER_CALL", stats.perf.cycles);
+                line("INSTRUCTIONS_PER_CALL", stats.perf.instructions);
+                line("IPC", stats.perf.instructions_per_cycle());
+                line("CACHE_MISSES_PER_CALL", stats.perf.cache_misses);
+                line("CACHE_REFS_PER_CALL", stats.perf.cache_references);
+                line("BRANCH_MISSES_PER_CALL", stats.perf.branch_misses);
+            }
+            o << md->name << "  HALIDE_TARGET            " << md->target << "\n";
+            out() << o.str();
+        }
+    }
+
     static void rungen_ignore_error(void *user_context, const char *message) {
         // nothing
     }
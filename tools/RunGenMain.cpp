@@ -1,7 +1,8 @@
 #include "RunGen.h"
 
+#include <fstream>
+
 using namespace Halide::RunGen;
-using Halide::Tools::BenchmarkConfig;
 
 namespace {
 
@@ -142,6 +143,29 @@ Flags:
         Override the default minimum desired benchmarking time; ignored if
         --benchmarks is not also specified.
 
+    --benchmark_latency:
+        Also time a series of individual calls to the filter, and report the
+        p50, p95 and p99 latencies; ignored if --benchmarks is not also
+        specified.
+
+    --benchmark_concurrency=NUM [default = 1]:
+        Measure latency and total throughput with NUM threads calling the
+        filter at once, each with its own output buffers. Implies
+        --benchmark_latency.
+
+    --benchmark_num_threads=NUM,NUM,...:
+        Repeat the benchmark once for each given size of the Halide thread
+        pool (as if HL_NUM_THREADS had been set to each value in turn), to
+        see how the filter scales.
+
+    --perf_counters:
+        Count cycles, instructions, cache misses and branch misses per call
+        during the latency measurement, using perf_event_open(). Linux only;
+        implies --benchmark_latency.
+
+    --benchmark_json=PATH:
+        Also write all benchmark results to PATH as JSON ("-" for stdout).
+
     --track_memory:
         Override Halide memory allocator to track high-water mark of memory
         allocation during run; note that this may slow down execution, so
@@ -398,7 +422,8 @@ int main(int argc, char **argv) {
     bool benchmark = false;
     bool track_memory = false;
     bool describe = false;
-    double benchmark_min_time = BenchmarkConfig().min_time;
+    BenchmarkOptions benchmark_options;
+    std::string benchmark_json;
     std::string default_input_buffers;
     std::string default_input_scalars;
     std::string benchmarks_flag_value;
@@ -461,7 +486,40 @@ int main(int argc, char **argv) {
                 benchmarks_flag_value = flag_value;
                 benchmark = true;
             } else if (flag_name == "benchmark_min_time") {
-                if (!parse_scalar(flag_value, &benchmark_min_time)) {
+                if (!parse_scalar(flag_value, &benchmark_options.min_time)) {
+                    fail() << "Invalid value for flag: " << flag_name;
+                }
+            } else if (flag_name == "benchmark_latency") {
+                if (flag_value.empty()) {
+                    flag_value = "true";
+                }
+                if (!parse_scalar(flag_value, &benchmark_options.latency)) {
+                    fail() << "Invalid value for flag: " << flag_name;
+                }
+            } else if (flag_name == "benchmark_concurrency") {
+                if (!parse_scalar(flag_value, &benchmark_options.concurrency) ||
+                    benchmark_options.concurrency < 1) {
+                    fail() << "Invalid value for flag: " << flag_name;
+                }
+            } else if (flag_name == "benchmark_num_threads") {
+                benchmark_options.num_threads.clear();
+                for (const auto &s : split_string(flag_value, ",")) {
+                    int n;
+                    if (!parse_scalar(s, &n) || n < 1) {
+                        fail() << "Invalid value for flag: " << flag_name;
+                    }
+                    benchmark_options.num_threads.push_back(n);
+                }
+            } else if (flag_name == "perf_counters") {
+                if (flag_value.empty()) {
+                    flag_value = "true";
+                }
+                if (!parse_scalar(flag_value, &benchmark_options.perf_counters)) {
+                    fail() << "Invalid value for flag: " << flag_name;
+                }
+            } else if (flag_name == "benchmark_json") {
+                benchmark_json = flag_value;
+                if (benchmark_json.empty()) {
                     fail() << "Invalid value for flag: " << flag_name;
                 }
             } else if (flag_name == "default_input_buffers") {
@@ -616,7 +674,16 @@ int main(int argc, char **argv) {
         if (benchmarks_flag_value != "all") {
             fail() << "The only valid value for --benchmarks is 'all'";
         }
-        r.run_for_benchmark(benchmark_min_time);
+        std::vector<BenchmarkStats> results = r.run_for_benchmark(benchmark_options);
+        if (benchmark_json == "-") {
+            r.write_benchmark_json(std::cout, results);
+        } else if (!benchmark_json.empty()) {
+            std::ofstream f(benchmark_json);
+            r.write_benchmark_json(f, results);
+            if (!f) {
+                fail() << "Unable to write benchmark results to: " << benchmark_json;
+            }
+        }
     } else {
         r.run_for_output();
     }
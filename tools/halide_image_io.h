@@ -5,16 +5,20 @@
 #define HALIDE_IMAGE_IO_H
 
 #include <algorithm>
+#include <atomic>
 #include <cctype>
 #include <cmath>
 #include <cstdarg>
 #include <cstddef>
 #include <cstdio>
 #include <cstdlib>
+#include <cstring>
 #include <functional>
 #include <map>
+#include <memory>
 #include <set>
 #include <string>
+#include <thread>
 #include <vector>
 
 #ifndef HALIDE_NO_PNG
@@ -31,6 +35,13 @@
 #include "jpeglib.h"
 #endif
 
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
 #include "HalideRuntime.h"  // for halide_type_t
 
 namespace Halide {
@@ -60,6 +71,14 @@ struct FormatInfo {
     }
 };
 
+// The type and shape of a .chunked file (see create_chunked()), which
+// stores an image too large to hold in memory as a grid of chunks of
+// chunk_extent elements in each dimension.
+struct ChunkedFileInfo {
+    halide_type_t type;
+    std::vector<int> min, extent, chunk_extent;
+};
+
 namespace Internal {
 
 typedef bool (*CheckFunc)(bool condition, const char *msg);
@@ -696,27 +715,142 @@ struct FileOpener {
 
 constexpr int AnyDims = -1;
 
+// Whether the calling thread is running tasks of a parallel_for. This lives
+// outside of parallel_for so that all of its instantiations share it.
+inline bool &in_parallel_for() {
+    thread_local bool flag = false;
+    return flag;
+}
+
+// The number of threads for_each_row may use; see set_image_io_num_threads().
+inline std::atomic<int> &row_num_threads() {
+    static std::atomic<int> num_threads{1};
+    return num_threads;
+}
+
+// Call f(i) for each i in [0, n), spread across up to num_threads threads
+// (including the calling one). If num_threads is zero, use one thread per core.
+// Nested calls (e.g. decoding the rows of one image of a batch) run serially
+// rather than oversubscribing the machine.
+template<typename Fn>
+void parallel_for(int n, int num_threads, const Fn &f) {
+    if (num_threads <= 0) {
+        num_threads = std::max(1, (int)std::thread::hardware_concurrency());
+    }
+    num_threads = std::min(num_threads, n);
+    if (num_threads <= 1 || in_parallel_for()) {
+        for (int i = 0; i < n; i++) {
+            f(i);
+        }
+        return;
+    }
+    std::atomic<int> next{0};
+    const auto worker = [&]() {
+        in_parallel_for() = true;
+        for (int i = next++; i < n; i = next++) {
+            f(i);
+        }
+        in_parallel_for() = false;
+    };
+    std::vector<std::thread> threads;
+    for (int t = 1; t < num_threads; t++) {
+        threads.emplace_back(worker);
+    }
+    worker();
+    for (auto &t : threads) {
+        t.join();
+    }
+}
+
+// Call f(y) for each row y in [ymin, ymax]. If more than one thread has been
+// allowed with set_image_io_num_threads(), the rows are spread over them
+// when they add up to enough bytes to be worth it.
+template<typename Fn>
+void for_each_row(int ymin, int ymax, size_t bytes_per_row, const Fn &f) {
+    constexpr size_t min_bytes_per_task = 256 * 1024;
+    const int rows_per_task = (int)std::max<size_t>(1, min_bytes_per_task / std::max<size_t>(1, bytes_per_row));
+    const int tasks = (ymax - ymin + rows_per_task) / rows_per_task;
+    parallel_for(tasks, row_num_threads(), [&](int t) {
+        const int y_end = std::min(ymax, ymin + (t + 1) * rows_per_task - 1);
+        for (int y = ymin + t * rows_per_task; y <= y_end; y++) {
+            f(y);
+        }
+    });
+}
+
+// Copy width pixels of Channels interleaved big-endian elements from src
+// into an image row. Successive pixels of the row are x_stride elements
+// apart, and channels c_stride elements apart. When Channels is known at
+// compile time and x_stride is one (i.e. a planar image), the compiler can
+// vectorize the deinterleave.
+template<typename ElemType, int Channels>
+void read_big_endian_pixels(const uint8_t *src, ElemType *dst, int width, int x_stride, int c_stride) {
+    for (int c = 0; c < Channels; c++) {
+        const uint8_t *s = src + c * sizeof(ElemType);
+        ElemType *d = dst + c * c_stride;
+        if (x_stride == 1) {
+            for (int x = 0; x < width; x++) {
+                d[x] = read_big_endian<ElemType>(s + x * Channels * sizeof(ElemType));
+            }
+        } else {
+            for (int x = 0; x < width; x++) {
+                d[x * x_stride] = read_big_endian<ElemType>(s + x * Channels * sizeof(ElemType));
+            }
+        }
+    }
+}
+
+// The inverse of read_big_endian_pixels.
+template<typename ElemType, int Channels>
+void write_big_endian_pixels(const ElemType *src, int width, int x_stride, int c_stride, uint8_t *dst) {
+    for (int c = 0; c < Channels; c++) {
+        const ElemType *s = src + c * c_stride;
+        uint8_t *d = dst + c * sizeof(ElemType);
+        if (x_stride == 1) {
+            for (int x = 0; x < width; x++) {
+                write_big_endian<ElemType>(s[x], d + x * Channels * sizeof(ElemType));
+            }
+        } else {
+            for (int x = 0; x < width; x++) {
+                write_big_endian<ElemType>(s[x * x_stride], d + x * Channels * sizeof(ElemType));
+            }
+        }
+    }
+}
+
 // Read a row of ElemTypes from a byte buffer and copy them into a specific image row.
 // Multibyte elements are assumed to be big-endian.
 template<typename ElemType, typename ImageType>
 void read_big_endian_row(const uint8_t *src, int y, ImageType *im) {
     auto im_typed = im->template as<ElemType, AnyDims>();
     const int xmin = im_typed.dim(0).min();
-    const int xmax = im_typed.dim(0).max();
+    const int width = im_typed.dim(0).extent();
+    const int x_stride = im_typed.dim(0).stride();
     if (im_typed.dimensions() > 2) {
         const int cmin = im_typed.dim(2).min();
-        const int cmax = im_typed.dim(2).max();
-        for (int x = xmin; x <= xmax; x++) {
-            for (int c = cmin; c <= cmax; c++) {
-                im_typed(x, y, c + cmin) = read_big_endian<ElemType>(src);
-                src += sizeof(ElemType);
+        const int channels = im_typed.dim(2).extent();
+        const int c_stride = im_typed.dim(2).stride();
+        ElemType *dst = &im_typed(xmin, y, cmin);
+        switch (channels) {
+        case 2:
+            read_big_endian_pixels<ElemType, 2>(src, dst, width, x_stride, c_stride);
+            break;
+        case 3:
+            read_big_endian_pixels<ElemType, 3>(src, dst, width, x_stride, c_stride);
+            break;
+        case 4:
+            read_big_endian_pixels<ElemType, 4>(src, dst, width, x_stride, c_stride);
+            break;
+        default:
+            for (int x = 0; x < width; x++) {
+                for (int c = 0; c < channels; c++) {
+                    dst[x * x_stride + c * c_stride] = read_big_endian<ElemType>(src);
+                    src += sizeof(ElemType);
+                }
             }
         }
     } else {
-        for (int x = xmin; x <= xmax; x++) {
-            im_typed(x, y) = read_big_endian<ElemType>(src);
-            src += sizeof(ElemType);
-        }
+        read_big_endian_pixels<ElemType, 1>(src, &im_typed(xmin, y), width, x_stride, 0);
     }
 }
 
@@ -726,24 +860,61 @@ template<typename ElemType, typename ImageType>
 void write_big_endian_row(const ImageType &im, int y, uint8_t *dst) {
     auto im_typed = im.template as<typename std::add_const<ElemType>::type, AnyDims>();
     const int xmin = im_typed.dim(0).min();
-    const int xmax = im_typed.dim(0).max();
+    const int width = im_typed.dim(0).extent();
+    const int x_stride = im_typed.dim(0).stride();
     if (im_typed.dimensions() > 2) {
         const int cmin = im_typed.dim(2).min();
-        const int cmax = im_typed.dim(2).max();
-        for (int x = xmin; x <= xmax; x++) {
-            for (int c = cmin; c <= cmax; c++) {
-                write_big_endian<ElemType>(im_typed(x, y, c), dst);
-                dst += sizeof(ElemType);
+        const int channels = im_typed.dim(2).extent();
+        const int c_stride = im_typed.dim(2).stride();
+        const ElemType *src = &im_typed(xmin, y, cmin);
+        switch (channels) {
+        case 2:
+            write_big_endian_pixels<ElemType, 2>(src, width, x_stride, c_stride, dst);
+            break;
+        case 3:
+            write_big_endian_pixels<ElemType, 3>(src, width, x_stride, c_stride, dst);
+            break;
+        case 4:
+            write_big_endian_pixels<ElemType, 4>(src, width, x_stride, c_stride, dst);
+            break;
+        default:
+            for (int x = 0; x < width; x++) {
+                for (int c = 0; c < channels; c++) {
+                    write_big_endian<ElemType>(src[x * x_stride + c * c_stride], dst);
+                    dst += sizeof(ElemType);
+                }
             }
         }
     } else {
-        for (int x = xmin; x <= xmax; x++) {
-            write_big_endian<ElemType>(im_typed(x, y), dst);
-            dst += sizeof(ElemType);
-        }
+        write_big_endian_pixels<ElemType, 1>(&im_typed(xmin, y), width, x_stride, 0, dst);
     }
 }
 
+// Decode or encode a whole image through an interleaved, big-endian staging
+// buffer with one row per row of the image, converting the rows in parallel.
+template<typename ImageType>
+void read_big_endian_rows(const std::vector<uint8_t> &src, size_t bytes_per_row, int bit_depth, ImageType *im) {
+    auto copy_to_image = bit_depth == 8 ?
+                             read_big_endian_row<uint8_t, ImageType> :
+                             read_big_endian_row<uint16_t, ImageType>;
+    const int ymin = im->dim(1).min();
+    for_each_row(ymin, im->dim(1).max(), bytes_per_row, [&](int y) {
+        copy_to_image(src.data() + (y - ymin) * bytes_per_row, y, im);
+    });
+}
+
+template<typename ImageType>
+void write_big_endian_rows(const ImageType &im, size_t bytes_per_row, int bit_depth, std::vector<uint8_t> *dst) {
+    auto copy_from_image = bit_depth == 8 ?
+                               write_big_endian_row<uint8_t, ImageType> :
+                               write_big_endian_row<uint16_t, ImageType>;
+    const int ymin = im.dim(1).min();
+    dst->resize(bytes_per_row * im.dim(1).extent());
+    for_each_row(ymin, im.dim(1).max(), bytes_per_row, [&](int y) {
+        copy_from_image(im, y, dst->data() + (y - ymin) * bytes_per_row);
+    });
+}
+
 #ifndef HALIDE_NO_PNG
 
 template<typename ImageType, Internal::CheckFunc check = Internal::CheckReturn>
@@ -798,17 +969,16 @@ bool load_png(const std::string &filename, ImageType *im) {
 
     png_read_update_info(png_ptr, info_ptr);
 
-    auto copy_to_image = bit_depth == 8 ?
-                             Internal::read_big_endian_row<uint8_t, ImageType> :
-                             Internal::read_big_endian_row<uint16_t, ImageType>;
-
-    std::vector<uint8_t> row(png_get_rowbytes(png_ptr, info_ptr));
-    const int ymin = im->dim(1).min();
-    const int ymax = im->dim(1).max();
-    for (int y = ymin; y <= ymax; ++y) {
-        png_read_row(png_ptr, row.data(), nullptr);
-        copy_to_image(row.data(), y, im);
+    // Decoding is inherently serial, so decode the whole image and then
+    // convert the rows in parallel.
+    const size_t bytes_per_row = png_get_rowbytes(png_ptr, info_ptr);
+    std::vector<uint8_t> data(bytes_per_row * height);
+    std::vector<png_bytep> rows(height);
+    for (int y = 0; y < height; y++) {
+        rows[y] = data.data() + y * bytes_per_row;
     }
+    png_read_image(png_ptr, rows.data());
+    Internal::read_big_endian_rows(data, bytes_per_row, bit_depth, im);
 
     png_destroy_read_struct(&png_ptr, &info_ptr, nullptr);
 
@@ -881,16 +1051,12 @@ bool save_png(ImageType &im, const std::string &filename) {
 
     png_write_info(png_ptr, info_ptr);
 
-    auto copy_from_image = bit_depth == 8 ?
-                               Internal::write_big_endian_row<uint8_t, ImageType> :
-                               Internal::write_big_endian_row<uint16_t, ImageType>;
-
-    std::vector<uint8_t> row(png_get_rowbytes(png_ptr, info_ptr));
-    const int ymin = im.dim(1).min();
-    const int ymax = im.dim(1).max();
-    for (int y = ymin; y <= ymax; ++y) {
-        copy_from_image(im, y, row.data());
-        png_write_row(png_ptr, row.data());
+    // Convert the rows in parallel, then encode them.
+    const size_t bytes_per_row = png_get_rowbytes(png_ptr, info_ptr);
+    std::vector<uint8_t> data;
+    Internal::write_big_endian_rows(im, bytes_per_row, bit_depth, &data);
+    for (int y = 0; y < height; y++) {
+        png_write_row(png_ptr, data.data() + y * bytes_per_row);
     }
     png_write_end(png_ptr, nullptr);
     png_destroy_write_struct(&png_ptr, &info_ptr);
@@ -954,19 +1120,12 @@ bool load_pnm(const std::string &filename, int channels, ImageType *im) {
     }
     *im = ImageType(im_type, im_dimensions);
 
-    auto copy_to_image = bit_depth == 8 ?
-                             Internal::read_big_endian_row<uint8_t, ImageType> :
-                             Internal::read_big_endian_row<uint16_t, ImageType>;
-
-    std::vector<uint8_t> row(width * channels * (bit_depth / 8));
-    const int ymin = im->dim(1).min();
-    const int ymax = im->dim(1).max();
-    for (int y = ymin; y <= ymax; ++y) {
-        if (!check(f.read_vector(&row), "Could not read data")) {
-            return false;
-        }
-        copy_to_image(row.data(), y, im);
+    const size_t bytes_per_row = (size_t)width * channels * (bit_depth / 8);
+    std::vector<uint8_t> data(bytes_per_row * height);
+    if (!check(f.read_vector(&data), "Could not read data")) {
+        return false;
     }
+    Internal::read_big_endian_rows(data, bytes_per_row, bit_depth, im);
 
     return true;
 }
@@ -995,18 +1154,11 @@ bool save_pnm(ImageType &im, const int channels, const std::string &filename) {
     const char *hdr_fmt = channels == 3 ? "P6" : "P5";
     fprintf(f.f, "%s\n%d %d\n%d\n", hdr_fmt, width, height, (1 << bit_depth) - 1);
 
-    auto copy_from_image = bit_depth == 8 ?
-                               Internal::write_big_endian_row<uint8_t, ImageType> :
-                               Internal::write_big_endian_row<uint16_t, ImageType>;
-
-    std::vector<uint8_t> row(width * channels * (bit_depth / 8));
-    const int ymin = im.dim(1).min();
-    const int ymax = im.dim(1).max();
-    for (int y = ymin; y <= ymax; ++y) {
-        copy_from_image(im, y, row.data());
-        if (!check(f.write_vector(row), "Could not write data")) {
-            return false;
-        }
+    const size_t bytes_per_row = (size_t)width * channels * (bit_depth / 8);
+    std::vector<uint8_t> data;
+    Internal::write_big_endian_rows(im, bytes_per_row, bit_depth, &data);
+    if (!check(f.write_vector(data), "Could not write data")) {
+        return false;
     }
 
     return true;
@@ -1078,16 +1230,18 @@ bool load_jpg(const std::string &filename, ImageType *im) {
     }
     *im = ImageType(im_type, im_dimensions);
 
-    auto copy_to_image = Internal::read_big_endian_row<uint8_t, ImageType>;
-
-    std::vector<uint8_t> row(width * channels);
-    const int ymin = im->dim(1).min();
-    const int ymax = im->dim(1).max();
-    for (int y = ymin; y <= ymax; ++y) {
-        uint8_t *src = row.data();
-        jpeg_read_scanlines(&cinfo, &src, 1);
-        copy_to_image(row.data(), y, im);
+    // Decoding is inherently serial, so decode the whole image and then
+    // convert the rows in parallel.
+    const size_t bytes_per_row = (size_t)width * channels;
+    std::vector<uint8_t> data(bytes_per_row * height);
+    std::vector<JSAMPROW> rows(height);
+    for (int y = 0; y < height; y++) {
+        rows[y] = data.data() + y * bytes_per_row;
     }
+    while (cinfo.output_scanline < cinfo.output_height) {
+        jpeg_read_scanlines(&cinfo, &rows[cinfo.output_scanline], cinfo.output_height - cinfo.output_scanline);
+    }
+    Internal::read_big_endian_rows(data, bytes_per_row, 8, im);
 
     jpeg_finish_decompress(&cinfo);
     jpeg_destroy_decompress(&cinfo);
@@ -1139,15 +1293,16 @@ bool save_jpg(ImageType &im, const std::string &filename) {
     jpeg_set_quality(&cinfo, quality, TRUE);
     jpeg_start_compress(&cinfo, TRUE);
 
-    auto copy_from_image = Internal::write_big_endian_row<uint8_t, ImageType>;
-
-    std::vector<uint8_t> row(width * channels);
-    const int ymin = im.dim(1).min();
-    const int ymax = im.dim(1).max();
-    for (int y = ymin; y <= ymax; ++y) {
-        uint8_t *dst = row.data();
-        copy_from_image(im, y, dst);
-        jpeg_write_scanlines(&cinfo, &dst, 1);
+    // Convert the rows in parallel, then encode them.
+    const size_t bytes_per_row = (size_t)width * channels;
+    std::vector<uint8_t> data;
+    Internal::write_big_endian_rows(im, bytes_per_row, 8, &data);
+    std::vector<JSAMPROW> rows(height);
+    for (int y = 0; y < height; y++) {
+        rows[y] = data.data() + y * bytes_per_row;
+    }
+    while (cinfo.next_scanline < cinfo.image_height) {
+        jpeg_write_scanlines(&cinfo, &rows[cinfo.next_scanline], cinfo.image_height - cinfo.next_scanline);
     }
 
     jpeg_finish_compress(&cinfo);
@@ -1180,7 +1335,7 @@ inline const halide_type_t *tmp_code_to_halide_type() {
 template<typename ImageType>
 bool buffer_is_compact_planar(ImageType &im) {
     const halide_type_t im_type = im.type();
-    const size_t elem_size = (im_type.bits / 8);
+    const size_t elem_size = (im_type.bits + 7) / 8;
     if (((const uint8_t *)im.begin() + (im.number_of_elements() * elem_size)) != (const uint8_t *)im.end()) {
         return false;
     }
@@ -1687,6 +1842,350 @@ bool save_mat(ImageType &im, const std::string &filename) {
     return true;
 }
 
+// ".npy" is numpy's array format, documented here:
+// https://numpy.org/doc/stable/reference/generated/numpy.lib.format.html
+// Arrays in C order have their shape reversed on the way in and out, so
+// that the last numpy axis is the innermost Halide dimension. Only the
+// host's byte order is supported.
+
+inline bool host_is_little_endian() {
+    const uint16_t one = 1;
+    return *(const uint8_t *)&one == 1;
+}
+
+// Return the numpy dtype string for a type, or an empty string if there
+// isn't one.
+inline std::string npy_descr(halide_type_t type) {
+    const int bytes = (type.bits + 7) / 8;
+    char kind;
+    switch (type.code) {
+    case halide_type_int:
+        kind = 'i';
+        break;
+    case halide_type_uint:
+        kind = type.bits == 1 ? 'b' : 'u';
+        break;
+    case halide_type_float:
+        kind = type.bits >= 16 ? 'f' : 0;
+        break;
+    default:
+        kind = 0;
+    }
+    if (kind == 0 || type.lanes != 1 || (type.bits != 1 && bytes * 8 != type.bits) ||
+        (bytes != 1 && bytes != 2 && bytes != 4 && bytes != 8)) {
+        return "";
+    }
+    const char order = bytes == 1 ? '|' : (host_is_little_endian() ? '<' : '>');
+    return std::string(1, order) + kind + std::to_string(bytes);
+}
+
+// The inverse of npy_descr. Returns false for dtypes we can't represent.
+inline bool npy_type(const std::string &descr, halide_type_t *type) {
+    if (descr.size() != 3 || descr[2] < '1' || descr[2] > '8') {
+        return false;
+    }
+    const int bytes = descr[2] - '0';
+    const char order = descr[0];
+    if (bytes > 1 && order != '=' && order != (host_is_little_endian() ? '<' : '>')) {
+        return false;
+    }
+    switch (descr[1]) {
+    case 'b':
+        *type = halide_type_t(halide_type_uint, 1);
+        return bytes == 1;
+    case 'i':
+        *type = halide_type_t(halide_type_int, bytes * 8);
+        break;
+    case 'u':
+        *type = halide_type_t(halide_type_uint, bytes * 8);
+        break;
+    case 'f':
+        *type = halide_type_t(halide_type_float, bytes * 8);
+        if (bytes == 1) {
+            return false;
+        }
+        break;
+    default:
+        return false;
+    }
+    return bytes == 1 || bytes == 2 || bytes == 4 || bytes == 8;
+}
+
+// Find the text following "'key':" in a .npy header, or return nullptr.
+inline const char *npy_header_value(const std::string &header, const char *key) {
+    size_t pos = header.find("'" + std::string(key) + "'");
+    if (pos == std::string::npos) {
+        return nullptr;
+    }
+    pos = header.find(':', pos);
+    if (pos == std::string::npos) {
+        return nullptr;
+    }
+    const char *value = header.c_str() + pos + 1;
+    while (*value == ' ') {
+        value++;
+    }
+    return value;
+}
+
+// Read the header of a .npy file, leaving f at the start of the payload,
+// which is payload_offset bytes into the file. The extents are in Halide
+// dimension order, so the last numpy axis is dimension 0, whatever the
+// order of the payload.
+template<CheckFunc check = CheckReturn>
+bool read_npy_header(FileOpener &f, halide_type_t *type, std::vector<int> *extents,
+                     bool *fortran_order_payload, size_t *payload_offset) {
+    uint8_t magic[8];
+    if (!check(f.read_array(magic) && memcmp(magic, "\x93NUMPY", 6) == 0, "Not a .npy file")) {
+        return false;
+    }
+    const int major = magic[6];
+    if (!check(major >= 1 && major <= 3, "Unsupported .npy version")) {
+        return false;
+    }
+    const size_t length_bytes = major == 1 ? 2 : 4;
+    uint8_t length[4] = {0, 0, 0, 0};
+    if (!check(f.read_bytes(length, length_bytes), "Could not read .npy header")) {
+        return false;
+    }
+    const size_t header_length = length[0] | (length[1] << 8) | (length[2] << 16) | ((size_t)length[3] << 24);
+    std::string header(header_length, ' ');
+    if (!check(f.read_bytes(&header[0], header_length), "Could not read .npy header")) {
+        return false;
+    }
+    *payload_offset = sizeof(magic) + length_bytes + header_length;
+
+    // The header is a python dict literal, e.g.
+    // {'descr': '<f4', 'fortran_order': False, 'shape': (480, 640, 3), }
+    const char *descr = npy_header_value(header, "descr");
+    const char *fortran_order = npy_header_value(header, "fortran_order");
+    const char *shape = npy_header_value(header, "shape");
+    if (!check(descr && fortran_order && shape && *descr == '\'' && *shape == '(',
+               "Could not parse .npy header")) {
+        return false;
+    }
+    const char *descr_end = strchr(descr + 1, '\'');
+    if (!check(descr_end && npy_type(std::string(descr + 1, descr_end), type),
+               "Unsupported dtype in .npy file")) {
+        return false;
+    }
+
+    extents->clear();
+    const char *p = shape + 1;
+    while (true) {
+        while (*p == ' ' || *p == ',') {
+            p++;
+        }
+        if (*p == ')') {
+            break;
+        }
+        char *end;
+        const long long extent = strtoll(p, &end, 10);
+        if (!check(end != p && extent >= 0 && extent <= 0x7fffffff, "Could not parse .npy shape")) {
+            return false;
+        }
+        extents->push_back((int)extent);
+        p = end;
+    }
+    std::reverse(extents->begin(), extents->end());
+    *fortran_order_payload = strncmp(fortran_order, "True", 4) == 0;
+    if (!check(*fortran_order_payload || strncmp(fortran_order, "False", 5) == 0, "Could not parse .npy header")) {
+        return false;
+    }
+    return true;
+}
+
+// A Fortran-order .npy payload has the first numpy axis innermost. Such
+// payloads are wrapped with the Halide dimensions in that storage order,
+// and then permuted back with this, which reverses them.
+template<typename ImageType>
+void reverse_dimensions(ImageType *im) {
+    std::vector<int> order(im->dimensions());
+    for (int i = 0; i < im->dimensions(); i++) {
+        order[i] = im->dimensions() - 1 - i;
+    }
+    im->transpose(order);
+}
+
+template<typename ImageType, CheckFunc check = CheckReturn>
+bool load_npy(const std::string &filename, ImageType *im) {
+    static_assert(!ImageType::has_static_halide_type, "");
+
+    FileOpener f(filename, "rb");
+    if (!check(f.f != nullptr, "File could not be opened for reading")) {
+        return false;
+    }
+
+    halide_type_t type;
+    std::vector<int> extents;
+    bool fortran_order;
+    size_t payload_offset;
+    if (!read_npy_header<check>(f, &type, &extents, &fortran_order, &payload_offset)) {
+        return false;
+    }
+
+    if (fortran_order) {
+        std::reverse(extents.begin(), extents.end());
+    }
+    *im = ImageType(type, extents);
+
+    // This should never fail unless the default Buffer<> constructor behavior changes.
+    if (!check(buffer_is_compact_planar(*im), "load_npy() requires compact planar images")) {
+        return false;
+    }
+
+    if (!check(f.read_bytes(im->begin(), im->size_in_bytes()), "Could not read .npy payload")) {
+        return false;
+    }
+
+    if (fortran_order) {
+        reverse_dimensions(im);
+    }
+    im->set_host_dirty();
+    return true;
+}
+
+inline const std::set<FormatInfo> &query_npy() {
+    // Our support arbitrarily stops at 16 dimensions.
+    static std::set<FormatInfo> info = []() {
+        std::set<FormatInfo> s;
+        for (int i = 0; i < 16; i++) {
+            s.insert({halide_type_t(halide_type_uint, 1), i});
+            for (int bits : {8, 16, 32, 64}) {
+                s.insert({halide_type_t(halide_type_int, bits), i});
+                s.insert({halide_type_t(halide_type_uint, bits), i});
+                if (bits > 8) {
+                    s.insert({halide_type_t(halide_type_float, bits), i});
+                }
+            }
+        }
+        return s;
+    }();
+    return info;
+}
+
+template<typename ImageType, CheckFunc check = CheckReturn>
+bool save_npy(ImageType &im, const std::string &filename) {
+    static_assert(!ImageType::has_static_halide_type, "");
+
+    if (!check(im.copy_to_host() == halide_error_code_success, "copy_to_host() failed.")) {
+        return false;
+    }
+
+    const std::string descr = npy_descr(im.type());
+    if (!check(!descr.empty(), "Unsupported type for .npy file")) {
+        return false;
+    }
+
+    std::string header = "{'descr': '" + descr + "', 'fortran_order': False, 'shape': (";
+    for (int d = im.dimensions() - 1; d >= 0; d--) {
+        header += std::to_string(im.dim(d).extent());
+        if (d > 0) {
+            header += ", ";
+        } else if (im.dimensions() == 1) {
+            header += ",";
+        }
+    }
+    header += "), }";
+
+    // Pad the header with spaces and a newline so that the payload is
+    // 64-byte aligned, which lets load_mapped() use it in place.
+    const int major = header.size() + 11 > 0xffff ? 2 : 1;
+    const size_t preamble_size = major == 1 ? 10 : 12;
+    const size_t padded_size = (preamble_size + header.size() + 1 + 63) / 64 * 64;
+    header.resize(padded_size - preamble_size - 1, ' ');
+    header += '\n';
+
+    const size_t header_length = header.size();
+    uint8_t preamble[12] = {0x93, 'N', 'U', 'M', 'P', 'Y', (uint8_t)major, 0,
+                            (uint8_t)header_length, (uint8_t)(header_length >> 8),
+                            (uint8_t)(header_length >> 16), (uint8_t)(header_length >> 24)};
+
+    FileOpener f(filename, "wb");
+    if (!check(f.f != nullptr, "File could not be opened for writing")) {
+        return false;
+    }
+
+    if (!check(f.write_bytes(preamble, preamble_size) && f.write_bytes(header.data(), header.size()),
+               "Could not write .npy header")) {
+        return false;
+    }
+
+    return write_planar_payload<ImageType, check>(im, f);
+}
+
+#ifndef _WIN32
+struct MappedFile {
+    void *addr;
+    size_t length;
+};
+
+inline void unmap_file(void *context) {
+    MappedFile *m = (MappedFile *)context;
+    munmap(m->addr, m->length);
+    delete m;
+}
+
+// Map a .npy file into memory and wrap its payload in place. The mapping
+// is private, so the image can be written to without touching the file.
+template<typename ImageType, CheckFunc check = CheckReturn>
+bool load_npy_mapped(const std::string &filename, ImageType *im) {
+    static_assert(!ImageType::has_static_halide_type, "");
+
+    halide_type_t type;
+    std::vector<int> extents;
+    bool fortran_order;
+    size_t payload_offset;
+    {
+        FileOpener f(filename, "rb");
+        if (!check(f.f != nullptr, "File could not be opened for reading")) {
+            return false;
+        }
+        if (!read_npy_header<check>(f, &type, &extents, &fortran_order, &payload_offset)) {
+            return false;
+        }
+    }
+
+    // Elements that aren't aligned in the file have to be copied out.
+    const size_t elem_size = (type.bits + 7) / 8;
+    if (payload_offset % elem_size != 0) {
+        return load_npy<ImageType, check>(filename, im);
+    }
+
+    size_t payload_bytes = elem_size;
+    for (int e : extents) {
+        payload_bytes *= e;
+    }
+
+    int fd = open(filename.c_str(), O_RDONLY);
+    if (!check(fd >= 0, "File could not be opened for reading")) {
+        return false;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0 || (size_t)st.st_size < payload_offset + payload_bytes) {
+        close(fd);
+        return check(false, "Could not read .npy payload");
+    }
+    const size_t length = (size_t)st.st_size;
+    void *addr = mmap(nullptr, length, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (!check(addr != MAP_FAILED, "Could not map .npy file")) {
+        return false;
+    }
+
+    if (fortran_order) {
+        std::reverse(extents.begin(), extents.end());
+    }
+    *im = ImageType(type, (uint8_t *)addr + payload_offset, extents);
+    im->take_host_ownership(unmap_file, new MappedFile{addr, length});
+    if (fortran_order) {
+        reverse_dimensions(im);
+    }
+    im->set_host_dirty();
+    return true;
+}
+#endif
+
 template<typename ImageType, Internal::CheckFunc check = Internal::CheckReturn>
 bool load_tiff(const std::string &filename, ImageType *im) {
     static_assert(!ImageType::has_static_halide_type, "");
@@ -1762,10 +2261,12 @@ struct halide_tiff_header {
 
 #pragma pack(pop)
 
-template<typename ElemType, int BUFFER_SIZE = 1024>
+// Gathers elements into a staging buffer large enough that writing them
+// out costs few calls to fwrite().
+template<typename ElemType, int BUFFER_SIZE = 64 * 1024>
 struct ElemWriter {
     ElemWriter(FileOpener *f)
-        : f(f), next(&buf[0]) {
+        : f(f), buf(new ElemType[BUFFER_SIZE]), next(&buf[0]) {
     }
     ~ElemWriter() {
         flush();
@@ -1787,16 +2288,16 @@ struct ElemWriter {
             return;
         }
 
-        if (next > buf) {
-            if (!f->write_bytes(buf, (next - buf) * sizeof(ElemType))) {
+        if (next > &buf[0]) {
+            if (!f->write_bytes(&buf[0], (next - &buf[0]) * sizeof(ElemType))) {
                 ok = false;
             }
-            next = buf;
+            next = &buf[0];
         }
     }
 
     FileOpener *const f;
-    ElemType buf[BUFFER_SIZE];
+    std::unique_ptr<ElemType[]> buf;
     ElemType *next;
     bool ok = true;
 };
@@ -2007,6 +2508,7 @@ bool find_imageio(const std::string &filename, ImageIO<ImageType, check> *result
         {"ppm", {load_ppm<ImageType, check>, save_ppm<ConstImageType, check>, query_ppm}},
         {"tmp", {load_tmp<ImageType, check>, save_tmp<ConstImageType, check>, query_tmp}},
         {"mat", {load_mat<ImageType, check>, save_mat<ConstImageType, check>, query_mat}},
+        {"npy", {load_npy<ImageType, check>, save_npy<ConstImageType, check>, query_npy}},
         {"tiff", {load_tiff<ImageType, check>, save_tiff<ConstImageType, check>, query_tiff}},
     };
     std::string ext = Internal::get_lowercase_extension(filename);
@@ -2052,6 +2554,224 @@ FormatInfo best_save_format(const ImageType &im, const std::set<FormatInfo> &inf
     return best;
 }
 
+// The layout of a ".chunked" file: a header, padded to a page, followed by
+// the chunks in order with dimension 0 varying fastest. Each chunk is
+// stored whole and dense, again with dimension 0 innermost. Header fields
+// are int32s in the host's byte order.
+struct ChunkedLayout {
+    ChunkedFileInfo info;
+    int64_t elem_size = 0;
+    int64_t chunk_elems = 1;
+    int64_t data_offset = 0;
+    std::vector<int64_t> chunks;
+
+    static constexpr char magic[8] = {'H', 'L', 'C', 'H', 'N', 'K', '0', '1'};
+
+    static int64_t header_size(int dims) {
+        return (int64_t)(sizeof(magic) + (4 + 3 * dims) * sizeof(int32_t));
+    }
+
+    bool init(const ChunkedFileInfo &i) {
+        info = i;
+        const size_t dims = info.extent.size();
+        if (info.min.size() != dims || info.chunk_extent.size() != dims || info.type.lanes != 1) {
+            return false;
+        }
+        elem_size = (info.type.bits + 7) / 8;
+        chunk_elems = 1;
+        chunks.resize(dims);
+        for (size_t d = 0; d < dims; d++) {
+            if (info.extent[d] <= 0 || info.chunk_extent[d] <= 0) {
+                return false;
+            }
+            chunks[d] = (info.extent[d] + info.chunk_extent[d] - 1) / info.chunk_extent[d];
+            chunk_elems *= info.chunk_extent[d];
+        }
+        data_offset = (header_size((int)dims) + 4095) / 4096 * 4096;
+        return true;
+    }
+
+    int64_t file_size() const {
+        int64_t num_chunks = 1;
+        for (int64_t c : chunks) {
+            num_chunks *= c;
+        }
+        return data_offset + num_chunks * chunk_elems * elem_size;
+    }
+
+    // The position in the file of the element at the given coordinates.
+    int64_t offset_of(const std::vector<int> &pos) const {
+        int64_t chunk_index = 0, within = 0;
+        for (int d = (int)pos.size() - 1; d >= 0; d--) {
+            const int64_t rel = pos[d] - info.min[d];
+            chunk_index = chunk_index * chunks[d] + rel / info.chunk_extent[d];
+            within = within * info.chunk_extent[d] + rel % info.chunk_extent[d];
+        }
+        return data_offset + (chunk_index * chunk_elems + within) * elem_size;
+    }
+};
+
+inline bool seek_file(FILE *f, int64_t offset) {
+#ifdef _WIN32
+    return _fseeki64(f, offset, SEEK_SET) == 0;
+#else
+    return fseeko(f, (off_t)offset, SEEK_SET) == 0;
+#endif
+}
+
+template<CheckFunc check = CheckReturn>
+bool read_chunked_header(FileOpener &f, ChunkedLayout *layout) {
+    char magic[8];
+    int32_t fields[4];
+    if (!check(f.read_array(magic) && memcmp(magic, ChunkedLayout::magic, sizeof(magic)) == 0,
+               "Not a .chunked file")) {
+        return false;
+    }
+    if (!check(f.read_array(fields) && fields[3] >= 0 && fields[3] <= 64, "Could not read .chunked header")) {
+        return false;
+    }
+    ChunkedFileInfo info;
+    info.type = halide_type_t((halide_type_code_t)fields[0], fields[1], fields[2]);
+    std::vector<int32_t> shape(fields[3] * 3);
+    if (!check(f.read_vector(&shape), "Could not read .chunked header")) {
+        return false;
+    }
+    for (int d = 0; d < fields[3]; d++) {
+        info.min.push_back(shape[d * 3]);
+        info.extent.push_back(shape[d * 3 + 1]);
+        info.chunk_extent.push_back(shape[d * 3 + 2]);
+    }
+    return check(layout->init(info), "Could not parse .chunked header");
+}
+
+// Copy a region of a buffer to or from a .chunked file. Each chunk the
+// region overlaps is transferred in runs that are contiguous both in the
+// file and in memory, so a region aligned to whole chunks of a dense
+// buffer moves one chunk per call to fread() or fwrite().
+template<CheckFunc check = CheckReturn>
+bool transfer_chunked_region(const std::string &filename, halide_buffer_t *region, bool write) {
+    FileOpener f(filename, write ? "r+b" : "rb");
+    if (!check(f.f != nullptr, "File could not be opened")) {
+        return false;
+    }
+    ChunkedLayout layout;
+    if (!read_chunked_header<check>(f, &layout)) {
+        return false;
+    }
+    const ChunkedFileInfo &info = layout.info;
+    const int dims = region->dimensions;
+    if (!check(region->type == info.type && dims == (int)info.extent.size(),
+               "Region does not match the type and dimensionality of the .chunked file")) {
+        return false;
+    }
+    for (int d = 0; d < dims; d++) {
+        const halide_dimension_t &dim = region->dim[d];
+        if (!check(dim.min >= info.min[d] && dim.min + dim.extent <= info.min[d] + info.extent[d],
+                   "Region is outside the bounds of the .chunked file")) {
+            return false;
+        }
+        if (dim.extent <= 0) {
+            return true;
+        }
+    }
+
+    // The range of chunks the region overlaps in each dimension.
+    std::vector<int> chunk_lo(dims), chunk_hi(dims), chunk(dims);
+    for (int d = 0; d < dims; d++) {
+        const halide_dimension_t &dim = region->dim[d];
+        chunk_lo[d] = (dim.min - info.min[d]) / info.chunk_extent[d];
+        chunk_hi[d] = (dim.min + dim.extent - 1 - info.min[d]) / info.chunk_extent[d];
+        chunk[d] = chunk_lo[d];
+    }
+
+    const int64_t elem_size = layout.elem_size;
+    std::vector<uint8_t> staging;
+    std::vector<int> lo(dims), hi(dims), pos(dims);
+    int64_t file_pos = -1;
+    while (true) {
+        // The part of this chunk that is in the region.
+        for (int d = 0; d < dims; d++) {
+            const halide_dimension_t &dim = region->dim[d];
+            const int chunk_min = info.min[d] + chunk[d] * info.chunk_extent[d];
+            lo[d] = std::max(dim.min, chunk_min);
+            hi[d] = std::min(dim.min + dim.extent, chunk_min + info.chunk_extent[d]) - 1;
+            pos[d] = lo[d];
+        }
+
+        // Merge leading dimensions into one run for as long as the
+        // intersection spans the whole chunk and memory is contiguous.
+        int merged = dims > 0 ? 1 : 0;
+        int64_t run = dims > 0 ? hi[0] - lo[0] + 1 : 1;
+        const bool dense = dims == 0 || region->dim[0].stride == 1;
+        if (dense) {
+            while (merged < dims &&
+                   hi[merged - 1] - lo[merged - 1] + 1 == info.chunk_extent[merged - 1] &&
+                   region->dim[merged].stride == run) {
+                run *= hi[merged] - lo[merged] + 1;
+                merged++;
+            }
+        } else {
+            staging.resize(run * elem_size);
+        }
+
+        while (true) {
+            const int64_t offset = layout.offset_of(pos);
+            int64_t index = 0;
+            for (int d = 0; d < dims; d++) {
+                index += (int64_t)(pos[d] - region->dim[d].min) * region->dim[d].stride;
+            }
+            uint8_t *mem = region->host + index * elem_size;
+            const size_t bytes = run * elem_size;
+            if (offset != file_pos && !check(seek_file(f.f, offset), "Could not seek in .chunked file")) {
+                return false;
+            }
+            if (write) {
+                if (!dense) {
+                    for (int64_t i = 0; i < run; i++) {
+                        memcpy(&staging[i * elem_size], mem + i * region->dim[0].stride * elem_size, elem_size);
+                    }
+                }
+                if (!check(f.write_bytes(dense ? mem : staging.data(), bytes), "Could not write .chunked file")) {
+                    return false;
+                }
+            } else {
+                if (!check(f.read_bytes(dense ? mem : staging.data(), bytes), "Could not read .chunked file")) {
+                    return false;
+                }
+                if (!dense) {
+                    for (int64_t i = 0; i < run; i++) {
+                        memcpy(mem + i * region->dim[0].stride * elem_size, &staging[i * elem_size], elem_size);
+                    }
+                }
+            }
+            file_pos = offset + bytes;
+
+            // Advance to the next run within this chunk.
+            int d = merged;
+            while (d < dims && pos[d] == hi[d]) {
+                pos[d] = lo[d];
+                d++;
+            }
+            if (d >= dims) {
+                break;
+            }
+            pos[d]++;
+        }
+
+        // Advance to the next chunk.
+        int d = 0;
+        while (d < dims && chunk[d] == chunk_hi[d]) {
+            chunk[d] = chunk_lo[d];
+            d++;
+        }
+        if (d >= dims) {
+            break;
+        }
+        chunk[d]++;
+    }
+    return true;
+}
+
 }  // namespace Internal
 
 struct ImageTypeConversion {
@@ -2259,6 +2979,58 @@ bool load(const std::string &filename, ImageType *im) {
     return true;
 }
 
+// Set how many threads (including the calling one) load() and save() may use
+// to convert the rows of a single PNG or PNM image. Zero means one per core.
+// The default is 1, i.e. no threads are started.
+inline void set_image_io_num_threads(int num_threads) {
+    Internal::row_num_threads() = num_threads;
+}
+
+// Load a batch of Images, decoding up to num_threads files at once (or one
+// per core, if num_threads is zero). By default they are decoded one at a
+// time. The Images are returned in the same order as the filenames.
+// Returns false if any of the files failed to load.
+template<typename ImageType, Internal::CheckFunc check = Internal::CheckReturn>
+bool load_batch(const std::vector<std::string> &filenames, std::vector<ImageType> *images, int num_threads = 1) {
+    images->clear();
+    images->resize(filenames.size());
+    std::atomic<bool> ok{true};
+    Internal::parallel_for((int)filenames.size(), num_threads, [&](int i) {
+        if (!load<ImageType, check>(filenames[i], &(*images)[i])) {
+            ok = false;
+        }
+    });
+    return ok;
+}
+
+// Load the Image from the given file without copying it, where the format
+// allows: a .npy file is mapped into memory and used in place, so pages of
+// it are only read as they are touched, and it is unmapped along with the
+// last Image that refers to it. Writes to the Image do not reach the file.
+// Other formats, and platforms without mmap, fall back to load().
+// Returns false upon failure.
+template<typename ImageType, Internal::CheckFunc check = Internal::CheckReturn>
+bool load_mapped(const std::string &filename, ImageType *im) {
+#ifndef _WIN32
+    if (Internal::get_lowercase_extension(filename) == "npy") {
+        using DynamicImageType = typename Internal::ImageTypeWithElemType<ImageType, void>::type;
+        DynamicImageType im_d;
+        if (!Internal::load_npy_mapped<DynamicImageType, check>(filename, &im_d)) {
+            return false;
+        }
+        if (ImageType::has_static_halide_type) {
+            const halide_type_t expected_type = ImageType::static_halide_type();
+            if (!check(im_d.type() == expected_type, "Image loaded did not match the expected type")) {
+                return false;
+            }
+        }
+        *im = im_d.template as<typename ImageType::ElemType, Internal::AnyDims>();
+        return true;
+    }
+#endif
+    return load<ImageType, check>(filename, im);
+}
+
 // Save the Image in the format associated with the filename's extension.
 // If the format can't represent the Image without losing data, fail.
 // Returns false upon failure.
@@ -2293,6 +3065,86 @@ bool save_query(const std::string &filename, std::set<FormatInfo> *info) {
     return true;
 }
 
+// Create a .chunked file with the given type, shape and chunk size. The
+// file is created at its full size with every element zero; on most
+// filesystems it takes no space until regions are saved into it.
+// Returns false upon failure.
+template<Internal::CheckFunc check = Internal::CheckReturn>
+bool create_chunked(const std::string &filename, const ChunkedFileInfo &info) {
+    Internal::ChunkedLayout layout;
+    if (!check(layout.init(info), "Invalid shape for .chunked file")) {
+        return false;
+    }
+
+    Internal::FileOpener f(filename, "wb");
+    if (!check(f.f != nullptr, "File could not be opened for writing")) {
+        return false;
+    }
+    const int dims = (int)info.extent.size();
+    int32_t fields[4] = {info.type.code, info.type.bits, info.type.lanes, dims};
+    std::vector<int32_t> shape;
+    for (int d = 0; d < dims; d++) {
+        shape.push_back(info.min[d]);
+        shape.push_back(info.extent[d]);
+        shape.push_back(info.chunk_extent[d]);
+    }
+    const uint8_t zero = 0;
+    bool success =
+        f.write_array(Internal::ChunkedLayout::magic) &&
+        f.write_array(fields) &&
+        f.write_vector(shape) &&
+        Internal::seek_file(f.f, layout.file_size() - 1) &&
+        f.write_bytes(&zero, 1);
+    return check(success, "Could not write .chunked file");
+}
+
+// Read the type, shape and chunk size of a .chunked file.
+// Returns false upon failure.
+template<Internal::CheckFunc check = Internal::CheckReturn>
+bool query_chunked(const std::string &filename, ChunkedFileInfo *info) {
+    Internal::FileOpener f(filename, "rb");
+    if (!check(f.f != nullptr, "File could not be opened for reading")) {
+        return false;
+    }
+    Internal::ChunkedLayout layout;
+    if (!Internal::read_chunked_header<check>(f, &layout)) {
+        return false;
+    }
+    *info = layout.info;
+    return true;
+}
+
+// Fill in the region of a .chunked file covered by the Image, which must
+// have the file's type and dimensionality. The Image is allocated if it
+// has no host memory. Only the chunks that overlap the region are read,
+// and several regions may be loaded and saved from different threads at
+// once, so this can serve directly as a Pipeline::realize_tiled() reader:
+//
+//    [](Buffer<> &tile) { return load_chunked_region("in.chunked", &tile) ? 0 : -1; }
+//
+// Returns false upon failure.
+template<typename ImageType, Internal::CheckFunc check = Internal::CheckReturn>
+bool load_chunked_region(const std::string &filename, ImageType *region) {
+    if (region->data() == nullptr) {
+        region->allocate();
+    }
+    if (!Internal::transfer_chunked_region<check>(filename, region->raw_buffer(), false)) {
+        return false;
+    }
+    region->set_host_dirty();
+    return true;
+}
+
+// Write the Image into the region of a .chunked file that it covers.
+// Returns false upon failure.
+template<typename ImageType, Internal::CheckFunc check = Internal::CheckReturn>
+bool save_chunked_region(ImageType &region, const std::string &filename) {
+    if (!check(region.copy_to_host() == halide_error_code_success, "copy_to_host() failed.")) {
+        return false;
+    }
+    return Internal::transfer_chunked_region<check>(filename, region.raw_buffer(), true);
+}
+
 // Fancy wrapper to call load() with CheckFail, inferring the return type;
 // this allows you to simply use
 //